@@ -1,473 +1,1543 @@
-/*****************************************************
- * PONTIFICIA UNIVERSIDAD JAVERIANA
- *
- * Materia: Sistemas Operativos
- * Docente: J. Corredor, PhD
- * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
- * Programa: agente.c
- * Fecha: 17 de noviembre de 2025
- * Tema: Agente del Sistema de Reservas
- * -----------------------------------------------
- * Descripción:
- * Este programa implementa el cliente del sistema de
- * reservas. Cada agente se ejecuta como un proceso
- * independiente que lee solicitudes de reserva desde
- * un archivo de texto y las envía al controlador
- * a través de un named pipe (FIFO) principal.
- * Para recibir respuestas, cada agente crea su propio
- * pipe nominal y utiliza una técnica de "doble open"
- * para evitar deadlocks durante la conexión inicial,
- * asegurando una comunicación robusta y sincronizada
- * con el servidor.
- *****************************************************/
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <errno.h>
-
-/* ============================================================================
- * CONSTANTES Y DEFINICIONES
- * ============================================================================ */
-#define MAX_BUFFER 1024
-#define MAX_NOMBRE 128  // Para nombres de familias y agentes
-#define MAX_PIPE_NAME 256  // Buffer más grande para nombres de pipes
-#define MAX_LINEA 256
-#define TIEMPO_ESPERA 2  // Segundos de espera entre solicitudes
-
-/* Tipos de mensaje entre agente y controlador */
-typedef enum {
-    MSG_REGISTRO,
-    MSG_SOLICITUD_RESERVA,
-    MSG_FIN_AGENTE
-} TipoMensaje;
-
-/* Tipos de respuesta del controlador */
-typedef enum {
-    RESP_HORA_ACTUAL,
-    RESP_RESERVA_OK,
-    RESP_RESERVA_REPROG,
-    RESP_RESERVA_NEGADA,
-    RESP_FIN_DIA
-} TipoRespuesta;
-
-/* Estructura para mensajes del agente al controlador */
-typedef struct {
-    TipoMensaje tipo;
-    char nombreAgente[MAX_NOMBRE];
-    char pipeRespuesta[MAX_NOMBRE];
-    char nombreFamilia[MAX_NOMBRE];
-    int horaSolicitada;
-    int numPersonas;
-} MensajeAgente;
-
-/* Estructura para respuestas del controlador al agente */
-typedef struct {
-    TipoRespuesta tipo;
-    int horaAsignada;
-    int horaActual;
-    char mensaje[MAX_BUFFER];
-} RespuestaControlador;
-
-/* ============================================================================
- * VARIABLES GLOBALES
- * ============================================================================ */
-char nombreAgente[MAX_NOMBRE];
-char archivoSolicitudes[MAX_NOMBRE];
-char pipeControlador[MAX_NOMBRE];
-char pipeRespuesta[MAX_PIPE_NAME];  // Buffer más grande para el nombre del pipe
-int horaActualSimulacion = -1;
-
-/* ============================================================================
- * PROTOTIPOS DE FUNCIONES
- * ============================================================================ */
-void procesarArgumentos(int argc, char *argv[]);
-int registrarseConControlador();
-void procesarSolicitudes();
-void enviarMensaje(MensajeAgente *msg);
-int recibirRespuesta(RespuestaControlador *resp);
-void imprimirRespuesta(RespuestaControlador *resp, char *nombreFamilia);
-void limpiarRecursos();
-void parsearLineaCSV(char *linea, char *familia, int *hora, int *personas);
-
-/* ============================================================================
- * FUNCIÓN PRINCIPAL
- * ============================================================================ */
-int main(int argc, char *argv[]) {
-    printf("\n");
-    printf("╔════════════════════════════════════════════════════════════╗\n");
-    printf("║  AGENTE DE RESERVAS - PARQUE BERLÍN                        ║\n");
-    printf("╚════════════════════════════════════════════════════════════╝\n");
-    printf("\n");
-    
-    // Procesar argumentos
-    procesarArgumentos(argc, argv);
-    
-    // Crear nombre único para pipe de respuestas
-    snprintf(pipeRespuesta, MAX_PIPE_NAME, "pipe_%s_%d", nombreAgente, getpid());
-    
-    // Crear pipe para recibir respuestas
-    unlink(pipeRespuesta);
-    unlink(pipeRespuesta);
-    if (mkfifo(pipeRespuesta, 0666) == -1) {
-        if (errno != EEXIST) {
-            perror("Error al crear pipe de respuesta");
-            exit(EXIT_FAILURE);
-        }
-    }
-    
-    printf("✓ Agente '%s' iniciado\n", nombreAgente);
-    printf("✓ Archivo de solicitudes: %s\n", archivoSolicitudes);
-    printf("✓ Pipe de respuesta: %s\n\n", pipeRespuesta);
-    
-    // Registrarse con el controlador
-    if (!registrarseConControlador()) {
-        fprintf(stderr, "Error al registrarse con el controlador\n");
-        limpiarRecursos();
-        exit(EXIT_FAILURE);
-    }
-    
-    printf("✓ Registrado correctamente con el controlador\n");
-    printf("✓ Hora actual del sistema: %d:00\n\n", horaActualSimulacion);
-    
-    // Procesar solicitudes del archivo
-    procesarSolicitudes();
-    
-    // Notificar finalización al controlador
-    MensajeAgente msgFin;
-    msgFin.tipo = MSG_FIN_AGENTE;
-    strncpy(msgFin.nombreAgente, nombreAgente, MAX_NOMBRE - 1);
-    enviarMensaje(&msgFin);
-    
-    printf("\n✓ Agente %s termina.\n\n", nombreAgente);
-    
-    // Limpiar recursos
-    limpiarRecursos();
-    
-    return 0;
-}
-
-/* ============================================================================
- * PROCESAMIENTO DE ARGUMENTOS
- * ============================================================================ */
-void procesarArgumentos(int argc, char *argv[]) {
-    int opt;
-    int flagS = 0, flagA = 0, flagP = 0;
-    
-    while ((opt = getopt(argc, argv, "s:a:p:")) != -1) {
-        switch (opt) {
-            case 's':
-                strncpy(nombreAgente, optarg, MAX_NOMBRE - 1);
-                nombreAgente[MAX_NOMBRE - 1] = '\0';
-                flagS = 1;
-                break;
-            case 'a':
-                strncpy(archivoSolicitudes, optarg, MAX_NOMBRE - 1);
-                archivoSolicitudes[MAX_NOMBRE - 1] = '\0';
-                flagA = 1;
-                break;
-            case 'p':
-                strncpy(pipeControlador, optarg, MAX_NOMBRE - 1);
-                pipeControlador[MAX_NOMBRE - 1] = '\0';
-                flagP = 1;
-                break;
-            default:
-                fprintf(stderr, "Uso: %s -s <nombre> -a <fileSolicitud> -p <pipeRecibe>\n", argv[0]);
-                exit(EXIT_FAILURE);
-        }
-    }
-    
-    // Validar que todos los parámetros fueron proporcionados
-    if (!flagS || !flagA || !flagP) {
-        fprintf(stderr, "Error: Faltan parámetros obligatorios\n");
-        fprintf(stderr, "Uso: %s -s <nombre> -a <fileSolicitud> -p <pipeRecibe>\n", argv[0]);
-        exit(EXIT_FAILURE);
-    }
-}
-
-/* ============================================================================
- * REGISTRO CON EL CONTROLADOR
- * ============================================================================ */
-int registrarseConControlador() {
-    MensajeAgente msg;
-    RespuestaControlador resp;
-    
-    // Preparar mensaje de registro
-    msg.tipo = MSG_REGISTRO;
-    strncpy(msg.nombreAgente, nombreAgente, MAX_NOMBRE - 1);
-    strncpy(msg.pipeRespuesta, pipeRespuesta, MAX_NOMBRE - 1);
-    msg.horaSolicitada = 0;
-    msg.numPersonas = 0;
-    
-    // Enviar mensaje de registro
-    enviarMensaje(&msg);
-    
-    // Esperar respuesta con hora actual
-    if (!recibirRespuesta(&resp)) {
-        return 0;
-    }
-    
-    if (resp.tipo == RESP_HORA_ACTUAL) {
-        horaActualSimulacion = resp.horaActual;
-        return 1;
-    }
-    
-    return 0;
-}
-
-/* ============================================================================
- * PROCESAMIENTO DE SOLICITUDES
- * ============================================================================ */
-void procesarSolicitudes() {
-    FILE *archivo;
-    char linea[MAX_LINEA];
-    char nombreFamilia[MAX_NOMBRE];
-    int horaSolicitada;
-    int numPersonas;
-    MensajeAgente msg;
-    RespuestaControlador resp;
-    int numLinea = 0;
-    
-    // Abrir archivo de solicitudes
-    archivo = fopen(archivoSolicitudes, "r");
-    if (archivo == NULL) {
-        perror("Error al abrir archivo de solicitudes");
-        return;
-    }
-    
-    printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
-    printf("         PROCESANDO SOLICITUDES DE RESERVA\n");
-    printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n");
-    
-    // Leer y procesar cada línea del archivo
-    while (fgets(linea, sizeof(linea), archivo) != NULL) {
-        numLinea++;
-        
-        // Eliminar salto de línea
-        linea[strcspn(linea, "\n")] = 0;
-        
-        // Ignorar líneas vacías
-        if (strlen(linea) == 0) {
-            continue;
-        }
-        
-        // Parsear línea CSV
-        parsearLineaCSV(linea, nombreFamilia, &horaSolicitada, &numPersonas);
-        
-        printf("┌─────────────────────────────────────────────────────────┐\n");
-        printf("│ Solicitud #%d                                            │\n", numLinea);
-        printf("├─────────────────────────────────────────────────────────┤\n");
-        printf("│ Familia: %-47s│\n", nombreFamilia);
-        printf("│ Hora solicitada: %d:00                                   │\n", horaSolicitada);
-        printf("│ Personas: %-3d                                           │\n", numPersonas);
-        printf("└─────────────────────────────────────────────────────────┘\n");
-        
-        // Validar que la hora no sea anterior a la hora actual
-        if (horaSolicitada < horaActualSimulacion) {
-            printf("⚠  ADVERTENCIA: Hora solicitada (%d:00) es anterior a la hora actual (%d:00)\n", 
-                   horaSolicitada, horaActualSimulacion);
-            printf("   El controlador intentará reprogramar la reserva.\n\n");
-        }
-        
-        // Preparar mensaje de solicitud
-        msg.tipo = MSG_SOLICITUD_RESERVA;
-        strncpy(msg.nombreAgente, nombreAgente, MAX_NOMBRE - 1);
-        strncpy(msg.pipeRespuesta, pipeRespuesta, MAX_NOMBRE - 1);
-        strncpy(msg.nombreFamilia, nombreFamilia, MAX_NOMBRE - 1);
-        msg.horaSolicitada = horaSolicitada;
-        msg.numPersonas = numPersonas;
-        
-        // Enviar solicitud
-        enviarMensaje(&msg);
-        
-        // Esperar respuesta
-        if (recibirRespuesta(&resp)) {
-            imprimirRespuesta(&resp, nombreFamilia);
-        } else {
-            printf("✗ Error al recibir respuesta del controlador\n\n");
-        }
-        
-        // Esperar antes de enviar la siguiente solicitud
-        sleep(TIEMPO_ESPERA);
-    }
-    
-    fclose(archivo);
-    
-    printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
-    printf("         FIN DE SOLICITUDES\n");
-    printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
-}
-
-/* ============================================================================
- * ENVÍO DE MENSAJES AL CONTROLADOR
- * ============================================================================ */
-void enviarMensaje(MensajeAgente *msg) {
-    int fdPipeControlador;
-    int intentos = 0;
-    int maxIntentos = 5;
-    
-    // Abrir pipe del controlador (con reintentos)
-    while (intentos < maxIntentos) {
-        fdPipeControlador = open(pipeControlador, O_WRONLY);
-        if (fdPipeControlador != -1) {
-            break;
-        }
-        
-        if (errno == ENXIO) {
-            // El controlador aún no ha abierto el pipe
-            sleep(1);
-            intentos++;
-        } else {
-            perror("Error al abrir pipe del controlador");
-            exit(EXIT_FAILURE);
-        }
-    }
-    
-    if (fdPipeControlador == -1) {
-        fprintf(stderr, "Error: No se pudo conectar con el controlador después de %d intentos\n", maxIntentos);
-        exit(EXIT_FAILURE);
-    }
-    
-    // Escribir mensaje
-    if (write(fdPipeControlador, msg, sizeof(MensajeAgente)) == -1) {
-        perror("Error al enviar mensaje al controlador");
-        close(fdPipeControlador);
-        exit(EXIT_FAILURE);
-    }
-    
-    close(fdPipeControlador);
-}
-
-/* ============================================================================
- * RECEPCIÓN DE RESPUESTAS DEL CONTROLADOR
- * ============================================================================ */
-int recibirRespuesta(RespuestaControlador *resp) {
-    int fdPipeRespuesta;
-    ssize_t bytesLeidos;
-    
-    // Abrir pipe de respuesta
-    fdPipeRespuesta = open(pipeRespuesta, O_RDONLY);
-    if (fdPipeRespuesta == -1) {
-        perror("Error al abrir pipe de respuesta");
-        return 0;
-    }
-    
-    // Leer respuesta
-    bytesLeidos = read(fdPipeRespuesta, resp, sizeof(RespuestaControlador));
-    
-    close(fdPipeRespuesta);
-    
-    if (bytesLeidos != sizeof(RespuestaControlador)) {
-        fprintf(stderr, "Error: Respuesta incompleta del controlador\n");
-        return 0;
-    }
-    
-    return 1;
-}
-
-/* ============================================================================
- * IMPRESIÓN DE RESPUESTAS
- * ============================================================================ */
-void imprimirRespuesta(RespuestaControlador *resp, char *nombreFamilia) {
-    printf("\n╭─────────────────────────────────────────────────────────╮\n");
-    printf("│ 📨 RESPUESTA DEL CONTROLADOR                            │\n");
-    printf("├─────────────────────────────────────────────────────────┤\n");
-    
-    switch (resp->tipo) {
-        case RESP_HORA_ACTUAL:
-            printf("│ Tipo: Hora Actual                                       │\n");
-            printf("│ Hora: %d:00                                              │\n", resp->horaActual);
-            break;
-            
-        case RESP_RESERVA_OK:
-            printf("│ Estado: ✓ RESERVA APROBADA                              │\n");
-            printf("│ Familia: %-47s│\n", nombreFamilia);
-            printf("│ Hora asignada: %d:00 - %d:00                             │\n", 
-                   resp->horaAsignada, resp->horaAsignada + 2);
-            printf("│ %s │\n", resp->mensaje);
-            break;
-            
-        case RESP_RESERVA_REPROG:
-            printf("│ Estado: ⚠ RESERVA REPROGRAMADA                          │\n");
-            printf("│ Familia: %-47s│\n", nombreFamilia);
-            printf("│ Nueva hora: %d:00 - %d:00                                │\n", 
-                   resp->horaAsignada, resp->horaAsignada + 2);
-            printf("│ Motivo: La hora solicitada no estaba disponible        │\n");
-            break;
-            
-        case RESP_RESERVA_NEGADA:
-            printf("│ Estado: ✗ RESERVA NEGADA                                │\n");
-            printf("│ Familia: %-47s│\n", nombreFamilia);
-            printf("│ Motivo:                                                 │\n");
-            
-            // Dividir mensaje en líneas si es muy largo
-            char *token = strtok(resp->mensaje, ".");
-            while (token != NULL) {
-                printf("│   %s│\n", token);
-                token = strtok(NULL, ".");
-            }
-            break;
-            
-        case RESP_FIN_DIA:
-            printf("│ Estado: Fin del día de operaciones                     │\n");
-            break;
-            
-        default:
-            printf("│ Estado: Respuesta desconocida                           │\n");
-            break;
-    }
-    
-    printf("╰─────────────────────────────────────────────────────────╯\n\n");
-}
-
-/* ============================================================================
- * PARSEO DE LÍNEA CSV
- * ============================================================================ */
-void parsearLineaCSV(char *linea, char *familia, int *hora, int *personas) {
-    char *token;
-    char lineaCopia[MAX_LINEA];
-    
-    // Hacer copia de la línea para no modificar la original
-    strncpy(lineaCopia, linea, MAX_LINEA - 1);
-    lineaCopia[MAX_LINEA - 1] = '\0';
-    
-    // Parsear familia
-    token = strtok(lineaCopia, ",");
-    if (token != NULL) {
-        strncpy(familia, token, MAX_NOMBRE - 1);
-        familia[MAX_NOMBRE - 1] = '\0';
-        
-        // Eliminar espacios al inicio y al final
-        while (*familia == ' ') familia++;
-    } else {
-        familia[0] = '\0';
-    }
-    
-    // Parsear hora
-    token = strtok(NULL, ",");
-    if (token != NULL) {
-        *hora = atoi(token);
-    } else {
-        *hora = 0;
-    }
-    
-    // Parsear número de personas
-    token = strtok(NULL, ",");
-    if (token != NULL) {
-        *personas = atoi(token);
-    } else {
-        *personas = 0;
-    }
-}
-
-/* ============================================================================
- * LIMPIEZA DE RECURSOS
- * ============================================================================ */
-void limpiarRecursos() {
-    // Eliminar pipe de respuesta
-    unlink(pipeRespuesta);
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: agente.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Agente del Sistema de Reservas
+ * -----------------------------------------------
+ * Descripción:
+ * Este programa implementa el cliente del sistema de
+ * reservas. Cada agente se ejecuta como un proceso
+ * independiente que lee solicitudes de reserva desde
+ * un archivo de texto y las envía al controlador
+ * a través de un named pipe (FIFO) principal.
+ * Para recibir respuestas, cada agente crea su propio
+ * pipe nominal y utiliza una técnica de "doble open"
+ * para evitar deadlocks durante la conexión inicial,
+ * asegurando una comunicación robusta y sincronizada
+ * con el servidor.
+ * Con la opción -W el agente mantiene varias
+ * solicitudes en vuelo: un hilo lector recibe las
+ * respuestas y las empareja por número de secuencia
+ * mientras el hilo principal sigue leyendo el archivo.
+ * El ritmo de envío es configurable (-r, -x) y al
+ * terminar se informa la tasa lograda y la latencia
+ * observada, de modo que el agente sirva también como
+ * generador de carga.
+ * Con -M el agente ofrece al registrarse un segmento de
+ * memoria compartida: si el controlador lo acepta, las
+ * solicitudes y respuestas viajan por sus anillos y los
+ * pipes solo se usan para el registro; si no, la sesión
+ * sigue por los pipes.
+ * Si -p es una dirección "unix:<ruta>" o
+ * "tcp:[host:]puerto", el agente se conecta por un
+ * socket y usa esa única conexión en ambos sentidos.
+ * El archivo de solicitudes se proyecta en memoria y
+ * lo interpreta un hilo lector (csv.h) mientras el hilo
+ * principal envía.
+ * Si el controlador responde RESP_OCUPADO (su cola está
+ * llena) la solicitud se reenvía tras una espera que
+ * crece exponencialmente con variación aleatoria, igual
+ * que los intentos de conexión al arrancar.
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include "protocolo.h"
+#include "anillo.h"
+#include "red.h"
+#include "csv.h"
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define MAX_PIPE_NAME 256  // Buffer más grande para nombres de pipes
+#define TIEMPO_ESPERA 2  // Segundos entre mensajes por defecto (-r 0.5)
+#define MAX_VENTANA 64  // Máximo de solicitudes en vuelo con -W
+#define CUBETAS_RESERVAS 4096  // Cubetas de la tabla familia -> id de reserva (potencia de 2)
+#define MAX_INTENTOS_CONEXION 8  // Intentos de abrir el pipe (o conectar) del controlador
+#define MAX_REINTENTOS 8  // Reenvíos de una solicitud rechazada con RESP_OCUPADO
+#define ESPERA_BASE_MS 50  // Espera antes del primer reintento; se duplica en cada uno
+#define ESPERA_MAXIMA_MS 2000  // Tope de la espera entre reintentos
+
+/* Los tipos de mensaje y respuesta del protocolo están en protocolo.h */
+
+/* Solicitud enviada cuya respuesta aún no ha llegado */
+typedef struct {
+    int enUso;
+    uint32_t secuencia;
+    int numPersonas;
+    char nombreFamilia[MAX_NOMBRE];
+    double instanteEnvio;  // Para medir la latencia al llegar la respuesta (la del primer envío)
+    MensajeAgente mensaje;  // Para reenviarla si el controlador está ocupado
+    int reintentos;         // Veces que ya se reenvió
+    int rechazada;          // 1 si espera su reenvío (RESP_OCUPADO)
+    double reenviarEn;      // Instante programado para el reenvío
+} SolicitudEnVuelo;
+
+/* Última reserva aprobada de una familia, para cancelarla o modificarla por nombre */
+typedef struct ReservaFamilia {
+    char nombreFamilia[MAX_NOMBRE];
+    uint32_t idReserva;
+    struct ReservaFamilia *siguiente;  // Siguiente familia de la misma cubeta
+} ReservaFamilia;
+
+/* ============================================================================
+ * VARIABLES GLOBALES
+ * ============================================================================ */
+char nombreAgente[MAX_NOMBRE];
+char archivoSolicitudes[MAX_NOMBRE];
+char pipeControlador[MAX_NOMBRE];
+char pipeRespuesta[MAX_PIPE_NAME];  // Buffer más grande para el nombre del pipe
+int horaActualSimulacion = -1;  // Minutos desde la medianoche
+uint32_t idAgente = 0;  // Asignado por el controlador al registrarse
+int tamLote = 1;  // Solicitudes por trama (1 = una solicitud por mensaje)
+int tamVentana = 1;  // Solicitudes en vuelo (1 = enviar y esperar)
+double tasaEnvio = 1.0 / TIEMPO_ESPERA;  // Mensajes por segundo (0 = sin pausa)
+int llegadasPoisson = 0;  // 1: intervalos exponenciales en lugar de fijos
+
+// Transporte en memoria compartida (-M); los pipes son el respaldo
+int pedirMemoria = 0;
+char nombreSegmento[MAX_NOMBRE];  // "" si no se creó
+SegmentoMemoria *segmento = NULL;
+int usarMemoria = 0;  // 1 si el controlador aceptó el segmento
+uint8_t tramaMemoria[MAX_TRAMA];  // Última trama recibida por el anillo
+
+// Pipes (o la conexión por socket) abiertos durante toda la vida del agente
+int usarSocket = 0;  // -p es una dirección unix:/tcp: en lugar de un pipe
+int fdPipeControlador = -1;
+int fdPipeRespuesta = -1;
+int fdPipeRespuestaEscritura = -1;  // Segundo open: evita EOF antes de que escriba el controlador
+BufferTramas bufferRespuestas;
+
+// Ventana de solicitudes en vuelo (modo -W), compartida con el hilo lector
+SolicitudEnVuelo solicitudesEnVuelo[MAX_VENTANA];
+int numEnVuelo = 0;
+int numRechazadas = 0;  // Entradas en vuelo que esperan su reenvío
+uint32_t siguienteSecuencia = 1;
+int lectorTerminado = 0;  // El hilo lector dejó de recibir (error en el pipe)
+int detenerLector = 0;    // Ya no se esperan respuestas: el lector debe salir sin error
+pthread_mutex_t mutexVentana = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t ventanaLibre = PTHREAD_COND_INITIALIZER;
+
+// Serializa la salida: cada recuadro se imprime completo
+pthread_mutex_t mutexSalida = PTHREAD_MUTEX_INITIALIZER;
+
+// Reservas aprobadas por familia (el hilo lector también las actualiza)
+ReservaFamilia *reservasFamilias[CUBETAS_RESERVAS];
+pthread_mutex_t mutexReservasFamilias = PTHREAD_MUTEX_INITIALIZER;
+
+// Ritmo de envío: instante programado para el próximo mensaje
+double proximoEnvio = 0.0;
+unsigned int semillaRitmo;
+unsigned int semillaReintentos;  // Variación de las esperas entre reintentos (hilo principal)
+
+// Estadísticas de carga (el hilo lector también las actualiza)
+double *latencias = NULL;  // En segundos, una por solicitud respondida
+size_t numLatencias = 0;
+size_t capacidadLatencias = 0;
+double instantePrimerEnvio = 0.0;
+double instanteUltimaRespuesta = 0.0;
+long reintentosOcupado = 0;  // Reenvíos por RESP_OCUPADO
+pthread_mutex_t mutexEstadisticas = PTHREAD_MUTEX_INITIALIZER;
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+void procesarArgumentos(int argc, char *argv[]);
+void abrirPipeRespuesta();
+void conectarConControlador();
+int registrarseConControlador();
+void procesarSolicitudes();
+void enviarMensaje(MensajeAgente *msg);
+void enviarTrama(const uint8_t *trama, size_t longitud);
+void enviarLote(LoteSolicitudes *lote);
+int enviarYRecibir(MensajeAgente *msg, RespuestaControlador *resp, RespuestaDisponibilidad *disponibilidad,
+                   int *esConsulta);
+double retardoReintento(int intento, int esperaSugeridaMs, unsigned int *semilla);
+void esperarReintento(int intento, int esperaSugeridaMs);
+void avisarReintento(const char *nombreFamilia, int reintento, int esperaSugeridaMs);
+void enviarEnVentana(MensajeAgente *msg);
+void reenviarRechazadas();
+void enviarCambio(const SolicitudLeida *sol);
+void enviarConsulta(const SolicitudLeida *sol);
+void esperarVentanaVacia();
+void *hiloLectorRespuestas(void *arg);
+double instanteActual();
+void esperarTurno();
+void dormir(double segundos);
+void registrarLatencia(double instanteEnvio);
+void imprimirEstadisticasCarga();
+int recibirTrama(const uint8_t **trama, size_t *longitud);
+int recibirRespuesta(RespuestaControlador *resp);
+int recibirRespuestaOConsulta(RespuestaControlador *resp, RespuestaDisponibilidad *disponibilidad, int *esConsulta);
+void imprimirRespuesta(RespuestaControlador *resp, const char *nombreFamilia, int numPersonas);
+void imprimirDisponibilidad(const RespuestaDisponibilidad *disponibilidad, const char *nombreFamilia);
+void recordarReserva(const RespuestaControlador *resp, const char *nombreFamilia);
+uint32_t reservaDeFamilia(const char *nombreFamilia);
+void liberarReservasFamilias();
+void limpiarRecursos();
+
+/* ============================================================================
+ * FUNCIÓN PRINCIPAL
+ * ============================================================================ */
+int main(int argc, char *argv[]) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  AGENTE DE RESERVAS - PARQUE BERLÍN                        ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+    printf("\n");
+    
+    // Procesar argumentos
+    procesarArgumentos(argc, argv);
+    
+    // Por un socket las respuestas llegan por la misma conexión: no hay pipe propio
+    usarSocket = esDireccionSocket(pipeControlador);
+    if (!usarSocket) {
+        // Crear nombre único para pipe de respuestas
+        snprintf(pipeRespuesta, MAX_PIPE_NAME, "pipe_%s_%d", nombreAgente, getpid());
+        
+        // Crear pipe para recibir respuestas
+        unlink(pipeRespuesta);
+        unlink(pipeRespuesta);
+        if (mkfifo(pipeRespuesta, 0666) == -1) {
+            if (errno != EEXIST) {
+                perror("Error al crear pipe de respuesta");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    
+    // Un controlador caído se reporta como error de escritura, no como señal
+    signal(SIGPIPE, SIG_IGN);
+    
+    // Mantener abiertos ambos pipes (o la conexión) durante toda la sesión
+    semillaReintentos = (unsigned int)getpid() ^ (unsigned int)time(NULL);
+    if (!usarSocket) {
+        abrirPipeRespuesta();
+    }
+    conectarConControlador();
+    
+    // Segmento que se ofrecerá al controlador en el registro
+    if (pedirMemoria) {
+        snprintf(nombreSegmento, sizeof(nombreSegmento), "/reservas_%.64s_%d", nombreAgente, getpid());
+        segmento = crearSegmento(nombreSegmento);
+        if (segmento == NULL) {
+            perror("No se pudo crear la memoria compartida; se usarán los pipes");
+            nombreSegmento[0] = '\0';
+        }
+    }
+    
+    printf("✓ Agente '%s' iniciado\n", nombreAgente);
+    printf("✓ Archivo de solicitudes: %s\n", archivoSolicitudes);
+    if (usarSocket) {
+        printf("✓ Conectado por socket a %s\n\n", pipeControlador);
+    } else {
+        printf("✓ Pipe de respuesta: %s\n\n", pipeRespuesta);
+    }
+    
+    // Registrarse con el controlador
+    if (!registrarseConControlador()) {
+        fprintf(stderr, "Error al registrarse con el controlador\n");
+        limpiarRecursos();
+        exit(EXIT_FAILURE);
+    }
+    
+    printf("✓ Registrado correctamente con el controlador\n");
+    if (usarMemoria) {
+        printf("✓ Transporte: memoria compartida (%s)\n", nombreSegmento);
+    } else if (pedirMemoria) {
+        printf("⚠  El controlador no aceptó la memoria compartida; se usan los pipes\n");
+    }
+    char textoHora[MAX_TEXTO_HORA];
+    formatearHora(horaActualSimulacion, textoHora, sizeof(textoHora));
+    printf("✓ Hora actual del sistema: %s\n\n", textoHora);
+    
+    // Procesar solicitudes del archivo
+    procesarSolicitudes();
+    
+    // Notificar finalización al controlador
+    MensajeAgente msgFin;
+    memset(&msgFin, 0, sizeof(msgFin));
+    msgFin.tipo = MSG_FIN_AGENTE;
+    msgFin.idAgente = idAgente;
+    enviarMensaje(&msgFin);
+    
+    printf("\n✓ Agente %s termina.\n\n", nombreAgente);
+    
+    // Limpiar recursos
+    limpiarRecursos();
+    
+    return 0;
+}
+
+/* ============================================================================
+ * PROCESAMIENTO DE ARGUMENTOS
+ * ============================================================================ */
+void procesarArgumentos(int argc, char *argv[]) {
+    int opt;
+    int flagS = 0, flagA = 0, flagP = 0;
+    
+    while ((opt = getopt(argc, argv, "s:a:p:l:W:r:xM")) != -1) {
+        switch (opt) {
+            case 's':
+                strncpy(nombreAgente, optarg, MAX_NOMBRE - 1);
+                nombreAgente[MAX_NOMBRE - 1] = '\0';
+                flagS = 1;
+                break;
+            case 'a':
+                strncpy(archivoSolicitudes, optarg, MAX_NOMBRE - 1);
+                archivoSolicitudes[MAX_NOMBRE - 1] = '\0';
+                flagA = 1;
+                break;
+            case 'p':
+                strncpy(pipeControlador, optarg, MAX_NOMBRE - 1);
+                pipeControlador[MAX_NOMBRE - 1] = '\0';
+                flagP = 1;
+                break;
+            case 'l':
+                tamLote = atoi(optarg);
+                break;
+            case 'W':
+                tamVentana = atoi(optarg);
+                break;
+            case 'r':
+                tasaEnvio = strtod(optarg, NULL);
+                break;
+            case 'x':
+                llegadasPoisson = 1;
+                break;
+            case 'M':
+                pedirMemoria = 1;
+                break;
+            default:
+                fprintf(stderr, "Uso: %s -s <nombre> -a <fileSolicitud> -p <pipeRecibe|unix:ruta|tcp:host:puerto> [-l <tamLote>] [-W <ventana>] [-r <mensajes/s>] [-x] [-M]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    
+    // Validar que todos los parámetros fueron proporcionados
+    if (!flagS || !flagA || !flagP) {
+        fprintf(stderr, "Error: Faltan parámetros obligatorios\n");
+        fprintf(stderr, "Uso: %s -s <nombre> -a <fileSolicitud> -p <pipeRecibe|unix:ruta|tcp:host:puerto> [-l <tamLote>] [-W <ventana>] [-r <mensajes/s>] [-x] [-M]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    
+    if (tamLote < 1 || tamLote > MAX_LOTE) {
+        fprintf(stderr, "Error: El tamaño de lote debe estar entre 1 y %d\n", MAX_LOTE);
+        exit(EXIT_FAILURE);
+    }
+    
+    if (tamVentana < 1 || tamVentana > MAX_VENTANA) {
+        fprintf(stderr, "Error: La ventana debe estar entre 1 y %d\n", MAX_VENTANA);
+        exit(EXIT_FAILURE);
+    }
+    
+    // Los lotes se responden en orden: no tiene sentido combinarlos con la ventana
+    if (tamLote > 1 && tamVentana > 1) {
+        fprintf(stderr, "Error: Las opciones -l y -W no se pueden combinar\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    if (tasaEnvio < 0) {
+        fprintf(stderr, "Error: La tasa de envío no puede ser negativa\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    if (llegadasPoisson && tasaEnvio == 0) {
+        fprintf(stderr, "Error: Las llegadas de Poisson (-x) requieren una tasa mayor que 0\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* ============================================================================
+ * REGISTRO CON EL CONTROLADOR
+ * ============================================================================ */
+int registrarseConControlador() {
+    MensajeAgente msg;
+    RespuestaControlador resp;
+    
+    // Preparar mensaje de registro
+    memset(&msg, 0, sizeof(msg));
+    msg.tipo = MSG_REGISTRO;
+    strncpy(msg.nombreAgente, nombreAgente, MAX_NOMBRE - 1);
+    strncpy(msg.pipeRespuesta, pipeRespuesta, MAX_NOMBRE - 1);
+    strncpy(msg.segmentoMemoria, nombreSegmento, MAX_NOMBRE - 1);
+    msg.horaSolicitada = 0;
+    msg.numPersonas = 0;
+    
+    // Enviar mensaje de registro
+    enviarMensaje(&msg);
+    
+    // Esperar respuesta con hora actual (el registro siempre se responde por el pipe)
+    if (!recibirRespuesta(&resp)) {
+        return 0;
+    }
+    
+    // Ambos procesos ya tienen el segmento proyectado (o no lo usarán): quitarle el nombre
+    if (segmento != NULL) {
+        shm_unlink(nombreSegmento);
+        if (resp.tipo == RESP_HORA_ACTUAL && resp.transporte == TRANSPORTE_MEMORIA) {
+            usarMemoria = 1;
+        } else {
+            liberarSegmento(segmento);
+            segmento = NULL;
+        }
+    }
+    
+    // El controlador responde con la hora actual y nuestro id (0 = rechazado)
+    if (resp.tipo == RESP_HORA_ACTUAL && resp.dato != 0) {
+        horaActualSimulacion = resp.horaActual;
+        idAgente = (uint32_t)resp.dato;
+        return 1;
+    }
+    
+    return 0;
+}
+
+/* ============================================================================
+ * PROCESAMIENTO DE SOLICITUDES
+ * ============================================================================ */
+void procesarSolicitudes() {
+    LectorSolicitudes *lector;
+    const SolicitudLeida *sol;
+    char textoHora[MAX_TEXTO_HORA];
+    char textoHoraActual[MAX_TEXTO_HORA];
+    MensajeAgente msg;
+    RespuestaControlador resp;
+    LoteSolicitudes lote;
+    pthread_t tidLector;
+    
+    inicializarLote(&lote, idAgente);
+    
+    // Abrir archivo de solicitudes (el hilo lector empieza a interpretarlo)
+    lector = abrirSolicitudes(archivoSolicitudes);
+    if (lector == NULL) {
+        perror("Error al abrir archivo de solicitudes");
+        return;
+    }
+    
+    printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
+    printf("         PROCESANDO SOLICITUDES DE RESERVA\n");
+    printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n");
+    
+    // Modo ventana: las respuestas las recibe un hilo aparte
+    if (tamVentana > 1) {
+        if (pthread_create(&tidLector, NULL, hiloLectorRespuestas, NULL) != 0) {
+            perror("Error al crear hilo lector de respuestas");
+            cerrarSolicitudes(lector);
+            return;
+        }
+    }
+    
+    // Procesar cada solicitud del archivo (las líneas vacías ya se omitieron)
+    while ((sol = siguienteSolicitud(lector)) != NULL) {
+        // Un cambio se refiere a una reserva ya respondida, y una consulta debe
+        // ver las anteriores: la del lote pendiente o las que siguen en vuelo
+        // deben llegar antes
+        if (sol->operacion != MSG_SOLICITUD_RESERVA) {
+            if (lote.cantidad > 0) {
+                enviarLote(&lote);
+            }
+            if (tamVentana > 1) {
+                esperarVentanaVacia();
+            }
+            if (sol->operacion == MSG_CONSULTA_DISPONIBILIDAD) {
+                enviarConsulta(sol);
+            } else {
+                enviarCambio(sol);
+            }
+            continue;
+        }
+        
+        const char *nombreFamilia = sol->nombreFamilia;
+        int horaSolicitada = sol->horaSolicitada;
+        int numPersonas = sol->numPersonas;
+        int dia = sol->dia;
+        int parque = sol->parque;
+        
+        formatearHora(horaSolicitada, textoHora, sizeof(textoHora));
+        formatearHora(horaActualSimulacion, textoHoraActual, sizeof(textoHoraActual));
+        
+        pthread_mutex_lock(&mutexSalida);
+        printf("┌─────────────────────────────────────────────────────────┐\n");
+        printf("│ Solicitud #%d                                            │\n", sol->numLinea);
+        printf("├─────────────────────────────────────────────────────────┤\n");
+        printf("│ Familia: %-47s│\n", nombreFamilia);
+        printf("│ Hora solicitada: %-5s                                  │\n", textoHora);
+        printf("│ Personas: %-3d                                           │\n", numPersonas);
+        if (dia != 0 || parque != 0) {
+            printf("│ Día: +%-3d Parque: %-3d                                   │\n", dia, parque);
+        }
+        printf("└─────────────────────────────────────────────────────────┘\n");
+        
+        if (sol->avisos & AVISO_NOMBRE_TRUNCADO) {
+            printf("⚠  ADVERTENCIA: Línea %d: nombre de familia truncado a %d caracteres\n",
+                   sol->numLinea, MAX_NOMBRE - 1);
+        }
+        if (sol->avisos & AVISO_CAMPO_INVALIDO) {
+            printf("⚠  ADVERTENCIA: Línea %d: hora, personas, día o parque no es un número válido\n",
+                   sol->numLinea);
+        }
+        if (sol->avisos & AVISO_CAMPOS_DE_MAS) {
+            printf("⚠  ADVERTENCIA: Línea %d: se ignoran los campos después del parque\n", sol->numLinea);
+        }
+        
+        // Validar que la hora no sea anterior a la hora actual (solo aplica a hoy)
+        if (dia == 0 && horaSolicitada < horaActualSimulacion) {
+            printf("⚠  ADVERTENCIA: Hora solicitada (%s) es anterior a la hora actual (%s)\n", 
+                   textoHora, textoHoraActual);
+            printf("   El controlador intentará reprogramar la reserva.\n\n");
+        }
+        pthread_mutex_unlock(&mutexSalida);
+        
+        // Preparar mensaje de solicitud (el agente se identifica por su id)
+        memset(&msg, 0, sizeof(msg));
+        msg.tipo = MSG_SOLICITUD_RESERVA;
+        msg.idAgente = idAgente;
+        strncpy(msg.nombreFamilia, nombreFamilia, MAX_NOMBRE - 1);
+        msg.horaSolicitada = horaSolicitada;
+        msg.numPersonas = numPersonas;
+        msg.dia = dia;
+        msg.parque = parque;
+        
+        // Modo ventana: enviar sin esperar la respuesta
+        if (tamVentana > 1) {
+            enviarEnVentana(&msg);
+            continue;
+        }
+        
+        // Modo lote: acumular y enviar cuando el lote se llena
+        if (tamLote > 1) {
+            if (!agregarALote(&lote, horaSolicitada, numPersonas, dia, parque, nombreFamilia)) {
+                // No cabe en la trama: enviar lo acumulado y empezar otro lote
+                enviarLote(&lote);
+                agregarALote(&lote, horaSolicitada, numPersonas, dia, parque, nombreFamilia);
+            }
+            if (lote.cantidad == tamLote) {
+                enviarLote(&lote);
+            }
+            continue;
+        }
+        
+        // Enviar solicitud cuando le toque según el ritmo configurado
+        esperarTurno();
+        double instanteEnvio = instanteActual();
+        
+        // Esperar respuesta (reenviando mientras el controlador esté ocupado)
+        if (enviarYRecibir(&msg, &resp, NULL, NULL)) {
+            registrarLatencia(instanteEnvio);
+            recordarReserva(&resp, nombreFamilia);
+            imprimirRespuesta(&resp, nombreFamilia, numPersonas);
+        } else {
+            printf("✗ Error al recibir respuesta del controlador\n\n");
+        }
+    }
+    
+    // Enviar el último lote incompleto
+    if (lote.cantidad > 0) {
+        enviarLote(&lote);
+    }
+    
+    // Esperar las respuestas pendientes antes de detener el hilo lector
+    if (tamVentana > 1) {
+        esperarVentanaVacia();
+        if (usarMemoria) {
+            // La espera en el anillo no es un punto de cancelación: cerrarlo despierta al lector
+            pthread_mutex_lock(&mutexVentana);
+            detenerLector = 1;
+            pthread_mutex_unlock(&mutexVentana);
+            cerrarAnillo(&segmento->respuestas);
+        } else {
+            pthread_cancel(tidLector);
+        }
+        pthread_join(tidLector, NULL);
+    }
+    
+    cerrarSolicitudes(lector);
+    
+    printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
+    printf("         FIN DE SOLICITUDES\n");
+    printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
+    
+    imprimirEstadisticasCarga();
+}
+
+/* ============================================================================
+ * APERTURA DE PIPES DE LA SESIÓN
+ * ============================================================================ */
+/*
+ * Abre el pipe de respuesta con la técnica de "doble open": primero el
+ * extremo de lectura en modo no bloqueante (para no esperar al controlador)
+ * y luego un extremo de escritura propio, de modo que las lecturas bloqueen
+ * esperando datos en lugar de devolver EOF mientras el controlador no lo
+ * haya abierto. El controlador abre su extremo una sola vez al registrarnos.
+ */
+void abrirPipeRespuesta() {
+    fdPipeRespuesta = open(pipeRespuesta, O_RDONLY | O_NONBLOCK);
+    if (fdPipeRespuesta == -1) {
+        perror("Error al abrir pipe de respuesta");
+        limpiarRecursos();
+        exit(EXIT_FAILURE);
+    }
+    
+    fdPipeRespuestaEscritura = open(pipeRespuesta, O_WRONLY);
+    if (fdPipeRespuestaEscritura == -1) {
+        perror("Error al abrir pipe de respuesta para escritura");
+        limpiarRecursos();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Lecturas bloqueantes a partir de aquí
+    int flags = fcntl(fdPipeRespuesta, F_GETFL, 0);
+    fcntl(fdPipeRespuesta, F_SETFL, flags & ~O_NONBLOCK);
+    
+    inicializarBufferTramas(&bufferRespuestas);
+}
+
+/*
+ * Abre el pipe del controlador (o se conecta a su socket) con reintentos y lo
+ * mantiene abierto. Por un socket la misma conexión trae las respuestas.
+ */
+void conectarConControlador() {
+    int intentos = 0;
+    
+    // Abrir pipe del controlador (con reintentos cada vez más espaciados)
+    while (intentos < MAX_INTENTOS_CONEXION) {
+        fdPipeControlador = usarSocket ? conectarA(pipeControlador) : open(pipeControlador, O_WRONLY);
+        if (fdPipeControlador != -1) {
+            break;
+        }
+        
+        if (errno == ENXIO || errno == ENOENT || errno == ECONNREFUSED) {
+            // El controlador aún no ha abierto (o creado) el pipe
+            esperarReintento(intentos, 0);
+            intentos++;
+        } else {
+            perror("Error al abrir pipe del controlador");
+            limpiarRecursos();
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    if (fdPipeControlador == -1) {
+        fprintf(stderr, "Error: No se pudo conectar con el controlador después de %d intentos\n", MAX_INTENTOS_CONEXION);
+        limpiarRecursos();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Una copia para leer: el resto del agente cierra cada extremo por separado
+    if (usarSocket) {
+        fdPipeRespuesta = dup(fdPipeControlador);
+        if (fdPipeRespuesta == -1) {
+            perror("Error al duplicar la conexión con el controlador");
+            limpiarRecursos();
+            exit(EXIT_FAILURE);
+        }
+        inicializarBufferTramas(&bufferRespuestas);
+    }
+}
+
+/* ============================================================================
+ * ENVÍO DE MENSAJES AL CONTROLADOR
+ * ============================================================================ */
+void enviarMensaje(MensajeAgente *msg) {
+    uint8_t trama[MAX_TRAMA];
+    size_t longitud = codificarMensaje(msg, trama);
+    
+    enviarTrama(trama, longitud);
+}
+
+void enviarTrama(const uint8_t *trama, size_t longitud) {
+    if (usarMemoria) {
+        if (!escribirEnAnillo(&segmento->solicitudes, trama, longitud)) {
+            fprintf(stderr, "Error al enviar mensaje al controlador: memoria compartida cerrada\n");
+            limpiarRecursos();
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+    
+    // Escribir la trama (menor que PIPE_BUF, la escritura es atómica)
+    if (write(fdPipeControlador, trama, longitud) != (ssize_t)longitud) {
+        perror("Error al enviar mensaje al controlador");
+        limpiarRecursos();
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * Envía el lote acumulado, imprime cada resultado y lo deja vacío. Un lote
+ * rechazado con RESP_OCUPADO se reenvía completo, como una solicitud.
+ */
+void enviarLote(LoteSolicitudes *lote) {
+    uint8_t trama[MAX_TRAMA];
+    const uint8_t *tramaRespuesta;
+    size_t longitud, longitudRespuesta;
+    RespuestaLote respLote;
+    RespuestaControlador ocupado;
+    int recibida;
+    int rechazado;
+    
+    longitud = codificarLote(lote, trama);
+    esperarTurno();
+    double instanteEnvio = instanteActual();
+    
+    for (int intento = 0; ; intento++) {
+        enviarTrama(trama, longitud);
+        recibida = recibirTrama(&tramaRespuesta, &longitudRespuesta);
+        rechazado = recibida && tipoTrama(tramaRespuesta) == RESP_OCUPADO;
+        if (rechazado && !decodificarRespuesta(tramaRespuesta, longitudRespuesta, &ocupado)) {
+            recibida = rechazado = 0;
+        }
+        if (!rechazado || intento == MAX_REINTENTOS) {
+            break;
+        }
+        avisarReintento(lote->elementos[0].nombreFamilia, intento + 1, ocupado.dato);
+        esperarReintento(intento, ocupado.dato);
+    }
+    
+    if (rechazado) {
+        // Se agotaron los reintentos: el lote no se atendió
+        for (int i = 0; i < lote->cantidad; i++) {
+            registrarLatencia(instanteEnvio);
+            imprimirRespuesta(&ocupado, lote->elementos[i].nombreFamilia, lote->elementos[i].numPersonas);
+        }
+    } else if (!recibida ||
+        !decodificarRespuestaLote(tramaRespuesta, longitudRespuesta, &respLote) ||
+        respLote.cantidad != lote->cantidad) {
+        printf("✗ Error al recibir respuesta del lote\n\n");
+    } else {
+        for (int i = 0; i < lote->cantidad; i++) {
+            RespuestaControlador resp;
+            respuestaDeLote(&respLote, i, &resp);
+            registrarLatencia(instanteEnvio);  // Todas esperaron lo mismo que el lote
+            recordarReserva(&resp, lote->elementos[i].nombreFamilia);
+            imprimirRespuesta(&resp, lote->elementos[i].nombreFamilia, lote->elementos[i].numPersonas);
+        }
+    }
+    
+    inicializarLote(lote, idAgente);
+}
+
+/*
+ * Envía un mensaje y espera su respuesta (con disponibilidad, también la de
+ * una consulta). Mientras el controlador responda RESP_OCUPADO, espera (ver
+ * esperarReintento) y lo reenvía, a lo sumo MAX_REINTENTOS veces; si se
+ * agotan, la respuesta es el último RESP_OCUPADO.
+ */
+int enviarYRecibir(MensajeAgente *msg, RespuestaControlador *resp, RespuestaDisponibilidad *disponibilidad,
+                   int *esConsulta) {
+    for (int intento = 0; ; intento++) {
+        enviarMensaje(msg);
+        
+        int recibida = disponibilidad != NULL ? recibirRespuestaOConsulta(resp, disponibilidad, esConsulta)
+                                              : recibirRespuesta(resp);
+        if (!recibida || (disponibilidad != NULL && *esConsulta) || resp->tipo != RESP_OCUPADO ||
+            intento == MAX_REINTENTOS) {
+            return recibida;
+        }
+        
+        avisarReintento(msg->nombreFamilia, intento + 1, resp->dato);
+        esperarReintento(intento, resp->dato);
+    }
+}
+
+/*
+ * Retroceso exponencial con variación, en segundos: antes del reintento
+ * intento + 1 toca esperar un tiempo al azar entre la mitad y el total de
+ * ESPERA_BASE_MS * 2^intento (a lo sumo ESPERA_MAXIMA_MS), y nunca menos de
+ * lo que sugirió el controlador. La variación evita que las solicitudes
+ * rechazadas a la vez vuelvan todas en el mismo instante.
+ */
+double retardoReintento(int intento, int esperaSugeridaMs, unsigned int *semilla) {
+    double topeMs = ESPERA_BASE_MS;
+    for (int i = 0; i < intento && topeMs < ESPERA_MAXIMA_MS; i++) {
+        topeMs *= 2;
+    }
+    if (topeMs > ESPERA_MAXIMA_MS) {
+        topeMs = ESPERA_MAXIMA_MS;
+    }
+    
+    double esperaMs = topeMs / 2 + topeMs / 2 * ((double)rand_r(semilla) / RAND_MAX);
+    return (esperaMs < esperaSugeridaMs ? esperaSugeridaMs : esperaMs) / 1000.0;
+}
+
+/* Espera el retroceso del intento dado (hilo principal) */
+void esperarReintento(int intento, int esperaSugeridaMs) {
+    dormir(retardoReintento(intento, esperaSugeridaMs, &semillaReintentos));
+}
+
+/* Cuenta e informa un reenvío por RESP_OCUPADO */
+void avisarReintento(const char *nombreFamilia, int reintento, int esperaSugeridaMs) {
+    pthread_mutex_lock(&mutexEstadisticas);
+    reintentosOcupado++;
+    pthread_mutex_unlock(&mutexEstadisticas);
+    
+    pthread_mutex_lock(&mutexSalida);
+    printf("⏳ Controlador ocupado: se reenvía la solicitud de %s (reintento %d de %d, espera sugerida %d ms)\n\n",
+           nombreFamilia, reintento, MAX_REINTENTOS, esperaSugeridaMs);
+    pthread_mutex_unlock(&mutexSalida);
+}
+
+/* ============================================================================
+ * VENTANA DE SOLICITUDES EN VUELO
+ * ============================================================================ */
+/*
+ * Envía una solicitud (o un cambio) sin esperar su respuesta y le asigna su
+ * número de secuencia. Bloquea mientras haya tamVentana solicitudes en
+ * vuelo; la entrada se registra antes de enviar para que el hilo lector la
+ * encuentre aunque la respuesta llegue enseguida.
+ */
+void enviarEnVentana(MensajeAgente *msg) {
+    int i;
+    
+    esperarTurno();
+    
+    pthread_mutex_lock(&mutexVentana);
+    
+    // Las rechazadas se reenvían antes de enviar otra
+    while ((numEnVuelo == tamVentana || numRechazadas > 0) && !lectorTerminado) {
+        if (numRechazadas > 0) {
+            reenviarRechazadas();
+        } else {
+            pthread_cond_wait(&ventanaLibre, &mutexVentana);
+        }
+    }
+    
+    if (lectorTerminado) {
+        pthread_mutex_unlock(&mutexVentana);
+        return;
+    }
+    
+    // Hay al menos una entrada libre porque numEnVuelo < tamVentana
+    i = 0;
+    while (solicitudesEnVuelo[i].enUso) {
+        i++;
+    }
+    solicitudesEnVuelo[i].enUso = 1;
+    solicitudesEnVuelo[i].secuencia = siguienteSecuencia++;
+    solicitudesEnVuelo[i].numPersonas = msg->numPersonas;
+    strncpy(solicitudesEnVuelo[i].nombreFamilia, msg->nombreFamilia, MAX_NOMBRE - 1);
+    solicitudesEnVuelo[i].nombreFamilia[MAX_NOMBRE - 1] = '\0';
+    solicitudesEnVuelo[i].instanteEnvio = instanteActual();
+    msg->secuencia = solicitudesEnVuelo[i].secuencia;
+    solicitudesEnVuelo[i].mensaje = *msg;
+    solicitudesEnVuelo[i].reintentos = 0;
+    solicitudesEnVuelo[i].rechazada = 0;
+    numEnVuelo++;
+    
+    pthread_mutex_unlock(&mutexVentana);
+    
+    enviarMensaje(msg);
+}
+
+/* Espera hasta recibir todas las respuestas pendientes (reenviando las rechazadas) */
+void esperarVentanaVacia() {
+    pthread_mutex_lock(&mutexVentana);
+    while (numEnVuelo > 0 && !lectorTerminado) {
+        if (numRechazadas > 0) {
+            reenviarRechazadas();
+        } else {
+            pthread_cond_wait(&ventanaLibre, &mutexVentana);
+        }
+    }
+    pthread_mutex_unlock(&mutexVentana);
+}
+
+/*
+ * Reenvía, con su misma secuencia, las solicitudes en vuelo que el
+ * controlador rechazó con RESP_OCUPADO y cuyo instante de reenvío ya llegó,
+ * después de esperar al más próximo. Se llama con mutexVentana tomado; lo
+ * suelta mientras espera y envía.
+ */
+void reenviarRechazadas() {
+    MensajeAgente reenvios[MAX_VENTANA];
+    int numReenvios = 0;
+    double proximo = 0.0;
+    
+    for (int i = 0; i < tamVentana; i++) {
+        if (solicitudesEnVuelo[i].enUso && solicitudesEnVuelo[i].rechazada &&
+            (proximo == 0.0 || solicitudesEnVuelo[i].reenviarEn < proximo)) {
+            proximo = solicitudesEnVuelo[i].reenviarEn;
+        }
+    }
+    
+    double espera = proximo - instanteActual();
+    if (espera > 0) {
+        pthread_mutex_unlock(&mutexVentana);
+        dormir(espera);
+        pthread_mutex_lock(&mutexVentana);
+    }
+    
+    double ahora = instanteActual();
+    for (int i = 0; i < tamVentana; i++) {
+        if (solicitudesEnVuelo[i].enUso && solicitudesEnVuelo[i].rechazada &&
+            solicitudesEnVuelo[i].reenviarEn <= ahora) {
+            solicitudesEnVuelo[i].rechazada = 0;
+            numRechazadas--;
+            reenvios[numReenvios++] = solicitudesEnVuelo[i].mensaje;
+        }
+    }
+    
+    pthread_mutex_unlock(&mutexVentana);
+    for (int i = 0; i < numReenvios; i++) {
+        enviarMensaje(&reenvios[i]);
+    }
+    pthread_mutex_lock(&mutexVentana);
+}
+
+/*
+ * Hilo que recibe las respuestas en el modo ventana y las empareja con su
+ * solicitud por número de secuencia (pueden llegar en otro orden si el
+ * controlador usa varios hilos trabajadores).
+ */
+void *hiloLectorRespuestas(void *arg) {
+    (void)arg;
+    RespuestaControlador resp;
+    RespuestaDisponibilidad disponibilidad;
+    SolicitudEnVuelo solicitud;
+    int encontrada;
+    int esConsulta;
+    unsigned int semilla = semillaReintentos ^ (unsigned int)pthread_self();
+    
+    while (1) {
+        if (!recibirRespuestaOConsulta(&resp, &disponibilidad, &esConsulta)) {
+            pthread_mutex_lock(&mutexVentana);
+            int detenido = detenerLector;
+            lectorTerminado = 1;
+            pthread_cond_broadcast(&ventanaLibre);
+            pthread_mutex_unlock(&mutexVentana);
+            
+            if (detenido) {
+                return NULL;  // Fin normal con memoria compartida
+            }
+            
+            pthread_mutex_lock(&mutexSalida);
+            printf("✗ Error al recibir respuesta del controlador\n\n");
+            pthread_mutex_unlock(&mutexSalida);
+            return NULL;
+        }
+        
+        // No cancelar mientras se actualiza la ventana o se imprime
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        
+        uint32_t secuencia = esConsulta ? disponibilidad.secuencia : resp.secuencia;
+        int ocupado = !esConsulta && resp.tipo == RESP_OCUPADO;
+        int reintento = 0;
+        encontrada = 0;
+        pthread_mutex_lock(&mutexVentana);
+        for (int i = 0; i < tamVentana; i++) {
+            if (solicitudesEnVuelo[i].enUso && solicitudesEnVuelo[i].secuencia == secuencia) {
+                solicitud = solicitudesEnVuelo[i];
+                if (ocupado && solicitudesEnVuelo[i].reintentos < MAX_REINTENTOS) {
+                    // Sigue en vuelo: el hilo principal la reenvía después de esperar
+                    reintento = ++solicitudesEnVuelo[i].reintentos;
+                    solicitudesEnVuelo[i].rechazada = 1;
+                    solicitudesEnVuelo[i].reenviarEn = instanteActual() + retardoReintento(reintento - 1, resp.dato, &semilla);
+                    numRechazadas++;
+                } else {
+                    solicitudesEnVuelo[i].enUso = 0;
+                    numEnVuelo--;
+                }
+                encontrada = 1;
+                pthread_cond_signal(&ventanaLibre);
+                break;
+            }
+        }
+        pthread_mutex_unlock(&mutexVentana);
+        
+        if (reintento > 0) {
+            avisarReintento(solicitud.nombreFamilia, reintento, resp.dato);
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+            continue;
+        }
+        
+        pthread_mutex_lock(&mutexSalida);
+        if (encontrada && esConsulta) {
+            registrarLatencia(solicitud.instanteEnvio);
+            imprimirDisponibilidad(&disponibilidad, solicitud.nombreFamilia);
+        } else if (encontrada) {
+            registrarLatencia(solicitud.instanteEnvio);
+            recordarReserva(&resp, solicitud.nombreFamilia);
+            imprimirRespuesta(&resp, solicitud.nombreFamilia, solicitud.numPersonas);
+        } else {
+            printf("⚠  Respuesta con secuencia desconocida (%u) ignorada\n\n", secuencia);
+        }
+        pthread_mutex_unlock(&mutexSalida);
+        
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    }
+    
+    return NULL;
+}
+
+/* ============================================================================
+ * CANCELACIÓN Y MODIFICACIÓN DE RESERVAS
+ * ============================================================================ */
+/*
+ * Cancela o modifica la última reserva aprobada de la familia, identificada
+ * por el id que devolvió el controlador. Si la familia no tiene ninguna, la
+ * línea se omite. Con -W viaja por la ventana como cualquier solicitud.
+ */
+void enviarCambio(const SolicitudLeida *sol) {
+    MensajeAgente msg;
+    RespuestaControlador resp;
+    char textoHora[MAX_TEXTO_HORA];
+    uint32_t idReserva = reservaDeFamilia(sol->nombreFamilia);
+    
+    pthread_mutex_lock(&mutexSalida);
+    printf("┌─────────────────────────────────────────────────────────┐\n");
+    if (sol->operacion == MSG_CANCELAR) {
+        printf("│ Cancelación #%-43d│\n", sol->numLinea);
+    } else {
+        printf("│ Modificación #%-42d│\n", sol->numLinea);
+    }
+    printf("├─────────────────────────────────────────────────────────┤\n");
+    printf("│ Familia: %-47s│\n", sol->nombreFamilia);
+    if (sol->operacion == MSG_MODIFICAR) {
+        formatearHora(sol->horaSolicitada, textoHora, sizeof(textoHora));
+        printf("│ Nueva hora: %-5s                                       │\n", textoHora);
+        printf("│ Personas: %-3d                                           │\n", sol->numPersonas);
+    }
+    printf("└─────────────────────────────────────────────────────────┘\n");
+    
+    if (sol->avisos & AVISO_NOMBRE_TRUNCADO) {
+        printf("⚠  ADVERTENCIA: Línea %d: nombre de familia truncado a %d caracteres\n",
+               sol->numLinea, MAX_NOMBRE - 1);
+    }
+    if (sol->avisos & AVISO_CAMPO_INVALIDO) {
+        printf("⚠  ADVERTENCIA: Línea %d: hora o personas no es un número válido\n", sol->numLinea);
+    }
+    if (sol->avisos & AVISO_CAMPOS_DE_MAS) {
+        printf("⚠  ADVERTENCIA: Línea %d: se ignoran los campos de más\n", sol->numLinea);
+    }
+    if (idReserva == 0) {
+        printf("⚠  ADVERTENCIA: Línea %d: la familia %s no tiene una reserva aprobada; se omite\n\n",
+               sol->numLinea, sol->nombreFamilia);
+    }
+    pthread_mutex_unlock(&mutexSalida);
+    
+    if (idReserva == 0) {
+        return;
+    }
+    
+    memset(&msg, 0, sizeof(msg));
+    msg.tipo = sol->operacion;
+    msg.idAgente = idAgente;
+    msg.idReserva = idReserva;
+    strncpy(msg.nombreFamilia, sol->nombreFamilia, MAX_NOMBRE - 1);
+    msg.horaSolicitada = sol->horaSolicitada;
+    msg.numPersonas = sol->numPersonas;
+    
+    if (tamVentana > 1) {
+        enviarEnVentana(&msg);
+        return;
+    }
+    
+    esperarTurno();
+    double instanteEnvio = instanteActual();
+    
+    if (enviarYRecibir(&msg, &resp, NULL, NULL)) {
+        registrarLatencia(instanteEnvio);
+        recordarReserva(&resp, sol->nombreFamilia);
+        imprimirRespuesta(&resp, sol->nombreFamilia, sol->numPersonas);
+    } else {
+        printf("✗ Error al recibir respuesta del controlador\n\n");
+    }
+}
+
+/* ============================================================================
+ * CONSULTAS DE DISPONIBILIDAD
+ * ============================================================================ */
+/*
+ * Pregunta cuántas personas caben todavía en cada hora de inicio de un día y
+ * un parque, sin reservar nada. Con -W viaja por la ventana como cualquier
+ * solicitud; el hilo lector reconoce la respuesta por su tipo de trama.
+ */
+void enviarConsulta(const SolicitudLeida *sol) {
+    MensajeAgente msg;
+    RespuestaControlador resp;
+    RespuestaDisponibilidad disponibilidad;
+    int esConsulta;
+    
+    pthread_mutex_lock(&mutexSalida);
+    printf("┌─────────────────────────────────────────────────────────┐\n");
+    printf("│ Consulta #%-46d│\n", sol->numLinea);
+    printf("├─────────────────────────────────────────────────────────┤\n");
+    printf("│ Familia: %-47s│\n", sol->nombreFamilia);
+    printf("│ Día: +%-3d Parque: %-3d                                   │\n", sol->dia, sol->parque);
+    printf("└─────────────────────────────────────────────────────────┘\n");
+    
+    if (sol->avisos & AVISO_NOMBRE_TRUNCADO) {
+        printf("⚠  ADVERTENCIA: Línea %d: nombre de familia truncado a %d caracteres\n",
+               sol->numLinea, MAX_NOMBRE - 1);
+    }
+    if (sol->avisos & AVISO_CAMPO_INVALIDO) {
+        printf("⚠  ADVERTENCIA: Línea %d: día o parque no es un número válido\n", sol->numLinea);
+    }
+    if (sol->avisos & AVISO_CAMPOS_DE_MAS) {
+        printf("⚠  ADVERTENCIA: Línea %d: se ignoran los campos después del parque\n", sol->numLinea);
+    }
+    pthread_mutex_unlock(&mutexSalida);
+    
+    memset(&msg, 0, sizeof(msg));
+    msg.tipo = MSG_CONSULTA_DISPONIBILIDAD;
+    msg.idAgente = idAgente;
+    strncpy(msg.nombreFamilia, sol->nombreFamilia, MAX_NOMBRE - 1);
+    msg.dia = sol->dia;
+    msg.parque = sol->parque;
+    
+    if (tamVentana > 1) {
+        enviarEnVentana(&msg);
+        return;
+    }
+    
+    esperarTurno();
+    double instanteEnvio = instanteActual();
+    
+    if (enviarYRecibir(&msg, &resp, &disponibilidad, &esConsulta)) {
+        registrarLatencia(instanteEnvio);
+        if (esConsulta) {
+            imprimirDisponibilidad(&disponibilidad, sol->nombreFamilia);
+        } else {
+            imprimirRespuesta(&resp, sol->nombreFamilia, 0);  // Se agotaron los reintentos
+        }
+    } else {
+        printf("✗ Error al recibir respuesta del controlador\n\n");
+    }
+}
+
+/* Cubeta de una familia en la tabla de reservas (FNV-1a) */
+static uint32_t cubetaFamilia(const char *nombreFamilia) {
+    uint32_t hash = 2166136261u;
+    
+    for (const char *c = nombreFamilia; *c != '\0'; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+    return hash & (CUBETAS_RESERVAS - 1);
+}
+
+/*
+ * Guarda el id de una reserva aprobada o reprogramada (una modificación
+ * aprobada reemplaza al anterior) y lo olvida cuando se cancela.
+ */
+void recordarReserva(const RespuestaControlador *resp, const char *nombreFamilia) {
+    if (resp->tipo != RESP_RESERVA_OK && resp->tipo != RESP_RESERVA_REPROG &&
+        resp->tipo != RESP_RESERVA_CANCELADA) {
+        return;
+    }
+    
+    pthread_mutex_lock(&mutexReservasFamilias);
+    ReservaFamilia **enlace = &reservasFamilias[cubetaFamilia(nombreFamilia)];
+    while (*enlace != NULL && strcmp((*enlace)->nombreFamilia, nombreFamilia) != 0) {
+        enlace = &(*enlace)->siguiente;
+    }
+    
+    if (resp->tipo == RESP_RESERVA_CANCELADA) {
+        if (*enlace != NULL) {
+            ReservaFamilia *cancelada = *enlace;
+            *enlace = cancelada->siguiente;
+            free(cancelada);
+        }
+    } else {
+        if (*enlace == NULL) {
+            *enlace = calloc(1, sizeof(ReservaFamilia));
+            if (*enlace == NULL) {
+                perror("Error al reservar memoria para la tabla de reservas");
+                pthread_mutex_unlock(&mutexReservasFamilias);
+                return;
+            }
+            strncpy((*enlace)->nombreFamilia, nombreFamilia, MAX_NOMBRE - 1);
+        }
+        (*enlace)->idReserva = resp->idReserva;
+    }
+    pthread_mutex_unlock(&mutexReservasFamilias);
+}
+
+/* Id de la última reserva aprobada de la familia (0 = ninguna) */
+uint32_t reservaDeFamilia(const char *nombreFamilia) {
+    uint32_t idReserva = 0;
+    
+    pthread_mutex_lock(&mutexReservasFamilias);
+    for (ReservaFamilia *r = reservasFamilias[cubetaFamilia(nombreFamilia)]; r != NULL; r = r->siguiente) {
+        if (strcmp(r->nombreFamilia, nombreFamilia) == 0) {
+            idReserva = r->idReserva;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mutexReservasFamilias);
+    return idReserva;
+}
+
+void liberarReservasFamilias() {
+    for (int c = 0; c < CUBETAS_RESERVAS; c++) {
+        while (reservasFamilias[c] != NULL) {
+            ReservaFamilia *siguiente = reservasFamilias[c]->siguiente;
+            free(reservasFamilias[c]);
+            reservasFamilias[c] = siguiente;
+        }
+    }
+}
+
+/* ============================================================================
+ * RITMO DE ENVÍO Y ESTADÍSTICAS DE CARGA
+ * ============================================================================ */
+double instanteActual() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Espera hasta el instante programado para el próximo mensaje y programa el
+ * siguiente. Los instantes se acumulan sobre el programado (no sobre el real)
+ * para que la tasa media no se desvíe; si vamos atrasados se envía de
+ * inmediato. Con -x el intervalo sigue una distribución exponencial.
+ */
+void esperarTurno() {
+    double ahora = instanteActual();
+    
+    if (instantePrimerEnvio == 0.0) {
+        instantePrimerEnvio = ahora;
+        proximoEnvio = ahora;
+        semillaRitmo = (unsigned int)getpid() ^ (unsigned int)time(NULL);
+    }
+    
+    if (tasaEnvio == 0) {
+        return;  // Tan rápido como sea posible
+    }
+    
+    if (proximoEnvio > ahora) {
+        dormir(proximoEnvio - ahora);
+    } else {
+        proximoEnvio = ahora;  // Atrasados: no acumular ráfagas
+    }
+    
+    if (llegadasPoisson) {
+        double u = ((double)rand_r(&semillaRitmo) + 1.0) / ((double)RAND_MAX + 2.0);
+        proximoEnvio += -log(u) / tasaEnvio;
+    } else {
+        proximoEnvio += 1.0 / tasaEnvio;
+    }
+}
+
+/* Duerme los segundos indicados aunque lleguen señales */
+void dormir(double segundos) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)segundos;
+    ts.tv_nsec = (long)((segundos - (double)ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+        // Reanudar con el tiempo restante
+    }
+}
+
+/* Registra la latencia de una solicitud respondida */
+void registrarLatencia(double instanteEnvio) {
+    double ahora = instanteActual();
+    
+    pthread_mutex_lock(&mutexEstadisticas);
+    
+    if (numLatencias == capacidadLatencias) {
+        size_t nuevaCapacidad = capacidadLatencias ? capacidadLatencias * 2 : 64;
+        double *nuevas = realloc(latencias, nuevaCapacidad * sizeof(double));
+        if (nuevas == NULL) {
+            pthread_mutex_unlock(&mutexEstadisticas);
+            return;
+        }
+        latencias = nuevas;
+        capacidadLatencias = nuevaCapacidad;
+    }
+    
+    latencias[numLatencias++] = ahora - instanteEnvio;
+    instanteUltimaRespuesta = ahora;
+    
+    pthread_mutex_unlock(&mutexEstadisticas);
+}
+
+static int compararLatencias(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Percentil p (0-100) sobre latencias ya ordenadas, en milisegundos */
+static double percentilMs(double p) {
+    size_t indice = (size_t)ceil(p / 100.0 * (double)numLatencias);
+    if (indice > 0) {
+        indice--;
+    }
+    return latencias[indice] * 1000.0;
+}
+
+void imprimirEstadisticasCarga() {
+    pthread_mutex_lock(&mutexEstadisticas);
+    
+    printf("\n📊 ESTADÍSTICAS DE CARGA:\n");
+    printf("   • Solicitudes respondidas:  %zu\n", numLatencias);
+    
+    if (numLatencias > 0) {
+        double duracion = instanteUltimaRespuesta - instantePrimerEnvio;
+        double suma = 0.0;
+        
+        qsort(latencias, numLatencias, sizeof(double), compararLatencias);
+        for (size_t i = 0; i < numLatencias; i++) {
+            suma += latencias[i];
+        }
+        
+        printf("   • Duración:                 %.3f s\n", duracion);
+        if (duracion > 0) {
+            printf("   • Tasa lograda:             %.2f solicitudes/s\n", (double)numLatencias / duracion);
+        }
+        printf("   • Latencia (ms):            mín %.3f | p50 %.3f | p90 %.3f | p99 %.3f | máx %.3f\n",
+               latencias[0] * 1000.0, percentilMs(50), percentilMs(90), percentilMs(99),
+               latencias[numLatencias - 1] * 1000.0);
+        printf("   • Latencia media:           %.3f ms\n", suma / (double)numLatencias * 1000.0);
+    }
+    if (reintentosOcupado > 0) {
+        printf("   • Reintentos por ocupación: %ld\n", reintentosOcupado);
+    }
+    
+    pthread_mutex_unlock(&mutexEstadisticas);
+}
+
+/* ============================================================================
+ * RECEPCIÓN DE RESPUESTAS DEL CONTROLADOR
+ * ============================================================================ */
+int recibirTrama(const uint8_t **trama, size_t *longitud) {
+    int estado;
+    
+    // Por el anillo llegan tramas completas
+    if (usarMemoria) {
+        if (!leerDeAnillo(&segmento->respuestas, tramaMemoria, longitud)) {
+            pthread_mutex_lock(&mutexVentana);
+            if (!detenerLector) {
+                fprintf(stderr, "Error: El controlador cerró la memoria compartida\n");
+            }
+            pthread_mutex_unlock(&mutexVentana);
+            return 0;
+        }
+        if (*longitud < TAM_CABECERA || tramaMemoria[0] != PROTOCOLO_VERSION) {
+            fprintf(stderr, "Error: Respuesta inválida del controlador\n");
+            return 0;
+        }
+        *trama = tramaMemoria;
+        return 1;
+    }
+    
+    // Leer del pipe hasta completar una trama
+    while ((estado = siguienteTrama(&bufferRespuestas, trama, longitud)) == 0) {
+        if (llenarBufferTramas(&bufferRespuestas, fdPipeRespuesta) <= 0) {
+            fprintf(stderr, "Error: Respuesta incompleta del controlador\n");
+            return 0;
+        }
+    }
+    
+    if (estado == -1) {
+        fprintf(stderr, "Error: Respuesta inválida del controlador\n");
+        return 0;
+    }
+    
+    return 1;
+}
+
+int recibirRespuesta(RespuestaControlador *resp) {
+    const uint8_t *trama;
+    size_t longitud;
+    
+    if (!recibirTrama(&trama, &longitud)) {
+        return 0;
+    }
+    
+    if (!decodificarRespuesta(trama, longitud, resp)) {
+        fprintf(stderr, "Error: Respuesta inválida del controlador\n");
+        return 0;
+    }
+    
+    return 1;
+}
+
+/* Como recibirRespuesta, pero acepta también la respuesta a una consulta (esConsulta = 1) */
+int recibirRespuestaOConsulta(RespuestaControlador *resp, RespuestaDisponibilidad *disponibilidad, int *esConsulta) {
+    const uint8_t *trama;
+    size_t longitud;
+    
+    if (!recibirTrama(&trama, &longitud)) {
+        return 0;
+    }
+    
+    *esConsulta = tipoTrama(trama) == RESP_DISPONIBILIDAD;
+    if (*esConsulta ? !decodificarDisponibilidad(trama, longitud, disponibilidad)
+                    : !decodificarRespuesta(trama, longitud, resp)) {
+        fprintf(stderr, "Error: Respuesta inválida del controlador\n");
+        return 0;
+    }
+    
+    return 1;
+}
+
+/* ============================================================================
+ * IMPRESIÓN DE RESPUESTAS
+ * ============================================================================ */
+void imprimirRespuesta(RespuestaControlador *resp, const char *nombreFamilia, int numPersonas) {
+    char mensaje[MAX_TEXTO_RESPUESTA];
+    char inicio[MAX_TEXTO_HORA];
+    char fin[MAX_TEXTO_HORA];
+    
+    // Reconstruir el texto a partir del tipo y motivo recibidos
+    describirRespuesta(resp, numPersonas, mensaje, sizeof(mensaje));
+    formatearHora(resp->horaAsignada, inicio, sizeof(inicio));
+    formatearHora(resp->horaAsignada + resp->duracion, fin, sizeof(fin));
+    
+    printf("\n╭─────────────────────────────────────────────────────────╮\n");
+    printf("│ 📨 RESPUESTA DEL CONTROLADOR                            │\n");
+    printf("├─────────────────────────────────────────────────────────┤\n");
+    
+    switch (resp->tipo) {
+        case RESP_HORA_ACTUAL:
+            printf("│ Tipo: Hora Actual                                       │\n");
+            formatearHora(resp->horaActual, inicio, sizeof(inicio));
+            printf("│ Hora: %-5s                                             │\n", inicio);
+            break;
+            
+        case RESP_RESERVA_OK:
+            printf("│ Estado: ✓ RESERVA APROBADA                              │\n");
+            printf("│ Familia: %-47s│\n", nombreFamilia);
+            printf("│ Hora asignada: %5s - %-5s                            │\n", inicio, fin);
+            printf("│ Reserva: #%-46u│\n", resp->idReserva);
+            printf("│ %s │\n", mensaje);
+            break;
+            
+        case RESP_RESERVA_REPROG:
+            printf("│ Estado: ⚠ RESERVA REPROGRAMADA                          │\n");
+            printf("│ Familia: %-47s│\n", nombreFamilia);
+            printf("│ Nueva hora: %5s - %-5s                               │\n", inicio, fin);
+            printf("│ Reserva: #%-46u│\n", resp->idReserva);
+            printf("│ Motivo: La hora solicitada no estaba disponible        │\n");
+            break;
+            
+        case RESP_RESERVA_CANCELADA:
+            printf("│ Estado: ✓ RESERVA CANCELADA                             │\n");
+            printf("│ Familia: %-47s│\n", nombreFamilia);
+            printf("│ Hora liberada: %5s - %-5s                            │\n", inicio, fin);
+            printf("│ Personas: %-3d                                           │\n", resp->dato);
+            break;
+            
+        case RESP_RESERVA_NEGADA:
+            printf("│ Estado: ✗ RESERVA NEGADA                                │\n");
+            printf("│ Familia: %-47s│\n", nombreFamilia);
+            printf("│ Motivo:                                                 │\n");
+            
+            // Dividir mensaje en líneas si es muy largo
+            char *token = strtok(mensaje, ".");
+            while (token != NULL) {
+                printf("│   %s│\n", token);
+                token = strtok(NULL, ".");
+            }
+            break;
+            
+        case RESP_FIN_DIA:
+            printf("│ Estado: Fin del día de operaciones                     │\n");
+            break;
+            
+        case RESP_OCUPADO:
+            printf("│ Estado: ✗ CONTROLADOR OCUPADO                           │\n");
+            printf("│ Familia: %-47s│\n", nombreFamilia);
+            printf("│ Motivo: La cola del controlador sigue llena             │\n");
+            printf("│ Reintentos: %-44d│\n", MAX_REINTENTOS);
+            break;
+            
+        default:
+            printf("│ Estado: Respuesta desconocida                           │\n");
+            break;
+    }
+    
+    printf("╰─────────────────────────────────────────────────────────╯\n\n");
+}
+
+/* Una fila por hora de inicio, con las personas que aún caben en una reserva que empiece en ella */
+void imprimirDisponibilidad(const RespuestaDisponibilidad *disponibilidad, const char *nombreFamilia) {
+    char inicio[MAX_TEXTO_HORA];
+    char fin[MAX_TEXTO_HORA];
+    
+    printf("\n╭─────────────────────────────────────────────────────────╮\n");
+    printf("│ 📨 RESPUESTA DEL CONTROLADOR                            │\n");
+    printf("├─────────────────────────────────────────────────────────┤\n");
+    
+    if (disponibilidad->motivo == MOTIVO_CALENDARIO_INEXISTENTE) {
+        printf("│ Estado: ✗ CONSULTA NEGADA                               │\n");
+        printf("│ Familia: %-47s│\n", nombreFamilia);
+        printf("│ Motivo:                                                 │\n");
+        printf("│   El controlador no atiende ese día o parque            │\n");
+        printf("╰─────────────────────────────────────────────────────────╯\n\n");
+        return;
+    }
+    
+    printf("│ Estado: DISPONIBILIDAD                                  │\n");
+    printf("│ Familia: %-47s│\n", nombreFamilia);
+    printf("│ Día: +%-3d Parque: %-3d                                   │\n",
+           disponibilidad->dia, disponibilidad->parque);
+    if (disponibilidad->cantidad == 0) {
+        printf("│ No quedan horas reservables en el periodo               │\n");
+    }
+    for (int i = 0; i < disponibilidad->cantidad; i++) {
+        int minuto = disponibilidad->horaDesde + i * disponibilidad->minutosFranja;
+        formatearHora(minuto, inicio, sizeof(inicio));
+        formatearHora(minuto + disponibilidad->duracion, fin, sizeof(fin));
+        printf("│ %5s - %-5s  %7d plazas                           │\n", inicio, fin, disponibilidad->plazas[i]);
+    }
+    
+    printf("╰─────────────────────────────────────────────────────────╯\n\n");
+}
+
+/* ============================================================================
+ * LIMPIEZA DE RECURSOS
+ * ============================================================================ */
+void limpiarRecursos() {
+    // Cerrar los pipes de la sesión
+    if (fdPipeControlador != -1) {
+        close(fdPipeControlador);
+        fdPipeControlador = -1;
+    }
+    if (fdPipeRespuesta != -1) {
+        close(fdPipeRespuesta);
+        fdPipeRespuesta = -1;
+    }
+    if (fdPipeRespuestaEscritura != -1) {
+        close(fdPipeRespuestaEscritura);
+        fdPipeRespuestaEscritura = -1;
+    }
+    
+    // Eliminar pipe de respuesta
+    if (pipeRespuesta[0] != '\0') {
+        unlink(pipeRespuesta);
+    }
+    
+    // Soltar el segmento (si el registro falló aún conserva su nombre)
+    if (segmento != NULL) {
+        liberarSegmento(segmento);
+        segmento = NULL;
+        usarMemoria = 0;
+    }
+    if (nombreSegmento[0] != '\0') {
+        shm_unlink(nombreSegmento);
+    }
+    
+    free(latencias);
+    latencias = NULL;
+    liberarReservasFamilias();
 }
\ No newline at end of file
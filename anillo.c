@@ -0,0 +1,263 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: anillo.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Transporte de tramas en memoria compartida
+ * -----------------------------------------------
+ * Descripción:
+ * Implementa el segmento de memoria compartida y los
+ * anillos de tramas declarados en anillo.h. Las colas
+ * siguen el esquema de celdas con secuencia de Vyukov
+ * y las esperas usan futex compartidos entre procesos.
+ *****************************************************/
+
+#define _GNU_SOURCE  // syscall() para futex
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "anillo.h"
+
+/* ============================================================================
+ * ESPERAS CON FUTEX
+ * ============================================================================ */
+/*
+ * Duerme mientras la palabra siga valiendo valor (vuelve de inmediato si ya
+ * cambió), a lo sumo plazo (NULL = sin límite).
+ */
+static void esperarFutex(atomic_uint *palabra, unsigned int valor, const struct timespec *plazo) {
+    syscall(SYS_futex, (unsigned int *)palabra, FUTEX_WAIT, valor, plazo, NULL, 0);
+}
+
+static void despertarFutex(atomic_uint *palabra) {
+    syscall(SYS_futex, (unsigned int *)palabra, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Anuncia un evento y despierta solo si alguien duerme esperándolo */
+static void avisar(atomic_uint *aviso, atomic_uint *esperando) {
+    atomic_fetch_add(aviso, 1);
+    if (atomic_load(esperando) > 0) {
+        despertarFutex(aviso);
+    }
+}
+
+/* Espera a que el aviso cambie respecto de visto (lo leído antes de intentar) */
+static void esperarAviso(atomic_uint *aviso, atomic_uint *esperando, unsigned int visto,
+                         const struct timespec *plazo) {
+    atomic_fetch_add(esperando, 1);
+    esperarFutex(aviso, visto, plazo);
+    atomic_fetch_sub(esperando, 1);
+}
+
+/* ============================================================================
+ * COLA SIN CERROJOS
+ * ============================================================================ */
+static void inicializarAnillo(AnilloTramas *anillo) {
+    memset(anillo, 0, sizeof(*anillo));
+    for (unsigned int i = 0; i < TAM_ANILLO; i++) {
+        atomic_init(&anillo->celdas[i].secuencia, i);
+    }
+}
+
+/* Copia la trama en la siguiente celda libre; devuelve 0 si el anillo está lleno */
+static int insertarTrama(AnilloTramas *anillo, const uint8_t *trama, size_t longitud) {
+    unsigned int posicion = atomic_load_explicit(&anillo->escritura, memory_order_relaxed);
+
+    for (;;) {
+        CeldaAnillo *celda = &anillo->celdas[posicion & (TAM_ANILLO - 1)];
+        unsigned int secuencia = atomic_load_explicit(&celda->secuencia, memory_order_acquire);
+        int diferencia = (int)(secuencia - posicion);
+
+        if (diferencia == 0) {
+            // Celda libre en este turno: reservarla antes de escribir
+            if (atomic_compare_exchange_weak_explicit(&anillo->escritura, &posicion, posicion + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                memcpy(celda->datos, trama, longitud);
+                celda->longitud = (uint32_t)longitud;
+                atomic_store_explicit(&celda->secuencia, posicion + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diferencia < 0) {
+            return 0;  // La celda aún no se ha leído en la vuelta anterior
+        } else {
+            posicion = atomic_load_explicit(&anillo->escritura, memory_order_relaxed);
+        }
+    }
+}
+
+/* Saca la trama más antigua; devuelve 0 si el anillo está vacío */
+static int extraerTrama(AnilloTramas *anillo, uint8_t *trama, size_t *longitud) {
+    unsigned int posicion = atomic_load_explicit(&anillo->lectura, memory_order_relaxed);
+
+    for (;;) {
+        CeldaAnillo *celda = &anillo->celdas[posicion & (TAM_ANILLO - 1)];
+        unsigned int secuencia = atomic_load_explicit(&celda->secuencia, memory_order_acquire);
+        int diferencia = (int)(secuencia - (posicion + 1));
+
+        if (diferencia == 0) {
+            if (atomic_compare_exchange_weak_explicit(&anillo->lectura, &posicion, posicion + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                // La longitud viene del otro proceso: no confiar en ella
+                *longitud = celda->longitud <= MAX_TRAMA ? celda->longitud : 0;
+                memcpy(trama, celda->datos, *longitud);
+                atomic_store_explicit(&celda->secuencia, posicion + TAM_ANILLO, memory_order_release);
+                return 1;
+            }
+        } else if (diferencia < 0) {
+            return 0;  // La celda aún no se ha publicado
+        } else {
+            posicion = atomic_load_explicit(&anillo->lectura, memory_order_relaxed);
+        }
+    }
+}
+
+/*
+ * Publica una trama (a lo sumo MAX_TRAMA bytes), esperando si el anillo está
+ * lleno. Devuelve 0 si el anillo se cerró, como un write sobre un pipe sin
+ * lector.
+ */
+int escribirEnAnillo(AnilloTramas *anillo, const uint8_t *trama, size_t longitud) {
+    for (;;) {
+        unsigned int visto = atomic_load(&anillo->avisoEspacio);
+
+        if (atomic_load(&anillo->cerrado)) {
+            return 0;
+        }
+        if (insertarTrama(anillo, trama, longitud)) {
+            avisar(&anillo->avisoDatos, &anillo->esperandoDatos);
+            return 1;
+        }
+        esperarAviso(&anillo->avisoEspacio, &anillo->esperandoEspacio, visto, NULL);
+    }
+}
+
+/*
+ * Como escribirEnAnillo, pero espera espacio a lo sumo plazoMs. Devuelve 1 si
+ * publicó la trama, 0 si el anillo se cerró y -1 si no hubo lugar a tiempo.
+ */
+int escribirEnAnilloConPlazo(AnilloTramas *anillo, const uint8_t *trama, size_t longitud, int plazoMs) {
+    struct timespec inicio, ahora;
+
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    for (;;) {
+        unsigned int visto = atomic_load(&anillo->avisoEspacio);
+
+        if (atomic_load(&anillo->cerrado)) {
+            return 0;
+        }
+        if (insertarTrama(anillo, trama, longitud)) {
+            avisar(&anillo->avisoDatos, &anillo->esperandoDatos);
+            return 1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &ahora);
+        long restante = plazoMs * 1000000L - ((ahora.tv_sec - inicio.tv_sec) * 1000000000L +
+                                              (ahora.tv_nsec - inicio.tv_nsec));
+        if (restante <= 0) {
+            return -1;
+        }
+        struct timespec plazo = { .tv_sec = restante / 1000000000L, .tv_nsec = restante % 1000000000L };
+        esperarAviso(&anillo->avisoEspacio, &anillo->esperandoEspacio, visto, &plazo);
+    }
+}
+
+/*
+ * Recibe la siguiente trama en trama (al menos MAX_TRAMA bytes), esperando
+ * si el anillo está vacío. Devuelve 0 cuando el anillo está cerrado y ya no
+ * quedan tramas, como un EOF.
+ */
+int leerDeAnillo(AnilloTramas *anillo, uint8_t *trama, size_t *longitud) {
+    for (;;) {
+        unsigned int visto = atomic_load(&anillo->avisoDatos);
+
+        if (extraerTrama(anillo, trama, longitud)) {
+            avisar(&anillo->avisoEspacio, &anillo->esperandoEspacio);
+            return 1;
+        }
+        if (atomic_load(&anillo->cerrado)) {
+            return 0;
+        }
+        esperarAviso(&anillo->avisoDatos, &anillo->esperandoDatos, visto, NULL);
+    }
+}
+
+/* Rechaza nuevas tramas y despierta a todos los que esperan en el anillo */
+void cerrarAnillo(AnilloTramas *anillo) {
+    atomic_store(&anillo->cerrado, 1);
+    atomic_fetch_add(&anillo->avisoDatos, 1);
+    atomic_fetch_add(&anillo->avisoEspacio, 1);
+    despertarFutex(&anillo->avisoDatos);
+    despertarFutex(&anillo->avisoEspacio);
+}
+
+/* ============================================================================
+ * SEGMENTO DE MEMORIA COMPARTIDA
+ * ============================================================================ */
+/* Crea (lo usa el agente) un segmento nuevo con ambos anillos vacíos; NULL si falla */
+SegmentoMemoria *crearSegmento(const char *nombre) {
+    int fd = shm_open(nombre, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    if (ftruncate(fd, sizeof(SegmentoMemoria)) == -1) {
+        close(fd);
+        shm_unlink(nombre);
+        return NULL;
+    }
+
+    SegmentoMemoria *segmento = mmap(NULL, sizeof(SegmentoMemoria), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  // La proyección se mantiene sin el descriptor
+    if (segmento == MAP_FAILED) {
+        shm_unlink(nombre);
+        return NULL;
+    }
+
+    segmento->version = PROTOCOLO_VERSION;
+    inicializarAnillo(&segmento->solicitudes);
+    inicializarAnillo(&segmento->respuestas);
+    return segmento;
+}
+
+/* Proyecta (lo usa el controlador) el segmento que anunció un agente; NULL si no es válido */
+SegmentoMemoria *abrirSegmento(const char *nombre) {
+    struct stat info;
+
+    int fd = shm_open(nombre, O_RDWR, 0);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    if (fstat(fd, &info) == -1 || (size_t)info.st_size != sizeof(SegmentoMemoria)) {
+        close(fd);
+        return NULL;
+    }
+
+    SegmentoMemoria *segmento = mmap(NULL, sizeof(SegmentoMemoria), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segmento == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (segmento->version != PROTOCOLO_VERSION) {
+        munmap(segmento, sizeof(SegmentoMemoria));
+        return NULL;
+    }
+    return segmento;
+}
+
+void liberarSegmento(SegmentoMemoria *segmento) {
+    if (segmento != NULL) {
+        munmap(segmento, sizeof(SegmentoMemoria));
+    }
+}
@@ -0,0 +1,82 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: anillo.h
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Transporte de tramas en memoria compartida
+ * -----------------------------------------------
+ * Descripción:
+ * Transporte opcional entre un agente y el controlador
+ * que corren en la misma máquina. El agente crea un
+ * segmento de memoria compartida POSIX (shm_open +
+ * mmap) con dos anillos de tramas, uno por sentido, y
+ * anuncia su nombre en MSG_REGISTRO. Cada anillo es una
+ * cola acotada sin cerrojos (varios productores y
+ * varios consumidores) cuyas esperas usan futex sobre
+ * contadores del propio segmento: mientras haya datos
+ * o espacio, enviar y recibir no hace ninguna llamada
+ * al sistema. Las tramas son las mismas del protocolo
+ * de los pipes.
+ *****************************************************/
+
+#ifndef ANILLO_H
+#define ANILLO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "protocolo.h"
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define TAM_ANILLO 64  // Tramas por anillo (potencia de 2)
+#define TAM_LINEA_ANILLO 64  // Los índices de productores y consumidores no comparten línea
+
+/* Una trama dentro del anillo */
+typedef struct {
+    atomic_uint secuencia;  // Turno de la celda: quién puede escribirla o leerla ahora
+    uint32_t longitud;
+    uint8_t datos[MAX_TRAMA];
+} CeldaAnillo;
+
+/*
+ * Cola acotada de tramas. Un productor reserva la posición escritura con
+ * compare-and-swap, copia la trama en su celda y la publica avanzando la
+ * secuencia de la celda; un consumidor hace lo mismo con lectura. Los
+ * avisos son contadores de eventos para futex: quien publica los incrementa
+ * y solo despierta (una llamada al sistema) si hay alguien esperando.
+ */
+typedef struct {
+    _Alignas(TAM_LINEA_ANILLO) atomic_uint escritura;  // Próxima posición a escribir
+    _Alignas(TAM_LINEA_ANILLO) atomic_uint lectura;    // Próxima posición a leer
+    _Alignas(TAM_LINEA_ANILLO) atomic_uint avisoDatos;    // Cambia con cada trama publicada
+    atomic_uint esperandoDatos;                            // Consumidores dormidos
+    _Alignas(TAM_LINEA_ANILLO) atomic_uint avisoEspacio;  // Cambia con cada trama consumida
+    atomic_uint esperandoEspacio;                          // Productores dormidos
+    atomic_uint cerrado;  // 1: no se aceptan tramas; las pendientes aún se pueden leer
+    CeldaAnillo celdas[TAM_ANILLO];
+} AnilloTramas;
+
+/* Segmento compartido por un agente y el controlador */
+typedef struct {
+    uint32_t version;           // PROTOCOLO_VERSION de quien lo creó
+    AnilloTramas solicitudes;   // Agente -> controlador
+    AnilloTramas respuestas;    // Controlador -> agente
+} SegmentoMemoria;
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+SegmentoMemoria *crearSegmento(const char *nombre);
+SegmentoMemoria *abrirSegmento(const char *nombre);
+void liberarSegmento(SegmentoMemoria *segmento);
+int escribirEnAnillo(AnilloTramas *anillo, const uint8_t *trama, size_t longitud);
+int escribirEnAnilloConPlazo(AnilloTramas *anillo, const uint8_t *trama, size_t longitud, int plazoMs);
+int leerDeAnillo(AnilloTramas *anillo, uint8_t *trama, size_t *longitud);
+void cerrarAnillo(AnilloTramas *anillo);
+
+#endif
@@ -0,0 +1,611 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: carga.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Banco de carga del sistema de reservas
+ * -----------------------------------------------
+ * Descripción:
+ * Mide el rendimiento del controlador de punta a punta.
+ * Genera un archivo de solicitudes aleatorias (con una
+ * semilla fija, para que las corridas sean comparables)
+ * por agente, arranca el controlador a máxima velocidad
+ * (-s 0) y N agentes sin pausa entre envíos (-r 0), y
+ * al terminar reúne la tasa lograda, las latencias que
+ * vieron los agentes, la latencia de admisión y la
+ * profundidad de la cola del reporte del controlador
+ * (-R) y sus cambios de contexto y tiempo de CPU. El
+ * resultado se guarda en JSON; si se indica una base
+ * (-b) se compara con ella y termina con error si la
+ * tasa bajó o la latencia p99 subió más del umbral. Si
+ * la base no existe, la corrida se guarda como base.
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define RUTA_CONTROLADOR "./controlador"
+#define RUTA_AGENTE "./agente"
+#define MAX_AGENTES_CARGA 256
+#define MAX_RUTA 512
+#define HORA_INICIAL "7"
+#define HORA_FINAL "19"
+#define MAX_PERSONAS_CARGA 8        // Personas por solicitud: de 1 a 8
+#define ESPERA_ARRANQUE_MS 5000     // Lo más que se espera a que aparezca el pipe
+#define ESPERA_FIN_SEGUNDOS 60      // Lo más que se espera al controlador tras los agentes
+#define UMBRAL_DEFECTO 15.0         // Porcentaje tolerado antes de declarar una regresión
+
+/* Lo que informa un agente al terminar (ver imprimirEstadisticasCarga en agente.c) */
+typedef struct {
+    long respondidas;
+    double p50, p90, p99, maximo;  // Milisegundos
+} ResultadoAgente;
+
+/* ============================================================================
+ * VARIABLES GLOBALES
+ * ============================================================================ */
+// Parámetros de la corrida
+int numAgentes = 4;
+long solicitudesPorAgente = 20000;
+int numTrabajadores = 4;
+int tamVentana = 16;
+int tamLote = 1;
+int aforo = 2000;
+int numDias = 1;
+int numParques = 1;
+unsigned int semilla = 1;
+char transporte[16] = "pipe";  // pipe, memoria o unix
+char rutaResultados[MAX_RUTA] = "bench_resultados.json";
+char rutaBase[MAX_RUTA] = "";
+double umbral = UMBRAL_DEFECTO;
+
+// Directorio temporal de la corrida y lo que vive en él
+char directorio[32];  // /tmp/banco_XXXXXX
+char pipeControlador[MAX_RUTA];
+char rutaSocket[MAX_RUTA];
+char rutaReporte[MAX_RUTA];
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+void procesarArgumentos(int argc, char *argv[]);
+void generarSolicitudes(int agente, const char *ruta);
+pid_t lanzar(char *const argumentos[], const char *salida);
+pid_t lanzarControlador();
+pid_t lanzarAgente(int agente);
+int esperarPipe(pid_t controlador);
+int esperarConLimite(pid_t pid, int segundos, struct rusage *uso);
+long microsegundos(const struct timeval *tiempo);
+int leerResultadoAgente(const char *ruta, ResultadoAgente *resultado);
+char *leerArchivo(const char *ruta);
+double buscarNumero(const char *json, const char *objeto, const char *campo);
+int compararConBase(const char *resultados);
+void borrarDirectorio();
+double segundosAhora();
+
+/* ============================================================================
+ * FUNCIÓN PRINCIPAL
+ * ============================================================================ */
+int main(int argc, char *argv[]) {
+    pid_t agentes[MAX_AGENTES_CARGA];
+    struct rusage usoControlador;
+
+    procesarArgumentos(argc, argv);
+
+    // Todo lo de la corrida (solicitudes, pipe, registros y reporte) va a un directorio propio
+    strcpy(directorio, "/tmp/banco_XXXXXX");
+    if (mkdtemp(directorio) == NULL) {
+        perror("Error al crear el directorio de la corrida");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(pipeControlador, sizeof(pipeControlador), "%s/pipe_banco", directorio);
+    snprintf(rutaSocket, sizeof(rutaSocket), "unix:%s/banco.sock", directorio);
+    snprintf(rutaReporte, sizeof(rutaReporte), "%s/reporte.json", directorio);
+
+    printf("📦 Generando %ld solicitudes para cada uno de %d agentes (semilla %u)...\n",
+           solicitudesPorAgente, numAgentes, semilla);
+    for (int a = 0; a < numAgentes; a++) {
+        char ruta[MAX_RUTA];
+        snprintf(ruta, sizeof(ruta), "%s/agente%d.csv", directorio, a);
+        generarSolicitudes(a, ruta);
+    }
+
+    pid_t controlador = lanzarControlador();
+    if (!esperarPipe(controlador)) {
+        fprintf(stderr, "Error: el controlador no arrancó (ver %s/controlador.log)\n", directorio);
+        kill(controlador, SIGKILL);
+        waitpid(controlador, NULL, 0);
+        exit(EXIT_FAILURE);
+    }
+
+    // Todos los agentes a la vez y sin pausa entre envíos
+    printf("🚀 Corriendo: %d agentes, %d trabajadores, ventana %d, lote %d, transporte %s\n",
+           numAgentes, numTrabajadores, tamVentana, tamLote, transporte);
+    double inicio = segundosAhora();
+    for (int a = 0; a < numAgentes; a++) {
+        agentes[a] = lanzarAgente(a);
+    }
+    int agentesFallidos = 0;
+    for (int a = 0; a < numAgentes; a++) {
+        int estado;
+        if (waitpid(agentes[a], &estado, 0) == -1 || !WIFEXITED(estado) || WEXITSTATUS(estado) != 0) {
+            agentesFallidos++;
+        }
+    }
+    double duracion = segundosAhora() - inicio;
+
+    // Si ningún agente llegó a conectarse, el controlador no terminaría solo
+    if (agentesFallidos == numAgentes) {
+        kill(controlador, SIGINT);
+    }
+
+    // A máxima velocidad el controlador termina solo al quedar sin agentes ni pendientes
+    if (!esperarConLimite(controlador, ESPERA_FIN_SEGUNDOS, &usoControlador)) {
+        fprintf(stderr, "Error: el controlador no terminó en %d s\n", ESPERA_FIN_SEGUNDOS);
+        exit(EXIT_FAILURE);
+    }
+
+    // Latencias vistas por los agentes: la mediana típica y el peor extremo
+    long respondidas = 0;
+    double sumaP50 = 0, peorP99 = 0, peorMaximo = 0;
+    for (int a = 0; a < numAgentes; a++) {
+        char ruta[MAX_RUTA];
+        ResultadoAgente resultado;
+        snprintf(ruta, sizeof(ruta), "%s/agente%d.log", directorio, a);
+        if (!leerResultadoAgente(ruta, &resultado)) {
+            agentesFallidos++;
+            continue;
+        }
+        respondidas += resultado.respondidas;
+        sumaP50 += resultado.p50;
+        peorP99 = resultado.p99 > peorP99 ? resultado.p99 : peorP99;
+        peorMaximo = resultado.maximo > peorMaximo ? resultado.maximo : peorMaximo;
+    }
+
+    char *reporte = leerArchivo(rutaReporte);
+    if (reporte == NULL) {
+        fprintf(stderr, "Error: no se pudo leer el reporte del controlador %s\n", rutaReporte);
+        exit(EXIT_FAILURE);
+    }
+
+    double tasa = duracion > 0 ? (double)respondidas / duracion : 0;
+    double cerrojoP99 = buscarNumero(reporte, "cerrojo", "p99");  // Solo con make INSTRUMENTAR=1
+    char resultados[4096];
+    snprintf(resultados, sizeof(resultados),
+             "{\"configuracion\":{\"agentes\":%d,\"solicitudesPorAgente\":%ld,\"trabajadores\":%d,"
+             "\"ventana\":%d,\"lote\":%d,\"transporte\":\"%s\",\"dias\":%d,\"parques\":%d,\"aforo\":%d,"
+             "\"semilla\":%u},\n"
+             " \"resultados\":{\"respondidas\":%ld,\"agentesFallidos\":%d,\"segundos\":%.3f,"
+             "\"solicitudesPorSegundo\":%.1f,"
+             "\"aceptadas\":%.0f,\"reprogramadas\":%.0f,\"negadas\":%.0f,\n"
+             "  \"latenciaAgentesMs\":{\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f},\n"
+             "  \"latenciaAdmisionUs\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f},\n"
+             "  \"contencion\":{\"maximoCola\":%.0f,\"cerrojoP99Us\":%.3f,\"cambiosVoluntarios\":%ld,"
+             "\"cambiosInvoluntarios\":%ld,\"cpuUsuario\":%.3f,\"cpuSistema\":%.3f}}}\n",
+             numAgentes, solicitudesPorAgente, numTrabajadores, tamVentana, tamLote, transporte,
+             numDias, numParques, aforo, semilla,
+             respondidas, agentesFallidos, duracion, tasa,
+             buscarNumero(reporte, "solicitudes", "aceptadas"), buscarNumero(reporte, "solicitudes", "reprogramadas"),
+             buscarNumero(reporte, "solicitudes", "negadas"),
+             numAgentes > 0 ? sumaP50 / numAgentes : 0, peorP99, peorMaximo,
+             buscarNumero(reporte, "latenciaAdmisionUs", "p50"), buscarNumero(reporte, "latenciaAdmisionUs", "p90"),
+             buscarNumero(reporte, "latenciaAdmisionUs", "p99"), buscarNumero(reporte, "latenciaAdmisionUs", "max"),
+             buscarNumero(reporte, "cola", "maximo"), cerrojoP99,
+             usoControlador.ru_nvcsw, usoControlador.ru_nivcsw,
+             (double)usoControlador.ru_utime.tv_sec + usoControlador.ru_utime.tv_usec / 1e6,
+             (double)usoControlador.ru_stime.tv_sec + usoControlador.ru_stime.tv_usec / 1e6);
+    free(reporte);
+
+    printf("\n📊 RESULTADOS DEL BANCO DE CARGA:\n");
+    printf("   • Solicitudes respondidas:  %ld en %.3f s (%d agentes fallidos)\n", respondidas, duracion, agentesFallidos);
+    printf("   • Tasa lograda:             %.1f solicitudes/s\n", tasa);
+    printf("   • Latencia de los agentes:  p50 %.3f ms (media) | p99 %.3f ms (peor) | máx %.3f ms\n",
+           numAgentes > 0 ? sumaP50 / numAgentes : 0, peorP99, peorMaximo);
+    printf("   • Contención:               %ld cambios de contexto voluntarios, %ld involuntarios\n",
+           usoControlador.ru_nvcsw, usoControlador.ru_nivcsw);
+
+    FILE *archivo = fopen(rutaResultados, "w");
+    if (archivo == NULL || fputs(resultados, archivo) == EOF || fclose(archivo) != 0) {
+        perror("Error al guardar los resultados");
+        exit(EXIT_FAILURE);
+    }
+    printf("   • Resultados en:            %s\n", rutaResultados);
+
+    int regresion = compararConBase(resultados);
+    if (agentesFallidos > 0) {
+        fprintf(stderr, "Error: fallaron %d agentes (ver los registros en %s)\n", agentesFallidos, directorio);
+    } else {
+        borrarDirectorio();
+    }
+
+    return (agentesFallidos > 0 || regresion) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* ============================================================================
+ * PROCESAMIENTO DE ARGUMENTOS
+ * ============================================================================ */
+void procesarArgumentos(int argc, char *argv[]) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:w:W:l:t:D:P:T:x:o:b:u:")) != -1) {
+        switch (opt) {
+            case 'n':
+                numAgentes = atoi(optarg);
+                break;
+            case 's':
+                solicitudesPorAgente = atol(optarg);
+                break;
+            case 'w':
+                numTrabajadores = atoi(optarg);
+                break;
+            case 'W':
+                tamVentana = atoi(optarg);
+                break;
+            case 'l':
+                tamLote = atoi(optarg);
+                break;
+            case 't':
+                aforo = atoi(optarg);
+                break;
+            case 'D':
+                numDias = atoi(optarg);
+                break;
+            case 'P':
+                numParques = atoi(optarg);
+                break;
+            case 'T':
+                strncpy(transporte, optarg, sizeof(transporte) - 1);
+                transporte[sizeof(transporte) - 1] = '\0';
+                break;
+            case 'x':
+                semilla = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'o':
+                strncpy(rutaResultados, optarg, MAX_RUTA - 1);
+                rutaResultados[MAX_RUTA - 1] = '\0';
+                break;
+            case 'b':
+                strncpy(rutaBase, optarg, MAX_RUTA - 1);
+                rutaBase[MAX_RUTA - 1] = '\0';
+                break;
+            case 'u':
+                umbral = strtod(optarg, NULL);
+                break;
+            default:
+                fprintf(stderr, "Uso: %s [-n <agentes>] [-s <solicitudesPorAgente>] [-w <hilos>] [-W <ventana>] "
+                        "[-l <tamLote>] [-t <aforo>] [-D <dias>] [-P <parques>] [-T pipe|memoria|unix] "
+                        "[-x <semilla>] [-o <resultados.json>] [-b <base.json>] [-u <umbral%%>]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (numAgentes < 1 || numAgentes > MAX_AGENTES_CARGA || solicitudesPorAgente < 1) {
+        fprintf(stderr, "Error: Los agentes deben estar entre 1 y %d y las solicitudes ser al menos 1\n",
+                MAX_AGENTES_CARGA);
+        exit(EXIT_FAILURE);
+    }
+
+    if (strcmp(transporte, "pipe") != 0 && strcmp(transporte, "memoria") != 0 && strcmp(transporte, "unix") != 0) {
+        fprintf(stderr, "Error: El transporte debe ser pipe, memoria o unix\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (aforo < 1 || numDias < 1 || numParques < 1 || umbral <= 0) {
+        fprintf(stderr, "Error: El aforo, los días, los parques y el umbral deben ser mayores a 0\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* ============================================================================
+ * GENERACIÓN DE LA CARGA
+ * ============================================================================ */
+/* Solicitudes aleatorias repartidas entre las horas, los días y los parques */
+void generarSolicitudes(int agente, const char *ruta) {
+    unsigned int estado = semilla * 7919u + (unsigned int)agente;
+    FILE *archivo = fopen(ruta, "w");
+    if (archivo == NULL) {
+        perror("Error al crear el archivo de solicitudes");
+        exit(EXIT_FAILURE);
+    }
+
+    int horas = atoi(HORA_FINAL) - atoi(HORA_INICIAL) + 1;
+    for (long i = 0; i < solicitudesPorAgente; i++) {
+        int hora = atoi(HORA_INICIAL) + rand_r(&estado) % horas;
+        int personas = 1 + rand_r(&estado) % MAX_PERSONAS_CARGA;
+        int dia = rand_r(&estado) % numDias;
+        int parque = rand_r(&estado) % numParques;
+        fprintf(archivo, "Familia_%d_%ld,%d,%d,%d,%d\n", agente, i, hora, personas, dia, parque);
+    }
+
+    if (fclose(archivo) != 0) {
+        perror("Error al escribir el archivo de solicitudes");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Ejecuta un programa con la salida estándar y de error en un archivo */
+pid_t lanzar(char *const argumentos[], const char *salida) {
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("Error al crear el proceso");
+        exit(EXIT_FAILURE);
+    }
+
+    if (pid == 0) {
+        int fd = open(salida, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd != -1) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execv(argumentos[0], argumentos);
+        perror("Error al ejecutar el programa");
+        _exit(127);
+    }
+    return pid;
+}
+
+pid_t lanzarControlador() {
+    char aforoTexto[16], trabajadores[16], dias[16], parques[16], salida[MAX_RUTA];
+    snprintf(aforoTexto, sizeof(aforoTexto), "%d", aforo);
+    snprintf(trabajadores, sizeof(trabajadores), "%d", numTrabajadores);
+    snprintf(dias, sizeof(dias), "%d", numDias);
+    snprintf(parques, sizeof(parques), "%d", numParques);
+    snprintf(salida, sizeof(salida), "%s/controlador.log", directorio);
+
+    // Con -v 0 la consola no pesa en la medición; -R deja el reporte para leerlo
+    char *argumentos[] = {
+        RUTA_CONTROLADOR, "-i", HORA_INICIAL, "-f", HORA_FINAL, "-s", "0", "-t", aforoTexto,
+        "-p", pipeControlador, "-w", trabajadores, "-D", dias, "-P", parques, "-v", "0",
+        "-R", rutaReporte, "-L", rutaSocket, NULL
+    };
+    if (strcmp(transporte, "unix") != 0) {
+        argumentos[21] = NULL;  // Sin socket de escucha
+    }
+    return lanzar(argumentos, salida);
+}
+
+pid_t lanzarAgente(int agente) {
+    char nombre[32], archivo[MAX_RUTA], ventana[16], lote[16], salida[MAX_RUTA];
+    snprintf(nombre, sizeof(nombre), "Banco%d", agente);
+    snprintf(archivo, sizeof(archivo), "%s/agente%d.csv", directorio, agente);
+    snprintf(ventana, sizeof(ventana), "%d", tamVentana);
+    snprintf(lote, sizeof(lote), "%d", tamLote);
+    snprintf(salida, sizeof(salida), "%s/agente%d.log", directorio, agente);
+
+    char *destino = strcmp(transporte, "unix") == 0 ? rutaSocket : pipeControlador;
+    // El agente no admite -l y -W juntos: con lotes la ventana no aplica
+    char *argumentos[] = {
+        RUTA_AGENTE, "-s", nombre, "-a", archivo, "-p", destino, "-r", "0", "-W", ventana,
+        strcmp(transporte, "memoria") == 0 ? "-M" : NULL, NULL, NULL
+    };
+    if (tamLote > 1) {
+        argumentos[9] = "-l";
+        argumentos[10] = lote;
+    }
+    return lanzar(argumentos, salida);
+}
+
+/* ============================================================================
+ * ESPERAS
+ * ============================================================================ */
+/* Espera a que el controlador cree su pipe (y su socket, si se usa). 0 si murió antes */
+int esperarPipe(pid_t controlador) {
+    struct stat info;
+    const char *socketUnix = rutaSocket + strlen("unix:");
+
+    for (int ms = 0; ms < ESPERA_ARRANQUE_MS; ms += 10) {
+        if (waitpid(controlador, NULL, WNOHANG) == controlador) {
+            return 0;
+        }
+        if (stat(pipeControlador, &info) == 0 && S_ISFIFO(info.st_mode) &&
+            (strcmp(transporte, "unix") != 0 || stat(socketUnix, &info) == 0)) {
+            return 1;
+        }
+        struct timespec pausa = { 0, 10 * 1000000L };
+        nanosleep(&pausa, NULL);
+    }
+    return 0;
+}
+
+/*
+ * Espera a un proceso a lo sumo los segundos indicados; pasado el plazo lo
+ * interrumpe. En uso deja lo que consumió: la diferencia de RUSAGE_CHILDREN
+ * antes y después de recogerlo (los agentes ya se recogieron antes).
+ */
+int esperarConLimite(pid_t pid, int segundos, struct rusage *uso) {
+    struct rusage antes, despues;
+    int estado, terminado = 0;
+
+    getrusage(RUSAGE_CHILDREN, &antes);
+    for (int ms = 0; ms < segundos * 1000 && !terminado; ms += 10) {
+        if (waitpid(pid, &estado, WNOHANG) == pid) {
+            terminado = 1;
+            break;
+        }
+        struct timespec pausa = { 0, 10 * 1000000L };
+        nanosleep(&pausa, NULL);
+    }
+    if (!terminado) {
+        kill(pid, SIGINT);
+        waitpid(pid, &estado, 0);
+    }
+    getrusage(RUSAGE_CHILDREN, &despues);
+
+    uso->ru_nvcsw = despues.ru_nvcsw - antes.ru_nvcsw;
+    uso->ru_nivcsw = despues.ru_nivcsw - antes.ru_nivcsw;
+    long usuario = microsegundos(&despues.ru_utime) - microsegundos(&antes.ru_utime);
+    long sistema = microsegundos(&despues.ru_stime) - microsegundos(&antes.ru_stime);
+    uso->ru_utime.tv_sec = usuario / 1000000;
+    uso->ru_utime.tv_usec = usuario % 1000000;
+    uso->ru_stime.tv_sec = sistema / 1000000;
+    uso->ru_stime.tv_usec = sistema % 1000000;
+
+    return terminado && WIFEXITED(estado) && WEXITSTATUS(estado) == 0;
+}
+
+long microsegundos(const struct timeval *tiempo) {
+    return (long)tiempo->tv_sec * 1000000L + (long)tiempo->tv_usec;
+}
+
+double segundosAhora() {
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    return (double)ahora.tv_sec + (double)ahora.tv_nsec / 1e9;
+}
+
+/* ============================================================================
+ * LECTURA DE RESULTADOS
+ * ============================================================================ */
+/* Toma las estadísticas de carga que el agente imprime al terminar */
+int leerResultadoAgente(const char *ruta, ResultadoAgente *resultado) {
+    char *texto = leerArchivo(ruta);
+    if (texto == NULL) {
+        return 0;
+    }
+
+    const char *respondidas = strstr(texto, "Solicitudes respondidas:");
+    const char *latencia = strstr(texto, "Latencia (ms):");
+    const char *p50 = latencia != NULL ? strstr(latencia, "p50 ") : NULL;
+    int leido = respondidas != NULL && p50 != NULL &&
+                sscanf(respondidas, "Solicitudes respondidas: %ld", &resultado->respondidas) == 1 &&
+                sscanf(p50, "p50 %lf | p90 %lf | p99 %lf | máx %lf",
+                       &resultado->p50, &resultado->p90, &resultado->p99, &resultado->maximo) == 4;
+
+    free(texto);
+    return leido;
+}
+
+char *leerArchivo(const char *ruta) {
+    FILE *archivo = fopen(ruta, "r");
+    if (archivo == NULL) {
+        return NULL;
+    }
+
+    size_t capacidad = 4096, longitud = 0, leidos;
+    char *texto = malloc(capacidad);
+    while (texto != NULL && (leidos = fread(texto + longitud, 1, capacidad - longitud - 1, archivo)) > 0) {
+        longitud += leidos;
+        if (capacidad - longitud - 1 == 0) {
+            char *mayor = realloc(texto, capacidad * 2);
+            if (mayor == NULL) {
+                free(texto);
+                texto = NULL;
+                break;
+            }
+            texto = mayor;
+            capacidad *= 2;
+        }
+    }
+    fclose(archivo);
+
+    if (texto != NULL) {
+        texto[longitud] = '\0';
+    }
+    return texto;
+}
+
+/*
+ * Valor numérico de "campo" dentro del primer objeto "objeto" del JSON (sin
+ * un intérprete completo: basta para lo que escriben el controlador y este
+ * banco). Devuelve -1 si no aparece.
+ */
+double buscarNumero(const char *json, const char *objeto, const char *campo) {
+    char clave[64];
+
+    snprintf(clave, sizeof(clave), "\"%s\":{", objeto);
+    const char *inicio = strstr(json, clave);
+    if (inicio == NULL) {
+        return -1;
+    }
+    const char *fin = strchr(inicio + strlen(clave), '}');
+
+    snprintf(clave, sizeof(clave), "\"%s\":", campo);
+    const char *valor = strstr(inicio, clave);
+    if (valor == NULL || (fin != NULL && valor > fin)) {
+        return -1;
+    }
+    return strtod(valor + strlen(clave), NULL);
+}
+
+/* ============================================================================
+ * COMPARACIÓN CON LA BASE
+ * ============================================================================ */
+/*
+ * Compara la tasa y la latencia de admisión p99 con la base. Devuelve 1 si
+ * alguna empeoró más del umbral; sin base, guarda la corrida como base.
+ */
+int compararConBase(const char *resultados) {
+    if (rutaBase[0] == '\0') {
+        return 0;
+    }
+
+    char *base = leerArchivo(rutaBase);
+    if (base == NULL) {
+        FILE *archivo = fopen(rutaBase, "w");
+        if (archivo == NULL || fputs(resultados, archivo) == EOF || fclose(archivo) != 0) {
+            perror("Error al guardar la base");
+            return 0;
+        }
+        printf("   • Sin base previa: esta corrida queda como base en %s\n", rutaBase);
+        return 0;
+    }
+
+    double tasaBase = buscarNumero(base, "resultados", "solicitudesPorSegundo");
+    double tasa = buscarNumero(resultados, "resultados", "solicitudesPorSegundo");
+    double p99Base = buscarNumero(base, "latenciaAdmisionUs", "p99");
+    double p99 = buscarNumero(resultados, "latenciaAdmisionUs", "p99");
+    free(base);
+
+    int regresion = 0;
+    printf("\n📏 COMPARACIÓN CON LA BASE (%s, umbral %.0f%%):\n", rutaBase, umbral);
+    if (tasaBase > 0) {
+        double cambio = (tasa - tasaBase) / tasaBase * 100.0;
+        int peor = cambio < -umbral;
+        printf("   • Tasa:             %.1f → %.1f solicitudes/s (%+.1f%%)%s\n", tasaBase, tasa, cambio,
+               peor ? "  ❌ REGRESIÓN" : "");
+        regresion |= peor;
+    }
+    if (p99Base > 0) {
+        double cambio = (p99 - p99Base) / p99Base * 100.0;
+        int peor = cambio > umbral;
+        printf("   • Latencia p99:     %.3f → %.3f µs (%+.1f%%)%s\n", p99Base, p99, cambio,
+               peor ? "  ❌ REGRESIÓN" : "");
+        regresion |= peor;
+    }
+    return regresion;
+}
+
+/* Borra los archivos de la corrida y su directorio */
+void borrarDirectorio() {
+    char ruta[MAX_RUTA];
+    const char *fijos[] = { "pipe_banco", "banco.sock", "reporte.json", "controlador.log" };
+
+    for (size_t i = 0; i < sizeof(fijos) / sizeof(fijos[0]); i++) {
+        snprintf(ruta, sizeof(ruta), "%s/%s", directorio, fijos[i]);
+        unlink(ruta);
+    }
+    for (int a = 0; a < numAgentes; a++) {
+        snprintf(ruta, sizeof(ruta), "%s/agente%d.csv", directorio, a);
+        unlink(ruta);
+        snprintf(ruta, sizeof(ruta), "%s/agente%d.log", directorio, a);
+        unlink(ruta);
+    }
+    rmdir(directorio);
+}
@@ -1,943 +1,4040 @@
-/*****************************************************
- * PONTIFICIA UNIVERSIDAD JAVERIANA
- *
- * Materia: Sistemas Operativos
- * Docente: J. Corredor, PhD
- * Autor: Juan David Garzon Ballen
- * Programa: controlador.c
- * Fecha: 17 de noviembre de 2025
- * Tema: Controlador del Sistema de Reservas
- * -----------------------------------------------
- * Descripción:
- * Este programa implementa el servidor del sistema de
- * reservas del Parque Berlín. Actúa como un proceso
- * multihilo que gestiona el estado del parque, procesa
- * las solicitudes de reserva de múltiples agentes y
- * controla el aforo. Utiliza hilos POSIX para manejar
- * tareas concurrentes (reloj y recepción de mensajes)
- * y mutex para garantizar la exclusión mutua al acceder
- * a datos compartidos. La comunicación con los agentes
- * se realiza a través de named pipes (FIFOs).
- *****************************************************/
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <pthread.h>
-#include <signal.h>
-#include <fcntl.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <sys/select.h>
-#include <errno.h>
-#include <time.h>
-
-/* ============================================================================
- * CONSTANTES Y DEFINICIONES
- * ============================================================================ */
-#define MAX_BUFFER 1024
-#define MAX_AGENTES 50
-#define MAX_NOMBRE 128  // Para nombres de familias y agentes
-#define MAX_PIPE_NAME 256  // Buffer más grande para nombres de pipes
-#define HORAS_MIN 7
-#define HORAS_MAX 19
-#define MAX_HORAS (HORAS_MAX - HORAS_MIN + 1)  // 13 horas
-#define DURACION_RESERVA 2  // Cada reserva es por 2 horas
-
-/* Tipos de mensaje entre agente y controlador */
-typedef enum {
-    MSG_REGISTRO,           // Registro inicial del agente
-    MSG_SOLICITUD_RESERVA,  // Solicitud de reserva
-    MSG_FIN_AGENTE          // Agente termina
-} TipoMensaje;
-
-/* Tipos de respuesta del controlador */
-typedef enum {
-    RESP_HORA_ACTUAL,       // Respuesta con hora actual
-    RESP_RESERVA_OK,        // Reserva aprobada
-    RESP_RESERVA_REPROG,    // Reserva reprogramada
-    RESP_RESERVA_NEGADA,    // Reserva negada
-    RESP_FIN_DIA            // Fin del día
-} TipoRespuesta;
-
-/* Estructura para mensajes del agente al controlador */
-typedef struct {
-    TipoMensaje tipo;
-    char nombreAgente[MAX_NOMBRE];
-    char pipeRespuesta[MAX_NOMBRE];  // Pipe para respuestas específicas
-    char nombreFamilia[MAX_NOMBRE];
-    int horaSolicitada;
-    int numPersonas;
-} MensajeAgente;
-
-/* Estructura para respuestas del controlador al agente */
-typedef struct {
-    TipoRespuesta tipo;
-    int horaAsignada;
-    int horaActual;
-    char mensaje[MAX_BUFFER];
-} RespuestaControlador;
-
-/* Estructura para registrar una reserva */
-typedef struct {
-    char nombreFamilia[MAX_NOMBRE];
-    char nombreAgente[MAX_NOMBRE];
-    int horaInicio;
-    int horaFin;
-    int numPersonas;
-    int activa;  // 1 si está activa, 0 si ya salió
-} Reserva;
-
-/* Estructura para información de un agente registrado */
-typedef struct {
-    char nombre[MAX_NOMBRE];
-    char pipeRespuesta[MAX_NOMBRE];
-    int activo;
-} AgenteInfo;
-
-/* ============================================================================
- * VARIABLES GLOBALES
- * ============================================================================ */
-// Parámetros de configuración
-int horaInicial;
-int horaFinal;
-int segundosPorHora;
-int aforoMaximo;
-char pipeRecibe[MAX_NOMBRE];
-
-// Estado del sistema
-int horaActual;
-int ocupacionPorHora[MAX_HORAS];  // Personas por hora
-Reserva reservas[1000];
-int numReservas = 0;
-AgenteInfo agentesRegistrados[MAX_AGENTES];
-int numAgentes = 0;
-
-// Estadísticas
-int solicitudesNegadas = 0;
-int solicitudesAceptadas = 0;
-int solicitudesReprogramadas = 0;
-
-// Mutex y variables de sincronización
-pthread_mutex_t mutexReservas = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t mutexAgentes = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t mutexEstadisticas = PTHREAD_MUTEX_INITIALIZER;
-
-// Control de señales
-volatile sig_atomic_t alarmaRecibida = 0;
-volatile sig_atomic_t finalizarServidor = 0;
-
-/* ============================================================================
- * PROTOTIPOS DE FUNCIONES
- * ============================================================================ */
-void procesarArgumentos(int argc, char *argv[]);
-void inicializarServidor();
-void manejadorAlarma(int sig);
-void manejadorSigInt(int sig);
-void *hiloReloj(void *arg);
-void *hiloRecibirPeticiones(void *arg);
-void procesarMensaje(MensajeAgente *msg, int fdPipeRecibe);
-void registrarAgente(MensajeAgente *msg);
-void procesarSolicitudReserva(MensajeAgente *msg);
-void enviarRespuesta(char *pipeAgente, RespuestaControlador *resp);
-int verificarDisponibilidad(int hora, int numPersonas);
-int buscarHoraAlternativa(int numPersonas, int *horaEncontrada);
-void avanzarHora();
-void imprimirEstadoHora();
-void generarReporte();
-void limpiarRecursos();
-int validarHora(int hora);
-int indiceHora(int hora);
-
-/* ============================================================================
- * FUNCIÓN PRINCIPAL
- * ============================================================================ */
-int main(int argc, char *argv[]) {
-    pthread_t tidReloj, tidPeticiones;
-    
-    printf("\n");
-    printf("╔════════════════════════════════════════════════════════════╗\n");
-    printf("║  SISTEMA DE RESERVAS - PARQUE BERLÍN                       ║\n");
-    printf("║  Controlador de Reservas (Servidor)                        ║\n");
-    printf("╚════════════════════════════════════════════════════════════╝\n");
-    printf("\n");
-    
-    // Procesar argumentos de línea de comandos
-    procesarArgumentos(argc, argv);
-    
-    // Inicializar el servidor
-    inicializarServidor();
-    
-    // Configurar manejadores de señales
-    signal(SIGALRM, manejadorAlarma);
-    signal(SIGINT, manejadorSigInt);
-    
-    // Crear hilo para el reloj de simulación
-    if (pthread_create(&tidReloj, NULL, hiloReloj, NULL) != 0) {
-        perror("Error al crear hilo del reloj");
-        limpiarRecursos();
-        exit(EXIT_FAILURE);
-    }
-    
-    // Crear hilo para recibir peticiones de agentes
-    if (pthread_create(&tidPeticiones, NULL, hiloRecibirPeticiones, NULL) != 0) {
-        perror("Error al crear hilo de peticiones");
-        limpiarRecursos();
-        exit(EXIT_FAILURE);
-    }
-    
-    printf("✓ Servidor iniciado correctamente\n");
-    printf("✓ Hora inicial: %d:00\n", horaActual);
-    printf("✓ Hora final: %d:00\n", horaFinal);
-    printf("✓ Aforo máximo: %d personas\n", aforoMaximo);
-    printf("✓ Segundos por hora: %d\n", segundosPorHora);
-    printf("✓ Esperando conexiones de agentes...\n\n");
-    
-    // Esperar a que el hilo del reloj termine (termina cuando horaActual > horaFinal)
-    pthread_join(tidReloj, NULL);
-    
-    // Dar tiempo para que los agentes reciban últimas respuestas
-    printf("⏳ Esperando finalización de comunicaciones...\n");
-    sleep(2);
-    
-    // Marcar finalización para el hilo de peticiones
-    finalizarServidor = 1;
-    
-    // Dar tiempo para que el hilo de peticiones detecte la señal de finalización
-    sleep(1);
-    
-    // Cancelar el hilo de peticiones si aún está esperando
-    pthread_cancel(tidPeticiones);
-    pthread_join(tidPeticiones, NULL);
-    
-    // Generar reporte final
-    generarReporte();
-    
-    // Limpiar recursos
-    limpiarRecursos();
-    
-    printf("\n✓ Servidor finalizado correctamente\n\n");
-    
-    return 0;
-}
-
-/* ============================================================================
- * PROCESAMIENTO DE ARGUMENTOS
- * ============================================================================ */
-void procesarArgumentos(int argc, char *argv[]) {
-    int opt;
-    int flagI = 0, flagF = 0, flagS = 0, flagT = 0, flagP = 0;
-    
-    while ((opt = getopt(argc, argv, "i:f:s:t:p:")) != -1) {
-        switch (opt) {
-            case 'i':
-                horaInicial = atoi(optarg);
-                flagI = 1;
-                break;
-            case 'f':
-                horaFinal = atoi(optarg);
-                flagF = 1;
-                break;
-            case 's':
-                segundosPorHora = atoi(optarg);
-                flagS = 1;
-                break;
-            case 't':
-                aforoMaximo = atoi(optarg);
-                flagT = 1;
-                break;
-            case 'p':
-                strncpy(pipeRecibe, optarg, MAX_NOMBRE - 1);
-                pipeRecibe[MAX_NOMBRE - 1] = '\0';
-                flagP = 1;
-                break;
-            default:
-                fprintf(stderr, "Uso: %s -i <horaIni> -f <horaFin> -s <segHoras> -t <total> -p <pipeRecibe>\n", argv[0]);
-                exit(EXIT_FAILURE);
-        }
-    }
-    
-    // Validar que todos los parámetros fueron proporcionados
-    if (!flagI || !flagF || !flagS || !flagT || !flagP) {
-        fprintf(stderr, "Error: Faltan parámetros obligatorios\n");
-        fprintf(stderr, "Uso: %s -i <horaIni> -f <horaFin> -s <segHoras> -t <total> -p <pipeRecibe>\n", argv[0]);
-        exit(EXIT_FAILURE);
-    }
-    
-    // Validar rangos
-    if (!validarHora(horaInicial) || !validarHora(horaFinal)) {
-        fprintf(stderr, "Error: Las horas deben estar entre %d y %d\n", HORAS_MIN, HORAS_MAX);
-        exit(EXIT_FAILURE);
-    }
-    
-    if (horaInicial >= horaFinal) {
-        fprintf(stderr, "Error: La hora inicial debe ser menor que la hora final\n");
-        exit(EXIT_FAILURE);
-    }
-    
-    if (segundosPorHora <= 0) {
-        fprintf(stderr, "Error: Los segundos por hora deben ser mayores a 0\n");
-        exit(EXIT_FAILURE);
-    }
-    
-    if (aforoMaximo <= 0) {
-        fprintf(stderr, "Error: El aforo máximo debe ser mayor a 0\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
-/* ============================================================================
- * INICIALIZACIÓN DEL SERVIDOR
- * ============================================================================ */
-void inicializarServidor() {
-    // Inicializar hora actual
-    horaActual = horaInicial;
-    
-    // Inicializar ocupación por hora
-    memset(ocupacionPorHora, 0, sizeof(ocupacionPorHora));
-    
-    // Crear el pipe nominal para recibir mensajes
-    unlink(pipeRecibe);  // Eliminar si existe
-    if (mkfifo(pipeRecibe, 0666) == -1) {
-        if (errno != EEXIST) {
-            perror("Error al crear pipe de recepción");
-            exit(EXIT_FAILURE);
-        }
-    }
-}
-
-/* ============================================================================
- * MANEJADORES DE SEÑALES
- * ============================================================================ */
-void manejadorAlarma(int sig) {
-    (void)sig;  // Suprimir warning de parámetro no usado
-    alarmaRecibida = 1;
-}
-
-void manejadorSigInt(int sig) {
-    (void)sig;  // Suprimir warning de parámetro no usado
-    finalizarServidor = 1;
-}
-
-/* ============================================================================
- * HILO DEL RELOJ DE SIMULACIÓN
- * ============================================================================ */
-void *hiloReloj(void *arg) {
-    (void)arg;  // Suprimir warning de parámetro no usado
-    
-    while (horaActual <= horaFinal && !finalizarServidor) {
-        // Esperar los segundos configurados (simula el paso de una hora)
-        sleep(segundosPorHora);
-        
-        // Avanzar a la siguiente hora
-        avanzarHora();
-        
-        // Imprimir estado actual
-        imprimirEstadoHora();
-    }
-    
-    // Marcar que el servidor debe finalizar
-    finalizarServidor = 1;
-    
-    // Notificar que la simulación ha terminado
-    printf("\n");
-    printf("╔════════════════════════════════════════════════════════════╗\n");
-    printf("║          🏁 SIMULACIÓN FINALIZADA                          ║\n");
-    printf("╚════════════════════════════════════════════════════════════╝\n");
-    printf("\n");
-    
-    return NULL;
-}
-
-/* ============================================================================
- * HILO PARA RECIBIR PETICIONES DE AGENTES
- * ============================================================================ */
-void *hiloRecibirPeticiones(void *arg) {
-    (void)arg;  // Suprimir warning de parámetro no usado
-    
-    int fdPipeRecibe;
-    MensajeAgente msg;
-    ssize_t bytesLeidos;
-    
-    // Abrir pipe en modo lectura (bloqueante hasta que un agente se conecte)
-    fdPipeRecibe = open(pipeRecibe, O_RDONLY | O_NONBLOCK);
-    if (fdPipeRecibe == -1) {
-        perror("Error al abrir pipe de recepción");
-        finalizarServidor = 1;
-        return NULL;
-    }
-    
-    // Cambiar a modo bloqueante después de abrir
-    int flags = fcntl(fdPipeRecibe, F_GETFL, 0);
-    fcntl(fdPipeRecibe, F_SETFL, flags & ~O_NONBLOCK);
-    
-    while (!finalizarServidor) {
-        // Configurar timeout para read usando select
-        fd_set readfds;
-        struct timeval tv;
-        
-        FD_ZERO(&readfds);
-        FD_SET(fdPipeRecibe, &readfds);
-        
-        // Timeout de 1 segundo
-        tv.tv_sec = 1;
-        tv.tv_usec = 0;
-        
-        int ret = select(fdPipeRecibe + 1, &readfds, NULL, NULL, &tv);
-        
-        if (ret == -1) {
-            if (errno != EINTR && !finalizarServidor) {
-                perror("Error en select");
-            }
-            continue;
-        } else if (ret == 0) {
-            // Timeout - verificar si debe finalizar
-            continue;
-        }
-        
-        // Leer mensaje del agente
-        bytesLeidos = read(fdPipeRecibe, &msg, sizeof(MensajeAgente));
-        
-        if (bytesLeidos > 0) {
-            if (bytesLeidos == sizeof(MensajeAgente)) {
-                procesarMensaje(&msg, fdPipeRecibe);
-            }
-        } else if (bytesLeidos == 0) {
-            // EOF - reabrir el pipe para aceptar nuevas conexiones
-            close(fdPipeRecibe);
-            
-            if (!finalizarServidor) {
-                fdPipeRecibe = open(pipeRecibe, O_RDONLY | O_NONBLOCK);
-                if (fdPipeRecibe == -1) {
-                    if (!finalizarServidor) {
-                        perror("Error al reabrir pipe de recepción");
-                    }
-                    break;
-                }
-                // Cambiar a modo bloqueante
-                flags = fcntl(fdPipeRecibe, F_GETFL, 0);
-                fcntl(fdPipeRecibe, F_SETFL, flags & ~O_NONBLOCK);
-            }
-        } else {
-            if (errno != EINTR && !finalizarServidor) {
-                perror("Error al leer del pipe");
-            }
-        }
-    }
-    
-    close(fdPipeRecibe);
-    return NULL;
-}
-
-/* ============================================================================
- * PROCESAMIENTO DE MENSAJES
- * ============================================================================ */
-void procesarMensaje(MensajeAgente *msg, int fdPipeRecibe) {
-    (void)fdPipeRecibe;  // Suprimir warning de parámetro no usado
-    
-    switch (msg->tipo) {
-        case MSG_REGISTRO:
-            registrarAgente(msg);
-            break;
-        case MSG_SOLICITUD_RESERVA:
-            procesarSolicitudReserva(msg);
-            break;
-        case MSG_FIN_AGENTE:
-            printf("→ Agente %s ha finalizado\n", msg->nombreAgente);
-            break;
-        default:
-            fprintf(stderr, "Mensaje desconocido recibido\n");
-            break;
-    }
-}
-
-/* ============================================================================
- * REGISTRO DE AGENTES
- * ============================================================================ */
-void registrarAgente(MensajeAgente *msg) {
-    RespuestaControlador resp;
-    
-    pthread_mutex_lock(&mutexAgentes);
-    
-    // Registrar agente
-    if (numAgentes < MAX_AGENTES) {
-        strncpy(agentesRegistrados[numAgentes].nombre, msg->nombreAgente, MAX_NOMBRE - 1);
-        strncpy(agentesRegistrados[numAgentes].pipeRespuesta, msg->pipeRespuesta, MAX_NOMBRE - 1);
-        agentesRegistrados[numAgentes].activo = 1;
-        numAgentes++;
-    }
-    
-    pthread_mutex_unlock(&mutexAgentes);
-    
-    printf("→ Agente '%s' registrado\n", msg->nombreAgente);
-    
-    // Enviar hora actual al agente
-    resp.tipo = RESP_HORA_ACTUAL;
-    resp.horaActual = horaActual;
-    snprintf(resp.mensaje, MAX_BUFFER, "Bienvenido. Hora actual: %d:00", horaActual);
-    
-    enviarRespuesta(msg->pipeRespuesta, &resp);
-}
-
-/* ============================================================================
- * PROCESAMIENTO DE SOLICITUDES DE RESERVA
- * ============================================================================ */
-void procesarSolicitudReserva(MensajeAgente *msg) {
-    RespuestaControlador resp;
-    int horaAlternativa;
-    
-    printf("\n╔═══════════════════════════════════════════════════════╗\n");
-    printf("║ SOLICITUD DE RESERVA                                  ║\n");
-    printf("╠═══════════════════════════════════════════════════════╣\n");
-    printf("║ Agente: %-45s ║\n", msg->nombreAgente);
-    printf("║ Familia: %-44s ║\n", msg->nombreFamilia);
-    printf("║ Hora solicitada: %d:00                                 ║\n", msg->horaSolicitada);
-    printf("║ Personas: %-3d                                         ║\n", msg->numPersonas);
-    printf("╚═══════════════════════════════════════════════════════╝\n");
-    
-    // Validar que la hora esté en rango
-    if (!validarHora(msg->horaSolicitada)) {
-        pthread_mutex_lock(&mutexEstadisticas);
-        solicitudesNegadas++;
-        pthread_mutex_unlock(&mutexEstadisticas);
-        
-        resp.tipo = RESP_RESERVA_NEGADA;
-        resp.horaActual = horaActual;
-        snprintf(resp.mensaje, MAX_BUFFER, 
-                "Reserva NEGADA - Hora fuera del rango de operación (%d-%d)", 
-                HORAS_MIN, HORAS_MAX);
-        
-        printf("✗ Respuesta: %s\n\n", resp.mensaje);
-        enviarRespuesta(msg->pipeRespuesta, &resp);
-        return;
-    }
-    
-    // Validar que el número de personas no exceda el aforo
-    if (msg->numPersonas > aforoMaximo) {
-        pthread_mutex_lock(&mutexEstadisticas);
-        solicitudesNegadas++;
-        pthread_mutex_unlock(&mutexEstadisticas);
-        
-        resp.tipo = RESP_RESERVA_NEGADA;
-        resp.horaActual = horaActual;
-        snprintf(resp.mensaje, MAX_BUFFER, 
-                "Reserva NEGADA - Número de personas (%d) excede el aforo máximo (%d). Debe volver otro día.", 
-                msg->numPersonas, aforoMaximo);
-        
-        printf("✗ Respuesta: %s\n\n", resp.mensaje);
-        enviarRespuesta(msg->pipeRespuesta, &resp);
-        return;
-    }
-    
-    // Validar hora solicitada vs hora actual
-    if (msg->horaSolicitada < horaActual) {
-        printf("⚠ Solicitud extemporánea (hora solicitada < hora actual)\n");
-        
-        // Buscar hora alternativa
-        if (buscarHoraAlternativa(msg->numPersonas, &horaAlternativa)) {
-            pthread_mutex_lock(&mutexEstadisticas);
-            solicitudesReprogramadas++;
-            pthread_mutex_unlock(&mutexEstadisticas);
-            
-            // Realizar reserva en hora alternativa
-            pthread_mutex_lock(&mutexReservas);
-            strncpy(reservas[numReservas].nombreFamilia, msg->nombreFamilia, MAX_NOMBRE - 1);
-            strncpy(reservas[numReservas].nombreAgente, msg->nombreAgente, MAX_NOMBRE - 1);
-            reservas[numReservas].horaInicio = horaAlternativa;
-            reservas[numReservas].horaFin = horaAlternativa + DURACION_RESERVA - 1;
-            reservas[numReservas].numPersonas = msg->numPersonas;
-            reservas[numReservas].activa = 0;  // Se activará cuando llegue su hora
-            
-            // Actualizar ocupación
-            for (int h = horaAlternativa; h < horaAlternativa + DURACION_RESERVA && validarHora(h); h++) {
-                ocupacionPorHora[indiceHora(h)] += msg->numPersonas;
-            }
-            
-            numReservas++;
-            pthread_mutex_unlock(&mutexReservas);
-            
-            resp.tipo = RESP_RESERVA_REPROG;
-            resp.horaAsignada = horaAlternativa;
-            resp.horaActual = horaActual;
-            snprintf(resp.mensaje, MAX_BUFFER, 
-                    "Reserva REPROGRAMADA - Hora solicitada ya pasó. Nueva hora: %d:00 - %d:00", 
-                    horaAlternativa, horaAlternativa + DURACION_RESERVA);
-            
-            printf("✓ Respuesta: %s\n\n", resp.mensaje);
-        } else {
-            pthread_mutex_lock(&mutexEstadisticas);
-            solicitudesNegadas++;
-            pthread_mutex_unlock(&mutexEstadisticas);
-            
-            resp.tipo = RESP_RESERVA_NEGADA;
-            resp.horaActual = horaActual;
-            snprintf(resp.mensaje, MAX_BUFFER, 
-                    "Reserva NEGADA - Hora extemporánea y sin disponibilidad posterior. Debe volver otro día.");
-            
-            printf("✗ Respuesta: %s\n\n", resp.mensaje);
-        }
-        
-        enviarRespuesta(msg->pipeRespuesta, &resp);
-        return;
-    }
-    
-    // Verificar si la hora solicitada está fuera del periodo de simulación
-    if (msg->horaSolicitada > horaFinal) {
-        pthread_mutex_lock(&mutexEstadisticas);
-        solicitudesNegadas++;
-        pthread_mutex_unlock(&mutexEstadisticas);
-        
-        resp.tipo = RESP_RESERVA_NEGADA;
-        resp.horaActual = horaActual;
-        snprintf(resp.mensaje, MAX_BUFFER, 
-                "Reserva NEGADA - Hora solicitada fuera del periodo de simulación. Debe volver otro día.");
-        
-        printf("✗ Respuesta: %s\n\n", resp.mensaje);
-        enviarRespuesta(msg->pipeRespuesta, &resp);
-        return;
-    }
-    
-    // Verificar disponibilidad en la hora solicitada
-    if (verificarDisponibilidad(msg->horaSolicitada, msg->numPersonas)) {
-        pthread_mutex_lock(&mutexEstadisticas);
-        solicitudesAceptadas++;
-        pthread_mutex_unlock(&mutexEstadisticas);
-        
-        // Realizar reserva
-        pthread_mutex_lock(&mutexReservas);
-        strncpy(reservas[numReservas].nombreFamilia, msg->nombreFamilia, MAX_NOMBRE - 1);
-        strncpy(reservas[numReservas].nombreAgente, msg->nombreAgente, MAX_NOMBRE - 1);
-        reservas[numReservas].horaInicio = msg->horaSolicitada;
-        reservas[numReservas].horaFin = msg->horaSolicitada + DURACION_RESERVA - 1;
-        reservas[numReservas].numPersonas = msg->numPersonas;
-        reservas[numReservas].activa = 0;  // Se activará cuando llegue su hora
-        
-        // Actualizar ocupación
-        for (int h = msg->horaSolicitada; h < msg->horaSolicitada + DURACION_RESERVA && validarHora(h); h++) {
-            ocupacionPorHora[indiceHora(h)] += msg->numPersonas;
-        }
-        
-        numReservas++;
-        pthread_mutex_unlock(&mutexReservas);
-        
-        resp.tipo = RESP_RESERVA_OK;
-        resp.horaAsignada = msg->horaSolicitada;
-        resp.horaActual = horaActual;
-        snprintf(resp.mensaje, MAX_BUFFER, 
-                "Reserva APROBADA - Hora: %d:00 - %d:00 para %d personas", 
-                msg->horaSolicitada, msg->horaSolicitada + DURACION_RESERVA, msg->numPersonas);
-        
-        printf("✓ Respuesta: %s\n\n", resp.mensaje);
-    } else {
-        printf("⚠ No hay disponibilidad en hora solicitada\n");
-        
-        // Buscar hora alternativa
-        if (buscarHoraAlternativa(msg->numPersonas, &horaAlternativa)) {
-            pthread_mutex_lock(&mutexEstadisticas);
-            solicitudesReprogramadas++;
-            pthread_mutex_unlock(&mutexEstadisticas);
-            
-            // Realizar reserva en hora alternativa
-            pthread_mutex_lock(&mutexReservas);
-            strncpy(reservas[numReservas].nombreFamilia, msg->nombreFamilia, MAX_NOMBRE - 1);
-            strncpy(reservas[numReservas].nombreAgente, msg->nombreAgente, MAX_NOMBRE - 1);
-            reservas[numReservas].horaInicio = horaAlternativa;
-            reservas[numReservas].horaFin = horaAlternativa + DURACION_RESERVA - 1;
-            reservas[numReservas].numPersonas = msg->numPersonas;
-            reservas[numReservas].activa = 0;
-            
-            // Actualizar ocupación
-            for (int h = horaAlternativa; h < horaAlternativa + DURACION_RESERVA && validarHora(h); h++) {
-                ocupacionPorHora[indiceHora(h)] += msg->numPersonas;
-            }
-            
-            numReservas++;
-            pthread_mutex_unlock(&mutexReservas);
-            
-            resp.tipo = RESP_RESERVA_REPROG;
-            resp.horaAsignada = horaAlternativa;
-            resp.horaActual = horaActual;
-            snprintf(resp.mensaje, MAX_BUFFER, 
-                    "Reserva REPROGRAMADA - Sin disponibilidad en hora solicitada. Nueva hora: %d:00 - %d:00", 
-                    horaAlternativa, horaAlternativa + DURACION_RESERVA);
-            
-            printf("✓ Respuesta: %s\n\n", resp.mensaje);
-        } else {
-            pthread_mutex_lock(&mutexEstadisticas);
-            solicitudesNegadas++;
-            pthread_mutex_unlock(&mutexEstadisticas);
-            
-            resp.tipo = RESP_RESERVA_NEGADA;
-            resp.horaActual = horaActual;
-            snprintf(resp.mensaje, MAX_BUFFER, 
-                    "Reserva NEGADA - Sin disponibilidad en todo el periodo. Debe volver otro día.");
-            
-            printf("✗ Respuesta: %s\n\n", resp.mensaje);
-        }
-    }
-    
-    enviarRespuesta(msg->pipeRespuesta, &resp);
-}
-
-/* ============================================================================
- * ENVÍO DE RESPUESTAS A AGENTES
- * ============================================================================ */
-void enviarRespuesta(char *pipeAgente, RespuestaControlador *resp) {
-    int fdPipeAgente;
-    
-    // Abrir pipe del agente para escribir
-    fdPipeAgente = open(pipeAgente, O_WRONLY);
-    if (fdPipeAgente == -1) {
-        perror("Error al abrir pipe del agente para responder");
-        return;
-    }
-    
-    // Escribir respuesta
-    if (write(fdPipeAgente, resp, sizeof(RespuestaControlador)) == -1) {
-        perror("Error al escribir respuesta al agente");
-    }
-    
-    close(fdPipeAgente);
-}
-
-/* ============================================================================
- * VERIFICACIÓN DE DISPONIBILIDAD
- * ============================================================================ */
-int verificarDisponibilidad(int hora, int numPersonas) {
-    pthread_mutex_lock(&mutexReservas);
-    
-    // Verificar que la hora y la hora siguiente tengan cupo
-    for (int h = hora; h < hora + DURACION_RESERVA && validarHora(h); h++) {
-        if (ocupacionPorHora[indiceHora(h)] + numPersonas > aforoMaximo) {
-            pthread_mutex_unlock(&mutexReservas);
-            return 0;  // No hay disponibilidad
-        }
-    }
-    
-    pthread_mutex_unlock(&mutexReservas);
-    return 1;  // Hay disponibilidad
-}
-
-/* ============================================================================
- * BÚSQUEDA DE HORA ALTERNATIVA
- * ============================================================================ */
-int buscarHoraAlternativa(int numPersonas, int *horaEncontrada) {
-    pthread_mutex_lock(&mutexReservas);
-    
-    // Buscar desde la hora actual hasta el final
-    for (int h = horaActual; h <= horaFinal - DURACION_RESERVA + 1; h++) {
-        int disponible = 1;
-        
-        for (int offset = 0; offset < DURACION_RESERVA; offset++) {
-            if (!validarHora(h + offset) || 
-                ocupacionPorHora[indiceHora(h + offset)] + numPersonas > aforoMaximo) {
-                disponible = 0;
-                break;
-            }
-        }
-        
-        if (disponible) {
-            *horaEncontrada = h;
-            pthread_mutex_unlock(&mutexReservas);
-            return 1;
-        }
-    }
-    
-    pthread_mutex_unlock(&mutexReservas);
-    return 0;  // No se encontró hora alternativa
-}
-
-/* ============================================================================
- * AVANCE DE HORA
- * ============================================================================ */
-void avanzarHora() {
-    pthread_mutex_lock(&mutexReservas);
-    
-    horaActual++;
-    
-    // Activar reservas que comienzan en esta hora
-    for (int i = 0; i < numReservas; i++) {
-        if (reservas[i].horaInicio == horaActual && !reservas[i].activa) {
-            reservas[i].activa = 1;
-        }
-    }
-    
-    // Desactivar reservas que terminan en esta hora
-    for (int i = 0; i < numReservas; i++) {
-        if (reservas[i].horaFin < horaActual && reservas[i].activa) {
-            reservas[i].activa = 0;
-        }
-    }
-    
-    pthread_mutex_unlock(&mutexReservas);
-}
-
-/* ============================================================================
- * IMPRESIÓN DEL ESTADO DE LA HORA
- * ============================================================================ */
-void imprimirEstadoHora() {
-    pthread_mutex_lock(&mutexReservas);
-    
-    printf("\n");
-    printf("╔════════════════════════════════════════════════════════════╗\n");
-    printf("║                   ⏰ HORA: %02d:00                           ║\n", horaActual);
-    printf("╚════════════════════════════════════════════════════════════╝\n");
-    
-    // Familias que salen
-    printf("\n📤 Familias que SALEN del parque:\n");
-    int totalSalen = 0;
-    int haySalidas = 0;
-    for (int i = 0; i < numReservas; i++) {
-        if (reservas[i].horaFin == horaActual - 1 && reservas[i].horaFin >= horaInicial) {
-            printf("   • Familia %s (%d personas) - Agente: %s\n", 
-                   reservas[i].nombreFamilia, 
-                   reservas[i].numPersonas,
-                   reservas[i].nombreAgente);
-            totalSalen += reservas[i].numPersonas;
-            haySalidas = 1;
-        }
-    }
-    if (!haySalidas) {
-        printf("   (Ninguna)\n");
-    } else {
-        printf("   Total: %d personas\n", totalSalen);
-    }
-    
-    // Familias que entran
-    printf("\n📥 Familias que ENTRAN al parque:\n");
-    int totalEntran = 0;
-    int hayEntradas = 0;
-    for (int i = 0; i < numReservas; i++) {
-        if (reservas[i].horaInicio == horaActual) {
-            printf("   • Familia %s (%d personas) - Agente: %s [%d:00-%d:00]\n", 
-                   reservas[i].nombreFamilia, 
-                   reservas[i].numPersonas,
-                   reservas[i].nombreAgente,
-                   reservas[i].horaInicio,
-                   reservas[i].horaFin + 1);
-            totalEntran += reservas[i].numPersonas;
-            hayEntradas = 1;
-        }
-    }
-    if (!hayEntradas) {
-        printf("   (Ninguna)\n");
-    } else {
-        printf("   Total: %d personas\n", totalEntran);
-    }
-    
-    // Ocupación actual
-    int ocupacionActual = 0;
-    if (validarHora(horaActual)) {
-        ocupacionActual = ocupacionPorHora[indiceHora(horaActual)];
-    }
-    
-    printf("\n📊 Ocupación actual: %d / %d personas", ocupacionActual, aforoMaximo);
-    
-    // Barra de progreso visual
-    int porcentaje = (ocupacionActual * 100) / aforoMaximo;
-    printf(" [");
-    int barras = porcentaje / 5;
-    for (int i = 0; i < 20; i++) {
-        if (i < barras) printf("█");
-        else printf("░");
-    }
-    printf("] %d%%\n", porcentaje);
-    
-    pthread_mutex_unlock(&mutexReservas);
-    printf("\n");
-}
-
-/* ============================================================================
- * GENERACIÓN DE REPORTE FINAL
- * ============================================================================ */
-void generarReporte() {
-    pthread_mutex_lock(&mutexReservas);
-    pthread_mutex_lock(&mutexEstadisticas);
-    
-    printf("\n");
-    printf("╔════════════════════════════════════════════════════════════╗\n");
-    printf("║                  📊 REPORTE FINAL DEL DÍA                  ║\n");
-    printf("╚════════════════════════════════════════════════════════════╝\n");
-    printf("\n");
-    
-    // Encontrar horas pico
-    int maxOcupacion = 0;
-    for (int i = 0; i < MAX_HORAS; i++) {
-        if (ocupacionPorHora[i] > maxOcupacion) {
-            maxOcupacion = ocupacionPorHora[i];
-        }
-    }
-    
-    printf("🔝 HORAS PICO (mayor ocupación: %d personas):\n", maxOcupacion);
-    for (int i = 0; i < MAX_HORAS; i++) {
-        if (ocupacionPorHora[i] == maxOcupacion && maxOcupacion > 0) {
-            printf("   • %d:00 - %d personas\n", HORAS_MIN + i, ocupacionPorHora[i]);
-        }
-    }
-    
-    // Encontrar horas valle
-    int minOcupacion = aforoMaximo + 1;
-    for (int i = 0; i < MAX_HORAS; i++) {
-        if (ocupacionPorHora[i] < minOcupacion) {
-            minOcupacion = ocupacionPorHora[i];
-        }
-    }
-    
-    printf("\n🔽 HORAS VALLE (menor ocupación: %d personas):\n", minOcupacion);
-    for (int i = 0; i < MAX_HORAS; i++) {
-        if (ocupacionPorHora[i] == minOcupacion) {
-            printf("   • %d:00 - %d personas\n", HORAS_MIN + i, ocupacionPorHora[i]);
-        }
-    }
-    
-    // Estadísticas de solicitudes
-    printf("\n📈 ESTADÍSTICAS DE SOLICITUDES:\n");
-    printf("   • Solicitudes aceptadas en su hora:  %d\n", solicitudesAceptadas);
-    printf("   • Solicitudes reprogramadas:          %d\n", solicitudesReprogramadas);
-    printf("   • Solicitudes negadas:                %d\n", solicitudesNegadas);
-    printf("   • Total de solicitudes:               %d\n", 
-           solicitudesAceptadas + solicitudesReprogramadas + solicitudesNegadas);
-    
-    // Tabla de ocupación por hora
-    printf("\n📅 OCUPACIÓN POR HORA:\n");
-    printf("   ┌──────┬───────────┬────────────┐\n");
-    printf("   │ Hora │ Personas  │ Porcentaje │\n");
-    printf("   ├──────┼───────────┼────────────┤\n");
-    for (int i = 0; i < MAX_HORAS; i++) {
-        int hora = HORAS_MIN + i;
-        if (hora <= horaFinal) {
-            int porcentaje = (ocupacionPorHora[i] * 100) / aforoMaximo;
-            printf("   │ %02d:00│    %3d    │    %3d%%   │\n", 
-                   hora, ocupacionPorHora[i], porcentaje);
-        }
-    }
-    printf("   └──────┴───────────┴────────────┘\n");
-    
-    pthread_mutex_unlock(&mutexEstadisticas);
-    pthread_mutex_unlock(&mutexReservas);
-}
-
-/* ============================================================================
- * LIMPIEZA DE RECURSOS
- * ============================================================================ */
-void limpiarRecursos() {
-    // Eliminar pipe nominal
-    unlink(pipeRecibe);
-    
-    // Destruir mutexes
-    pthread_mutex_destroy(&mutexReservas);
-    pthread_mutex_destroy(&mutexAgentes);
-    pthread_mutex_destroy(&mutexEstadisticas);
-}
-
-/* ============================================================================
- * FUNCIONES DE UTILIDAD
- * ============================================================================ */
-int validarHora(int hora) {
-    return (hora >= HORAS_MIN && hora <= HORAS_MAX);
-}
-
-int indiceHora(int hora) {
-    return hora - HORAS_MIN;
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen
+ * Programa: controlador.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Controlador del Sistema de Reservas
+ * -----------------------------------------------
+ * Descripción:
+ * Este programa implementa el servidor del sistema de
+ * reservas del Parque Berlín. Actúa como un proceso
+ * multihilo que gestiona el estado del parque, procesa
+ * las solicitudes de reserva de múltiples agentes y
+ * controla el aforo. Utiliza hilos POSIX para manejar
+ * tareas concurrentes (reloj, recepción de mensajes
+ * con un bucle de eventos epoll y un grupo de
+ * trabajadores alimentado por una cola acotada) y mutex para garantizar la exclusión mutua al acceder
+ * a datos compartidos. Puede atender varios días y
+ * parques a la vez: cada combinación es un calendario
+ * independiente con su propio mutex. La comunicación
+ * con los agentes se realiza a través de named pipes
+ * (FIFOs), de sockets Unix o TCP (-L) atendidos por el
+ * mismo bucle de eventos, o, si el agente lo pide al
+ * registrarse, de anillos en memoria compartida con un
+ * hilo lector por agente. Con -j las reservas se anotan
+ * en un diario durable (ver diario.h) y se recuperan al
+ * volver a arrancar. Ningún hilo escribe en la consola:
+ * los eventos se encolan y los escribe el hilo del
+ * registro (ver registro.h), con el detalle que pida -v.
+ * Con -M publica sus métricas en vivo (archivo JSON o
+ * CSV, o un socket que entrega la instantánea a quien
+ * se conecte) y con -R deja el reporte final también en
+ * JSON o CSV (ver metricas.h).
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <poll.h>
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#include "protocolo.h"
+#include "anillo.h"
+#include "red.h"
+#include "diario.h"
+#include "registro.h"
+#include "metricas.h"
+#include "reservas.h"
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define CAPACIDAD_INICIAL_AGENTES 16  // Cubetas iniciales del registro (potencia de 2)
+#define MAX_ID_AGENTE (ID_EVENTO_ESCUCHA - 1)  // Los ids son etiquetas de epoll: no invaden las demás
+#define MAX_PIPE_NAME 256  // Buffer más grande para nombres de pipes
+#define MINUTOS_FRANJA_DEFECTO 60     // Ancho de franja por defecto (-m)
+#define MINUTOS_DURACION_DEFECTO 120  // Duración de una reserva por defecto (-d)
+#define PROFUNDIDAD_COLA_DEFECTO 256  // Peticiones pendientes que admite la cola (-q)
+#define MAX_PROFUNDIDAD_COLA 16384    // Límite de -q
+#define MAX_ESPERA_SUGERIDA_MS 1000   // Tope de la espera que sugiere un RESP_OCUPADO
+#define MAX_AVISOS_OCUPADO 1024       // RESP_OCUPADO pendientes de enviar; con más se descartan
+#define PLAZO_AVISO_OCUPADO_MS 1000   // Lo que el respondedor espera a un agente antes de descartarlo
+#define MAX_TRABAJADORES 64  // Límite de hilos trabajadores
+#define MAX_AFORO 65535  // Límite de -t: el diario guarda las personas de una reserva en 16 bits
+#define MAX_EVENTOS 32  // Eventos atendidos por cada epoll_wait
+#define MAX_ESCUCHAS 4  // Direcciones de escucha (-L)
+#define VENTANA_RITMO_SEGUNDOS 1.0  // Las solicitudes por segundo se miden en al menos este intervalo
+#define ESPERA_CLIENTE_METRICAS_MS 100  // Lo más que se espera a que un cliente de -M lea
+#define MAX_FRANJAS_DIA (MINUTO_CIERRE - MINUTO_APERTURA)  // Franjas de un día con -m 1
+
+/* Niveles de detalle de la salida (-v) */
+#define NIVEL_SILENCIOSO 0  // Solo registros estructurados, una línea clave=valor por evento
+#define NIVEL_RESUMEN 1     // Reloj, agentes y reporte, sin el detalle de cada solicitud
+#define NIVEL_DETALLE 2     // Todo, con los recuadros de cada solicitud (por defecto)
+
+/* Etiquetas de los descriptores vigilados por epoll (los agentes usan su id >= 1) */
+#define ID_EVENTO_PIPE 0u          // Pipe nominal de solicitudes
+#define ID_EVENTO_FIN UINT32_MAX   // Evento de fin del servidor
+#define ID_EVENTO_METRICAS (UINT32_MAX - 1)  // Socket de métricas (se distingue antes que las conexiones)
+#define ID_EVENTO_ESCUCHA 0x40000000u   // Socket de escucha: el resto es su índice
+#define ID_EVENTO_CONEXION 0x80000000u  // Conexión de un agente: el resto es el descriptor
+#define MASCARA_EVENTO 0x3FFFFFFFu
+
+/* Los tipos de mensaje, respuesta y las horas de operación están en protocolo.h; los calendarios, en reservas.h */
+
+/* Resultados contabilizados por un trabajador, en su propia línea de caché */
+typedef struct {
+    _Alignas(TAM_LINEA_CACHE) atomic_long aceptadas;
+    atomic_long reprogramadas;
+    atomic_long negadas;
+    atomic_long canceladas;      // Cancelaciones atendidas
+    atomic_long modificadas;     // Modificaciones atendidas
+    atomic_long cambiosNegados;  // Cancelaciones o modificaciones rechazadas
+    atomic_long consultas;       // Consultas de disponibilidad atendidas
+    HistogramaLatencia latencia;  // Desde que llegó cada solicitud hasta que se respondió
+} EstadisticasTrabajador;
+
+/* Canal por el que se registró un agente */
+typedef enum {
+    CANAL_PIPE,
+    CANAL_SOCKET,
+    CANAL_MEMORIA
+} CanalAgente;
+
+/*
+ * Estructura para información de un agente registrado. Vive en la tabla de
+ * agentes desde MSG_REGISTRO hasta MSG_FIN_AGENTE (o su caída); quien la use
+ * fuera de mutexAgentes toma una referencia, y se libera con la última.
+ */
+typedef struct AgenteInfo {
+    uint32_t id;
+    char nombre[MAX_NOMBRE];
+    int fdRespuesta;  // Canal de respuesta abierto durante toda la sesión (-1 si no hay)
+    int activo;       // 1 mientras está en la tabla
+    int referencias;  // La tabla, cada envío en curso y el hilo lector de memoria
+    CanalAgente canal;  // Con qué canal se registró, para los eventos de fin y desconexión
+    SegmentoMemoria *segmento;  // Anillos del transporte en memoria (NULL = pipes)
+    pthread_mutex_t mutexEscritura;  // Una trama a la vez en fdRespuesta (en un socket puede ir en partes)
+    struct AgenteInfo *siguiente;    // Siguiente agente de la misma cubeta
+} AgenteInfo;
+
+/* Trama recibida, pendiente de decodificar por un trabajador */
+typedef struct {
+    uint8_t datos[MAX_TRAMA];
+    size_t longitud;
+    int fdOrigen;  // MSG_REGISTRO por socket: copia de la conexión para responder (-1 si no)
+    struct timespec llegada;  // Momento en que se encoló (CLOCK_MONOTONIC)
+} TramaPendiente;
+
+/* Cola acotada de peticiones entre el hilo receptor y los trabajadores */
+typedef struct {
+    TramaPendiente *tramas;  // capacidad posiciones (ver inicializarServidor)
+    int capacidad;   // Profundidad de la cola (-q)
+    int frente;      // Próxima posición a desencolar
+    int cantidad;    // Mensajes pendientes
+    int cerrada;     // 1 cuando ya no se aceptan más mensajes
+    int enProceso;   // Mensajes desencolados que un trabajador aún atiende
+    long atendidas;  // Mensajes ya atendidos desde el arranque
+    int maximoPendientes;  // Mayor cantidad de pendientes que ha habido
+    long rechazadas;    // Tramas respondidas con RESP_OCUPADO por no caber
+    long nanosAtencion; // Tiempo de atención de las ya atendidas, para sugerir esperas
+    pthread_mutex_t mutex;
+    pthread_cond_t noVacia;
+    pthread_cond_t noLlena;
+    pthread_cond_t drenada;  // Sin pendientes ni en proceso (ver -s 0)
+} ColaPeticiones;
+
+/* RESP_OCUPADO pendiente de enviar por el hilo respondedor */
+typedef struct {
+    uint32_t idAgente;
+    RespuestaControlador resp;
+} AvisoOcupado;
+
+/*
+ * Avisos RESP_OCUPADO entre quien recibe (receptor y lectores de memoria) y
+ * el hilo respondedor. Acotada como la de peticiones: con MAX_AVISOS_OCUPADO
+ * pendientes, el aviso se descarta en vez de retener a quien recibe.
+ */
+typedef struct {
+    AvisoOcupado avisos[MAX_AVISOS_OCUPADO];
+    int cantidad;
+    long descartados;  // Avisos que no cupieron
+    int cerrada;  // 1: el respondedor envía lo que quede y termina
+    pthread_mutex_t mutex;
+    pthread_cond_t hayAvisos;
+} ColaAvisos;
+
+/* Eventos de la salida por consola (ver formatearEventoSalida) */
+typedef enum {
+    EVENTO_TEXTO,              // Línea ya compuesta (arranque y cierre)
+    EVENTO_INICIO,             // Configuración del servidor, solo en modo silencioso
+    EVENTO_AGENTE,             // Registro, fin o desconexión de un agente
+    EVENTO_SOLICITUD,          // Solicitud individual con su respuesta
+    EVENTO_LOTE,               // Cabecera de un lote
+    EVENTO_ELEMENTO_LOTE,      // Una solicitud del lote con su respuesta
+    EVENTO_CAMBIO,             // Cancelación o modificación con su respuesta
+    EVENTO_CONSULTA,           // Consulta de disponibilidad con su resumen
+    EVENTO_HORA,               // El reloj pasó a una nueva franja
+    EVENTO_LISTA_MOVIMIENTOS,  // Encabezado de las salidas o entradas de un parque
+    EVENTO_MOVIMIENTO,         // Una familia que sale o entra
+    EVENTO_TOTAL_MOVIMIENTOS,  // Cierre de la lista de salidas o entradas
+    EVENTO_OCUPACION,          // Ocupación de un parque en la franja
+    EVENTO_FIN_HORA,
+    EVENTO_FIN_SIMULACION,
+    EVENTO_REPORTE             // Totales del reporte final, solo en modo silencioso
+} TipoEventoSalida;
+
+typedef enum {
+    AGENTE_REGISTRADO,
+    AGENTE_FINALIZADO,
+    AGENTE_DESCONECTADO
+} AccionAgente;
+
+typedef enum {
+    MOVIMIENTO_SALIDA,
+    MOVIMIENTO_ENTRADA
+} SentidoMovimiento;
+
+typedef struct {
+    char texto[TAM_DATOS_EVENTO];
+} EventoTexto;
+
+typedef struct {
+    int horaInicial, horaFinal, aforo, trabajadores, dias, parques, cola;
+    long recuperadas;
+} EventoInicio;
+
+typedef struct {
+    AccionAgente accion;
+    CanalAgente canal;
+    char nombre[MAX_NOMBRE];
+} EventoAgente;
+
+typedef struct {
+    char agente[MAX_NOMBRE];
+    char familia[MAX_NOMBRE];
+    int horaSolicitada;
+    int numPersonas;
+    uint8_t dia;
+    uint8_t parque;
+    uint8_t extemporanea;
+    RespuestaControlador resp;
+} EventoSolicitud;
+
+typedef struct {
+    char agente[MAX_NOMBRE];
+    int cantidad;
+} EventoLote;
+
+typedef struct {
+    char familia[MAX_NOMBRE];
+    int horaSolicitada;
+    int numPersonas;
+    int indice;
+    int cantidad;
+    RespuestaControlador resp;
+} EventoElementoLote;
+
+typedef struct {
+    char agente[MAX_NOMBRE];
+    char familia[MAX_NOMBRE];  // "" si el id no corresponde a ninguna reserva
+    TipoMensaje tipo;          // MSG_CANCELAR o MSG_MODIFICAR
+    uint32_t idReserva;        // Reserva que se quería cambiar
+    int horaSolicitada;        // Cancelación: la de la reserva; modificación: la nueva
+    int numPersonas;
+    RespuestaControlador resp;
+} EventoCambio;
+
+typedef struct {
+    char agente[MAX_NOMBRE];
+    int dia;
+    int parque;
+    MotivoRespuesta motivo;  // MOTIVO_CALENDARIO_INEXISTENTE o MOTIVO_NINGUNO
+    int horaDesde;           // Primera franja de la respuesta
+    int cantidad;            // Franjas de la respuesta
+    int plazasMaximas;       // Mayor grupo que aún cabe en alguna de ellas
+    int franjasLibres;       // Franjas con cupo para al menos una persona
+} EventoConsulta;
+
+/* Eventos del reloj sin nombres (hora, listas, totales, ocupación) */
+typedef struct {
+    int minuto;
+    int parque;
+    SentidoMovimiento sentido;
+    int total;      // Personas de la lista
+    int cantidad;   // Familias de la lista
+    int ocupacion;
+} EventoFranja;
+
+typedef struct {
+    int parque;
+    SentidoMovimiento sentido;
+    int numPersonas;
+    int inicio;  // Minutos desde la medianoche
+    int fin;
+    char familia[MAX_NOMBRE];
+    char agente[MAX_NOMBRE];
+} EventoMovimiento;
+
+typedef struct {
+    long aceptadas, reprogramadas, negadas;
+    long canceladas, modificadas, cambiosNegados;
+    long consultas;
+    long rechazadas;
+} EventoReporte;
+
+_Static_assert(sizeof(EventoSolicitud) <= TAM_DATOS_EVENTO, "EventoSolicitud no cabe en un evento");
+_Static_assert(sizeof(EventoMovimiento) <= TAM_DATOS_EVENTO, "EventoMovimiento no cabe en un evento");
+_Static_assert(sizeof(EventoElementoLote) <= TAM_DATOS_EVENTO, "EventoElementoLote no cabe en un evento");
+_Static_assert(sizeof(EventoCambio) <= TAM_DATOS_EVENTO, "EventoCambio no cabe en un evento");
+_Static_assert(sizeof(EventoConsulta) <= TAM_DATOS_EVENTO, "EventoConsulta no cabe en un evento");
+
+/* Estado del servidor en un momento, base de las métricas en vivo y del reporte estructurado */
+typedef struct {
+    double segundos;  // Desde el arranque
+    int franja;
+    long aceptadas, reprogramadas, negadas;
+    long canceladas, modificadas, cambiosNegados;
+    long consultas;
+    double solicitudesPorSegundo;  // En el último intervalo de al menos VENTANA_RITMO_SEGUNDOS
+    int pendientes, maximoPendientes, enProceso;
+    long atendidas, rechazadas;
+    int agentes;
+    HistogramaLatencia latencia;  // La de todos los trabajadores sumada
+} MuestraMetricas;
+
+/* ============================================================================
+ * VARIABLES GLOBALES
+ * ============================================================================ */
+// Parámetros de configuración
+int horaInicial;
+int horaFinal;
+double segundosPorHora;  // Puede ser fraccionario; 0 = máxima velocidad
+int minutosPorFranja = MINUTOS_FRANJA_DEFECTO;
+int minutosDuracion = MINUTOS_DURACION_DEFECTO;
+int aforoMaximo;
+int numTrabajadores = 1;
+int profundidadCola = PROFUNDIDAD_COLA_DEFECTO;  // Peticiones pendientes antes de rechazar (-q)
+int numDias = 1;     // Días que se atienden, incluido hoy (-D)
+int numParques = 1;  // Parques o atracciones (-P)
+char pipeRecibe[MAX_NOMBRE];
+char direccionesEscucha[MAX_ESCUCHAS][MAX_NOMBRE];  // unix:<ruta> o tcp:[host:]puerto (-L)
+int numEscuchas = 0;
+char rutaDiario[MAX_NOMBRE] = "";  // Diario de reservas (-j); "" = sin persistencia
+int nivelSalida = NIVEL_DETALLE;  // Detalle de la salida por consola (-v)
+char destinoMetricas[MAX_NOMBRE] = "";  // Métricas en vivo (-M): archivo .json/.csv o socket
+char rutaReporte[MAX_NOMBRE] = "";      // Reporte final estructurado (-R): .csv o JSON
+int colocacionLotes = 0;  // Colocar cada lote completo, de mayor a menor grupo (-O)
+
+// Franjas del día, calculadas a partir de -m y -d (ver inicializarServidor)
+int numFranjas;         // Franjas entre la apertura y el cierre
+int franjasPorReserva;  // Duración de una reserva en franjas
+int franjaInicial;      // Franja de la hora inicial de la simulación
+int franjaFinPeriodo;   // Primera franja después de la hora final (exclusiva)
+
+// Estado del sistema
+int franjaActual;  // Franja del reloj (solo la escribe el hilo del reloj)
+Calendario *calendarios;  // numDias * numParques, por día y luego por parque
+int numCalendarios;
+int bitsCalendario = 0;  // Bits bajos del id de reserva que eligen su calendario (ver idDeReserva)
+long limiteReservasCalendario;  // Reservas por calendario que caben en el resto del id
+// Registro de agentes: tabla hash por id con encadenamiento (protegida por mutexAgentes)
+AgenteInfo **tablaAgentes = NULL;
+int bitsTablaAgentes = 0;  // La tabla tiene 1 << bitsTablaAgentes cubetas
+int numAgentes = 0;        // Agentes registrados que aún no terminan
+uint32_t siguienteIdAgente = 1;
+int aceptarMemoria = 1;  // 0 al terminar: ya no se crean hilos lectores (protegido por mutexAgentes)
+int lectoresMemoria = 0;  // Hilos lectores de memoria aún vivos
+pthread_cond_t lectoresTerminados = PTHREAD_COND_INITIALIZER;
+
+// Estadísticas: un juego de contadores por trabajador, sumados en el reporte
+EstadisticasTrabajador estadisticasTrabajadores[MAX_TRABAJADORES];
+_Thread_local EstadisticasTrabajador *estadisticasHilo = &estadisticasTrabajadores[0];
+
+// Mutex y variables de sincronización (cada calendario tiene el suyo)
+pthread_mutex_t mutexAgentes = PTHREAD_MUTEX_INITIALIZER;
+
+// Cola de peticiones compartida por el receptor y los trabajadores
+ColaPeticiones colaPeticiones = {
+    .tramas = NULL,
+    .capacidad = 0,
+    .frente = 0,
+    .cantidad = 0,
+    .cerrada = 0,
+    .enProceso = 0,
+    .atendidas = 0,
+    .maximoPendientes = 0,
+    .rechazadas = 0,
+    .nanosAtencion = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .noVacia = PTHREAD_COND_INITIALIZER,
+    .noLlena = PTHREAD_COND_INITIALIZER,
+    .drenada = PTHREAD_COND_INITIALIZER
+};
+
+// Avisos de cola llena pendientes de enviar
+ColaAvisos colaAvisos = {
+    .cantidad = 0,
+    .descartados = 0,
+    .cerrada = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .hayAvisos = PTHREAD_COND_INITIALIZER
+};
+
+// Control de señales
+volatile sig_atomic_t alarmaRecibida = 0;
+volatile sig_atomic_t finalizarServidor = 0;
+
+// Bucle de eventos: epoll del hilo receptor y eventfd que anuncia el fin
+int fdEpoll = -1;
+int fdEventoFin = -1;  // Nunca se lee: una vez notificado queda legible para todos
+int fdEscuchas[MAX_ESCUCHAS];
+
+// Conexiones de socket abiertas, por descriptor (solo las usa el hilo receptor)
+BufferTramas **buffersConexion = NULL;
+int capacidadConexiones = 0;
+
+// Movimientos de la franja copiados bajo el mutex para registrarlos después (solo el reloj)
+EventoMovimiento *movimientosFranja = NULL;
+int capacidadMovimientos = 0;
+
+// Métricas en vivo (-M): socket que entrega la instantánea o serie CSV abierta
+int fdEscuchaMetricas = -1;
+int fdSerieMetricas = -1;
+struct timespec instanteArranque;
+MuestraMetricas muestraMetricas;  // Protegida por mutexMetricas, igual que el ritmo
+double segundosRitmoAnterior = 0, segundosRitmo = 0;  // Bases del ritmo de solicitudes
+long solicitudesRitmoAnterior = 0, solicitudesRitmo = 0;
+pthread_mutex_t mutexMetricas = PTHREAD_MUTEX_INITIALIZER;
+
+#ifdef INSTRUMENTAR_ETAPAS
+// Última lectura del pipe, de una conexión o de un anillo en este hilo (etapa de recepción)
+_Thread_local struct timespec instanteLectura;
+#endif
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+void procesarArgumentos(int argc, char *argv[]);
+void inicializarServidor();
+void manejadorAlarma(int sig);
+void manejadorSigInt(int sig);
+void notificarFin();
+int esperarFranjas(int fdTemporizador, uint64_t *franjas);
+int esperarColaDrenada();
+int contarAgentesActivos();
+void *hiloReloj(void *arg);
+void *hiloRecibirPeticiones(void *arg);
+int abrirPipeRecibe();
+int atenderPipeRecibe(int *fdPipeRecibe, BufferTramas *buffer);
+void vigilarConexionAgente(int fd, uint32_t idAgente);
+void cerrarConexionAgente(AgenteInfo *agente);
+void aceptarConexiones(int fdEscucha);
+void atenderConexion(int fd);
+void cerrarConexion(int fd);
+int escribirCompleto(int fd, const uint8_t *datos, size_t longitud);
+int escribirConPlazo(int fd, const uint8_t *datos, size_t longitud, int plazoMs);
+void descartarConexionAgente(uint32_t idAgente);
+void *hiloLectorMemoria(void *arg);
+void cerrarAnillosAgente(AgenteInfo *agente);
+void detenerLectoresMemoria();
+void *hiloTrabajador(void *arg);
+int encolarPeticion(const uint8_t *trama, size_t longitud, int fdOrigen);
+int desencolarPeticion(TramaPendiente *trama);
+void terminarPeticion(long nanosAtencion);
+int esperaSugeridaMs();
+void rechazarPorOcupacion(const uint8_t *trama, size_t longitud, int esperaMs);
+void *hiloRespondedor(void *arg);
+void cerrarAvisos();
+void despertarReloj();
+void cerrarCola();
+void procesarMensaje(MensajeAgente *msg, int fdOrigen);
+int resolverAgente(MensajeAgente *msg);
+void inicializarTablaAgentes();
+AgenteInfo *buscarAgente(uint32_t idAgente);
+AgenteInfo *crearAgente(const char *nombre, int fdRespuesta);
+void retirarAgente(AgenteInfo *agente);
+void soltarAgente(AgenteInfo *agente);
+int buscarNombreAgente(uint32_t idAgente, char *nombre);
+void registrarAgente(MensajeAgente *msg, int fdOrigen);
+void finalizarAgente(MensajeAgente *msg);
+int abrirPipeAgente(char *pipeAgente);
+void procesarSolicitudReserva(MensajeAgente *msg);
+void procesarCambioReserva(MensajeAgente *msg);
+Reserva *reservaModificable(Calendario *cal, int indice, MensajeAgente *msg, ResultadoSolicitud *res);
+void modificarReserva(Calendario *cal, int indice, MensajeAgente *msg, int extemporanea, ResultadoSolicitud *res);
+void anotarCancelacion(Calendario *cal, int indice);
+void contabilizarCambio(TipoMensaje tipo, ResultadoSolicitud *res);
+void responderCambio(MensajeAgente *msg, ResultadoSolicitud *res, EventoCambio *evento);
+void procesarConsultaDisponibilidad(MensajeAgente *msg);
+void registrarConsulta(MensajeAgente *msg, const RespuestaDisponibilidad *resp);
+void procesarLote(LoteSolicitudes *lote, char *nombreAgente);
+void ordenarLote(LoteSolicitudes *lote, Calendario **cals, int *orden);
+int validarSolicitud(MensajeAgente *msg, ResultadoSolicitud *res, int *extemporanea, Calendario **cal);
+void completarAdmision(ResultadoSolicitud *res, ResultadoAdmision admision, int extemporanea, int hora,
+                       uint32_t idReserva);
+void contabilizarResultado(ResultadoSolicitud *res);
+void responderSolicitud(MensajeAgente *msg, ResultadoSolicitud *res, int extemporanea);
+void enviarRespuesta(uint32_t idAgente, RespuestaControlador *resp);
+void enviarTrama(uint32_t idAgente, const uint8_t *trama, size_t longitud);
+void enviarTramaConPlazo(uint32_t idAgente, const uint8_t *trama, size_t longitud, int plazoMs);
+int escribirRespuesta(int fd, RespuestaControlador *resp);
+ResultadoAdmision admitirReserva(Calendario *cal, MensajeAgente *msg, int intentarHoraSolicitada, int *horaAsignada,
+                                 uint32_t *idReserva);
+ResultadoAdmision admitirReservaSinBloqueo(Calendario *cal, MensajeAgente *msg, int intentarHoraSolicitada,
+                                          int alternativaCercana, int *horaAsignada, uint32_t *idReserva);
+uint32_t registrarReserva(Calendario *cal, MensajeAgente *msg, int franjaInicio);
+void restaurarReserva(const AnotacionReserva *anotacion);
+int reservaRecuperable(int franjaInicio, int numPersonas);
+void capturarEstado(Instantanea *instantanea);
+Calendario *buscarCalendario(int dia, int parque);
+uint32_t idDeReserva(Calendario *cal, int indice);
+Calendario *calendarioDeReserva(uint32_t id, int *indice);
+void avanzarHora();
+void imprimirEstadoHora();
+void imprimirMovimientos(Calendario *cal);
+void registrarTexto(const char *formato, ...);
+void copiarNombre(char *destino, const char *origen);
+EventoMovimiento *agregarMovimiento(int *numMovimientos);
+void registrarEventoAgente(AccionAgente accion, CanalAgente canal, const char *nombre);
+size_t formatearEventoSalida(const EventoRegistro *evento, char *destino, size_t tam);
+void sumarEstadisticas(long *aceptadas, long *reprogramadas, long *negadas);
+void sumarCambios(long *canceladas, long *modificadas, long *negados);
+long sumarConsultas();
+int esArchivoCSV(const char *ruta);
+void tomarMuestra(MuestraMetricas *muestra);
+void componerMetricasJSON(TextoMetricas *texto, const MuestraMetricas *muestra, int final);
+void componerCalendarioJSON(TextoMetricas *texto, Calendario *cal, int final);
+void componerFilaCSV(TextoMetricas *texto, const MuestraMetricas *muestra);
+void componerReporteCSV(TextoMetricas *texto, const MuestraMetricas *muestra);
+void publicarMetricas(int final);
+void atenderMetricas();
+void enviarMetricas(int fd, const char *datos, size_t longitud);
+void escribirReporteEstructurado();
+void componerEtapas(TextoMetricas *texto, int csv);
+void reportarEtapas();
+void generarReporte();
+void reportarPicos(Calendario *cal);
+void reportarOcupacion(Calendario *cal);
+void limpiarRecursos();
+int validarHora(int hora);
+int validarFranja(int franja);
+int minutoValido(int minuto);
+int franjaDeMinuto(int minuto);
+int minutoDeFranja(int franja);
+
+/* ============================================================================
+ * FUNCIÓN PRINCIPAL
+ * ============================================================================ */
+int main(int argc, char *argv[]) {
+    pthread_t tidReloj, tidPeticiones, tidRespondedor;
+    pthread_t *tidTrabajadores;
+    
+    // Procesar argumentos de línea de comandos
+    procesarArgumentos(argc, argv);
+    clock_gettime(CLOCK_MONOTONIC, &instanteArranque);
+    
+    // Desde aquí la consola solo la escribe el hilo del registro
+    if (!iniciarRegistro(STDOUT_FILENO, formatearEventoSalida)) {
+        perror("Error al crear el hilo del registro; la salida se escribe en línea");
+    }
+    
+    registrarTexto("\n");
+    registrarTexto("╔════════════════════════════════════════════════════════════╗\n");
+    registrarTexto("║  SISTEMA DE RESERVAS - PARQUE BERLÍN                       ║\n");
+    registrarTexto("║  Controlador de Reservas (Servidor)                        ║\n");
+    registrarTexto("╚════════════════════════════════════════════════════════════╝\n");
+    registrarTexto("\n");
+    
+    // Inicializar el servidor
+    inicializarServidor();
+    
+    // Recuperar las reservas del diario antes de que arranque el reloj
+    long recuperadas = 0;
+    if (rutaDiario[0] != '\0') {
+        ConfiguracionDiario config = {
+            .numDias = (uint32_t)numDias, .numParques = (uint32_t)numParques,
+            .minutosPorFranja = (uint32_t)minutosPorFranja, .franjasPorReserva = (uint32_t)franjasPorReserva,
+            .aforoMaximo = (uint32_t)aforoMaximo
+        };
+        recuperadas = abrirDiario(rutaDiario, &config, restaurarReserva, capturarEstado);
+        if (recuperadas == -1) {
+            limpiarRecursos();
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    // Configurar manejadores de señales
+    signal(SIGALRM, manejadorAlarma);
+    signal(SIGINT, manejadorSigInt);
+    signal(SIGPIPE, SIG_IGN);  // Un agente caído no debe terminar el servidor
+    
+    // Crear hilo para el reloj de simulación
+    if (pthread_create(&tidReloj, NULL, hiloReloj, NULL) != 0) {
+        perror("Error al crear hilo del reloj");
+        limpiarRecursos();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Crear los hilos trabajadores que atienden la cola de peticiones
+    tidTrabajadores = malloc(sizeof(pthread_t) * numTrabajadores);
+    if (tidTrabajadores == NULL) {
+        perror("Error al reservar memoria para los trabajadores");
+        limpiarRecursos();
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < numTrabajadores; i++) {
+        if (pthread_create(&tidTrabajadores[i], NULL, hiloTrabajador, (void *)(intptr_t)i) != 0) {
+            perror("Error al crear hilo trabajador");
+            limpiarRecursos();
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    // Crear el hilo que envía los RESP_OCUPADO, para que recibir nunca espere a un agente
+    if (pthread_create(&tidRespondedor, NULL, hiloRespondedor, NULL) != 0) {
+        perror("Error al crear hilo respondedor");
+        limpiarRecursos();
+        exit(EXIT_FAILURE);
+    }
+    
+    // Crear hilo para recibir peticiones de agentes
+    if (pthread_create(&tidPeticiones, NULL, hiloRecibirPeticiones, NULL) != 0) {
+        perror("Error al crear hilo de peticiones");
+        limpiarRecursos();
+        exit(EXIT_FAILURE);
+    }
+    
+    registrarTexto("✓ Servidor iniciado correctamente\n");
+    registrarTexto("✓ Hora inicial: %d:00\n", horaInicial);
+    registrarTexto("✓ Hora final: %d:00\n", horaFinal);
+    registrarTexto("✓ Aforo máximo: %d personas\n", aforoMaximo);
+    if (segundosPorHora > 0) {
+        registrarTexto("✓ Segundos por hora: %g\n", segundosPorHora);
+    } else {
+        registrarTexto("✓ Segundos por hora: 0 (máxima velocidad: avanza al vaciarse la cola sin agentes conectados)\n");
+    }
+    registrarTexto("✓ Franjas de %d minutos, reservas de %d minutos\n", minutosPorFranja, minutosDuracion);
+    registrarTexto("✓ Calendarios: %d día(s) x %d parque(s)\n", numDias, numParques);
+    registrarTexto("✓ Hilos trabajadores: %d\n", numTrabajadores);
+    registrarTexto("✓ Cola de peticiones: %d (con la cola llena se responde RESP_OCUPADO)\n", profundidadCola);
+    if (colocacionLotes) {
+        registrarTexto("✓ Colocación de lotes: de mayor a menor grupo, en la hora libre más cercana\n");
+    }
+    for (int i = 0; i < numEscuchas; i++) {
+        registrarTexto("✓ Escuchando en %s\n", direccionesEscucha[i]);
+    }
+    if (rutaDiario[0] != '\0') {
+        registrarTexto("✓ Diario de reservas: %s (%ld reservas recuperadas)\n", rutaDiario, recuperadas);
+    }
+    if (destinoMetricas[0] != '\0') {
+        registrarTexto("✓ Métricas en vivo: %s\n", destinoMetricas);
+    }
+    if (rutaReporte[0] != '\0') {
+        registrarTexto("✓ Reporte estructurado: %s\n", rutaReporte);
+    }
+    registrarTexto("✓ Esperando conexiones de agentes...\n\n");
+    if (nivelSalida == NIVEL_SILENCIOSO) {
+        EventoInicio inicio = {
+            .horaInicial = horaInicial, .horaFinal = horaFinal, .aforo = aforoMaximo,
+            .trabajadores = numTrabajadores, .dias = numDias, .parques = numParques,
+            .cola = profundidadCola, .recuperadas = recuperadas
+        };
+        registrarEvento(EVENTO_INICIO, &inicio, sizeof(inicio));
+    }
+    
+    // Esperar a que el hilo del reloj termine (al pasar la hora final o con SIGINT);
+    // al salir notifica el fin por fdEventoFin
+    pthread_join(tidReloj, NULL);
+    
+    // El hilo de peticiones despierta con el evento de fin, encola lo que
+    // quede en el pipe y termina
+    registrarTexto("⏳ Atendiendo las solicitudes pendientes...\n");
+    pthread_join(tidPeticiones, NULL);
+    
+    // Lo mismo con los anillos de los agentes en memoria compartida
+    detenerLectoresMemoria();
+    
+    // Ya no llegan tramas: enviar los RESP_OCUPADO que queden
+    cerrarAvisos();
+    pthread_join(tidRespondedor, NULL);
+    
+    // Cerrar la cola: los trabajadores atienden lo pendiente y terminan
+    cerrarCola();
+    for (int i = 0; i < numTrabajadores; i++) {
+        pthread_join(tidTrabajadores[i], NULL);
+    }
+    free(tidTrabajadores);
+    
+    // Hacer durable lo que quede del diario y dejar una instantánea
+    cerrarDiario();
+    
+    // Última publicación de las métricas y reporte estructurado
+    publicarMetricas(1);
+    escribirReporteEstructurado();
+    
+    // Generar reporte final
+    generarReporte();
+    
+    // Limpiar recursos
+    limpiarRecursos();
+    
+    if (nivelSalida != NIVEL_SILENCIOSO) {
+        printf("\n✓ Servidor finalizado correctamente\n\n");
+    }
+    
+    return 0;
+}
+
+/* ============================================================================
+ * PROCESAMIENTO DE ARGUMENTOS
+ * ============================================================================ */
+void procesarArgumentos(int argc, char *argv[]) {
+    int opt;
+    int flagI = 0, flagF = 0, flagS = 0, flagT = 0, flagP = 0;
+    
+    while ((opt = getopt(argc, argv, "i:f:s:t:p:w:q:m:d:D:P:L:j:v:M:R:O")) != -1) {
+        switch (opt) {
+            case 'i':
+                horaInicial = atoi(optarg);
+                flagI = 1;
+                break;
+            case 'f':
+                horaFinal = atoi(optarg);
+                flagF = 1;
+                break;
+            case 's': {
+                char *fin;
+                segundosPorHora = strtod(optarg, &fin);
+                if (fin == optarg || *fin != '\0') {
+                    segundosPorHora = -1;  // Se rechaza en la validación de rangos
+                }
+                flagS = 1;
+                break;
+            }
+            case 't':
+                aforoMaximo = atoi(optarg);
+                flagT = 1;
+                break;
+            case 'p':
+                strncpy(pipeRecibe, optarg, MAX_NOMBRE - 1);
+                pipeRecibe[MAX_NOMBRE - 1] = '\0';
+                flagP = 1;
+                break;
+            case 'w':
+                numTrabajadores = atoi(optarg);
+                break;
+            case 'q':
+                profundidadCola = atoi(optarg);
+                break;
+            case 'm':
+                minutosPorFranja = atoi(optarg);
+                break;
+            case 'd':
+                minutosDuracion = atoi(optarg);
+                break;
+            case 'D':
+                numDias = atoi(optarg);
+                break;
+            case 'P':
+                numParques = atoi(optarg);
+                break;
+            case 'L':
+                if (numEscuchas == MAX_ESCUCHAS || !esDireccionSocket(optarg)) {
+                    fprintf(stderr, "Error: -L espera %s<ruta> o %s[host:]puerto (a lo sumo %d direcciones)\n",
+                            PREFIJO_UNIX, PREFIJO_TCP, MAX_ESCUCHAS);
+                    exit(EXIT_FAILURE);
+                }
+                strncpy(direccionesEscucha[numEscuchas], optarg, MAX_NOMBRE - 1);
+                direccionesEscucha[numEscuchas][MAX_NOMBRE - 1] = '\0';
+                numEscuchas++;
+                break;
+            case 'j':
+                strncpy(rutaDiario, optarg, MAX_NOMBRE - 1);
+                rutaDiario[MAX_NOMBRE - 1] = '\0';
+                break;
+            case 'v':
+                nivelSalida = atoi(optarg);
+                break;
+            case 'M':
+                strncpy(destinoMetricas, optarg, MAX_NOMBRE - 1);
+                destinoMetricas[MAX_NOMBRE - 1] = '\0';
+                break;
+            case 'R':
+                strncpy(rutaReporte, optarg, MAX_NOMBRE - 1);
+                rutaReporte[MAX_NOMBRE - 1] = '\0';
+                break;
+            case 'O':
+                colocacionLotes = 1;
+                break;
+            default:
+                fprintf(stderr, "Uso: %s -i <horaIni> -f <horaFin> -s <segHoras> -t <total> -p <pipeRecibe> [-w <hilos>] [-q <profundidadCola>] [-m <minFranja>] [-d <minReserva>] [-D <dias>] [-P <parques>] [-L <unix:ruta|tcp:[host:]puerto>]... [-j <diario>] [-v <0-2>] [-M <metricas.json|.csv|unix:ruta|tcp:puerto>] [-R <reporte.json|.csv>] [-O]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    
+    // Validar que todos los parámetros fueron proporcionados
+    if (!flagI || !flagF || !flagS || !flagT || !flagP) {
+        fprintf(stderr, "Error: Faltan parámetros obligatorios\n");
+        fprintf(stderr, "Uso: %s -i <horaIni> -f <horaFin> -s <segHoras> -t <total> -p <pipeRecibe> [-w <hilos>] [-q <profundidadCola>] [-m <minFranja>] [-d <minReserva>] [-D <dias>] [-P <parques>] [-L <unix:ruta|tcp:[host:]puerto>]... [-j <diario>] [-v <0-2>] [-M <metricas.json|.csv|unix:ruta|tcp:puerto>] [-R <reporte.json|.csv>] [-O]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    
+    // Validar rangos
+    if (!validarHora(horaInicial) || !validarHora(horaFinal)) {
+        fprintf(stderr, "Error: Las horas deben estar entre %d y %d\n", HORAS_MIN, HORAS_MAX);
+        exit(EXIT_FAILURE);
+    }
+    
+    if (horaInicial >= horaFinal) {
+        fprintf(stderr, "Error: La hora inicial debe ser menor que la hora final\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    if (segundosPorHora < 0) {
+        fprintf(stderr, "Error: Los segundos por hora deben ser un número mayor o igual a 0 (0 = máxima velocidad)\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    if (aforoMaximo <= 0 || aforoMaximo > MAX_AFORO) {
+        fprintf(stderr, "Error: El aforo máximo debe estar entre 1 y %d\n", MAX_AFORO);
+        exit(EXIT_FAILURE);
+    }
+    
+    if (numTrabajadores < 1 || numTrabajadores > MAX_TRABAJADORES) {
+        fprintf(stderr, "Error: El número de hilos trabajadores debe estar entre 1 y %d\n", MAX_TRABAJADORES);
+        exit(EXIT_FAILURE);
+    }
+    
+    if (profundidadCola < 1 || profundidadCola > MAX_PROFUNDIDAD_COLA) {
+        fprintf(stderr, "Error: La profundidad de la cola (-q) debe estar entre 1 y %d\n", MAX_PROFUNDIDAD_COLA);
+        exit(EXIT_FAILURE);
+    }
+    
+    // Las franjas deben dividir la hora para que cada hora empiece una franja
+    if (minutosPorFranja < 1 || minutosPorFranja > MINUTOS_POR_HORA ||
+        MINUTOS_POR_HORA % minutosPorFranja != 0) {
+        fprintf(stderr, "Error: Los minutos por franja deben dividir a %d\n", MINUTOS_POR_HORA);
+        exit(EXIT_FAILURE);
+    }
+    
+    if (minutosDuracion < minutosPorFranja || minutosDuracion % minutosPorFranja != 0 ||
+        minutosDuracion > MINUTO_CIERRE - MINUTO_APERTURA) {
+        fprintf(stderr, "Error: La duración de la reserva debe ser un múltiplo de la franja (%d minutos) "
+                "dentro del horario de operación\n", minutosPorFranja);
+        exit(EXIT_FAILURE);
+    }
+    
+    if (numDias < 1 || numDias > MAX_DIAS || numParques < 1 || numParques > MAX_PARQUES) {
+        fprintf(stderr, "Error: Los días deben estar entre 1 y %d y los parques entre 1 y %d\n",
+                MAX_DIAS, MAX_PARQUES);
+        exit(EXIT_FAILURE);
+    }
+    
+    if (nivelSalida < NIVEL_SILENCIOSO || nivelSalida > NIVEL_DETALLE) {
+        fprintf(stderr, "Error: El nivel de detalle (-v) debe estar entre %d y %d\n",
+                NIVEL_SILENCIOSO, NIVEL_DETALLE);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* ============================================================================
+ * INICIALIZACIÓN DEL SERVIDOR
+ * ============================================================================ */
+void inicializarServidor() {
+    // Dividir el horario de operación en franjas
+    numFranjas = (MINUTO_CIERRE - MINUTO_APERTURA) / minutosPorFranja;
+    franjasPorReserva = minutosDuracion / minutosPorFranja;
+    franjaInicial = franjaDeMinuto(horaInicial * MINUTOS_POR_HORA);
+    franjaFinPeriodo = franjaDeMinuto((horaFinal + 1) * MINUTOS_POR_HORA);
+    
+    ConfiguracionCalendarios configuracion = {
+        .numFranjas = numFranjas, .franjasPorReserva = franjasPorReserva,
+        .aforoMaximo = aforoMaximo, .franjaFinPeriodo = franjaFinPeriodo
+    };
+    configurarCalendarios(&configuracion);
+    
+    // Inicializar hora actual
+    franjaActual = franjaInicial;
+    
+    // Cola de peticiones con la profundidad pedida (-q)
+    colaPeticiones.tramas = malloc(sizeof(TramaPendiente) * profundidadCola);
+    if (colaPeticiones.tramas == NULL) {
+        perror("Error al reservar memoria para la cola de peticiones");
+        exit(EXIT_FAILURE);
+    }
+    colaPeticiones.capacidad = profundidadCola;
+    
+    // Un calendario por día y parque, cada uno con su ocupación e índices
+    numCalendarios = numDias * numParques;
+    calendarios = malloc(sizeof(Calendario) * numCalendarios);
+    if (calendarios == NULL) {
+        perror("Error al reservar memoria para los calendarios");
+        exit(EXIT_FAILURE);
+    }
+    for (int d = 0; d < numDias; d++) {
+        for (int p = 0; p < numParques; p++) {
+            inicializarCalendario(&calendarios[d * numParques + p], d, p, franjaInicial);
+        }
+    }
+    while ((1 << bitsCalendario) < numCalendarios) {
+        bitsCalendario++;
+    }
+    limiteReservasCalendario = (long)(UINT32_MAX >> bitsCalendario) < INT_MAX ?
+                               (long)(UINT32_MAX >> bitsCalendario) : INT_MAX;
+    
+    // Bucle de eventos del receptor y evento de fin (lo notifican el reloj y SIGINT)
+    fdEventoFin = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    fdEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (fdEventoFin == -1 || fdEpoll == -1) {
+        perror("Error al crear el bucle de eventos");
+        exit(EXIT_FAILURE);
+    }
+    struct epoll_event evento;
+    evento.events = EPOLLIN;
+    evento.data.u32 = ID_EVENTO_FIN;
+    if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdEventoFin, &evento) == -1) {
+        perror("Error al vigilar el evento de fin");
+        exit(EXIT_FAILURE);
+    }
+    
+    // Sockets de escucha: sus conexiones las acepta el mismo bucle de eventos
+    for (int i = 0; i < numEscuchas; i++) {
+        fdEscuchas[i] = escucharEn(direccionesEscucha[i]);
+        if (fdEscuchas[i] == -1) {
+            fprintf(stderr, "Error al escuchar en %s: %s\n", direccionesEscucha[i], strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        evento.events = EPOLLIN;
+        evento.data.u32 = ID_EVENTO_ESCUCHA | (uint32_t)i;
+        if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdEscuchas[i], &evento) == -1) {
+            perror("Error al vigilar el socket de escucha");
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    // Métricas en vivo: un socket que atiende el mismo bucle de eventos o una serie CSV
+    if (esDireccionSocket(destinoMetricas)) {
+        fdEscuchaMetricas = escucharEn(destinoMetricas);
+        if (fdEscuchaMetricas == -1) {
+            fprintf(stderr, "Error al escuchar en %s: %s\n", destinoMetricas, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        evento.events = EPOLLIN;
+        evento.data.u32 = ID_EVENTO_METRICAS;
+        if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdEscuchaMetricas, &evento) == -1) {
+            perror("Error al vigilar el socket de métricas");
+            exit(EXIT_FAILURE);
+        }
+    } else if (esArchivoCSV(destinoMetricas)) {
+        static const char cabecera[] = "t,hora,solicitudes,aceptadas,reprogramadas,negadas,solicitudes_por_segundo,"
+                                       "pendientes,maximo_pendientes,en_proceso,agentes,"
+                                       "latencia_p50_us,latencia_p99_us,latencia_max_us\n";
+        fdSerieMetricas = open(destinoMetricas, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (fdSerieMetricas == -1 ||
+            !escribirCompleto(fdSerieMetricas, (const uint8_t *)cabecera, sizeof(cabecera) - 1)) {
+            fprintf(stderr, "Error al abrir %s: %s\n", destinoMetricas, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    inicializarTablaAgentes();
+    
+    // Crear el pipe nominal para recibir mensajes
+    unlink(pipeRecibe);  // Eliminar si existe
+    if (mkfifo(pipeRecibe, 0666) == -1) {
+        if (errno != EEXIST) {
+            perror("Error al crear pipe de recepción");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/* ============================================================================
+ * MANEJADORES DE SEÑALES
+ * ============================================================================ */
+void manejadorAlarma(int sig) {
+    (void)sig;  // Suprimir warning de parámetro no usado
+    alarmaRecibida = 1;
+}
+
+void manejadorSigInt(int sig) {
+    (void)sig;  // Suprimir warning de parámetro no usado
+    finalizarServidor = 1;
+    notificarFin();  // write() es seguro dentro de un manejador de señal
+}
+
+/* Despierta a todos los que esperan en fdEventoFin; puede llamarse varias veces. */
+void notificarFin() {
+    uint64_t uno = 1;
+    ssize_t escritos = write(fdEventoFin, &uno, sizeof(uno));
+    (void)escritos;  // Si el contador ya está lleno el evento sigue notificado
+}
+
+/*
+ * Espera a que venza el temporizador del reloj o a que se notifique el fin.
+ * Devuelve 1 con el número de franjas vencidas (más de una si el reloj se
+ * atrasó: así no se acumula deriva) o 0 si se notificó el fin.
+ */
+int esperarFranjas(int fdTemporizador, uint64_t *franjas) {
+    for (;;) {
+        fd_set fds;
+        int maximo = fdTemporizador > fdEventoFin ? fdTemporizador : fdEventoFin;
+        
+        FD_ZERO(&fds);
+        FD_SET(fdTemporizador, &fds);
+        FD_SET(fdEventoFin, &fds);
+        if (pselect(maximo + 1, &fds, NULL, NULL, NULL, NULL) == -1) {
+            continue;  // EINTR: volver a esperar
+        }
+        if (FD_ISSET(fdEventoFin, &fds) || finalizarServidor) {
+            return 0;
+        }
+        if (read(fdTemporizador, franjas, sizeof(*franjas)) == sizeof(*franjas)) {
+            return 1;
+        }
+    }
+}
+
+/*
+ * Modo de máxima velocidad (-s 0): espera a que la cola quede sin pendientes
+ * ni mensajes en proceso y sin agentes conectados que puedan enviar más,
+ * después de haber atendido al menos un mensaje (para no consumir el día
+ * antes de que llegue el primer agente). Todas las solicitudes se atienden
+ * así a la hora en que fueron recibidas y el resto del día pasa sin esperas.
+ * Devuelve 0 si se notificó el fin.
+ */
+int esperarColaDrenada() {
+    pthread_mutex_lock(&colaPeticiones.mutex);
+    while (!finalizarServidor &&
+           (colaPeticiones.atendidas == 0 || colaPeticiones.cantidad > 0 ||
+            colaPeticiones.enProceso > 0 || contarAgentesActivos() > 0)) {
+        pthread_cond_wait(&colaPeticiones.drenada, &colaPeticiones.mutex);
+    }
+    pthread_mutex_unlock(&colaPeticiones.mutex);
+    return !finalizarServidor;
+}
+
+/* ============================================================================
+ * HILO DEL RELOJ DE SIMULACIÓN
+ * ============================================================================ */
+void *hiloReloj(void *arg) {
+    (void)arg;  // Suprimir warning de parámetro no usado
+    
+    int fdTemporizador = -1;
+    
+    // Temporizador periódico: cada franja dura la parte proporcional de los
+    // segundos por hora y vence en instantes absolutos, sin deriva
+    if (segundosPorHora > 0) {
+        long long nanosPorFranja = (long long)(segundosPorHora * 1e9 * minutosPorFranja / MINUTOS_POR_HORA);
+        struct itimerspec periodo;
+        
+        if (nanosPorFranja < 1) {
+            nanosPorFranja = 1;
+        }
+        periodo.it_interval.tv_sec = (time_t)(nanosPorFranja / 1000000000LL);
+        periodo.it_interval.tv_nsec = (long)(nanosPorFranja % 1000000000LL);
+        periodo.it_value = periodo.it_interval;
+        
+        fdTemporizador = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (fdTemporizador == -1 || timerfd_settime(fdTemporizador, 0, &periodo, NULL) == -1) {
+            perror("Error al crear el temporizador del reloj");
+            finalizarServidor = 1;
+        }
+    }
+    
+    while (franjaActual < franjaFinPeriodo && !finalizarServidor) {
+        uint64_t franjas = 1;
+        
+        // Esperar el paso de una franja (o, a máxima velocidad, a que no
+        // quede nada por atender); el fin interrumpe la espera
+        if (fdTemporizador != -1 ? !esperarFranjas(fdTemporizador, &franjas) : !esperarColaDrenada()) {
+            break;
+        }
+        
+        for (uint64_t i = 0; i < franjas && franjaActual < franjaFinPeriodo; i++) {
+            // Avanzar a la siguiente franja
+            avanzarHora();
+            
+            // Imprimir estado actual
+            imprimirEstadoHora();
+            publicarMetricas(0);
+        }
+    }
+    
+    if (fdTemporizador != -1) {
+        close(fdTemporizador);
+    }
+    
+    // Marcar que el servidor debe finalizar y despertar al hilo receptor
+    finalizarServidor = 1;
+    notificarFin();
+    
+    // Notificar que la simulación ha terminado
+    registrarEvento(EVENTO_FIN_SIMULACION, NULL, 0);
+    
+    return NULL;
+}
+
+/* ============================================================================
+ * HILO PARA RECIBIR PETICIONES DE AGENTES
+ * ============================================================================ */
+/*
+ * Bucle de eventos del controlador. Vigila con epoll el pipe nominal, el
+ * evento de fin, los sockets de escucha y sus conexiones, y los canales de
+ * respuesta de los agentes (para cerrar la conexión en cuanto un agente
+ * desaparece). No hay esperas con tiempo límite: el hilo solo despierta
+ * cuando algo ocurre, y al notificarse el fin encola lo que quede en el pipe
+ * y en las conexiones y termina de inmediato.
+ */
+void *hiloRecibirPeticiones(void *arg) {
+    (void)arg;  // Suprimir warning de parámetro no usado
+    
+    struct epoll_event eventos[MAX_EVENTOS];
+    BufferTramas buffer;
+    int terminar = 0;
+    
+    inicializarBufferTramas(&buffer);
+    
+    int fdPipeRecibe = abrirPipeRecibe();
+    if (fdPipeRecibe == -1) {
+        perror("Error al abrir pipe de recepción");
+        finalizarServidor = 1;
+        notificarFin();
+        return NULL;
+    }
+    
+    while (!terminar) {
+        int n = epoll_wait(fdEpoll, eventos, MAX_EVENTOS, -1);
+        
+        if (n == -1) {
+            if (errno != EINTR) {
+                perror("Error en epoll_wait");
+                break;
+            }
+            continue;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            uint32_t id = eventos[i].data.u32;
+            
+            if (id == ID_EVENTO_FIN) {
+                terminar = 1;
+            } else if (id == ID_EVENTO_METRICAS) {
+                atenderMetricas();
+            } else if (id == ID_EVENTO_PIPE) {
+                if (!atenderPipeRecibe(&fdPipeRecibe, &buffer)) {
+                    terminar = 1;
+                }
+            } else if (id & ID_EVENTO_CONEXION) {
+                atenderConexion((int)(id & MASCARA_EVENTO));
+            } else if (id & ID_EVENTO_ESCUCHA) {
+                aceptarConexiones(fdEscuchas[id & MASCARA_EVENTO]);
+            } else {
+                // Error o cierre en el pipe de respuesta: el agente ya no lee
+                descartarConexionAgente(id);
+            }
+        }
+    }
+    
+    // Encolar lo que ya estaba escrito en el pipe y en las conexiones antes de terminar
+    if (fdPipeRecibe != -1) {
+        atenderPipeRecibe(&fdPipeRecibe, &buffer);
+        close(fdPipeRecibe);
+    }
+    for (int fd = 0; fd < capacidadConexiones; fd++) {
+        if (buffersConexion[fd] != NULL) {
+            atenderConexion(fd);
+        }
+        if (buffersConexion[fd] != NULL) {
+            cerrarConexion(fd);
+        }
+    }
+    free(buffersConexion);
+    buffersConexion = NULL;
+    capacidadConexiones = 0;
+    
+    // Un reloj a máxima velocidad espera en una variable de condición, que
+    // el manejador de SIGINT no puede señalar
+    despertarReloj();
+    return NULL;
+}
+
+/*
+ * Abre el pipe nominal en modo no bloqueante (epoll avisa cuando hay datos)
+ * y lo agrega al bucle de eventos. Devuelve el descriptor o -1.
+ */
+int abrirPipeRecibe() {
+    int fd = open(pipeRecibe, O_RDONLY | O_NONBLOCK);
+    if (fd == -1) {
+        return -1;
+    }
+    
+    struct epoll_event evento;
+    evento.events = EPOLLIN;
+    evento.data.u32 = ID_EVENTO_PIPE;
+    if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fd, &evento) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * Lee todo lo disponible en el pipe y delega cada trama completa a los
+ * trabajadores. Si el último agente cerró el pipe (EOF) lo reabre para
+ * esperar nuevas conexiones. Devuelve 0 si el pipe no pudo reabrirse.
+ */
+int atenderPipeRecibe(int *fdPipeRecibe, BufferTramas *buffer) {
+    for (;;) {
+        ssize_t bytesLeidos = llenarBufferTramas(buffer, *fdPipeRecibe);
+        
+        if (bytesLeidos > 0) {
+            MARCAR_INSTANTE(instanteLectura);
+            const uint8_t *trama;
+            size_t longitud;
+            int estado;
+            
+            while ((estado = siguienteTrama(buffer, &trama, &longitud)) != 0) {
+                if (estado == -1) {
+                    fprintf(stderr, "Trama inválida o de otra versión del protocolo, descartada\n");
+                    break;
+                }
+                encolarPeticion(trama, longitud, -1);
+            }
+        } else if (bytesLeidos == 0) {
+            // EOF - cerrar (lo retira de epoll) y reabrir para aceptar nuevas conexiones
+            close(*fdPipeRecibe);
+            inicializarBufferTramas(buffer);
+            *fdPipeRecibe = abrirPipeRecibe();
+            if (*fdPipeRecibe == -1) {
+                if (!finalizarServidor) {
+                    perror("Error al reabrir pipe de recepción");
+                }
+                return 0;
+            }
+            return 1;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && !finalizarServidor) {
+                perror("Error al leer del pipe");
+            }
+            return 1;  // Sin más datos por ahora
+        }
+    }
+}
+
+/*
+ * Acepta todas las conexiones pendientes de un socket de escucha y las agrega
+ * al bucle de eventos con su propio buffer de tramas.
+ */
+void aceptarConexiones(int fdEscucha) {
+    int fd;
+    
+    while ((fd = aceptarConexion(fdEscucha)) != -1) {
+        if (fd >= capacidadConexiones) {
+            int nuevaCapacidad = capacidadConexiones ? capacidadConexiones : 64;
+            while (nuevaCapacidad <= fd) {
+                nuevaCapacidad *= 2;
+            }
+            BufferTramas **nuevos = realloc(buffersConexion, sizeof(BufferTramas *) * nuevaCapacidad);
+            if (nuevos == NULL) {
+                perror("Error al reservar memoria para las conexiones");
+                close(fd);
+                return;
+            }
+            memset(nuevos + capacidadConexiones, 0, sizeof(BufferTramas *) * (nuevaCapacidad - capacidadConexiones));
+            buffersConexion = nuevos;
+            capacidadConexiones = nuevaCapacidad;
+        }
+        
+        buffersConexion[fd] = malloc(sizeof(BufferTramas));
+        if (buffersConexion[fd] == NULL) {
+            perror("Error al reservar memoria para la conexión");
+            close(fd);
+            continue;
+        }
+        inicializarBufferTramas(buffersConexion[fd]);
+        
+        struct epoll_event evento;
+        evento.events = EPOLLIN | EPOLLRDHUP;
+        evento.data.u32 = ID_EVENTO_CONEXION | (uint32_t)fd;
+        if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fd, &evento) == -1) {
+            perror("Error al vigilar la conexión");
+            free(buffersConexion[fd]);
+            buffersConexion[fd] = NULL;
+            close(fd);
+        }
+    }
+    
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror("Error al aceptar conexión");
+    }
+}
+
+/*
+ * Lee todo lo disponible en una conexión y delega cada trama completa a los
+ * trabajadores, igual que con el pipe nominal. Un MSG_REGISTRO lleva una
+ * copia del descriptor: la conexión es también el canal de respuesta del
+ * agente. Al cerrarse la conexión (o si llega basura) se libera.
+ */
+void atenderConexion(int fd) {
+    BufferTramas *buffer = buffersConexion[fd];
+    
+    for (;;) {
+        ssize_t bytesLeidos = llenarBufferTramas(buffer, fd);
+        
+        if (bytesLeidos > 0) {
+            MARCAR_INSTANTE(instanteLectura);
+            const uint8_t *trama;
+            size_t longitud;
+            int estado;
+            
+            while ((estado = siguienteTrama(buffer, &trama, &longitud)) != 0) {
+                if (estado == -1) {
+                    fprintf(stderr, "Trama inválida o de otra versión del protocolo, conexión cerrada\n");
+                    cerrarConexion(fd);
+                    return;
+                }
+                int fdOrigen = tipoTrama(trama) == MSG_REGISTRO ? dup(fd) : -1;
+                if (!encolarPeticion(trama, longitud, fdOrigen) && fdOrigen != -1) {
+                    close(fdOrigen);
+                }
+            }
+        } else if (bytesLeidos == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            cerrarConexion(fd);  // El agente cerró la conexión o se cayó
+            return;
+        } else {
+            return;  // Sin más datos por ahora
+        }
+    }
+}
+
+/* Deja de vigilar una conexión y la cierra (la copia del agente sigue abierta) */
+void cerrarConexion(int fd) {
+    epoll_ctl(fdEpoll, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    free(buffersConexion[fd]);
+    buffersConexion[fd] = NULL;
+}
+
+/*
+ * Agrega el canal de respuesta de un agente al bucle de eventos. En un pipe
+ * epoll informa EPOLLERR cuando el agente cierra su extremo aunque no se
+ * pidan eventos; en un socket se pide EPOLLRDHUP.
+ */
+void vigilarConexionAgente(int fd, uint32_t idAgente) {
+    struct epoll_event evento;
+    evento.events = EPOLLRDHUP;
+    evento.data.u32 = idAgente;
+    if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fd, &evento) == -1) {
+        perror("Error al vigilar el pipe de respuesta del agente");
+    }
+}
+
+/* Da por terminado a un agente cuya conexión se cerró sin MSG_FIN_AGENTE */
+void descartarConexionAgente(uint32_t idAgente) {
+    char nombre[MAX_NOMBRE] = "";
+    CanalAgente canal = CANAL_PIPE;
+    
+    pthread_mutex_lock(&mutexAgentes);
+    AgenteInfo *agente = buscarAgente(idAgente);
+    if (agente != NULL) {
+        strcpy(nombre, agente->nombre);
+        canal = agente->canal;
+        retirarAgente(agente);
+    }
+    pthread_mutex_unlock(&mutexAgentes);
+    
+    if (nombre[0] != '\0') {
+        registrarEventoAgente(AGENTE_DESCONECTADO, canal, nombre);
+    }
+    
+    // A máxima velocidad el reloj espera a que no queden agentes conectados
+    despertarReloj();
+}
+
+/*
+ * Cierra el canal de respuesta de un agente. Se retira de epoll antes de
+ * cerrarlo: con un socket el receptor puede tener abierta otra copia y epoll
+ * seguiría informándolo. Solo se llama al soltar la última referencia, de
+ * modo que ningún envío en curso escriba en un descriptor ya reutilizado.
+ */
+void cerrarConexionAgente(AgenteInfo *agente) {
+    if (agente->fdRespuesta != -1) {
+        epoll_ctl(fdEpoll, EPOLL_CTL_DEL, agente->fdRespuesta, NULL);
+        close(agente->fdRespuesta);
+        agente->fdRespuesta = -1;
+    }
+}
+
+/* ============================================================================
+ * TRANSPORTE EN MEMORIA COMPARTIDA
+ * ============================================================================ */
+/*
+ * Hilo lector de un agente que usa memoria compartida: pasa cada trama de su
+ * anillo de solicitudes a la cola de peticiones, igual que el bucle de
+ * eventos con el pipe nominal. Termina cuando el anillo se cierra y queda
+ * vacío (fin o caída del agente, o fin del servidor). Conserva una
+ * referencia al agente: el segmento sigue proyectado mientras lo lee.
+ */
+void *hiloLectorMemoria(void *arg) {
+    AgenteInfo *agente = arg;
+    uint8_t trama[MAX_TRAMA];
+    size_t longitud;
+    
+    while (leerDeAnillo(&agente->segmento->solicitudes, trama, &longitud)) {
+        MARCAR_INSTANTE(instanteLectura);
+        if (longitud < TAM_CABECERA || trama[0] != PROTOCOLO_VERSION) {
+            fprintf(stderr, "Trama inválida en memoria compartida, descartada\n");
+            continue;
+        }
+        encolarPeticion(trama, longitud, -1);
+    }
+    
+    pthread_mutex_lock(&mutexAgentes);
+    soltarAgente(agente);
+    lectoresMemoria--;
+    pthread_cond_broadcast(&lectoresTerminados);
+    pthread_mutex_unlock(&mutexAgentes);
+    
+    return NULL;
+}
+
+/* Cierra ambos anillos de un agente en memoria compartida. Requiere mutexAgentes tomado. */
+void cerrarAnillosAgente(AgenteInfo *agente) {
+    if (agente->segmento != NULL) {
+        cerrarAnillo(&agente->segmento->solicitudes);
+        cerrarAnillo(&agente->segmento->respuestas);
+    }
+}
+
+/*
+ * Al terminar el servidor: cierra los anillos de solicitudes (las tramas ya
+ * escritas aún se encolan) y espera a los hilos lectores. Los anillos de
+ * respuestas siguen abiertos hasta que los trabajadores terminen. Los
+ * lectores de agentes ya retirados tienen su anillo cerrado y terminan solos.
+ */
+void detenerLectoresMemoria() {
+    pthread_mutex_lock(&mutexAgentes);
+    
+    // Los registros que aún estén en la cola ya no crean hilos lectores
+    aceptarMemoria = 0;
+    for (int b = 0; b < (1 << bitsTablaAgentes); b++) {
+        for (AgenteInfo *agente = tablaAgentes[b]; agente != NULL; agente = agente->siguiente) {
+            if (agente->segmento != NULL) {
+                cerrarAnillo(&agente->segmento->solicitudes);
+            }
+        }
+    }
+    
+    while (lectoresMemoria > 0) {
+        pthread_cond_wait(&lectoresTerminados, &mutexAgentes);
+    }
+    pthread_mutex_unlock(&mutexAgentes);
+}
+
+/* ============================================================================
+ * HILOS TRABAJADORES
+ * ============================================================================ */
+void *hiloTrabajador(void *arg) {
+    TramaPendiente trama;
+    MensajeAgente msg;
+    LoteSolicitudes lote;
+    char nombreAgente[MAX_NOMBRE];
+    
+    // Cada trabajador contabiliza en sus propios contadores (ver generarReporte)
+    estadisticasHilo = &estadisticasTrabajadores[(intptr_t)arg];
+    
+    // Atender mensajes hasta que la cola se cierre y quede vacía
+    while (desencolarPeticion(&trama)) {
+        long solicitudes = 0;  // Respondidas por esta trama, para la latencia
+        struct timespec inicioAtencion;
+        clock_gettime(CLOCK_MONOTONIC, &inicioAtencion);
+        MEDIR_ETAPA(ETAPA_COLA, trama.llegada);
+        
+        // Los lotes tienen su propio formato y se atienden completos
+        if (tipoTrama(trama.datos) == MSG_SOLICITUD_LOTE) {
+            if (!decodificarLote(trama.datos, trama.longitud, &lote) ||
+                !buscarNombreAgente(lote.idAgente, nombreAgente)) {
+                fprintf(stderr, "Lote mal formado o de un agente no registrado\n");
+                terminarPeticion(0);
+                continue;
+            }
+            procesarLote(&lote, nombreAgente);
+            solicitudes = lote.cantidad;
+        } else if (decodificarMensaje(trama.datos, trama.longitud, &msg)) {
+            procesarMensaje(&msg, trama.fdOrigen);
+            solicitudes = msg.tipo == MSG_SOLICITUD_RESERVA || msg.tipo == MSG_CANCELAR ||
+                          msg.tipo == MSG_MODIFICAR;
+        } else {
+            fprintf(stderr, "Mensaje mal formado recibido\n");
+            if (trama.fdOrigen != -1) {
+                close(trama.fdOrigen);
+            }
+        }
+        
+        // Latencia de admisión: de la llegada de la trama a su respuesta
+        struct timespec ahora;
+        clock_gettime(CLOCK_MONOTONIC, &ahora);
+        if (solicitudes > 0) {
+            registrarLatencia(&estadisticasHilo->latencia, nanosEntre(&trama.llegada, &ahora), solicitudes);
+        }
+        
+        terminarPeticion(nanosEntre(&inicioAtencion, &ahora));
+    }
+    
+    return NULL;
+}
+
+/* ============================================================================
+ * COLA DE PETICIONES
+ * ============================================================================ */
+/*
+ * Encola una trama para los trabajadores. Con la cola llena, el registro y
+ * el fin de un agente esperan espacio (contrapresión sobre el hilo
+ * receptor); cualquier otra trama se responde en el acto con RESP_OCUPADO,
+ * sin atenderla (el aviso lo envía el hilo respondedor), para que la espera
+ * de las admitidas siga acotada. Devuelve 0 solo si la cola ya se cerró.
+ */
+int encolarPeticion(const uint8_t *trama, size_t longitud, int fdOrigen) {
+    struct timespec llegada;
+    clock_gettime(CLOCK_MONOTONIC, &llegada);  // La latencia incluye la espera por espacio
+    int esperarEspacio = tipoTrama(trama) == MSG_REGISTRO || tipoTrama(trama) == MSG_FIN_AGENTE;
+    
+    pthread_mutex_lock(&colaPeticiones.mutex);
+    
+    while (esperarEspacio && colaPeticiones.cantidad == colaPeticiones.capacidad && !colaPeticiones.cerrada) {
+        pthread_cond_wait(&colaPeticiones.noLlena, &colaPeticiones.mutex);
+    }
+    
+    if (colaPeticiones.cerrada) {
+        pthread_mutex_unlock(&colaPeticiones.mutex);
+        return 0;
+    }
+    
+    if (colaPeticiones.cantidad == colaPeticiones.capacidad) {
+        int esperaMs = esperaSugeridaMs();
+        colaPeticiones.rechazadas++;
+        pthread_mutex_unlock(&colaPeticiones.mutex);
+        rechazarPorOcupacion(trama, longitud, esperaMs);
+        return 1;
+    }
+    
+    int posicion = (colaPeticiones.frente + colaPeticiones.cantidad) % colaPeticiones.capacidad;
+    memcpy(colaPeticiones.tramas[posicion].datos, trama, longitud);
+    colaPeticiones.tramas[posicion].longitud = longitud;
+    colaPeticiones.tramas[posicion].fdOrigen = fdOrigen;
+    colaPeticiones.tramas[posicion].llegada = llegada;
+    colaPeticiones.cantidad++;
+    if (colaPeticiones.cantidad > colaPeticiones.maximoPendientes) {
+        colaPeticiones.maximoPendientes = colaPeticiones.cantidad;
+    }
+    
+    pthread_cond_signal(&colaPeticiones.noVacia);
+    pthread_mutex_unlock(&colaPeticiones.mutex);
+    MEDIR_ETAPA(ETAPA_RECEPCION, instanteLectura);
+    return 1;
+}
+
+int desencolarPeticion(TramaPendiente *trama) {
+    pthread_mutex_lock(&colaPeticiones.mutex);
+    
+    while (colaPeticiones.cantidad == 0 && !colaPeticiones.cerrada) {
+        pthread_cond_wait(&colaPeticiones.noVacia, &colaPeticiones.mutex);
+    }
+    
+    // Cola cerrada y sin pendientes: el trabajador debe terminar
+    if (colaPeticiones.cantidad == 0) {
+        pthread_mutex_unlock(&colaPeticiones.mutex);
+        return 0;
+    }
+    
+    TramaPendiente *origen = &colaPeticiones.tramas[colaPeticiones.frente];
+    memcpy(trama->datos, origen->datos, origen->longitud);
+    trama->longitud = origen->longitud;
+    trama->fdOrigen = origen->fdOrigen;
+    trama->llegada = origen->llegada;
+    colaPeticiones.frente = (colaPeticiones.frente + 1) % colaPeticiones.capacidad;
+    colaPeticiones.cantidad--;
+    colaPeticiones.enProceso++;
+    
+    pthread_cond_signal(&colaPeticiones.noLlena);
+    pthread_mutex_unlock(&colaPeticiones.mutex);
+    return 1;
+}
+
+/*
+ * Marca como atendido un mensaje desencolado, que ocupó a su trabajador
+ * nanosAtencion; avisa al reloj si la cola quedó drenada.
+ */
+void terminarPeticion(long nanosAtencion) {
+    pthread_mutex_lock(&colaPeticiones.mutex);
+    colaPeticiones.enProceso--;
+    colaPeticiones.atendidas++;
+    colaPeticiones.nanosAtencion += nanosAtencion;
+    if (colaPeticiones.cantidad == 0 && colaPeticiones.enProceso == 0) {
+        pthread_cond_broadcast(&colaPeticiones.drenada);
+    }
+    pthread_mutex_unlock(&colaPeticiones.mutex);
+}
+
+/*
+ * Espera que se sugiere a quien encuentra la cola llena: lo que tardarían
+ * los trabajadores en atender lo pendiente, al tiempo medio de atención
+ * observado, entre 1 y MAX_ESPERA_SUGERIDA_MS. Requiere colaPeticiones.mutex.
+ */
+int esperaSugeridaMs() {
+    long mediaNanos = colaPeticiones.atendidas > 0 ? colaPeticiones.nanosAtencion / colaPeticiones.atendidas : 0;
+    long esperaMs = (colaPeticiones.cantidad * mediaNanos / numTrabajadores + 999999) / 1000000;
+    
+    return esperaMs < 1 ? 1 : esperaMs > MAX_ESPERA_SUGERIDA_MS ? MAX_ESPERA_SUGERIDA_MS : (int)esperaMs;
+}
+
+/*
+ * Responde RESP_OCUPADO a una trama que no cupo en la cola, con la misma
+ * secuencia para que el agente sepa cuál reenviar (un lote va sin ella).
+ * Quien llama está recibiendo, así que solo deja el aviso al respondedor.
+ */
+void rechazarPorOcupacion(const uint8_t *trama, size_t longitud, int esperaMs) {
+    RespuestaControlador resp;
+    uint32_t idAgente;
+    
+    memset(&resp, 0, sizeof(resp));
+    if (!remitenteTrama(trama, longitud, &idAgente, &resp.secuencia)) {
+        return;
+    }
+    resp.tipo = RESP_OCUPADO;
+    resp.horaActual = minutoDeFranja(franjaActual);
+    resp.dato = esperaMs;
+    
+    pthread_mutex_lock(&colaAvisos.mutex);
+    if (colaAvisos.cantidad == MAX_AVISOS_OCUPADO) {
+        colaAvisos.descartados++;
+        pthread_mutex_unlock(&colaAvisos.mutex);
+        return;
+    }
+    colaAvisos.avisos[colaAvisos.cantidad].idAgente = idAgente;
+    colaAvisos.avisos[colaAvisos.cantidad].resp = resp;
+    colaAvisos.cantidad++;
+    pthread_cond_signal(&colaAvisos.hayAvisos);
+    pthread_mutex_unlock(&colaAvisos.mutex);
+}
+
+/*
+ * Hilo respondedor: toma todos los avisos acumulados y los envía fuera del
+ * mutex. Espera a cada agente a lo sumo PLAZO_AVISO_OCUPADO_MS y descarta al
+ * que no lee, de modo que uno atascado no retiene los avisos de los demás.
+ * Termina con cerrarAvisos, tras enviar los que queden.
+ */
+void *hiloRespondedor(void *arg) {
+    (void)arg;
+    AvisoOcupado *lote = malloc(sizeof(AvisoOcupado) * MAX_AVISOS_OCUPADO);
+    if (lote == NULL) {
+        perror("Error al reservar memoria para los avisos de cola llena");
+        exit(EXIT_FAILURE);
+    }
+    
+    pthread_mutex_lock(&colaAvisos.mutex);
+    for (;;) {
+        while (colaAvisos.cantidad == 0 && !colaAvisos.cerrada) {
+            pthread_cond_wait(&colaAvisos.hayAvisos, &colaAvisos.mutex);
+        }
+        if (colaAvisos.cantidad == 0) {
+            break;  // Cerrada y sin avisos pendientes
+        }
+        
+        // Copiar los pendientes para enviarlos sin retener a quien recibe
+        int cantidad = colaAvisos.cantidad;
+        memcpy(lote, colaAvisos.avisos, sizeof(AvisoOcupado) * cantidad);
+        colaAvisos.cantidad = 0;
+        pthread_mutex_unlock(&colaAvisos.mutex);
+        
+        for (int i = 0; i < cantidad; i++) {
+            uint8_t trama[MAX_TRAMA];
+            size_t longitud = codificarRespuesta(&lote[i].resp, trama);
+            enviarTramaConPlazo(lote[i].idAgente, trama, longitud, PLAZO_AVISO_OCUPADO_MS);
+        }
+        
+        pthread_mutex_lock(&colaAvisos.mutex);
+    }
+    pthread_mutex_unlock(&colaAvisos.mutex);
+    
+    free(lote);
+    return NULL;
+}
+
+void cerrarAvisos() {
+    pthread_mutex_lock(&colaAvisos.mutex);
+    colaAvisos.cerrada = 1;
+    pthread_cond_signal(&colaAvisos.hayAvisos);
+    pthread_mutex_unlock(&colaAvisos.mutex);
+}
+
+void despertarReloj() {
+    pthread_mutex_lock(&colaPeticiones.mutex);
+    pthread_cond_broadcast(&colaPeticiones.drenada);
+    pthread_mutex_unlock(&colaPeticiones.mutex);
+}
+
+void cerrarCola() {
+    pthread_mutex_lock(&colaPeticiones.mutex);
+    colaPeticiones.cerrada = 1;
+    pthread_cond_broadcast(&colaPeticiones.noVacia);
+    pthread_cond_broadcast(&colaPeticiones.noLlena);
+    pthread_mutex_unlock(&colaPeticiones.mutex);
+}
+
+/* ============================================================================
+ * PROCESAMIENTO DE MENSAJES
+ * ============================================================================ */
+void procesarMensaje(MensajeAgente *msg, int fdOrigen) {
+    // Fuera del registro los mensajes solo traen el id del agente. Un
+    // MSG_FIN_AGENTE puede llegar después de que el cierre de su canal lo
+    // retirara: ya no hay nada que liberar
+    if (msg->tipo != MSG_REGISTRO && !resolverAgente(msg)) {
+        if (msg->tipo == MSG_FIN_AGENTE) {
+            return;
+        }
+        fprintf(stderr, "Mensaje de un agente no registrado (id %u) descartado\n", msg->idAgente);
+        return;
+    }
+    
+    switch (msg->tipo) {
+        case MSG_REGISTRO:
+            registrarAgente(msg, fdOrigen);
+            break;
+        case MSG_SOLICITUD_RESERVA:
+            procesarSolicitudReserva(msg);
+            break;
+        case MSG_CANCELAR:
+        case MSG_MODIFICAR:
+            procesarCambioReserva(msg);
+            break;
+        case MSG_CONSULTA_DISPONIBILIDAD:
+            procesarConsultaDisponibilidad(msg);
+            break;
+        case MSG_FIN_AGENTE:
+            finalizarAgente(msg);
+            break;
+        default:
+            fprintf(stderr, "Mensaje desconocido recibido\n");
+            break;
+    }
+}
+
+/*
+ * Completa el nombre del agente a partir del id asignado en el registro
+ * (0 = sin registrar).
+ */
+int resolverAgente(MensajeAgente *msg) {
+    return buscarNombreAgente(msg->idAgente, msg->nombreAgente);
+}
+
+/* Copia en nombre (MAX_NOMBRE bytes) el nombre del agente activo con ese id */
+int buscarNombreAgente(uint32_t idAgente, char *nombre) {
+    int encontrado = 0;
+    
+    pthread_mutex_lock(&mutexAgentes);
+    AgenteInfo *agente = buscarAgente(idAgente);
+    if (agente != NULL) {
+        strncpy(nombre, agente->nombre, MAX_NOMBRE - 1);
+        nombre[MAX_NOMBRE - 1] = '\0';
+        encontrado = 1;
+    }
+    pthread_mutex_unlock(&mutexAgentes);
+    
+    return encontrado;
+}
+
+/* Agentes registrados que aún no envían MSG_FIN_AGENTE */
+int contarAgentesActivos() {
+    pthread_mutex_lock(&mutexAgentes);
+    int activos = numAgentes;
+    pthread_mutex_unlock(&mutexAgentes);
+    
+    return activos;
+}
+
+/* ============================================================================
+ * TABLA DE AGENTES
+ * ============================================================================ */
+void inicializarTablaAgentes() {
+    bitsTablaAgentes = 0;
+    while ((1 << bitsTablaAgentes) < CAPACIDAD_INICIAL_AGENTES) {
+        bitsTablaAgentes++;
+    }
+    tablaAgentes = calloc((size_t)1 << bitsTablaAgentes, sizeof(AgenteInfo *));
+    if (tablaAgentes == NULL) {
+        perror("Error al reservar memoria para la tabla de agentes");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Cubeta de un id (hash multiplicativo de Fibonacci: usa los bits altos) */
+static size_t cubetaAgente(uint32_t idAgente, int bits) {
+    return (size_t)((uint32_t)(idAgente * 2654435769u) >> (32 - bits));
+}
+
+/* Agente registrado con ese id (NULL si no hay). Requiere mutexAgentes tomado. */
+AgenteInfo *buscarAgente(uint32_t idAgente) {
+    AgenteInfo *agente = tablaAgentes[cubetaAgente(idAgente, bitsTablaAgentes)];
+    while (agente != NULL && agente->id != idAgente) {
+        agente = agente->siguiente;
+    }
+    return agente;
+}
+
+/* Duplica las cubetas cuando la carga pasa de 3/4; si no hay memoria sigue con las actuales */
+static void crecerTablaAgentes() {
+    int bits = bitsTablaAgentes + 1;
+    AgenteInfo **nueva = calloc((size_t)1 << bits, sizeof(AgenteInfo *));
+    if (nueva == NULL) {
+        return;
+    }
+    
+    for (int b = 0; b < (1 << bitsTablaAgentes); b++) {
+        AgenteInfo *agente = tablaAgentes[b];
+        while (agente != NULL) {
+            AgenteInfo *siguiente = agente->siguiente;
+            size_t destino = cubetaAgente(agente->id, bits);
+            agente->siguiente = nueva[destino];
+            nueva[destino] = agente;
+            agente = siguiente;
+        }
+    }
+    
+    free(tablaAgentes);
+    tablaAgentes = nueva;
+    bitsTablaAgentes = bits;
+}
+
+/*
+ * Crea un agente con un id libre y lo inserta en la tabla, que conserva su
+ * referencia. Los ids solo se reutilizan al dar la vuelta. Requiere
+ * mutexAgentes tomado; devuelve NULL si no hay memoria.
+ */
+AgenteInfo *crearAgente(const char *nombre, int fdRespuesta) {
+    AgenteInfo *agente = calloc(1, sizeof(AgenteInfo));
+    if (agente == NULL) {
+        return NULL;
+    }
+    
+    do {
+        agente->id = siguienteIdAgente;
+        siguienteIdAgente = siguienteIdAgente == MAX_ID_AGENTE ? 1 : siguienteIdAgente + 1;
+    } while (buscarAgente(agente->id) != NULL);
+    
+    strncpy(agente->nombre, nombre, MAX_NOMBRE - 1);
+    agente->fdRespuesta = fdRespuesta;
+    agente->activo = 1;
+    agente->referencias = 1;
+    pthread_mutex_init(&agente->mutexEscritura, NULL);
+    
+    if ((numAgentes + 1) * 4 > (1 << bitsTablaAgentes) * 3) {
+        crecerTablaAgentes();
+    }
+    size_t cubeta = cubetaAgente(agente->id, bitsTablaAgentes);
+    agente->siguiente = tablaAgentes[cubeta];
+    tablaAgentes[cubeta] = agente;
+    numAgentes++;
+    
+    return agente;
+}
+
+/*
+ * Saca al agente de la tabla (su id deja de resolverse), deja de vigilar su
+ * canal y cierra sus anillos, de modo que el hilo lector termine. Suelta la
+ * referencia de la tabla. Requiere mutexAgentes tomado.
+ */
+void retirarAgente(AgenteInfo *agente) {
+    if (!agente->activo) {
+        return;
+    }
+    
+    AgenteInfo **enlace = &tablaAgentes[cubetaAgente(agente->id, bitsTablaAgentes)];
+    while (*enlace != agente) {
+        enlace = &(*enlace)->siguiente;
+    }
+    *enlace = agente->siguiente;
+    numAgentes--;
+    
+    agente->activo = 0;
+    if (agente->fdRespuesta != -1) {
+        epoll_ctl(fdEpoll, EPOLL_CTL_DEL, agente->fdRespuesta, NULL);
+    }
+    cerrarAnillosAgente(agente);
+    soltarAgente(agente);
+}
+
+/* Suelta una referencia; con la última se cierran el canal y el segmento. Requiere mutexAgentes tomado. */
+void soltarAgente(AgenteInfo *agente) {
+    if (--agente->referencias > 0) {
+        return;
+    }
+    
+    cerrarConexionAgente(agente);
+    liberarSegmento(agente->segmento);
+    pthread_mutex_destroy(&agente->mutexEscritura);
+    free(agente);
+}
+
+/* ============================================================================
+ * REGISTRO DE AGENTES
+ * ============================================================================ */
+/*
+ * Registra un agente. Si llegó por un socket, fdOrigen es una copia de la
+ * conexión, que pasa a ser su canal de respuesta; si no, se abre su pipe.
+ */
+void registrarAgente(MensajeAgente *msg, int fdOrigen) {
+    RespuestaControlador resp;
+    uint32_t idAgente = 0;
+    TipoTransporte transporte = TRANSPORTE_PIPE;
+    CanalAgente canal = CANAL_PIPE;
+    
+    // Abrir una sola vez el pipe de respuesta (o usar la conexión del socket);
+    // queda abierto hasta MSG_FIN_AGENTE. Con memoria compartida el canal solo
+    // sirve para el registro y para detectar la caída del agente
+    int fdRespuesta = fdOrigen != -1 ? fdOrigen : abrirPipeAgente(msg->pipeRespuesta);
+    SegmentoMemoria *segmento = NULL;
+    if (msg->segmentoMemoria[0] != '\0' && fdRespuesta != -1) {
+        segmento = abrirSegmento(msg->segmentoMemoria);
+        if (segmento == NULL) {
+            fprintf(stderr, "No se pudo abrir la memoria compartida de '%s'; se usan los pipes\n",
+                    msg->nombreAgente);
+        }
+    }
+    
+    pthread_mutex_lock(&mutexAgentes);
+    
+    // Registrar agente en la tabla con un id nuevo
+    AgenteInfo *agente = fdRespuesta != -1 ? crearAgente(msg->nombreAgente, fdRespuesta) : NULL;
+    if (agente != NULL) {
+        if (segmento != NULL && aceptarMemoria) {
+            pthread_t tidMemoria;
+            agente->segmento = segmento;
+            agente->referencias++;  // La del hilo lector
+            if (pthread_create(&tidMemoria, NULL, hiloLectorMemoria, agente) == 0) {
+                pthread_detach(tidMemoria);
+                lectoresMemoria++;
+            } else {
+                perror("Error al crear hilo lector de memoria compartida");
+                agente->segmento = NULL;
+                agente->referencias--;
+            }
+        }
+        idAgente = agente->id;
+        vigilarConexionAgente(fdRespuesta, idAgente);
+        transporte = agente->segmento != NULL ? TRANSPORTE_MEMORIA : TRANSPORTE_PIPE;
+        agente->canal = transporte == TRANSPORTE_MEMORIA ? CANAL_MEMORIA :
+                        fdOrigen != -1 ? CANAL_SOCKET : CANAL_PIPE;
+        canal = agente->canal;
+        agente->referencias++;  // Para responder fuera del mutex
+    }
+    
+    pthread_mutex_unlock(&mutexAgentes);
+    
+    // Sin hilo lector el segmento no se usa
+    if (segmento != NULL && transporte != TRANSPORTE_MEMORIA) {
+        liberarSegmento(segmento);
+    }
+    
+    // Enviar hora actual y el id asignado (0 si no se pudo registrar)
+    memset(&resp, 0, sizeof(resp));
+    resp.tipo = RESP_HORA_ACTUAL;
+    resp.horaActual = minutoDeFranja(franjaActual);
+    resp.duracion = minutosDuracion;
+    resp.dato = (int32_t)idAgente;
+    resp.transporte = transporte;
+    
+    if (idAgente == 0) {
+        fprintf(stderr, "No se pudo registrar el agente '%s'\n", msg->nombreAgente);
+        
+        // Sin conexión persistente: responder abriendo el pipe solo esta vez
+        if (fdRespuesta == -1) {
+            fdRespuesta = open(msg->pipeRespuesta, O_WRONLY);
+        }
+        if (fdRespuesta != -1) {
+            escribirRespuesta(fdRespuesta, &resp);
+            close(fdRespuesta);
+        }
+        return;
+    }
+    
+    if (transporte == TRANSPORTE_MEMORIA) {
+        // El agente aún no sabe que se aceptó la memoria: esta respuesta va por el pipe
+        registrarEventoAgente(AGENTE_REGISTRADO, canal, msg->nombreAgente);
+        if (!escribirRespuesta(fdRespuesta, &resp)) {
+            perror("Error al escribir respuesta al agente");
+        }
+    } else {
+        registrarEventoAgente(AGENTE_REGISTRADO, canal, msg->nombreAgente);
+        enviarRespuesta(idAgente, &resp);
+    }
+    
+    pthread_mutex_lock(&mutexAgentes);
+    soltarAgente(agente);
+    pthread_mutex_unlock(&mutexAgentes);
+}
+
+/* ============================================================================
+ * FINALIZACIÓN DE AGENTES
+ * ============================================================================ */
+void finalizarAgente(MensajeAgente *msg) {
+    CanalAgente canal = CANAL_PIPE;
+    
+    pthread_mutex_lock(&mutexAgentes);
+    
+    // Liberar el lugar del agente que termina; la conexión persistente se
+    // cierra al terminar el último envío en curso y su hilo lector termina
+    AgenteInfo *agente = buscarAgente(msg->idAgente);
+    if (agente != NULL) {
+        canal = agente->canal;
+        retirarAgente(agente);
+    }
+    
+    pthread_mutex_unlock(&mutexAgentes);
+    
+    registrarEventoAgente(AGENTE_FINALIZADO, canal, msg->nombreAgente);
+}
+
+/* ============================================================================
+ * PROCESAMIENTO DE SOLICITUDES DE RESERVA
+ * ============================================================================ */
+void procesarSolicitudReserva(MensajeAgente *msg) {
+    ResultadoSolicitud res;
+    Calendario *cal;
+    int extemporanea;
+    int horaAsignada;
+    uint32_t idReserva;
+    
+    // Solo las solicitudes válidas pasan a la admisión atómica
+    if (validarSolicitud(msg, &res, &extemporanea, &cal)) {
+        // Las extemporáneas se reservan directamente en una hora alternativa
+        ResultadoAdmision admision = admitirReserva(cal, msg, !extemporanea, &horaAsignada, &idReserva);
+        completarAdmision(&res, admision, extemporanea, horaAsignada, idReserva);
+    }
+    
+    contabilizarResultado(&res);
+    responderSolicitud(msg, &res, extemporanea);
+}
+
+/* ============================================================================
+ * CANCELACIÓN Y MODIFICACIÓN DE RESERVAS
+ * ============================================================================ */
+/*
+ * Atiende MSG_CANCELAR y MSG_MODIFICAR. El id lleva el calendario y la
+ * posición de la reserva en su almacén (ver idDeReserva), de modo que se
+ * localiza en O(1) sin recorrer ninguna lista; el cupo que se libera se resta
+ * solo de sus franjas y del índice de capacidad sobre ellas, dentro de la
+ * misma sección crítica, y queda a la venta para la siguiente solicitud.
+ */
+void procesarCambioReserva(MensajeAgente *msg) {
+    ResultadoSolicitud res = { RESP_RESERVA_NEGADA, MOTIVO_RESERVA_INEXISTENTE, 0, 0 };
+    EventoCambio evento;
+    int extemporanea = 0;
+    int indice;
+    Calendario *cal = calendarioDeReserva(msg->idReserva, &indice);
+    
+    memset(&evento, 0, sizeof(evento));
+    evento.horaSolicitada = msg->horaSolicitada;
+    evento.numPersonas = msg->numPersonas;
+    
+    // La nueva hora y el nuevo grupo se validan como los de una solicitud, en
+    // el calendario de la reserva
+    if (cal != NULL && msg->tipo == MSG_MODIFICAR) {
+        msg->dia = cal->dia;
+        msg->parque = cal->parque;
+        if (!validarSolicitud(msg, &res, &extemporanea, &cal)) {
+            cal = NULL;
+        }
+    }
+    
+    if (cal != NULL) {
+        DECLARAR_INSTANTE(espera);
+        MARCAR_INSTANTE(espera);
+        pthread_mutex_lock(&cal->mutexReservas);
+        MEDIR_ETAPA(ETAPA_CERROJO, espera);
+        Reserva *reserva = reservaModificable(cal, indice, msg, &res);
+        if (reserva != NULL) {
+            copiarNombre(evento.familia, cadenaInternada(cal, reserva->idFamilia));
+            if (msg->tipo == MSG_CANCELAR) {
+                evento.horaSolicitada = minutoDeFranja(reserva->franjaInicio);
+                evento.numPersonas = reserva->numPersonas;
+                cancelarReserva(cal, indice);
+                anotarCancelacion(cal, indice);
+                res.tipo = RESP_RESERVA_CANCELADA;
+                res.motivo = MOTIVO_NINGUNO;
+                res.horaAsignada = evento.horaSolicitada;
+            } else {
+                modificarReserva(cal, indice, msg, extemporanea, &res);
+            }
+        }
+        pthread_mutex_unlock(&cal->mutexReservas);
+    }
+    
+    contabilizarCambio(msg->tipo, &res);
+    responderCambio(msg, &res, &evento);
+}
+
+/*
+ * La reserva indice de cal si el agente del mensaje puede cambiarla: existe,
+ * no está cancelada, la hizo ese agente y aún no ha comenzado. Si no, deja la
+ * negación en res y devuelve NULL. Requiere cal->mutexReservas tomado.
+ */
+Reserva *reservaModificable(Calendario *cal, int indice, MensajeAgente *msg, ResultadoSolicitud *res) {
+    Reserva *reserva = buscarReserva(cal, indice);
+    
+    res->tipo = RESP_RESERVA_NEGADA;
+    res->horaAsignada = 0;
+    res->idReserva = 0;
+    
+    if (reserva == NULL || strcmp(cadenaInternada(cal, reserva->idAgente), msg->nombreAgente) != 0) {
+        res->motivo = MOTIVO_RESERVA_INEXISTENTE;
+        return NULL;
+    }
+    if (reserva->activa || reserva->franjaInicio < cal->franjaMinima) {
+        res->motivo = MOTIVO_RESERVA_INICIADA;
+        return NULL;
+    }
+    return reserva;
+}
+
+/*
+ * Cambia la hora o el grupo de una reserva: devuelve su cupo, busca lugar
+ * para la nueva como para cualquier solicitud (la reserva original ya no
+ * estorba) y, si no lo hay, la restituye tal como estaba. La modificada es
+ * una reserva nueva, con su propio id; en el diario se anota primero la
+ * cancelación, para que al reaplicarlo el cupo ya esté libre. Requiere
+ * cal->mutexReservas tomado.
+ */
+void modificarReserva(Calendario *cal, int indice, MensajeAgente *msg, int extemporanea, ResultadoSolicitud *res) {
+    int franjaAsignada;
+    
+    copiarNombre(msg->nombreFamilia, cadenaInternada(cal, obtenerReserva(cal, indice)->idFamilia));
+    cancelarReserva(cal, indice);
+    
+    ResultadoAdmision admision = elegirFranja(cal, franjaDeMinuto(msg->horaSolicitada), !extemporanea, 0,
+                                              msg->numPersonas, &franjaAsignada);
+    if (admision == ADMISION_SIN_CUPO || cal->almacen.cantidad >= limiteReservasCalendario) {
+        restituirReserva(cal, indice);
+        res->tipo = RESP_RESERVA_NEGADA;
+        res->motivo = MOTIVO_CAMBIO_SIN_CUPO;
+        return;
+    }
+    
+    anotarCancelacion(cal, indice);
+    uint32_t idReserva = registrarReserva(cal, msg, franjaAsignada);
+    completarAdmision(res, admision, extemporanea, minutoDeFranja(franjaAsignada), idReserva);
+}
+
+/* Anota en el diario (si hay) la cancelación de una reserva. Requiere cal->mutexReservas tomado. */
+void anotarCancelacion(Calendario *cal, int indice) {
+    AnotacionReserva anotacion = {
+        .tipo = ANOTACION_CANCELACION, .indice = indice,
+        .dia = cal->dia, .parque = cal->parque,
+        .familia = "", .agente = ""
+    };
+    anotarReserva(&anotacion);
+}
+
+/* Suma el resultado de un cambio a los contadores del trabajador actual */
+void contabilizarCambio(TipoMensaje tipo, ResultadoSolicitud *res) {
+    atomic_long *contador = res->tipo == RESP_RESERVA_NEGADA ? &estadisticasHilo->cambiosNegados :
+                            tipo == MSG_CANCELAR ? &estadisticasHilo->canceladas : &estadisticasHilo->modificadas;
+    
+    atomic_fetch_add_explicit(contador, 1, memory_order_relaxed);
+}
+
+/* Arma la respuesta a un cambio, la registra en la salida y la envía */
+void responderCambio(MensajeAgente *msg, ResultadoSolicitud *res, EventoCambio *evento) {
+    RespuestaControlador resp;
+    
+    resp.tipo = res->tipo;
+    resp.motivo = res->motivo;
+    resp.horaAsignada = res->horaAsignada;
+    resp.horaActual = minutoDeFranja(franjaActual);
+    resp.duracion = minutosDuracion;
+    resp.dato = res->tipo == RESP_RESERVA_CANCELADA ? evento->numPersonas :
+                res->motivo == MOTIVO_EXCEDE_AFORO ? aforoMaximo : 0;
+    resp.secuencia = msg->secuencia;
+    resp.transporte = TRANSPORTE_PIPE;
+    resp.idReserva = res->idReserva;
+    
+    if (nivelSalida != NIVEL_RESUMEN) {
+        copiarNombre(evento->agente, msg->nombreAgente);
+        evento->tipo = msg->tipo;
+        evento->idReserva = msg->idReserva;
+        evento->resp = resp;
+        registrarEvento(EVENTO_CAMBIO, evento, sizeof(*evento));
+    }
+    
+    // Como en responderSolicitud: la cancelación o el cambio ya son durables
+    DECLARAR_INSTANTE(espera);
+    MARCAR_INSTANTE(espera);
+    esperarDiario();
+    MEDIR_ETAPA(ETAPA_DIARIO, espera);
+    enviarRespuesta(msg->idAgente, &resp);
+}
+
+/* ============================================================================
+ * CONSULTAS DE DISPONIBILIDAD
+ * ============================================================================ */
+/*
+ * Atiende MSG_CONSULTA_DISPONIBILIDAD: las personas que aún caben en una
+ * reserva que empiece en cada franja reservable del día y parque pedidos,
+ * desde la actual (hoy) o la inicial (otros días) hasta el fin del periodo.
+ * Se calcula sobre una instantánea de la ocupación (ver copiarOcupacion) sin
+ * tomar cal->mutexReservas, de modo que las consultas de todos los
+ * trabajadores avanzan en paralelo sin frenar a las admisiones. Una reserva
+ * que se admita justo después puede dejar la respuesta desactualizada: es
+ * orientativa, y quien reserve sigue pasando por la admisión atómica.
+ */
+void procesarConsultaDisponibilidad(MensajeAgente *msg) {
+    RespuestaDisponibilidad resp;
+    int ocupacion[MAX_FRANJAS_CONSULTA + MAX_FRANJAS_DIA];
+    uint8_t trama[MAX_TRAMA];
+    Calendario *cal = buscarCalendario(msg->dia, msg->parque);
+    int desde = msg->dia == 0 ? franjaActual : franjaInicial;
+    int hasta = franjaFinPeriodo < numFranjas ? franjaFinPeriodo : numFranjas;
+    
+    resp.motivo = MOTIVO_NINGUNO;
+    resp.horaActual = minutoDeFranja(franjaActual);
+    resp.duracion = minutosDuracion;
+    resp.minutosFranja = minutosPorFranja;
+    resp.secuencia = msg->secuencia;
+    resp.dia = msg->dia;
+    resp.parque = msg->parque;
+    resp.horaDesde = minutoDeFranja(desde);
+    resp.cantidad = hasta - desde < MAX_FRANJAS_CONSULTA ? hasta - desde : MAX_FRANJAS_CONSULTA;
+    
+    if (cal == NULL) {
+        resp.motivo = MOTIVO_CALENDARIO_INEXISTENTE;
+        resp.cantidad = 0;
+    } else if (resp.cantidad < 0) {
+        resp.cantidad = 0;
+    }
+    
+    if (resp.cantidad > 0) {
+        consultarPlazasLibres(cal, desde, resp.cantidad, ocupacion, resp.plazas);
+    }
+    
+    atomic_fetch_add_explicit(&estadisticasHilo->consultas, 1, memory_order_relaxed);
+    if (nivelSalida != NIVEL_RESUMEN) {
+        registrarConsulta(msg, &resp);
+    }
+    
+    enviarTrama(msg->idAgente, trama, codificarDisponibilidad(&resp, trama));
+}
+
+/* Registra en la salida el resumen de una consulta (no cada franja) */
+void registrarConsulta(MensajeAgente *msg, const RespuestaDisponibilidad *resp) {
+    EventoConsulta evento;
+    
+    copiarNombre(evento.agente, msg->nombreAgente);
+    evento.dia = resp->dia;
+    evento.parque = resp->parque;
+    evento.motivo = resp->motivo;
+    evento.horaDesde = resp->horaDesde;
+    evento.cantidad = resp->cantidad;
+    evento.plazasMaximas = 0;
+    evento.franjasLibres = 0;
+    for (int i = 0; i < resp->cantidad; i++) {
+        evento.plazasMaximas = resp->plazas[i] > evento.plazasMaximas ? resp->plazas[i] : evento.plazasMaximas;
+        evento.franjasLibres += resp->plazas[i] > 0;
+    }
+    registrarEvento(EVENTO_CONSULTA, &evento, sizeof(evento));
+}
+
+/* ============================================================================
+ * PROCESAMIENTO DE LOTES DE SOLICITUDES
+ * ============================================================================ */
+/*
+ * Atiende todas las solicitudes de un lote en una sola pasada de admisión:
+ * se validan fuera de la sección crítica y las que requieren cupo se admiten
+ * tomando el mutex de su calendario una vez por cada racha de solicitudes
+ * consecutivas del mismo calendario (a lo sumo uno tomado a la vez). Se
+ * responde con una sola trama.
+ *
+ * Con -O el lote se coloca completo en lugar de en orden de llegada: se
+ * agrupa por calendario (un solo bloqueo por calendario) y dentro de cada
+ * uno se admite de mayor a menor grupo (first-fit decreasing), y quien no
+ * cabe en su hora va a la hora libre más cercana a la pedida, no a la
+ * primera del periodo. Los grupos grandes ya no se niegan porque los
+ * pequeños, llegados antes, fragmentaron el cupo, y cada reprogramada se
+ * desplaza lo menos posible. El orden cuesta O(n²) con n <= MAX_LOTE y cada
+ * admisión lo mismo que sin -O (dos búsquedas O(log F) en el índice). Las
+ * respuestas conservan el orden del lote.
+ */
+void procesarLote(LoteSolicitudes *lote, char *nombreAgente) {
+    MensajeAgente msgs[MAX_LOTE];
+    Calendario *cals[MAX_LOTE];
+    Calendario *bloqueado = NULL;
+    int extemporaneas[MAX_LOTE];
+    int pendientes[MAX_LOTE];
+    int orden[MAX_LOTE];
+    RespuestaLote resp;
+    
+    memset(&resp, 0, sizeof(resp));
+    resp.cantidad = lote->cantidad;
+    
+    // Validación de cada solicitud (sin tomar ningún mutex de calendario)
+    for (int i = 0; i < lote->cantidad; i++) {
+        MensajeAgente *msg = &msgs[i];
+        msg->tipo = MSG_SOLICITUD_RESERVA;
+        msg->idAgente = lote->idAgente;
+        msg->horaSolicitada = lote->elementos[i].horaSolicitada;
+        msg->numPersonas = lote->elementos[i].numPersonas;
+        msg->dia = lote->elementos[i].dia;
+        msg->parque = lote->elementos[i].parque;
+        strncpy(msg->nombreAgente, nombreAgente, MAX_NOMBRE);
+        strncpy(msg->nombreFamilia, lote->elementos[i].nombreFamilia, MAX_NOMBRE);
+        pendientes[i] = validarSolicitud(msg, &resp.resultados[i], &extemporaneas[i], &cals[i]);
+    }
+    
+    for (int i = 0; i < lote->cantidad; i++) {
+        orden[i] = i;
+    }
+    if (colocacionLotes) {
+        ordenarLote(lote, cals, orden);
+    }
+    
+    // Admisión del lote: el mutex de un calendario se conserva mientras las
+    // solicitudes sigan siendo para él
+    for (int k = 0; k < lote->cantidad; k++) {
+        int i = orden[k];
+        if (pendientes[i]) {
+            int horaAsignada;
+            uint32_t idReserva;
+            if (cals[i] != bloqueado) {
+                if (bloqueado != NULL) {
+                    pthread_mutex_unlock(&bloqueado->mutexReservas);
+                }
+                DECLARAR_INSTANTE(espera);
+                MARCAR_INSTANTE(espera);
+                bloqueado = cals[i];
+                pthread_mutex_lock(&bloqueado->mutexReservas);
+                MEDIR_ETAPA(ETAPA_CERROJO, espera);
+            }
+            ResultadoAdmision admision = admitirReservaSinBloqueo(cals[i], &msgs[i], !extemporaneas[i],
+                                                                  colocacionLotes, &horaAsignada, &idReserva);
+            completarAdmision(&resp.resultados[i], admision, extemporaneas[i], horaAsignada, idReserva);
+        }
+    }
+    if (bloqueado != NULL) {
+        pthread_mutex_unlock(&bloqueado->mutexReservas);
+    }
+    resp.horaActual = minutoDeFranja(franjaActual);
+    
+    resp.aforoMaximo = aforoMaximo;
+    resp.duracion = minutosDuracion;
+    
+    for (int i = 0; i < lote->cantidad; i++) {
+        contabilizarResultado(&resp.resultados[i]);
+    }
+    
+    if (nivelSalida != NIVEL_RESUMEN) {
+        EventoLote cabecera;
+        copiarNombre(cabecera.agente, nombreAgente);
+        cabecera.cantidad = lote->cantidad;
+        registrarEvento(EVENTO_LOTE, &cabecera, sizeof(cabecera));
+        
+        for (int i = 0; i < lote->cantidad; i++) {
+            EventoElementoLote elemento;
+            copiarNombre(elemento.familia, msgs[i].nombreFamilia);
+            elemento.horaSolicitada = msgs[i].horaSolicitada;
+            elemento.numPersonas = msgs[i].numPersonas;
+            elemento.indice = i;
+            elemento.cantidad = lote->cantidad;
+            respuestaDeLote(&resp, i, &elemento.resp);
+            registrarEvento(EVENTO_ELEMENTO_LOTE, &elemento, sizeof(elemento));
+        }
+    }
+    
+    uint8_t trama[MAX_TRAMA];
+    size_t longitud = codificarRespuestaLote(&resp, trama);
+    DECLARAR_INSTANTE(espera);
+    MARCAR_INSTANTE(espera);
+    esperarDiario();  // Una sola espera por todas las reservas del lote
+    MEDIR_ETAPA(ETAPA_DIARIO, espera);
+    enviarTrama(lote->idAgente, trama, longitud);
+}
+
+/*
+ * Orden de admisión para -O: por calendario y, dentro de cada uno, de mayor
+ * a menor número de personas; a igual tamaño, en orden de llegada. Inserción
+ * directa, suficiente para MAX_LOTE solicitudes. Las que no tienen
+ * calendario (rechazadas en la validación) van al principio y no se admiten.
+ */
+void ordenarLote(LoteSolicitudes *lote, Calendario **cals, int *orden) {
+    long claves[MAX_LOTE];
+    
+    for (int i = 0; i < lote->cantidad; i++) {
+        claves[i] = cals[i] == NULL ? -1 : (long)(cals[i] - calendarios);
+    }
+    
+    for (int k = 1; k < lote->cantidad; k++) {
+        int i = orden[k];
+        int j = k - 1;
+        for (; j >= 0; j--) {
+            int otro = orden[j];
+            if (claves[otro] < claves[i] ||
+                (claves[otro] == claves[i] && lote->elementos[otro].numPersonas >= lote->elementos[i].numPersonas)) {
+                break;
+            }
+            orden[j + 1] = otro;
+        }
+        orden[j + 1] = i;
+    }
+}
+
+/* ============================================================================
+ * VALIDACIÓN Y RESULTADO DE SOLICITUDES
+ * ============================================================================ */
+/*
+ * Aplica las validaciones que no dependen del cupo. Devuelve 1 si la
+ * solicitud debe pasar a la admisión (indicando si es extemporánea y en qué
+ * calendario); en caso contrario deja en res la negación correspondiente y
+ * devuelve 0.
+ */
+int validarSolicitud(MensajeAgente *msg, ResultadoSolicitud *res, int *extemporanea, Calendario **cal) {
+    res->tipo = RESP_RESERVA_NEGADA;
+    res->horaAsignada = 0;
+    res->idReserva = 0;
+    *extemporanea = 0;
+    
+    // El día y el parque eligen el calendario
+    *cal = buscarCalendario(msg->dia, msg->parque);
+    if (*cal == NULL) {
+        res->motivo = MOTIVO_CALENDARIO_INEXISTENTE;
+        return 0;
+    }
+    
+    // Validar que la hora esté en rango y empiece una franja
+    if (!minutoValido(msg->horaSolicitada)) {
+        res->motivo = MOTIVO_FUERA_DE_RANGO;
+        return 0;
+    }
+    
+    // Un grupo vacío o negativo restaría cupo en lugar de ocuparlo
+    if (msg->numPersonas < 1) {
+        res->motivo = MOTIVO_PERSONAS_INVALIDAS;
+        return 0;
+    }
+    
+    // Validar que el número de personas no exceda el aforo
+    if (msg->numPersonas > aforoMaximo) {
+        res->motivo = MOTIVO_EXCEDE_AFORO;
+        return 0;
+    }
+    
+    // Validar hora solicitada vs hora actual (en días futuros nada ha pasado aún)
+    if (msg->horaSolicitada < minutoDeFranja((*cal)->franjaMinima)) {
+        *extemporanea = 1;
+        return 1;
+    }
+    
+    // Verificar si la hora solicitada está fuera del periodo de simulación
+    if (msg->horaSolicitada >= (horaFinal + 1) * MINUTOS_POR_HORA) {
+        res->motivo = MOTIVO_FUERA_DE_PERIODO;
+        return 0;
+    }
+    
+    return 1;
+}
+
+/* Traduce el resultado de la admisión a tipo y motivo de respuesta */
+void completarAdmision(ResultadoSolicitud *res, ResultadoAdmision admision, int extemporanea, int hora,
+                       uint32_t idReserva) {
+    MotivoRespuesta motivo = extemporanea ? MOTIVO_EXTEMPORANEA : MOTIVO_SIN_DISPONIBILIDAD;
+    
+    res->idReserva = admision == ADMISION_SIN_CUPO ? 0 : idReserva;
+    switch (admision) {
+        case ADMISION_EN_HORA:
+            res->tipo = RESP_RESERVA_OK;
+            res->motivo = MOTIVO_NINGUNO;
+            res->horaAsignada = hora;
+            break;
+        case ADMISION_ALTERNATIVA:
+            res->tipo = RESP_RESERVA_REPROG;
+            res->motivo = motivo;
+            res->horaAsignada = hora;
+            break;
+        case ADMISION_SIN_CUPO:
+        default:
+            res->tipo = RESP_RESERVA_NEGADA;
+            res->motivo = motivo;
+            res->horaAsignada = 0;
+            break;
+    }
+}
+
+/* Suma el resultado a los contadores del trabajador actual, sin tomar ningún mutex */
+void contabilizarResultado(ResultadoSolicitud *res) {
+    switch (res->tipo) {
+        case RESP_RESERVA_OK:
+            atomic_fetch_add_explicit(&estadisticasHilo->aceptadas, 1, memory_order_relaxed);
+            break;
+        case RESP_RESERVA_REPROG:
+            atomic_fetch_add_explicit(&estadisticasHilo->reprogramadas, 1, memory_order_relaxed);
+            break;
+        default:
+            atomic_fetch_add_explicit(&estadisticasHilo->negadas, 1, memory_order_relaxed);
+            break;
+    }
+}
+
+/* Arma la respuesta a una solicitud, la registra en la salida y la envía */
+void responderSolicitud(MensajeAgente *msg, ResultadoSolicitud *res, int extemporanea) {
+    RespuestaControlador resp;
+    
+    resp.tipo = res->tipo;
+    resp.motivo = res->motivo;
+    resp.horaAsignada = res->horaAsignada;
+    resp.horaActual = minutoDeFranja(franjaActual);
+    resp.duracion = minutosDuracion;
+    resp.dato = (res->motivo == MOTIVO_EXCEDE_AFORO) ? aforoMaximo : 0;
+    resp.secuencia = msg->secuencia;  // Permite al agente emparejar respuestas fuera de orden
+    resp.transporte = TRANSPORTE_PIPE;
+    resp.idReserva = res->idReserva;
+    
+    if (nivelSalida != NIVEL_RESUMEN) {
+        EventoSolicitud evento;
+        copiarNombre(evento.agente, msg->nombreAgente);
+        copiarNombre(evento.familia, msg->nombreFamilia);
+        evento.horaSolicitada = msg->horaSolicitada;
+        evento.numPersonas = msg->numPersonas;
+        evento.dia = (uint8_t)msg->dia;
+        evento.parque = (uint8_t)msg->parque;
+        evento.extemporanea = (uint8_t)extemporanea;
+        evento.resp = resp;
+        registrarEvento(EVENTO_SOLICITUD, &evento, sizeof(evento));
+    }
+    
+    // Con -j solo se confirma una reserva que ya es durable
+    DECLARAR_INSTANTE(espera);
+    MARCAR_INSTANTE(espera);
+    esperarDiario();
+    MEDIR_ETAPA(ETAPA_DIARIO, espera);
+    enviarRespuesta(msg->idAgente, &resp);
+}
+
+/* ============================================================================
+ * ENVÍO DE RESPUESTAS A AGENTES
+ * ============================================================================ */
+void enviarRespuesta(uint32_t idAgente, RespuestaControlador *resp) {
+    uint8_t trama[MAX_TRAMA];
+    size_t longitud = codificarRespuesta(resp, trama);
+    
+    enviarTrama(idAgente, trama, longitud);
+}
+
+/* Escribe una trama ya codificada en la conexión persistente del agente */
+void enviarTrama(uint32_t idAgente, const uint8_t *trama, size_t longitud) {
+    enviarTramaConPlazo(idAgente, trama, longitud, -1);
+}
+
+/*
+ * Como enviarTrama, pero espera al agente a lo sumo plazoMs en cada paso (el
+ * mutex de escritura y el espacio en su canal; -1 = sin límite). Un agente
+ * que no lee a tiempo se da por desconectado, como uno que cerró su extremo.
+ */
+void enviarTramaConPlazo(uint32_t idAgente, const uint8_t *trama, size_t longitud, int plazoMs) {
+    DECLARAR_INSTANTE(inicio);
+    MARCAR_INSTANTE(inicio);
+    
+    // La conexión persistente se localiza por el id en la tabla; la
+    // referencia la mantiene abierta aunque el agente se retire mientras tanto
+    pthread_mutex_lock(&mutexAgentes);
+    AgenteInfo *agente = buscarAgente(idAgente);
+    if (agente != NULL) {
+        agente->referencias++;
+    }
+    pthread_mutex_unlock(&mutexAgentes);
+    
+    if (agente == NULL) {
+        // Los avisos del respondedor pueden llegar tarde para un agente que ya se fue
+        if (plazoMs < 0) {
+            fprintf(stderr, "Error: el agente %u no tiene pipe de respuesta abierto\n", idAgente);
+        }
+        return;
+    }
+    
+    int vencido = 0;
+    if (agente->segmento != NULL) {
+        int escrita = plazoMs < 0 ? escribirEnAnillo(&agente->segmento->respuestas, trama, longitud) :
+                      escribirEnAnilloConPlazo(&agente->segmento->respuestas, trama, longitud, plazoMs);
+        if (escrita == 0) {
+            fprintf(stderr, "Error: el agente %u cerró su anillo de respuestas\n", idAgente);
+        }
+        vencido = escrita == -1;
+    } else {
+        // En un pipe la trama (menor que PIPE_BUF) se escribe de una vez; en un
+        // socket puede ir en partes, y el mutex evita que se intercalen
+        int escrita = 0;
+        int error = ETIMEDOUT;
+        if (plazoMs < 0) {
+            pthread_mutex_lock(&agente->mutexEscritura);
+            escrita = escribirCompleto(agente->fdRespuesta, trama, longitud);
+            error = errno;
+            pthread_mutex_unlock(&agente->mutexEscritura);
+        } else {
+            struct timespec limite;
+            clock_gettime(CLOCK_REALTIME, &limite);
+            limite.tv_sec += plazoMs / 1000;
+            limite.tv_nsec += (long)(plazoMs % 1000) * 1000000L;
+            if (limite.tv_nsec >= 1000000000L) {
+                limite.tv_sec++;
+                limite.tv_nsec -= 1000000000L;
+            }
+            if (pthread_mutex_timedlock(&agente->mutexEscritura, &limite) == 0) {
+                escrita = escribirConPlazo(agente->fdRespuesta, trama, longitud, plazoMs);
+                error = errno;
+                pthread_mutex_unlock(&agente->mutexEscritura);
+            }
+        }
+        vencido = !escrita && error == ETIMEDOUT;
+        
+        if (!escrita && !vencido) {
+            errno = error;
+            perror("Error al escribir respuesta al agente");
+        }
+        
+        // El agente cerró su extremo: descartar la conexión persistente
+        if (!escrita && (error == EPIPE || error == ECONNRESET)) {
+            pthread_mutex_lock(&mutexAgentes);
+            retirarAgente(agente);
+            pthread_mutex_unlock(&mutexAgentes);
+            despertarReloj();
+        }
+    }
+    
+    pthread_mutex_lock(&mutexAgentes);
+    soltarAgente(agente);
+    pthread_mutex_unlock(&mutexAgentes);
+    
+    if (vencido) {
+        fprintf(stderr, "El agente %u no lee sus respuestas: se descarta\n", idAgente);
+        descartarConexionAgente(idAgente);
+    }
+    MEDIR_ETAPA(ETAPA_RESPUESTA, inicio);
+}
+
+/*
+ * Escribe todos los bytes aunque el descriptor sea no bloqueante (las
+ * conexiones de socket lo son porque el receptor las lee con epoll).
+ */
+int escribirCompleto(int fd, const uint8_t *datos, size_t longitud) {
+    while (longitud > 0) {
+        ssize_t escritos = write(fd, datos, longitud);
+        
+        if (escritos > 0) {
+            datos += escritos;
+            longitud -= (size_t)escritos;
+        } else if (escritos == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd espera = { .fd = fd, .events = POLLOUT };
+            poll(&espera, 1, -1);
+        } else if (escritos == -1 && errno != EINTR) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Como escribirCompleto, pero se rinde si el descriptor no admite datos en
+ * plazoMs (errno = ETIMEDOUT). Espera con poll antes de cada write, así que
+ * tampoco se queda en un pipe bloqueante: una trama menor que PIPE_BUF
+ * entra entera en cuanto hay lugar.
+ */
+int escribirConPlazo(int fd, const uint8_t *datos, size_t longitud, int plazoMs) {
+    struct timespec inicio, ahora;
+    
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    while (longitud > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &ahora);
+        long transcurridos = (ahora.tv_sec - inicio.tv_sec) * 1000L + (ahora.tv_nsec - inicio.tv_nsec) / 1000000L;
+        struct pollfd espera = { .fd = fd, .events = POLLOUT };
+        int listos = poll(&espera, 1, transcurridos >= plazoMs ? 0 : (int)(plazoMs - transcurridos));
+        if (listos == 0) {
+            errno = ETIMEDOUT;
+            return 0;
+        }
+        if (listos == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        
+        ssize_t escritos = write(fd, datos, longitud);
+        if (escritos > 0) {
+            datos += escritos;
+            longitud -= (size_t)escritos;
+        } else if (escritos == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Codifica y escribe una respuesta en un descriptor sin conexión registrada */
+int escribirRespuesta(int fd, RespuestaControlador *resp) {
+    uint8_t trama[MAX_TRAMA];
+    size_t longitud = codificarRespuesta(resp, trama);
+    
+    return escribirCompleto(fd, trama, longitud);
+}
+
+/*
+ * Abre el pipe de respuesta de un agente para mantenerlo durante la sesión.
+ * El agente abre su extremo de lectura antes de registrarse, por lo que la
+ * apertura no bloqueante tiene éxito de inmediato; si no hay lector se
+ * devuelve -1 y el registro se rechaza.
+ */
+int abrirPipeAgente(char *pipeAgente) {
+    int fd = open(pipeAgente, O_WRONLY | O_NONBLOCK);
+    if (fd == -1) {
+        return -1;
+    }
+    
+    // Escrituras bloqueantes: si el pipe se llena se espera al agente
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+    return fd;
+}
+
+/* ============================================================================
+ * ADMISIÓN ATÓMICA DE RESERVAS
+ * ============================================================================ */
+/*
+ * Verifica el cupo y registra la reserva dentro de una sola sección crítica
+ * sobre el mutex del calendario, de modo que dos trabajadores no puedan tomar
+ * el mismo cupo. Si intentarHoraSolicitada es 0 (solicitud extemporánea) o la hora
+ * solicitada ya pasó, solo se busca una hora alternativa.
+ */
+ResultadoAdmision admitirReserva(Calendario *cal, MensajeAgente *msg, int intentarHoraSolicitada, int *horaAsignada,
+                                 uint32_t *idReserva) {
+    DECLARAR_INSTANTE(espera);
+    MARCAR_INSTANTE(espera);
+    pthread_mutex_lock(&cal->mutexReservas);
+    MEDIR_ETAPA(ETAPA_CERROJO, espera);
+    ResultadoAdmision resultado = admitirReservaSinBloqueo(cal, msg, intentarHoraSolicitada, 0, horaAsignada,
+                                                           idReserva);
+    pthread_mutex_unlock(&cal->mutexReservas);
+    return resultado;
+}
+
+/*
+ * Cuerpo de admitirReserva; requiere cal->mutexReservas tomado (ver procesarLote).
+ * La hora solicitada y la asignada van en minutos desde la medianoche; el id
+ * de la reserva solo se escribe si se admitió.
+ */
+ResultadoAdmision admitirReservaSinBloqueo(Calendario *cal, MensajeAgente *msg, int intentarHoraSolicitada,
+                                          int alternativaCercana, int *horaAsignada, uint32_t *idReserva) {
+    int franjaAsignada;
+    DECLARAR_INSTANTE(inicio);
+    
+    MARCAR_INSTANTE(inicio);
+    ResultadoAdmision resultado = elegirFranja(cal, franjaDeMinuto(msg->horaSolicitada), intentarHoraSolicitada,
+                                               alternativaCercana, msg->numPersonas, &franjaAsignada);
+    MEDIR_ETAPA(ETAPA_ADMISION, inicio);
+    
+    if (resultado != ADMISION_SIN_CUPO) {
+        MARCAR_INSTANTE(inicio);
+        *idReserva = registrarReserva(cal, msg, franjaAsignada);
+        if (*idReserva != 0) {
+            *horaAsignada = minutoDeFranja(franjaAsignada);
+        } else {
+            resultado = ADMISION_SIN_CUPO;
+        }
+        MEDIR_ETAPA(ETAPA_CONFIRMACION, inicio);
+    }
+    
+    return resultado;
+}
+
+/*
+ * Ocupa el cupo de la reserva, la registra y la anota en el diario (si hay).
+ * Devuelve su id, o 0 sin registrar nada si alguna franja se quedó sin cupo
+ * o el calendario ya no tiene ids libres. Requiere cal->mutexReservas tomado.
+ */
+uint32_t registrarReserva(Calendario *cal, MensajeAgente *msg, int franjaInicio) {
+    int indice = cal->almacen.cantidad;
+    
+    // Nunca se anota una reserva que restaurarReserva no pudiera reaplicar
+    if (indice >= limiteReservasCalendario || !reservaRecuperable(franjaInicio, msg->numPersonas) ||
+        !ocuparVentana(cal, franjaInicio, msg->numPersonas)) {
+        return 0;
+    }
+    
+    insertarReserva(cal, msg->nombreFamilia, msg->nombreAgente, franjaInicio, msg->numPersonas);
+    
+    AnotacionReserva anotacion = {
+        .dia = cal->dia, .parque = cal->parque,
+        .franjaInicio = franjaInicio, .numPersonas = msg->numPersonas,
+        .familia = msg->nombreFamilia, .agente = msg->nombreAgente
+    };
+    anotarReserva(&anotacion);
+    
+    return idDeReserva(cal, indice);
+}
+
+/* ============================================================================
+ * PERSISTENCIA (DIARIO E INSTANTÁNEAS)
+ * ============================================================================ */
+/*
+ * Vuelve a crear una reserva recuperada del diario o de la instantánea (al
+ * arrancar), o reaplica una cancelación. Las canceladas de la instantánea se
+ * insertan sin ocupar cupo para que las demás conserven su posición (y su id);
+ * lo mismo una reserva que no se puede reaplicar (inválida o sin cupo), que
+ * queda cancelada para que las cancelaciones posteriores, que la nombran por
+ * su posición, no caigan sobre otra.
+ */
+void restaurarReserva(const AnotacionReserva *anotacion) {
+    Calendario *cal = buscarCalendario(anotacion->dia, anotacion->parque);
+    
+    if (anotacion->tipo == ANOTACION_CANCELACION) {
+        if (cal == NULL) {
+            return;
+        }
+        pthread_mutex_lock(&cal->mutexReservas);
+        if (buscarReserva(cal, anotacion->indice) != NULL) {
+            cancelarReserva(cal, anotacion->indice);
+        } else {
+            fprintf(stderr, "Diario: cancelación de la reserva %d inexistente, descartada\n", anotacion->indice);
+        }
+        pthread_mutex_unlock(&cal->mutexReservas);
+        return;
+    }
+    
+    if (cal == NULL) {
+        fprintf(stderr, "Diario: reserva de '%s' fuera de esta configuración, descartada\n", anotacion->familia);
+        return;
+    }
+    
+    pthread_mutex_lock(&cal->mutexReservas);
+    int recuperable = reservaRecuperable(anotacion->franjaInicio, anotacion->numPersonas);
+    if (anotacion->tipo == ANOTACION_RESERVA_CANCELADA || !recuperable ||
+        !ocuparVentana(cal, anotacion->franjaInicio, anotacion->numPersonas)) {
+        if (anotacion->tipo != ANOTACION_RESERVA_CANCELADA) {
+            fprintf(stderr, "Diario: reserva de '%s' %s, se conserva cancelada\n", anotacion->familia,
+                    recuperable ? "sin cupo al recuperarla" : "inválida");
+        }
+        insertarReserva(cal, anotacion->familia, anotacion->agente, anotacion->franjaInicio, anotacion->numPersonas);
+        obtenerReserva(cal, cal->almacen.cantidad - 1)->cancelada = 1;
+    } else {
+        insertarReserva(cal, anotacion->familia, anotacion->agente, anotacion->franjaInicio, anotacion->numPersonas);
+    }
+    pthread_mutex_unlock(&cal->mutexReservas);
+}
+
+/* Si una reserva con estos datos se puede registrar (y reaplicar desde el diario) */
+int reservaRecuperable(int franjaInicio, int numPersonas) {
+    return validarFranja(franjaInicio) && numPersonas >= 1 && numPersonas <= aforoMaximo;
+}
+
+/*
+ * Llena una instantánea con todas las reservas. Toma los mutex de todos los
+ * calendarios (siempre en el mismo orden) para que ninguna admisión quede a
+ * medias entre la instantánea y el diario; cada nombre internado se guarda
+ * una sola vez por calendario.
+ */
+void capturarEstado(Instantanea *instantanea) {
+    for (int c = 0; c < numCalendarios; c++) {
+        pthread_mutex_lock(&calendarios[c].mutexReservas);
+    }
+    
+    cortarDiario(instantanea);
+    
+    for (int c = 0; c < numCalendarios; c++) {
+        Calendario *cal = &calendarios[c];
+        uint32_t *desplazamientos = malloc(sizeof(uint32_t) * (cal->cadenas.numCadenas + 1));
+        if (desplazamientos == NULL) {
+            perror("Error al reservar memoria para la instantánea");
+            exit(EXIT_FAILURE);
+        }
+        for (uint32_t id = 0; id < cal->cadenas.numCadenas; id++) {
+            desplazamientos[id] = agregarCadenaInstantanea(instantanea, cadenaInternada(cal, id));
+        }
+        
+        for (int i = 0; i < cal->almacen.cantidad; i++) {
+            Reserva *reserva = obtenerReserva(cal, i);
+            agregarReservaInstantanea(instantanea, cal->dia, cal->parque, reserva->franjaInicio,
+                                      reserva->numPersonas, reserva->cancelada, desplazamientos[reserva->idFamilia],
+                                      desplazamientos[reserva->idAgente]);
+        }
+        free(desplazamientos);
+    }
+    
+    for (int c = numCalendarios - 1; c >= 0; c--) {
+        pthread_mutex_unlock(&calendarios[c].mutexReservas);
+    }
+}
+
+/* ============================================================================
+ * CALENDARIOS
+ * ============================================================================ */
+/* Calendario de un día y un parque; NULL si el controlador no lo atiende. */
+Calendario *buscarCalendario(int dia, int parque) {
+    if (dia < 0 || dia >= numDias || parque < 0 || parque >= numParques) {
+        return NULL;
+    }
+    return &calendarios[dia * numParques + parque];
+}
+
+/*
+ * Id de la reserva indice de cal: su posición en el almacén más uno (0 es
+ * "ninguna") seguida de bitsCalendario bits con el calendario. Las reservas
+ * nunca cambian de posición, así que el id se resuelve sin buscar.
+ */
+uint32_t idDeReserva(Calendario *cal, int indice) {
+    return ((uint32_t)(indice + 1) << bitsCalendario) | (uint32_t)(cal - calendarios);
+}
+
+/* Calendario y posición de un id de reserva; NULL si no puede ser de ninguno */
+Calendario *calendarioDeReserva(uint32_t id, int *indice) {
+    uint32_t calendario = id & ((1u << bitsCalendario) - 1);
+    uint32_t posicion = id >> bitsCalendario;
+    
+    if (posicion == 0 || posicion > (uint32_t)INT_MAX || calendario >= (uint32_t)numCalendarios) {
+        return NULL;
+    }
+    *indice = (int)(posicion - 1);
+    return &calendarios[calendario];
+}
+
+/* ============================================================================
+ * AVANCE DE HORA
+ * ============================================================================ */
+/*
+ * Avanza el reloj una franja. Solo los calendarios de hoy ven pasar el
+ * tiempo; se actualizan uno a uno, cada uno bajo su propio mutex.
+ */
+void avanzarHora() {
+    franjaActual++;
+    
+    for (int p = 0; p < numParques; p++) {
+        avanzarCalendario(buscarCalendario(0, p), franjaActual);
+    }
+}
+
+/* ============================================================================
+ * IMPRESIÓN DEL ESTADO DE LA HORA
+ * ============================================================================ */
+void imprimirEstadoHora() {
+    EventoFranja hora = { .minuto = minutoDeFranja(franjaActual) };
+    
+    registrarEvento(EVENTO_HORA, &hora, sizeof(hora));
+    
+    // Solo los calendarios de hoy tienen entradas y salidas
+    for (int p = 0; p < numParques; p++) {
+        imprimirMovimientos(buscarCalendario(0, p));
+    }
+    
+    registrarEvento(EVENTO_FIN_HORA, NULL, 0);
+}
+
+/*
+ * Familias que salen y entran en la franja actual y ocupación de un
+ * calendario. Bajo el mutex solo se copian los movimientos; se registran
+ * después de soltarlo, para que la salida nunca retenga las admisiones.
+ */
+void imprimirMovimientos(Calendario *cal) {
+    int numMovimientos = 0;
+    int numSalidas;
+    
+    pthread_mutex_lock(&cal->mutexReservas);
+    
+    // Familias que salen
+    if (franjaActual - 1 >= franjaInicial && validarFranja(franjaActual - 1)) {
+        for (int i = cal->reservasQueTerminan[franjaActual - 1].primera; i != -1; ) {
+            Reserva *r = obtenerReserva(cal, i);
+            if (r->cancelada) {
+                i = r->siguienteQueTermina;
+                continue;
+            }
+            EventoMovimiento *m = agregarMovimiento(&numMovimientos);
+            if (m == NULL) {
+                break;
+            }
+            m->sentido = MOVIMIENTO_SALIDA;
+            m->numPersonas = r->numPersonas;
+            copiarNombre(m->familia, cadenaInternada(cal, r->idFamilia));
+            copiarNombre(m->agente, cadenaInternada(cal, r->idAgente));
+            i = r->siguienteQueTermina;
+        }
+    }
+    numSalidas = numMovimientos;
+    
+    // Familias que entran
+    if (validarFranja(franjaActual)) {
+        for (int i = cal->reservasQueInician[franjaActual].primera; i != -1; ) {
+            Reserva *r = obtenerReserva(cal, i);
+            if (r->cancelada) {
+                i = r->siguienteQueInicia;
+                continue;
+            }
+            EventoMovimiento *m = agregarMovimiento(&numMovimientos);
+            if (m == NULL) {
+                break;
+            }
+            m->sentido = MOVIMIENTO_ENTRADA;
+            m->numPersonas = r->numPersonas;
+            m->inicio = minutoDeFranja(r->franjaInicio);
+            m->fin = minutoDeFranja(r->franjaFin + 1);
+            copiarNombre(m->familia, cadenaInternada(cal, r->idFamilia));
+            copiarNombre(m->agente, cadenaInternada(cal, r->idAgente));
+            i = r->siguienteQueInicia;
+        }
+    }
+    
+    pthread_mutex_unlock(&cal->mutexReservas);
+    
+    // Registrar cada lista con su encabezado y su total
+    for (int sentido = MOVIMIENTO_SALIDA; sentido <= MOVIMIENTO_ENTRADA; sentido++) {
+        int desde = sentido == MOVIMIENTO_SALIDA ? 0 : numSalidas;
+        int hasta = sentido == MOVIMIENTO_SALIDA ? numSalidas : numMovimientos;
+        EventoFranja lista = { .parque = cal->parque, .sentido = sentido, .cantidad = hasta - desde };
+        
+        registrarEvento(EVENTO_LISTA_MOVIMIENTOS, &lista, sizeof(lista));
+        for (int i = desde; i < hasta; i++) {
+            movimientosFranja[i].parque = cal->parque;
+            lista.total += movimientosFranja[i].numPersonas;
+            registrarEvento(EVENTO_MOVIMIENTO, &movimientosFranja[i], sizeof(EventoMovimiento));
+        }
+        registrarEvento(EVENTO_TOTAL_MOVIMIENTOS, &lista, sizeof(lista));
+    }
+    
+    // Ocupación actual (contador atómico: no necesita el mutex)
+    EventoFranja ocupacion = { .parque = cal->parque };
+    if (validarFranja(franjaActual)) {
+        ocupacion.ocupacion = leerOcupacion(cal, franjaActual);
+    }
+    registrarEvento(EVENTO_OCUPACION, &ocupacion, sizeof(ocupacion));
+}
+
+/* Siguiente posición libre del búfer de movimientos del reloj (NULL si no hay memoria) */
+EventoMovimiento *agregarMovimiento(int *numMovimientos) {
+    if (*numMovimientos == capacidadMovimientos) {
+        int nuevaCapacidad = capacidadMovimientos ? capacidadMovimientos * 2 : 64;
+        EventoMovimiento *nuevo = realloc(movimientosFranja, sizeof(EventoMovimiento) * nuevaCapacidad);
+        if (nuevo == NULL) {
+            perror("Error al reservar memoria para los movimientos de la franja");
+            return NULL;
+        }
+        movimientosFranja = nuevo;
+        capacidadMovimientos = nuevaCapacidad;
+    }
+    return &movimientosFranja[(*numMovimientos)++];
+}
+
+/* ============================================================================
+ * SALIDA POR CONSOLA (EVENTOS DEL REGISTRO)
+ * ============================================================================ */
+/* Copia un nombre terminándolo en '\0' aunque el origen ocupe todo su arreglo */
+void copiarNombre(char *destino, const char *origen) {
+    strncpy(destino, origen, MAX_NOMBRE - 1);
+    destino[MAX_NOMBRE - 1] = '\0';
+}
+
+/* Registra una línea de texto (arranque y cierre); en modo silencioso no sale */
+void registrarTexto(const char *formato, ...) {
+    EventoTexto evento;
+    va_list args;
+    
+    if (nivelSalida == NIVEL_SILENCIOSO) {
+        return;
+    }
+    va_start(args, formato);
+    vsnprintf(evento.texto, sizeof(evento.texto), formato, args);
+    va_end(args);
+    registrarEvento(EVENTO_TEXTO, &evento, strlen(evento.texto) + 1);
+}
+
+void registrarEventoAgente(AccionAgente accion, CanalAgente canal, const char *nombre) {
+    EventoAgente evento;
+    
+    evento.accion = accion;
+    evento.canal = canal;
+    copiarNombre(evento.nombre, nombre);
+    registrarEvento(EVENTO_AGENTE, &evento, sizeof(evento));
+}
+
+/* Agrega texto con formato en destino + *usados sin pasarse de tam */
+static void agregar(char *destino, size_t tam, size_t *usados, const char *formato, ...) {
+    va_list args;
+    
+    if (*usados + 1 >= tam) {
+        return;
+    }
+    va_start(args, formato);
+    int n = vsnprintf(destino + *usados, tam - *usados, formato, args);
+    va_end(args);
+    if (n > 0) {
+        *usados += (size_t)n < tam - *usados ? (size_t)n : tam - *usados - 1;
+    }
+}
+
+/* Agrega " clave="valor"" con las comillas y barras del valor escapadas */
+static void agregarCampo(char *destino, size_t tam, size_t *usados, const char *clave, const char *valor) {
+    agregar(destino, tam, usados, " %s=\"", clave);
+    for (const char *c = valor; *c != '\0' && *usados + 3 < tam; c++) {
+        if (*c == '"' || *c == '\\') {
+            destino[(*usados)++] = '\\';
+        }
+        destino[(*usados)++] = *c;
+    }
+    agregar(destino, tam, usados, "\"");
+}
+
+static const char *nombreResultado(TipoRespuesta tipo) {
+    switch (tipo) {
+        case RESP_RESERVA_OK:     return "aprobada";
+        case RESP_RESERVA_REPROG: return "reprogramada";
+        case RESP_RESERVA_CANCELADA: return "cancelada";
+        default:                  return "negada";
+    }
+}
+
+static const char *nombreMotivo(MotivoRespuesta motivo) {
+    static const char *nombres[] = {
+        "ninguno", "fuera_de_rango", "excede_aforo", "extemporanea",
+        "fuera_de_periodo", "sin_disponibilidad", "calendario_inexistente",
+        "reserva_inexistente", "reserva_iniciada", "cambio_sin_cupo", "personas_invalidas"
+    };
+    return (unsigned)motivo < sizeof(nombres) / sizeof(nombres[0]) ? nombres[motivo] : "desconocido";
+}
+
+/* Campos de una respuesta en un registro estructurado */
+static void agregarResultado(char *destino, size_t tam, size_t *usados, const RespuestaControlador *resp) {
+    char textoHora[MAX_TEXTO_HORA];
+    
+    agregar(destino, tam, usados, " resultado=%s", nombreResultado(resp->tipo));
+    if (resp->tipo == RESP_RESERVA_OK || resp->tipo == RESP_RESERVA_REPROG) {
+        formatearHora(resp->horaAsignada, textoHora, sizeof(textoHora));
+        agregar(destino, tam, usados, " asignada=%s", textoHora);
+    }
+    if (resp->motivo != MOTIVO_NINGUNO) {
+        agregar(destino, tam, usados, " motivo=%s", nombreMotivo(resp->motivo));
+    }
+    if (resp->idReserva != 0) {
+        agregar(destino, tam, usados, " reserva=%u", resp->idReserva);
+    }
+}
+
+/* Texto legible de una respuesta, con el id de la reserva si se admitió */
+static void describirResultado(const RespuestaControlador *resp, int numPersonas, char *texto, size_t tam) {
+    describirRespuesta(resp, numPersonas, texto, tam);
+    if (resp->idReserva != 0) {
+        size_t longitud = strlen(texto);
+        snprintf(texto + longitud, tam - longitud, " [reserva #%u]", resp->idReserva);
+    }
+}
+
+/* Registro estructurado (modo silencioso): una línea clave=valor por evento */
+static size_t formatearEstructurado(const EventoRegistro *evento, char *destino, size_t tam) {
+    size_t usados = 0;
+    char textoHora[MAX_TEXTO_HORA];
+    
+    switch (evento->tipo) {
+        case EVENTO_INICIO: {
+            const EventoInicio *e = (const EventoInicio *)evento->datos;
+            agregar(destino, tam, &usados,
+                    "t=%.6f evento=inicio hora_inicial=%d hora_final=%d aforo=%d trabajadores=%d "
+                    "dias=%d parques=%d cola=%d recuperadas=%ld\n", evento->instante, e->horaInicial, e->horaFinal,
+                    e->aforo, e->trabajadores, e->dias, e->parques, e->cola, e->recuperadas);
+            break;
+        }
+        case EVENTO_AGENTE: {
+            static const char *acciones[] = { "registro", "fin", "desconexion" };
+            static const char *canales[] = { "pipe", "socket", "memoria" };
+            const EventoAgente *e = (const EventoAgente *)evento->datos;
+            agregar(destino, tam, &usados, "t=%.6f evento=agente accion=%s", evento->instante, acciones[e->accion]);
+            agregarCampo(destino, tam, &usados, "nombre", e->nombre);
+            agregar(destino, tam, &usados, " canal=%s\n", canales[e->canal]);
+            break;
+        }
+        case EVENTO_SOLICITUD: {
+            const EventoSolicitud *e = (const EventoSolicitud *)evento->datos;
+            formatearHora(e->horaSolicitada, textoHora, sizeof(textoHora));
+            agregar(destino, tam, &usados, "t=%.6f evento=solicitud", evento->instante);
+            agregarCampo(destino, tam, &usados, "agente", e->agente);
+            agregarCampo(destino, tam, &usados, "familia", e->familia);
+            agregar(destino, tam, &usados, " hora=%s personas=%d dia=%d parque=%d",
+                    textoHora, e->numPersonas, e->dia, e->parque);
+            agregarResultado(destino, tam, &usados, &e->resp);
+            agregar(destino, tam, &usados, "\n");
+            break;
+        }
+        case EVENTO_ELEMENTO_LOTE: {
+            const EventoElementoLote *e = (const EventoElementoLote *)evento->datos;
+            formatearHora(e->horaSolicitada, textoHora, sizeof(textoHora));
+            agregar(destino, tam, &usados, "t=%.6f evento=solicitud lote=%d/%d",
+                    evento->instante, e->indice + 1, e->cantidad);
+            agregarCampo(destino, tam, &usados, "familia", e->familia);
+            agregar(destino, tam, &usados, " hora=%s personas=%d", textoHora, e->numPersonas);
+            agregarResultado(destino, tam, &usados, &e->resp);
+            agregar(destino, tam, &usados, "\n");
+            break;
+        }
+        case EVENTO_CAMBIO: {
+            const EventoCambio *e = (const EventoCambio *)evento->datos;
+            agregar(destino, tam, &usados, "t=%.6f evento=%s original=%u", evento->instante,
+                    e->tipo == MSG_CANCELAR ? "cancelacion" : "modificacion", e->idReserva);
+            agregarCampo(destino, tam, &usados, "agente", e->agente);
+            agregarCampo(destino, tam, &usados, "familia", e->familia);
+            if (e->tipo == MSG_MODIFICAR || e->resp.tipo == RESP_RESERVA_CANCELADA) {
+                formatearHora(e->horaSolicitada, textoHora, sizeof(textoHora));
+                agregar(destino, tam, &usados, " hora=%s personas=%d", textoHora, e->numPersonas);
+            }
+            agregarResultado(destino, tam, &usados, &e->resp);
+            agregar(destino, tam, &usados, "\n");
+            break;
+        }
+        case EVENTO_CONSULTA: {
+            const EventoConsulta *e = (const EventoConsulta *)evento->datos;
+            formatearHora(e->horaDesde, textoHora, sizeof(textoHora));
+            agregar(destino, tam, &usados, "t=%.6f evento=consulta", evento->instante);
+            agregarCampo(destino, tam, &usados, "agente", e->agente);
+            agregar(destino, tam, &usados, " dia=%d parque=%d", e->dia, e->parque);
+            if (e->motivo != MOTIVO_NINGUNO) {
+                agregar(destino, tam, &usados, " motivo=%s\n", nombreMotivo(e->motivo));
+                break;
+            }
+            agregar(destino, tam, &usados, " desde=%s franjas=%d franjas_libres=%d plazas_max=%d\n",
+                    textoHora, e->cantidad, e->franjasLibres, e->plazasMaximas);
+            break;
+        }
+        case EVENTO_HORA: {
+            const EventoFranja *e = (const EventoFranja *)evento->datos;
+            formatearHora(e->minuto, textoHora, sizeof(textoHora));
+            agregar(destino, tam, &usados, "t=%.6f evento=hora hora=%s\n", evento->instante, textoHora);
+            break;
+        }
+        case EVENTO_MOVIMIENTO: {
+            const EventoMovimiento *e = (const EventoMovimiento *)evento->datos;
+            agregar(destino, tam, &usados, "t=%.6f evento=%s parque=%d", evento->instante,
+                    e->sentido == MOVIMIENTO_SALIDA ? "salida" : "entrada", e->parque);
+            agregarCampo(destino, tam, &usados, "familia", e->familia);
+            agregar(destino, tam, &usados, " personas=%d", e->numPersonas);
+            agregarCampo(destino, tam, &usados, "agente", e->agente);
+            agregar(destino, tam, &usados, "\n");
+            break;
+        }
+        case EVENTO_OCUPACION: {
+            const EventoFranja *e = (const EventoFranja *)evento->datos;
+            agregar(destino, tam, &usados, "t=%.6f evento=ocupacion parque=%d personas=%d aforo=%d\n",
+                    evento->instante, e->parque, e->ocupacion, aforoMaximo);
+            break;
+        }
+        case EVENTO_FIN_SIMULACION:
+            agregar(destino, tam, &usados, "t=%.6f evento=fin\n", evento->instante);
+            break;
+        case EVENTO_REPORTE: {
+            const EventoReporte *e = (const EventoReporte *)evento->datos;
+            agregar(destino, tam, &usados, "t=%.6f evento=reporte aceptadas=%ld reprogramadas=%ld negadas=%ld "
+                    "canceladas=%ld modificadas=%ld cambios_negados=%ld consultas=%ld rechazadas=%ld\n",
+                    evento->instante, e->aceptadas, e->reprogramadas, e->negadas, e->canceladas, e->modificadas,
+                    e->cambiosNegados, e->consultas, e->rechazadas);
+            break;
+        }
+        default:
+            break;  // Los demás solo dan forma a la salida legible
+    }
+    return usados;
+}
+
+/*
+ * Da formato a un evento en el hilo del registro (ver registro.h): la salida
+ * legible de siempre o, en modo silencioso, el registro estructurado.
+ */
+size_t formatearEventoSalida(const EventoRegistro *evento, char *destino, size_t tam) {
+    size_t usados = 0;
+    char textoHora[MAX_TEXTO_HORA];
+    char texto[MAX_TEXTO_RESPUESTA];
+    
+    if (nivelSalida == NIVEL_SILENCIOSO) {
+        return formatearEstructurado(evento, destino, tam);
+    }
+    
+    switch (evento->tipo) {
+        case EVENTO_TEXTO:
+            agregar(destino, tam, &usados, "%s", ((const EventoTexto *)evento->datos)->texto);
+            break;
+        case EVENTO_AGENTE: {
+            const EventoAgente *e = (const EventoAgente *)evento->datos;
+            if (e->accion == AGENTE_REGISTRADO) {
+                agregar(destino, tam, &usados, "→ Agente '%s' registrado%s\n", e->nombre,
+                        e->canal == CANAL_MEMORIA ? " (memoria compartida)" :
+                        e->canal == CANAL_SOCKET ? " (socket)" : "");
+            } else if (e->accion == AGENTE_FINALIZADO) {
+                agregar(destino, tam, &usados, "→ Agente %s ha finalizado\n", e->nombre);
+            } else {
+                agregar(destino, tam, &usados, "→ Agente %s se desconectó\n", e->nombre);
+            }
+            break;
+        }
+        case EVENTO_SOLICITUD: {
+            const EventoSolicitud *e = (const EventoSolicitud *)evento->datos;
+            formatearHora(e->horaSolicitada, textoHora, sizeof(textoHora));
+            agregar(destino, tam, &usados, "\n╔═══════════════════════════════════════════════════════╗\n");
+            agregar(destino, tam, &usados, "║ SOLICITUD DE RESERVA                                  ║\n");
+            agregar(destino, tam, &usados, "╠═══════════════════════════════════════════════════════╣\n");
+            agregar(destino, tam, &usados, "║ Agente: %-45s ║\n", e->agente);
+            agregar(destino, tam, &usados, "║ Familia: %-44s ║\n", e->familia);
+            agregar(destino, tam, &usados, "║ Hora solicitada: %-5s                                ║\n", textoHora);
+            agregar(destino, tam, &usados, "║ Personas: %-3d                                         ║\n", e->numPersonas);
+            if (numCalendarios > 1) {
+                agregar(destino, tam, &usados, "║ Día: +%-3d Parque: %-3d                                 ║\n",
+                        e->dia, e->parque);
+            }
+            agregar(destino, tam, &usados, "╚═══════════════════════════════════════════════════════╝\n");
+            if (e->extemporanea) {
+                agregar(destino, tam, &usados, "⚠ Solicitud extemporánea (hora solicitada < hora actual)\n");
+            }
+            if (e->resp.motivo == MOTIVO_SIN_DISPONIBILIDAD) {
+                agregar(destino, tam, &usados, "⚠ No hay disponibilidad en hora solicitada\n");
+            }
+            describirResultado(&e->resp, e->numPersonas, texto, sizeof(texto));
+            agregar(destino, tam, &usados, "%s Respuesta: %s\n\n",
+                    e->resp.tipo == RESP_RESERVA_NEGADA ? "✗" : "✓", texto);
+            break;
+        }
+        case EVENTO_CAMBIO: {
+            const EventoCambio *e = (const EventoCambio *)evento->datos;
+            agregar(destino, tam, &usados, "\n╔═══════════════════════════════════════════════════════╗\n");
+            agregar(destino, tam, &usados, e->tipo == MSG_CANCELAR ?
+                    "║ CANCELACIÓN DE RESERVA                                ║\n" :
+                    "║ MODIFICACIÓN DE RESERVA                               ║\n");
+            agregar(destino, tam, &usados, "╠═══════════════════════════════════════════════════════╣\n");
+            agregar(destino, tam, &usados, "║ Agente: %-45s ║\n", e->agente);
+            if (e->familia[0] != '\0') {
+                agregar(destino, tam, &usados, "║ Familia: %-44s ║\n", e->familia);
+            }
+            agregar(destino, tam, &usados, "║ Reserva: #%-43u ║\n", e->idReserva);
+            if (e->tipo == MSG_MODIFICAR) {
+                formatearHora(e->horaSolicitada, textoHora, sizeof(textoHora));
+                agregar(destino, tam, &usados, "║ Nueva hora: %-5s  Personas: %-3d                      ║\n",
+                        textoHora, e->numPersonas);
+            }
+            agregar(destino, tam, &usados, "╚═══════════════════════════════════════════════════════╝\n");
+            describirResultado(&e->resp, e->numPersonas, texto, sizeof(texto));
+            agregar(destino, tam, &usados, "%s Respuesta: %s\n\n",
+                    e->resp.tipo == RESP_RESERVA_NEGADA ? "✗" : "✓", texto);
+            break;
+        }
+        case EVENTO_CONSULTA: {
+            const EventoConsulta *e = (const EventoConsulta *)evento->datos;
+            formatearHora(e->horaDesde, textoHora, sizeof(textoHora));
+            if (e->motivo != MOTIVO_NINGUNO) {
+                agregar(destino, tam, &usados, "🔍 Consulta de %s (día +%d, parque %d): el controlador no atiende "
+                        "ese día o parque\n\n", e->agente, e->dia, e->parque);
+            } else {
+                agregar(destino, tam, &usados, "🔍 Consulta de %s (día +%d, parque %d): %d de %d franjas con cupo "
+                        "desde las %s, hasta %d personas\n\n", e->agente, e->dia, e->parque,
+                        e->franjasLibres, e->cantidad, textoHora, e->plazasMaximas);
+            }
+            break;
+        }
+        case EVENTO_LOTE: {
+            const EventoLote *e = (const EventoLote *)evento->datos;
+            agregar(destino, tam, &usados, "\n╔═══════════════════════════════════════════════════════╗\n");
+            agregar(destino, tam, &usados, "║ LOTE DE SOLICITUDES                                   ║\n");
+            agregar(destino, tam, &usados, "╠═══════════════════════════════════════════════════════╣\n");
+            agregar(destino, tam, &usados, "║ Agente: %-45s ║\n", e->agente);
+            agregar(destino, tam, &usados, "║ Solicitudes: %-3d                                      ║\n", e->cantidad);
+            agregar(destino, tam, &usados, "╚═══════════════════════════════════════════════════════╝\n");
+            break;
+        }
+        case EVENTO_ELEMENTO_LOTE: {
+            const EventoElementoLote *e = (const EventoElementoLote *)evento->datos;
+            formatearHora(e->horaSolicitada, textoHora, sizeof(textoHora));
+            describirResultado(&e->resp, e->numPersonas, texto, sizeof(texto));
+            agregar(destino, tam, &usados, "   %s %s (%d personas, %s): %s\n",
+                    e->resp.tipo == RESP_RESERVA_NEGADA ? "✗" : "✓",
+                    e->familia, e->numPersonas, textoHora, texto);
+            if (e->indice == e->cantidad - 1) {
+                agregar(destino, tam, &usados, "\n");
+            }
+            break;
+        }
+        case EVENTO_HORA: {
+            const EventoFranja *e = (const EventoFranja *)evento->datos;
+            agregar(destino, tam, &usados, "\n");
+            agregar(destino, tam, &usados, "╔════════════════════════════════════════════════════════════╗\n");
+            agregar(destino, tam, &usados, "║                   ⏰ HORA: %02d:%02d                           ║\n",
+                    e->minuto / MINUTOS_POR_HORA, e->minuto % MINUTOS_POR_HORA);
+            agregar(destino, tam, &usados, "╚════════════════════════════════════════════════════════════╝\n");
+            break;
+        }
+        case EVENTO_LISTA_MOVIMIENTOS: {
+            const EventoFranja *e = (const EventoFranja *)evento->datos;
+            if (e->sentido == MOVIMIENTO_SALIDA) {
+                if (numParques > 1) {
+                    agregar(destino, tam, &usados, "\n🎢 PARQUE %d\n", e->parque);
+                }
+                agregar(destino, tam, &usados, "\n📤 Familias que SALEN del parque:\n");
+            } else {
+                agregar(destino, tam, &usados, "\n📥 Familias que ENTRAN al parque:\n");
+            }
+            break;
+        }
+        case EVENTO_MOVIMIENTO: {
+            const EventoMovimiento *e = (const EventoMovimiento *)evento->datos;
+            if (e->sentido == MOVIMIENTO_SALIDA) {
+                agregar(destino, tam, &usados, "   • Familia %s (%d personas) - Agente: %s\n",
+                        e->familia, e->numPersonas, e->agente);
+            } else {
+                char inicio[MAX_TEXTO_HORA], fin[MAX_TEXTO_HORA];
+                formatearHora(e->inicio, inicio, sizeof(inicio));
+                formatearHora(e->fin, fin, sizeof(fin));
+                agregar(destino, tam, &usados, "   • Familia %s (%d personas) - Agente: %s [%s-%s]\n",
+                        e->familia, e->numPersonas, e->agente, inicio, fin);
+            }
+            break;
+        }
+        case EVENTO_TOTAL_MOVIMIENTOS: {
+            const EventoFranja *e = (const EventoFranja *)evento->datos;
+            if (e->cantidad == 0) {
+                agregar(destino, tam, &usados, "   (Ninguna)\n");
+            } else {
+                agregar(destino, tam, &usados, "   Total: %d personas\n", e->total);
+            }
+            break;
+        }
+        case EVENTO_OCUPACION: {
+            const EventoFranja *e = (const EventoFranja *)evento->datos;
+            int porcentaje = (e->ocupacion * 100) / aforoMaximo;
+            int barras = porcentaje / 5;
+            
+            agregar(destino, tam, &usados, "\n📊 Ocupación actual: %d / %d personas", e->ocupacion, aforoMaximo);
+            
+            // Barra de progreso visual
+            agregar(destino, tam, &usados, " [");
+            for (int i = 0; i < 20; i++) {
+                agregar(destino, tam, &usados, i < barras ? "█" : "░");
+            }
+            agregar(destino, tam, &usados, "] %d%%\n", porcentaje);
+            break;
+        }
+        case EVENTO_FIN_HORA:
+            agregar(destino, tam, &usados, "\n");
+            break;
+        case EVENTO_FIN_SIMULACION:
+            agregar(destino, tam, &usados, "\n");
+            agregar(destino, tam, &usados, "╔════════════════════════════════════════════════════════════╗\n");
+            agregar(destino, tam, &usados, "║          🏁 SIMULACIÓN FINALIZADA                          ║\n");
+            agregar(destino, tam, &usados, "╚════════════════════════════════════════════════════════════╝\n");
+            agregar(destino, tam, &usados, "\n");
+            break;
+        default:
+            break;
+    }
+    return usados;
+}
+
+/* ============================================================================
+ * MÉTRICAS EN VIVO Y REPORTE ESTRUCTURADO
+ * ============================================================================ */
+/* Suma los contadores de todos los trabajadores (sin tomar ningún mutex) */
+void sumarEstadisticas(long *aceptadas, long *reprogramadas, long *negadas) {
+    *aceptadas = *reprogramadas = *negadas = 0;
+    for (int t = 0; t < MAX_TRABAJADORES; t++) {
+        *aceptadas += atomic_load_explicit(&estadisticasTrabajadores[t].aceptadas, memory_order_relaxed);
+        *reprogramadas += atomic_load_explicit(&estadisticasTrabajadores[t].reprogramadas, memory_order_relaxed);
+        *negadas += atomic_load_explicit(&estadisticasTrabajadores[t].negadas, memory_order_relaxed);
+    }
+}
+
+/* Como sumarEstadisticas, para las cancelaciones y modificaciones */
+void sumarCambios(long *canceladas, long *modificadas, long *negados) {
+    *canceladas = *modificadas = *negados = 0;
+    for (int t = 0; t < MAX_TRABAJADORES; t++) {
+        *canceladas += atomic_load_explicit(&estadisticasTrabajadores[t].canceladas, memory_order_relaxed);
+        *modificadas += atomic_load_explicit(&estadisticasTrabajadores[t].modificadas, memory_order_relaxed);
+        *negados += atomic_load_explicit(&estadisticasTrabajadores[t].cambiosNegados, memory_order_relaxed);
+    }
+}
+
+/* Consultas de disponibilidad de todos los trabajadores */
+long sumarConsultas() {
+    long consultas = 0;
+    for (int t = 0; t < MAX_TRABAJADORES; t++) {
+        consultas += atomic_load_explicit(&estadisticasTrabajadores[t].consultas, memory_order_relaxed);
+    }
+    return consultas;
+}
+
+int esArchivoCSV(const char *ruta) {
+    size_t longitud = strlen(ruta);
+    return longitud > 4 && strcmp(ruta + longitud - 4, ".csv") == 0;
+}
+
+/*
+ * Toma los contadores, la cola, los agentes y la latencia del momento.
+ * Requiere mutexMetricas tomado (también protege las bases del ritmo).
+ */
+void tomarMuestra(MuestraMetricas *muestra) {
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    muestra->segundos = (double)nanosEntre(&instanteArranque, &ahora) / 1e9;
+    muestra->franja = franjaActual;
+    sumarEstadisticas(&muestra->aceptadas, &muestra->reprogramadas, &muestra->negadas);
+    sumarCambios(&muestra->canceladas, &muestra->modificadas, &muestra->cambiosNegados);
+    muestra->consultas = sumarConsultas();
+    
+    pthread_mutex_lock(&colaPeticiones.mutex);
+    muestra->pendientes = colaPeticiones.cantidad;
+    muestra->maximoPendientes = colaPeticiones.maximoPendientes;
+    muestra->enProceso = colaPeticiones.enProceso;
+    muestra->atendidas = colaPeticiones.atendidas;
+    muestra->rechazadas = colaPeticiones.rechazadas;
+    pthread_mutex_unlock(&colaPeticiones.mutex);
+    
+    muestra->agentes = contarAgentesActivos();
+    
+    inicializarHistograma(&muestra->latencia);
+    for (int t = 0; t < MAX_TRABAJADORES; t++) {
+        acumularHistograma(&muestra->latencia, &estadisticasTrabajadores[t].latencia);
+    }
+    
+    // El ritmo se mide desde una base de hace al menos VENTANA_RITMO_SEGUNDOS,
+    // sin importar cada cuánto se tomen muestras
+    long solicitudes = muestra->aceptadas + muestra->reprogramadas + muestra->negadas;
+    double intervalo = muestra->segundos - segundosRitmoAnterior;
+    muestra->solicitudesPorSegundo = intervalo > 0 ? (double)(solicitudes - solicitudesRitmoAnterior) / intervalo : 0;
+    if (muestra->segundos - segundosRitmo >= VENTANA_RITMO_SEGUNDOS) {
+        segundosRitmoAnterior = segundosRitmo;
+        solicitudesRitmoAnterior = solicitudesRitmo;
+        segundosRitmo = muestra->segundos;
+        solicitudesRitmo = solicitudes;
+    }
+}
+
+/*
+ * Instantánea en una línea de JSON: solicitudes y sus tasas, ritmo, cola,
+ * agentes, latencia de admisión (en microsegundos) y la ocupación de cada
+ * franja por calendario. El reporte final agrega las horas pico y valle.
+ */
+void componerMetricasJSON(TextoMetricas *texto, const MuestraMetricas *muestra, int final) {
+    long total = muestra->aceptadas + muestra->reprogramadas + muestra->negadas;
+    double divisor = total > 0 ? (double)total : 1;
+    const HistogramaLatencia *latencia = &muestra->latencia;
+    long muestrasLatencia = atomic_load_explicit(&latencia->muestras, memory_order_relaxed);
+    long sumaLatencia = atomic_load_explicit(&latencia->sumaNanos, memory_order_relaxed);
+    int minuto = minutoDeFranja(muestra->franja);
+    
+    agregarTexto(texto, "{\"t\":%.3f,\"final\":%s,\"hora\":\"%02d:%02d\",\"aforo\":%d,",
+                 muestra->segundos, final ? "true" : "false",
+                 minuto / MINUTOS_POR_HORA, minuto % MINUTOS_POR_HORA, aforoMaximo);
+    agregarTexto(texto, "\"solicitudes\":{\"total\":%ld,\"aceptadas\":%ld,\"reprogramadas\":%ld,\"negadas\":%ld,"
+                 "\"tasaAceptadas\":%.4f,\"tasaReprogramadas\":%.4f,\"tasaNegadas\":%.4f,\"porSegundo\":%.1f},",
+                 total, muestra->aceptadas, muestra->reprogramadas, muestra->negadas,
+                 muestra->aceptadas / divisor, muestra->reprogramadas / divisor, muestra->negadas / divisor,
+                 muestra->solicitudesPorSegundo);
+    agregarTexto(texto, "\"cambios\":{\"canceladas\":%ld,\"modificadas\":%ld,\"negados\":%ld},",
+                 muestra->canceladas, muestra->modificadas, muestra->cambiosNegados);
+    agregarTexto(texto, "\"consultas\":%ld,", muestra->consultas);
+    agregarTexto(texto, "\"cola\":{\"pendientes\":%d,\"maximo\":%d,\"capacidad\":%d,\"enProceso\":%d,\"atendidas\":%ld,"
+                 "\"rechazadas\":%ld},",
+                 muestra->pendientes, muestra->maximoPendientes, profundidadCola, muestra->enProceso, muestra->atendidas,
+                 muestra->rechazadas);
+    agregarTexto(texto, "\"agentes\":%d,", muestra->agentes);
+    agregarTexto(texto, "\"latenciaAdmisionUs\":{\"muestras\":%ld,\"media\":%.3f,\"p50\":%.3f,\"p90\":%.3f,"
+                 "\"p99\":%.3f,\"max\":%.3f},",
+                 muestrasLatencia, muestrasLatencia > 0 ? (double)sumaLatencia / muestrasLatencia / 1e3 : 0,
+                 percentilLatencia(latencia, 50) / 1e3, percentilLatencia(latencia, 90) / 1e3,
+                 percentilLatencia(latencia, 99) / 1e3,
+                 atomic_load_explicit(&latencia->maximoNanos, memory_order_relaxed) / 1e3);
+#ifdef INSTRUMENTAR_ETAPAS
+    componerEtapas(texto, 0);
+#endif
+    
+    agregarTexto(texto, "\"calendarios\":[");
+    for (int c = 0; c < numCalendarios; c++) {
+        if (c > 0) {
+            agregarTexto(texto, ",");
+        }
+        componerCalendarioJSON(texto, &calendarios[c], final);
+    }
+    agregarTexto(texto, "]}\n");
+}
+
+/* Ocupación por franja de un calendario (leída sin mutex) y, al final, sus picos y valles */
+void componerCalendarioJSON(TextoMetricas *texto, Calendario *cal, int final) {
+    int maxOcupacion = 0, minOcupacion = aforoMaximo + 1;
+    
+    agregarTexto(texto, "{\"dia\":%d,\"parque\":%d,\"ocupacion\":[", cal->dia, cal->parque);
+    for (int f = 0; f < numFranjas && f < franjaFinPeriodo; f++) {
+        int minuto = minutoDeFranja(f);
+        int ocupacion = leerOcupacion(cal, f);
+        agregarTexto(texto, "%s{\"hora\":\"%02d:%02d\",\"personas\":%d,\"porcentaje\":%d}", f > 0 ? "," : "",
+                     minuto / MINUTOS_POR_HORA, minuto % MINUTOS_POR_HORA, ocupacion,
+                     (ocupacion * 100) / aforoMaximo);
+    }
+    agregarTexto(texto, "]");
+    
+    if (final) {
+        // Mismo criterio que reportarPicos: sobre todas las franjas del día
+        for (int f = 0; f < numFranjas; f++) {
+            int ocupacion = leerOcupacion(cal, f);
+            maxOcupacion = ocupacion > maxOcupacion ? ocupacion : maxOcupacion;
+            minOcupacion = ocupacion < minOcupacion ? ocupacion : minOcupacion;
+        }
+        for (int extremo = 0; extremo < 2; extremo++) {
+            int personas = extremo == 0 ? maxOcupacion : minOcupacion;
+            int primera = 1;
+            agregarTexto(texto, ",\"%s\":{\"personas\":%d,\"horas\":[", extremo == 0 ? "pico" : "valle", personas);
+            for (int f = 0; f < numFranjas; f++) {
+                if (leerOcupacion(cal, f) == personas && (extremo == 1 || personas > 0)) {
+                    int minuto = minutoDeFranja(f);
+                    agregarTexto(texto, "%s\"%02d:%02d\"", primera ? "" : ",",
+                                 minuto / MINUTOS_POR_HORA, minuto % MINUTOS_POR_HORA);
+                    primera = 0;
+                }
+            }
+            agregarTexto(texto, "]}");
+        }
+    }
+    agregarTexto(texto, "}");
+}
+
+/* Fila de la serie CSV de -M (la cabecera la escribe inicializarServidor) */
+void componerFilaCSV(TextoMetricas *texto, const MuestraMetricas *muestra) {
+    int minuto = minutoDeFranja(muestra->franja);
+    
+    agregarTexto(texto, "%.3f,%02d:%02d,%ld,%ld,%ld,%ld,%.1f,%d,%d,%d,%d,%.3f,%.3f,%.3f\n",
+                 muestra->segundos, minuto / MINUTOS_POR_HORA, minuto % MINUTOS_POR_HORA,
+                 muestra->aceptadas + muestra->reprogramadas + muestra->negadas,
+                 muestra->aceptadas, muestra->reprogramadas, muestra->negadas, muestra->solicitudesPorSegundo,
+                 muestra->pendientes, muestra->maximoPendientes, muestra->enProceso, muestra->agentes,
+                 percentilLatencia(&muestra->latencia, 50) / 1e3, percentilLatencia(&muestra->latencia, 99) / 1e3,
+                 atomic_load_explicit(&muestra->latencia.maximoNanos, memory_order_relaxed) / 1e3);
+}
+
+/*
+ * Reporte final en CSV "largo": una métrica por fila, con el día, el parque
+ * y la hora solo en las que son de un calendario o de una franja.
+ */
+void componerReporteCSV(TextoMetricas *texto, const MuestraMetricas *muestra) {
+    long total = muestra->aceptadas + muestra->reprogramadas + muestra->negadas;
+    const HistogramaLatencia *latencia = &muestra->latencia;
+    
+    agregarTexto(texto, "metrica,dia,parque,hora,valor\n");
+    agregarTexto(texto, "solicitudes,,,,%ld\naceptadas,,,,%ld\nreprogramadas,,,,%ld\nnegadas,,,,%ld\n",
+                 total, muestra->aceptadas, muestra->reprogramadas, muestra->negadas);
+    agregarTexto(texto, "canceladas,,,,%ld\nmodificadas,,,,%ld\ncambios_negados,,,,%ld\n",
+                 muestra->canceladas, muestra->modificadas, muestra->cambiosNegados);
+    agregarTexto(texto, "consultas,,,,%ld\n", muestra->consultas);
+    agregarTexto(texto, "maximo_pendientes,,,,%d\n", muestra->maximoPendientes);
+    agregarTexto(texto, "rechazadas_ocupado,,,,%ld\n", muestra->rechazadas);
+    agregarTexto(texto, "latencia_muestras,,,,%ld\n", atomic_load_explicit(&latencia->muestras, memory_order_relaxed));
+    agregarTexto(texto, "latencia_p50_us,,,,%.3f\nlatencia_p90_us,,,,%.3f\nlatencia_p99_us,,,,%.3f\nlatencia_max_us,,,,%.3f\n",
+                 percentilLatencia(latencia, 50) / 1e3, percentilLatencia(latencia, 90) / 1e3,
+                 percentilLatencia(latencia, 99) / 1e3,
+                 atomic_load_explicit(&latencia->maximoNanos, memory_order_relaxed) / 1e3);
+#ifdef INSTRUMENTAR_ETAPAS
+    componerEtapas(texto, 1);
+#endif
+    
+    for (int c = 0; c < numCalendarios; c++) {
+        Calendario *cal = &calendarios[c];
+        for (int f = 0; f < numFranjas && f < franjaFinPeriodo; f++) {
+            int minuto = minutoDeFranja(f);
+            agregarTexto(texto, "ocupacion,%d,%d,%02d:%02d,%d\n", cal->dia, cal->parque,
+                         minuto / MINUTOS_POR_HORA, minuto % MINUTOS_POR_HORA, leerOcupacion(cal, f));
+        }
+    }
+}
+
+/*
+ * Publica las métricas en el archivo de -M: reemplaza el JSON de forma
+ * atómica o agrega una fila a la serie CSV. Lo llama el reloj en cada franja
+ * y main al terminar. Con un socket no hace nada: se sirve a pedido.
+ */
+void publicarMetricas(int final) {
+    TextoMetricas texto = {0};
+    
+    if (destinoMetricas[0] == '\0' || fdEscuchaMetricas != -1) {
+        return;
+    }
+    
+    pthread_mutex_lock(&mutexMetricas);
+    tomarMuestra(&muestraMetricas);
+    if (fdSerieMetricas != -1) {
+        componerFilaCSV(&texto, &muestraMetricas);
+    } else {
+        componerMetricasJSON(&texto, &muestraMetricas, final);
+    }
+    pthread_mutex_unlock(&mutexMetricas);
+    
+    if (texto.error) {
+        fprintf(stderr, "Error al componer las métricas: memoria insuficiente\n");
+    } else if (fdSerieMetricas != -1) {
+        if (!escribirCompleto(fdSerieMetricas, (const uint8_t *)texto.datos, texto.longitud)) {
+            fprintf(stderr, "Error al escribir las métricas en %s: %s\n", destinoMetricas, strerror(errno));
+        }
+    } else if (!publicarArchivo(destinoMetricas, texto.datos, texto.longitud)) {
+        fprintf(stderr, "Error al publicar las métricas en %s: %s\n", destinoMetricas, strerror(errno));
+    }
+    liberarTexto(&texto);
+}
+
+/*
+ * Atiende a los clientes del socket de métricas (bucle de eventos): a cada
+ * uno le entrega la instantánea del momento en JSON y cierra la conexión.
+ */
+void atenderMetricas() {
+    int fd;
+    
+    while ((fd = aceptarConexion(fdEscuchaMetricas)) != -1) {
+        TextoMetricas texto = {0};
+    
+        pthread_mutex_lock(&mutexMetricas);
+        tomarMuestra(&muestraMetricas);
+        componerMetricasJSON(&texto, &muestraMetricas, 0);
+        pthread_mutex_unlock(&mutexMetricas);
+    
+        if (!texto.error) {
+            enviarMetricas(fd, texto.datos, texto.longitud);
+        }
+        liberarTexto(&texto);
+        close(fd);
+    }
+}
+
+/* Como escribirCompleto, pero abandona a un cliente que no lee en ESPERA_CLIENTE_METRICAS_MS */
+void enviarMetricas(int fd, const char *datos, size_t longitud) {
+    while (longitud > 0) {
+        ssize_t escritos = write(fd, datos, longitud);
+    
+        if (escritos > 0) {
+            datos += escritos;
+            longitud -= (size_t)escritos;
+        } else if (escritos == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd espera = { .fd = fd, .events = POLLOUT };
+            if (poll(&espera, 1, ESPERA_CLIENTE_METRICAS_MS) <= 0) {
+                return;
+            }
+        } else if (escritos == -1 && errno != EINTR) {
+            return;
+        }
+    }
+}
+
+/*
+ * Latencia de cada etapa (INSTRUMENTAR_ETAPAS), sumada de todos los hilos:
+ * un objeto "etapasUs" del JSON o filas etapa_<nombre>_<medida>_us del CSV.
+ */
+void componerEtapas(TextoMetricas *texto, int csv) {
+    HistogramaLatencia etapas[NUM_ETAPAS];
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        inicializarHistograma(&etapas[e]);
+    }
+    sumarEtapas(etapas);
+    
+    if (!csv) {
+        agregarTexto(texto, "\"etapasUs\":{");
+    }
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        long muestras = atomic_load_explicit(&etapas[e].muestras, memory_order_relaxed);
+        double p50 = percentilLatencia(&etapas[e], 50) / 1e3;
+        double p99 = percentilLatencia(&etapas[e], 99) / 1e3;
+        double maximo = atomic_load_explicit(&etapas[e].maximoNanos, memory_order_relaxed) / 1e3;
+        if (csv) {
+            agregarTexto(texto, "etapa_%s_muestras,,,,%ld\netapa_%s_p50_us,,,,%.3f\n"
+                         "etapa_%s_p99_us,,,,%.3f\netapa_%s_max_us,,,,%.3f\n",
+                         nombreEtapa(e), muestras, nombreEtapa(e), p50, nombreEtapa(e), p99, nombreEtapa(e), maximo);
+        } else {
+            agregarTexto(texto, "%s\"%s\":{\"muestras\":%ld,\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+                         e > 0 ? "," : "", nombreEtapa(e), muestras, p50, p99, maximo);
+        }
+    }
+    if (!csv) {
+        agregarTexto(texto, "},");
+    }
+}
+
+/* Escribe el reporte final de -R: CSV si la ruta termina en .csv, JSON si no */
+void escribirReporteEstructurado() {
+    TextoMetricas texto = {0};
+    
+    if (rutaReporte[0] == '\0') {
+        return;
+    }
+    
+    pthread_mutex_lock(&mutexMetricas);
+    tomarMuestra(&muestraMetricas);
+    if (esArchivoCSV(rutaReporte)) {
+        componerReporteCSV(&texto, &muestraMetricas);
+    } else {
+        componerMetricasJSON(&texto, &muestraMetricas, 1);
+    }
+    pthread_mutex_unlock(&mutexMetricas);
+    
+    if (texto.error) {
+        fprintf(stderr, "Error al componer el reporte: memoria insuficiente\n");
+    } else if (!publicarArchivo(rutaReporte, texto.datos, texto.longitud)) {
+        fprintf(stderr, "Error al escribir el reporte en %s: %s\n", rutaReporte, strerror(errno));
+    }
+    liberarTexto(&texto);
+}
+
+/* ============================================================================
+ * GENERACIÓN DE REPORTE FINAL
+ * ============================================================================ */
+void generarReporte() {
+    long aceptadas, reprogramadas, negadas;
+    long canceladas, modificadas, cambiosNegados;
+    sumarEstadisticas(&aceptadas, &reprogramadas, &negadas);
+    sumarCambios(&canceladas, &modificadas, &cambiosNegados);
+    long consultas = sumarConsultas();
+    
+    pthread_mutex_lock(&colaPeticiones.mutex);
+    long rechazadas = colaPeticiones.rechazadas;
+    pthread_mutex_unlock(&colaPeticiones.mutex);
+    
+    if (nivelSalida == NIVEL_SILENCIOSO) {
+        EventoReporte reporte = { aceptadas, reprogramadas, negadas, canceladas, modificadas, cambiosNegados,
+                                  consultas, rechazadas };
+        registrarEvento(EVENTO_REPORTE, &reporte, sizeof(reporte));
+        return;
+    }
+    
+    // El reporte se imprime directamente: antes debe salir todo lo registrado
+    vaciarRegistro();
+    
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║                  📊 REPORTE FINAL DEL DÍA                  ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+    
+    for (int c = 0; c < numCalendarios; c++) {
+        if (numCalendarios > 1) {
+            printf("\n📆 DÍA +%d, PARQUE %d\n", calendarios[c].dia, calendarios[c].parque);
+        }
+        reportarPicos(&calendarios[c]);
+    }
+    
+    // Estadísticas de solicitudes (de todos los calendarios y trabajadores)
+    printf("\n📈 ESTADÍSTICAS DE SOLICITUDES:\n");
+    printf("   • Solicitudes aceptadas en su hora:  %ld\n", aceptadas);
+    printf("   • Solicitudes reprogramadas:          %ld\n", reprogramadas);
+    printf("   • Solicitudes negadas:                %ld\n", negadas);
+    printf("   • Total de solicitudes:               %ld\n", 
+           aceptadas + reprogramadas + negadas);
+    if (canceladas + modificadas + cambiosNegados > 0) {
+        printf("   • Reservas canceladas:                %ld\n", canceladas);
+        printf("   • Reservas modificadas:               %ld\n", modificadas);
+        printf("   • Cambios negados:                    %ld\n", cambiosNegados);
+    }
+    if (consultas > 0) {
+        printf("   • Consultas de disponibilidad:        %ld\n", consultas);
+    }
+    if (rechazadas > 0) {
+        printf("   • Rechazadas por cola llena:          %ld\n", rechazadas);
+    }
+    if (colaAvisos.descartados > 0) {
+        printf("   • Avisos de cola llena descartados:   %ld\n", colaAvisos.descartados);
+    }
+#ifdef INSTRUMENTAR_ETAPAS
+    reportarEtapas();
+#endif
+    
+    for (int c = 0; c < numCalendarios; c++) {
+        if (numCalendarios > 1) {
+            printf("\n📆 DÍA +%d, PARQUE %d\n", calendarios[c].dia, calendarios[c].parque);
+        }
+        reportarOcupacion(&calendarios[c]);
+    }
+    fflush(stdout);
+}
+
+/* Tabla de latencias por etapa del camino de una solicitud (INSTRUMENTAR_ETAPAS) */
+void reportarEtapas() {
+    HistogramaLatencia etapas[NUM_ETAPAS];
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        inicializarHistograma(&etapas[e]);
+    }
+    sumarEtapas(etapas);
+    
+    printf("\n⏱️  LATENCIA POR ETAPA (microsegundos):\n");
+    printf("   ┌──────────────┬───────────┬───────────┬───────────┬───────────┐\n");
+    printf("   │ Etapa        │ Muestras  │    p50    │    p99    │  Máximo   │\n");
+    printf("   ├──────────────┼───────────┼───────────┼───────────┼───────────┤\n");
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        printf("   │ %-12s │ %9ld │ %9.2f │ %9.2f │ %9.2f │\n", nombreEtapa(e),
+               atomic_load_explicit(&etapas[e].muestras, memory_order_relaxed),
+               percentilLatencia(&etapas[e], 50) / 1e3, percentilLatencia(&etapas[e], 99) / 1e3,
+               atomic_load_explicit(&etapas[e].maximoNanos, memory_order_relaxed) / 1e3);
+    }
+    printf("   └──────────────┴───────────┴───────────┴───────────┴───────────┘\n");
+}
+
+/* Horas pico y horas valle de un calendario (la ocupación se lee sin mutex) */
+void reportarPicos(Calendario *cal) {
+    // Encontrar horas pico
+    char textoHora[MAX_TEXTO_HORA];
+    int maxOcupacion = 0;
+    for (int f = 0; f < numFranjas; f++) {
+        if (leerOcupacion(cal, f) > maxOcupacion) {
+            maxOcupacion = leerOcupacion(cal, f);
+        }
+    }
+    
+    printf("\n🔝 HORAS PICO (mayor ocupación: %d personas):\n", maxOcupacion);
+    for (int f = 0; f < numFranjas; f++) {
+        if (leerOcupacion(cal, f) == maxOcupacion && maxOcupacion > 0) {
+            formatearHora(minutoDeFranja(f), textoHora, sizeof(textoHora));
+            printf("   • %s - %d personas\n", textoHora, leerOcupacion(cal, f));
+        }
+    }
+    
+    // Encontrar horas valle
+    int minOcupacion = aforoMaximo + 1;
+    for (int f = 0; f < numFranjas; f++) {
+        if (leerOcupacion(cal, f) < minOcupacion) {
+            minOcupacion = leerOcupacion(cal, f);
+        }
+    }
+    
+    printf("\n🔽 HORAS VALLE (menor ocupación: %d personas):\n", minOcupacion);
+    for (int f = 0; f < numFranjas; f++) {
+        if (leerOcupacion(cal, f) == minOcupacion) {
+            formatearHora(minutoDeFranja(f), textoHora, sizeof(textoHora));
+            printf("   • %s - %d personas\n", textoHora, leerOcupacion(cal, f));
+        }
+    }
+}
+
+/* Tabla de ocupación por hora de un calendario (la ocupación se lee sin mutex) */
+void reportarOcupacion(Calendario *cal) {
+    // Tabla de ocupación por hora
+    printf("\n📅 OCUPACIÓN POR HORA:\n");
+    printf("   ┌──────┬───────────┬────────────┐\n");
+    printf("   │ Hora │ Personas  │ Porcentaje │\n");
+    printf("   ├──────┼───────────┼────────────┤\n");
+    for (int f = 0; f < numFranjas && f < franjaFinPeriodo; f++) {
+        int minuto = minutoDeFranja(f);
+        int ocupacion = leerOcupacion(cal, f);
+        int porcentaje = (ocupacion * 100) / aforoMaximo;
+        printf("   │ %02d:%02d│    %3d    │    %3d%%   │\n", 
+               minuto / MINUTOS_POR_HORA, minuto % MINUTOS_POR_HORA,
+               ocupacion, porcentaje);
+    }
+    printf("   └──────┴───────────┴────────────┘\n");
+}
+
+/* ============================================================================
+ * LIMPIEZA DE RECURSOS
+ * ============================================================================ */
+void limpiarRecursos() {
+    // Escribir lo que quede registrado y detener el hilo del registro
+    terminarRegistro();
+    free(movimientosFranja);
+    movimientosFranja = NULL;
+    capacidadMovimientos = 0;
+    
+    // Retirar a los agentes que sigan registrados: se cierran sus conexiones
+    // persistentes (pipes, sockets y anillos) y se libera la tabla
+    for (int b = 0; b < (1 << bitsTablaAgentes); b++) {
+        while (tablaAgentes[b] != NULL) {
+            retirarAgente(tablaAgentes[b]);
+        }
+    }
+    free(tablaAgentes);
+    tablaAgentes = NULL;
+    
+    // Eliminar pipe nominal, cerrar los sockets de escucha y la serie de métricas
+    unlink(pipeRecibe);
+    for (int i = 0; i < numEscuchas; i++) {
+        if (fdEscuchas[i] != -1) {
+            close(fdEscuchas[i]);
+            fdEscuchas[i] = -1;
+            eliminarDireccion(direccionesEscucha[i]);
+        }
+    }
+    if (fdEscuchaMetricas != -1) {
+        close(fdEscuchaMetricas);
+        fdEscuchaMetricas = -1;
+        eliminarDireccion(destinoMetricas);
+    }
+    if (fdSerieMetricas != -1) {
+        close(fdSerieMetricas);
+        fdSerieMetricas = -1;
+    }
+    
+    // Liberar cada calendario (almacén, cadenas, ocupación e índices) y su mutex
+    for (int c = 0; c < numCalendarios; c++) {
+        liberarCalendario(&calendarios[c]);
+    }
+    free(calendarios);
+    calendarios = NULL;
+    numCalendarios = 0;
+    
+    // Cerrar el bucle de eventos
+    if (fdEpoll != -1) {
+        close(fdEpoll);
+        fdEpoll = -1;
+    }
+    if (fdEventoFin != -1) {
+        close(fdEventoFin);
+        fdEventoFin = -1;
+    }
+    
+    // Destruir mutexes
+    pthread_mutex_destroy(&mutexAgentes);
+    pthread_cond_destroy(&lectoresTerminados);
+    pthread_mutex_destroy(&colaPeticiones.mutex);
+    pthread_cond_destroy(&colaPeticiones.noVacia);
+    pthread_cond_destroy(&colaPeticiones.noLlena);
+    pthread_cond_destroy(&colaPeticiones.drenada);
+    free(colaPeticiones.tramas);
+    colaPeticiones.tramas = NULL;
+    pthread_mutex_destroy(&colaAvisos.mutex);
+    pthread_cond_destroy(&colaAvisos.hayAvisos);
+    pthread_mutex_destroy(&mutexMetricas);
+    liberarEtapas();
+}
+
+/* ============================================================================
+ * FUNCIONES DE UTILIDAD
+ * ============================================================================ */
+int validarHora(int hora) {
+    return (hora >= HORAS_MIN && hora <= HORAS_MAX);
+}
+
+int validarFranja(int franja) {
+    return (franja >= 0 && franja < numFranjas);
+}
+
+/* Un minuto es válido si cae dentro del horario y al inicio de una franja. */
+int minutoValido(int minuto) {
+    return (minuto >= MINUTO_APERTURA && minuto < MINUTO_CIERRE &&
+            (minuto - MINUTO_APERTURA) % minutosPorFranja == 0);
+}
+
+int franjaDeMinuto(int minuto) {
+    return (minuto - MINUTO_APERTURA) / minutosPorFranja;
+}
+
+int minutoDeFranja(int franja) {
+    return MINUTO_APERTURA + franja * minutosPorFranja;
 }
\ No newline at end of file
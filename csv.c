@@ -0,0 +1,529 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: csv.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Lectura del archivo de solicitudes del agente
+ * -----------------------------------------------
+ * Descripción:
+ * Implementa el recorrido del CSV proyectado y el hilo
+ * lector declarados en csv.h. El lector llena una cola
+ * circular de BLOQUES_LECTURA bloques; el hilo que
+ * envía consume un bloque completo antes de devolverlo,
+ * así que solo se toma el mutex una vez por bloque.
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "csv.h"
+
+#define TAM_LECTURA 65536  // Bloque de read() si el archivo no se puede proyectar
+
+typedef struct {
+    SolicitudLeida solicitudes[SOLICITUDES_POR_BLOQUE];
+    int cantidad;
+} BloqueSolicitudes;
+
+struct LectorSolicitudes {
+    const char *datos;
+    size_t tamano;
+    int proyectado;  // 1: datos viene de mmap; 0: de malloc
+
+    BloqueSolicitudes bloques[BLOQUES_LECTURA];
+    int siguienteLleno;   // Próximo bloque que llenará el lector
+    int siguienteVacio;   // Próximo bloque que consumirá el hilo que envía
+    int bloquesLlenos;
+    int enConsumo;        // Bloque que se está consumiendo (-1 si ninguno)
+    int posicion;         // Siguiente solicitud del bloque en consumo
+    int terminado;        // El lector llegó al final del archivo
+    int cancelado;        // Se cerró el lector antes de terminar
+
+    pthread_t hilo;
+    pthread_mutex_t mutex;
+    pthread_cond_t hayBloque;
+    pthread_cond_t hayHueco;
+};
+
+/* ============================================================================
+ * RECORRIDO DEL CSV
+ * ============================================================================ */
+static int esEspacio(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/*
+ * Lee un registro desde *cursor y deja *cursor al inicio del siguiente.
+ * Guarda hasta maxCampos campos (numCampos cuenta todos, incluso los que no
+ * caben) y suma a *lineas los saltos de línea consumidos, incluidos los que
+ * hay dentro de comillas. Una línea en blanco es un registro sin campos.
+ * Devuelve 0 si ya no quedan datos.
+ */
+int leerRegistroCSV(const char **cursor, const char *fin, CampoCSV *campos, int maxCampos,
+                    int *numCampos, int *lineas) {
+    const char *p = *cursor;
+    int cuenta = 0;
+    int vacio = 1;  // Hasta ahora solo hay un campo vacío sin comillas
+
+    if (p >= fin) {
+        return 0;
+    }
+
+    for (;;) {
+        CampoCSV campo = {NULL, 0, 0};
+
+        while (p < fin && esEspacio(*p)) {
+            p++;
+        }
+
+        if (p < fin && *p == '"') {
+            // Campo entre comillas: termina en una comilla que no sea ""
+            p++;
+            campo.inicio = p;
+            campo.entreComillas = 1;
+            while (p < fin) {
+                if (*p == '"') {
+                    if (p + 1 < fin && p[1] == '"') {
+                        p += 2;
+                        continue;
+                    }
+                    break;
+                }
+                if (*p == '\n') {
+                    (*lineas)++;
+                }
+                p++;
+            }
+            campo.longitud = (size_t)(p - campo.inicio);
+            if (p < fin) {
+                p++;  // Comilla de cierre
+            }
+            // Lo que siga a la comilla de cierre hasta el separador se descarta
+            while (p < fin && *p != ',' && *p != '\n') {
+                p++;
+            }
+            vacio = 0;
+        } else {
+            campo.inicio = p;
+            while (p < fin && *p != ',' && *p != '\n') {
+                p++;
+            }
+            const char *final = p;
+            while (final > campo.inicio && esEspacio(final[-1])) {
+                final--;
+            }
+            campo.longitud = (size_t)(final - campo.inicio);
+            if (campo.longitud > 0 || (p < fin && *p == ',')) {
+                vacio = 0;
+            }
+        }
+
+        if (cuenta < maxCampos) {
+            campos[cuenta] = campo;
+        }
+        cuenta++;
+
+        if (p < fin && *p == ',') {
+            p++;
+            continue;
+        }
+        if (p < fin) {
+            p++;  // Salto de línea
+            (*lineas)++;
+        }
+        break;
+    }
+
+    *cursor = p;
+    *numCampos = vacio ? 0 : cuenta;
+    return 1;
+}
+
+/*
+ * Copia el campo terminándolo en '\0' y deshaciendo las "" de un campo entre
+ * comillas. Devuelve la longitud completa del valor (como snprintf): si es
+ * mayor o igual que tamDestino, se truncó.
+ */
+size_t copiarCampoCSV(const CampoCSV *campo, char *destino, size_t tamDestino) {
+    size_t escritos = 0;
+    size_t total = 0;
+
+    for (size_t i = 0; i < campo->longitud; i++) {
+        char c = campo->inicio[i];
+        if (campo->entreComillas && c == '"' && i + 1 < campo->longitud && campo->inicio[i + 1] == '"') {
+            i++;
+        }
+        if (escritos + 1 < tamDestino) {
+            destino[escritos++] = c;
+        }
+        total++;
+    }
+    if (tamDestino > 0) {
+        destino[escritos] = '\0';
+    }
+    return total;
+}
+
+/*
+ * Interpreta los dígitos desde *p (con signo opcional si se permite) y avanza
+ * *p. Devuelve 0 si no hay dígitos o el valor no cabe en un int.
+ */
+static int leerEntero(const char **p, const char *fin, int conSigno, int *valor) {
+    const char *q = *p;
+    int negativo = 0;
+    long long acumulado = 0;
+    int digitos = 0;
+    int desborde = 0;
+
+    if (conSigno && q < fin && (*q == '-' || *q == '+')) {
+        negativo = *q == '-';
+        q++;
+    }
+    while (q < fin && *q >= '0' && *q <= '9') {
+        if (acumulado <= INT_MAX) {
+            acumulado = acumulado * 10 + (*q - '0');
+        }
+        if (acumulado > INT_MAX) {
+            desborde = 1;
+        }
+        digitos++;
+        q++;
+    }
+
+    if (desborde) {
+        acumulado = INT_MAX;
+    }
+    *valor = (int)(negativo ? -acumulado : acumulado);
+    *p = q;
+    return digitos > 0 && !desborde;
+}
+
+/*
+ * Convierte un campo entero. Devuelve 1 si el campo entero es un número; si
+ * no, *valor queda con lo que se pudo leer al principio (como atoi).
+ */
+int enteroCampoCSV(const CampoCSV *campo, int *valor) {
+    const char *p = campo->inicio;
+    const char *fin = campo->inicio + campo->longitud;
+    int valido = leerEntero(&p, fin, 1, valor);
+    return valido && p == fin;
+}
+
+/* Convierte una hora "H" o "H:MM" a minutos desde la medianoche; igual que enteroCampoCSV */
+int horaCampoCSV(const CampoCSV *campo, int *minutos) {
+    const char *p = campo->inicio;
+    const char *fin = campo->inicio + campo->longitud;
+    int horas;
+    int valido = leerEntero(&p, fin, 0, &horas);
+
+    if (horas > INT_MAX / MINUTOS_POR_HORA - MINUTOS_POR_HORA) {
+        horas = INT_MAX / MINUTOS_POR_HORA - MINUTOS_POR_HORA;
+        valido = 0;
+    }
+    *minutos = horas * MINUTOS_POR_HORA;
+    if (valido && p < fin && *p == ':') {
+        int mins;
+        p++;
+        valido = leerEntero(&p, fin, 0, &mins) && mins < MINUTOS_POR_HORA;
+        *minutos += mins;
+    }
+    return valido && p == fin;
+}
+
+/* ============================================================================
+ * INTERPRETACIÓN DE SOLICITUDES
+ * ============================================================================ */
+/* Campo numérico: ausente o vacío vale 0 (con aviso si es obligatorio); con basura se marca el aviso */
+static int numeroOpcional(const CampoCSV *campos, int numCampos, int indice,
+                          int esHora, int obligatorio, int *avisos) {
+    int valor = 0;
+
+    if (indice >= numCampos || campos[indice].longitud == 0) {
+        if (obligatorio) {
+            *avisos |= AVISO_CAMPO_INVALIDO;
+        }
+        return 0;
+    }
+    int valido = esHora ? horaCampoCSV(&campos[indice], &valor)
+                        : enteroCampoCSV(&campos[indice], &valor);
+    if (!valido) {
+        *avisos |= AVISO_CAMPO_INVALIDO;
+    }
+    return valor;
+}
+
+/* 1 si el campo es exactamente la palabra dada */
+static int campoEs(const CampoCSV *campo, const char *palabra) {
+    size_t longitud = strlen(palabra);
+    return campo->longitud == longitud && memcmp(campo->inicio, palabra, longitud) == 0;
+}
+
+/*
+ * Formato: familia,hora,personas[,dia[,parque]]. Si el segundo campo es
+ * "cancelar" o "modificar" la línea cambia la última reserva de la familia:
+ * familia,cancelar o familia,modificar,hora,personas (el día y el parque son
+ * los de la reserva).
+ */
+static void interpretarRegistro(const CampoCSV *campos, int numCampos, int numLinea,
+                                SolicitudLeida *sol) {
+    int maxCampos = 5;
+
+    sol->numLinea = numLinea;
+    sol->operacion = MSG_SOLICITUD_RESERVA;
+    sol->avisos = 0;
+
+    if (copiarCampoCSV(&campos[0], sol->nombreFamilia, MAX_NOMBRE) >= MAX_NOMBRE) {
+        sol->avisos |= AVISO_NOMBRE_TRUNCADO;
+    }
+    if (numCampos > 1 && (campoEs(&campos[1], "cancelar") || campoEs(&campos[1], "modificar"))) {
+        sol->operacion = campoEs(&campos[1], "cancelar") ? MSG_CANCELAR : MSG_MODIFICAR;
+        maxCampos = sol->operacion == MSG_CANCELAR ? 2 : 4;
+        sol->horaSolicitada = numeroOpcional(campos, numCampos, 2, 1, maxCampos > 2, &sol->avisos);
+        sol->numPersonas = numeroOpcional(campos, numCampos, 3, 0, maxCampos > 2, &sol->avisos);
+        sol->dia = 0;
+        sol->parque = 0;
+    } else if (numCampos > 1 && campoEs(&campos[1], "consultar")) {
+        sol->operacion = MSG_CONSULTA_DISPONIBILIDAD;
+        maxCampos = 4;
+        sol->horaSolicitada = 0;
+        sol->numPersonas = 0;
+        sol->dia = numeroOpcional(campos, numCampos, 2, 0, 0, &sol->avisos);
+        sol->parque = numeroOpcional(campos, numCampos, 3, 0, 0, &sol->avisos);
+    } else {
+        sol->horaSolicitada = numeroOpcional(campos, numCampos, 1, 1, 1, &sol->avisos);
+        sol->numPersonas = numeroOpcional(campos, numCampos, 2, 0, 1, &sol->avisos);
+        sol->dia = numeroOpcional(campos, numCampos, 3, 0, 0, &sol->avisos);
+        sol->parque = numeroOpcional(campos, numCampos, 4, 0, 0, &sol->avisos);
+    }
+    if (numCampos > maxCampos) {
+        sol->avisos |= AVISO_CAMPOS_DE_MAS;
+    }
+}
+
+/* ============================================================================
+ * HILO LECTOR
+ * ============================================================================ */
+/* Entrega el bloque lleno; devuelve 0 si el lector se canceló */
+static int publicarBloque(LectorSolicitudes *lector) {
+    pthread_mutex_lock(&lector->mutex);
+    lector->siguienteLleno = (lector->siguienteLleno + 1) % BLOQUES_LECTURA;
+    lector->bloquesLlenos++;
+    pthread_cond_signal(&lector->hayBloque);
+    while (lector->bloquesLlenos == BLOQUES_LECTURA && !lector->cancelado) {
+        pthread_cond_wait(&lector->hayHueco, &lector->mutex);
+    }
+    int seguir = !lector->cancelado;
+    pthread_mutex_unlock(&lector->mutex);
+    return seguir;
+}
+
+static void *hiloLectorArchivo(void *arg) {
+    LectorSolicitudes *lector = arg;
+    const char *cursor = lector->datos;
+    const char *fin = lector->datos + lector->tamano;
+    CampoCSV campos[MAX_CAMPOS_CSV];
+    int numCampos;
+    int lineas = 0;
+    int seguir = 1;
+
+    // El bloque siguienteLleno siempre está libre: el lector solo escribe en él
+    BloqueSolicitudes *bloque = &lector->bloques[lector->siguienteLleno];
+    bloque->cantidad = 0;
+
+    while (seguir) {
+        int numLinea = lineas + 1;
+        if (!leerRegistroCSV(&cursor, fin, campos, MAX_CAMPOS_CSV, &numCampos, &lineas)) {
+            break;
+        }
+        if (numCampos == 0) {
+            continue;  // Línea vacía
+        }
+
+        interpretarRegistro(campos, numCampos, numLinea, &bloque->solicitudes[bloque->cantidad++]);
+        if (bloque->cantidad == SOLICITUDES_POR_BLOQUE) {
+            seguir = publicarBloque(lector);
+            bloque = &lector->bloques[lector->siguienteLleno];
+            bloque->cantidad = 0;
+        }
+    }
+
+    pthread_mutex_lock(&lector->mutex);
+    if (bloque->cantidad > 0 && !lector->cancelado) {
+        lector->siguienteLleno = (lector->siguienteLleno + 1) % BLOQUES_LECTURA;
+        lector->bloquesLlenos++;
+    }
+    lector->terminado = 1;
+    pthread_cond_signal(&lector->hayBloque);
+    pthread_mutex_unlock(&lector->mutex);
+    return NULL;
+}
+
+/* ============================================================================
+ * APERTURA Y CONSUMO
+ * ============================================================================ */
+/* Lee completo un archivo que no se puede proyectar (por ejemplo, un pipe) */
+static int cargarArchivo(int fd, LectorSolicitudes *lector) {
+    char *datos = NULL;
+    size_t tamano = 0;
+    size_t capacidad = 0;
+
+    for (;;) {
+        if (capacidad - tamano < TAM_LECTURA) {
+            capacidad = capacidad ? capacidad * 2 : TAM_LECTURA;
+            char *nuevo = realloc(datos, capacidad);
+            if (nuevo == NULL) {
+                free(datos);
+                return 0;
+            }
+            datos = nuevo;
+        }
+        ssize_t leidos = read(fd, datos + tamano, capacidad - tamano);
+        if (leidos == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(datos);
+            return 0;
+        }
+        if (leidos == 0) {
+            break;
+        }
+        tamano += (size_t)leidos;
+    }
+
+    lector->datos = datos;
+    lector->tamano = tamano;
+    lector->proyectado = 0;
+    return 1;
+}
+
+static void liberarDatos(LectorSolicitudes *lector) {
+    if (!lector->proyectado) {
+        free((void *)lector->datos);
+    } else if (lector->tamano > 0) {
+        munmap((void *)lector->datos, lector->tamano);
+    }
+}
+
+/*
+ * Proyecta el archivo y arranca el hilo lector. Devuelve NULL con errno si
+ * el archivo no se puede abrir o leer.
+ */
+LectorSolicitudes *abrirSolicitudes(const char *ruta) {
+    struct stat info;
+    int error;
+
+    int fd = open(ruta, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    LectorSolicitudes *lector = calloc(1, sizeof(LectorSolicitudes));
+    if (lector == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        lector->tamano = (size_t)info.st_size;
+        lector->proyectado = 1;
+        if (lector->tamano > 0) {
+            void *datos = mmap(NULL, lector->tamano, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (datos == MAP_FAILED) {
+                goto fallo;
+            }
+            posix_madvise(datos, lector->tamano, POSIX_MADV_SEQUENTIAL);
+            lector->datos = datos;
+        }
+    } else if (!cargarArchivo(fd, lector)) {
+        goto fallo;
+    }
+    close(fd);
+
+    lector->enConsumo = -1;
+    pthread_mutex_init(&lector->mutex, NULL);
+    pthread_cond_init(&lector->hayBloque, NULL);
+    pthread_cond_init(&lector->hayHueco, NULL);
+    if (pthread_create(&lector->hilo, NULL, hiloLectorArchivo, lector) != 0) {
+        pthread_mutex_destroy(&lector->mutex);
+        pthread_cond_destroy(&lector->hayBloque);
+        pthread_cond_destroy(&lector->hayHueco);
+        liberarDatos(lector);
+        free(lector);
+        errno = EAGAIN;
+        return NULL;
+    }
+    return lector;
+
+fallo:
+    error = errno;
+    close(fd);
+    free(lector);
+    errno = error;
+    return NULL;
+}
+
+/*
+ * Siguiente solicitud del archivo, en orden, o NULL al final. El puntero es
+ * válido hasta la siguiente llamada.
+ */
+const SolicitudLeida *siguienteSolicitud(LectorSolicitudes *lector) {
+    if (lector->enConsumo != -1) {
+        BloqueSolicitudes *bloque = &lector->bloques[lector->enConsumo];
+        if (lector->posicion < bloque->cantidad) {
+            return &bloque->solicitudes[lector->posicion++];
+        }
+    }
+
+    pthread_mutex_lock(&lector->mutex);
+    if (lector->enConsumo != -1) {
+        // Devolver el bloque agotado al lector
+        lector->siguienteVacio = (lector->siguienteVacio + 1) % BLOQUES_LECTURA;
+        lector->bloquesLlenos--;
+        lector->enConsumo = -1;
+        pthread_cond_signal(&lector->hayHueco);
+    }
+    while (lector->bloquesLlenos == 0 && !lector->terminado) {
+        pthread_cond_wait(&lector->hayBloque, &lector->mutex);
+    }
+    if (lector->bloquesLlenos > 0) {
+        lector->enConsumo = lector->siguienteVacio;
+        lector->posicion = 0;
+    }
+    pthread_mutex_unlock(&lector->mutex);
+
+    if (lector->enConsumo == -1) {
+        return NULL;
+    }
+    return &lector->bloques[lector->enConsumo].solicitudes[lector->posicion++];
+}
+
+/* Detiene el hilo lector (aunque no haya terminado) y libera el archivo */
+void cerrarSolicitudes(LectorSolicitudes *lector) {
+    if (lector == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&lector->mutex);
+    lector->cancelado = 1;
+    pthread_cond_signal(&lector->hayHueco);
+    pthread_mutex_unlock(&lector->mutex);
+    pthread_join(lector->hilo, NULL);
+
+    liberarDatos(lector);
+    pthread_mutex_destroy(&lector->mutex);
+    pthread_cond_destroy(&lector->hayBloque);
+    pthread_cond_destroy(&lector->hayHueco);
+    free(lector);
+}
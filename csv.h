@@ -0,0 +1,81 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: csv.h
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Lectura del archivo de solicitudes del agente
+ * -----------------------------------------------
+ * Descripción:
+ * El archivo de solicitudes se proyecta en memoria con
+ * mmap y se recorre en su sitio: cada campo es un trozo
+ * del archivo (inicio y longitud), sin copiar líneas ni
+ * límite de longitud. Admite campos entre comillas
+ * dobles (con comas, saltos de línea y "" como comilla
+ * literal), espacios alrededor de los campos y fines de
+ * línea CRLF. Un hilo lector convierte los registros en
+ * solicitudes y las deja en bloques para el hilo que
+ * envía, de modo que leer el archivo se solapa con el
+ * envío en lugar de ir por delante de él.
+ *****************************************************/
+
+#ifndef CSV_H
+#define CSV_H
+
+#include <stddef.h>
+#include "protocolo.h"
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define MAX_CAMPOS_CSV 8             // Campos que se conservan por registro
+#define SOLICITUDES_POR_BLOQUE 256   // Solicitudes que el lector entrega de una vez
+#define BLOQUES_LECTURA 4            // Bloques que el lector puede adelantar
+
+/* Avisos sobre una solicitud leída (se combinan con |) */
+#define AVISO_NOMBRE_TRUNCADO 0x01   // La familia no cabía en MAX_NOMBRE
+#define AVISO_CAMPO_INVALIDO  0x02   // Hora, personas, día o parque no es un número
+#define AVISO_CAMPOS_DE_MAS   0x04   // La línea tiene más campos de los de su formato
+
+/* Campo de un registro: apunta al archivo proyectado, no se copia */
+typedef struct {
+    const char *inicio;
+    size_t longitud;
+    int entreComillas;  // Las "" del interior deben convertirse en "
+} CampoCSV;
+
+/*
+ * Solicitud interpretada: familia,hora,personas[,dia[,parque]], o bien
+ * familia,cancelar y familia,modificar,hora,personas para la última reserva
+ * aprobada de la familia, o familia,consultar[,dia[,parque]] para ver las
+ * plazas libres por franja sin reservar
+ */
+typedef struct {
+    int numLinea;  // Línea del archivo donde empieza el registro
+    TipoMensaje operacion;  // MSG_SOLICITUD_RESERVA, MSG_CANCELAR, MSG_MODIFICAR o MSG_CONSULTA_DISPONIBILIDAD
+    char nombreFamilia[MAX_NOMBRE];
+    int horaSolicitada;  // Minutos desde la medianoche
+    int numPersonas;
+    int dia;
+    int parque;
+    int avisos;
+} SolicitudLeida;
+
+typedef struct LectorSolicitudes LectorSolicitudes;
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+int leerRegistroCSV(const char **cursor, const char *fin, CampoCSV *campos, int maxCampos,
+                    int *numCampos, int *lineas);
+size_t copiarCampoCSV(const CampoCSV *campo, char *destino, size_t tamDestino);
+int enteroCampoCSV(const CampoCSV *campo, int *valor);
+int horaCampoCSV(const CampoCSV *campo, int *minutos);
+
+LectorSolicitudes *abrirSolicitudes(const char *ruta);
+const SolicitudLeida *siguienteSolicitud(LectorSolicitudes *lector);
+void cerrarSolicitudes(LectorSolicitudes *lector);
+
+#endif
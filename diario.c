@@ -0,0 +1,720 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: diario.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Diario de reservas e instantáneas del controlador
+ * -----------------------------------------------
+ * Descripción:
+ * Implementa el diario de solo agregado, su hilo
+ * escritor con confirmación en grupo, las instantáneas
+ * y la recuperación declarados en diario.h. Las
+ * anotaciones del diario se codifican campo a campo en
+ * little-endian y llevan una suma de comprobación, de
+ * modo que una anotación a medio escribir al caerse el
+ * controlador se detecta y se descarta. La instantánea
+ * se guarda con la misma disposición que en memoria
+ * para poder leerla directamente de la proyección.
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "protocolo.h"
+#include "diario.h"
+
+#define MAX_ANOTACION (8 + 19 + 2 * MAX_NOMBRE)  // Prefijo, campos fijos y dos cadenas
+
+/* Cabecera del diario: se escribe al crearlo y al vaciarlo tras una instantánea */
+typedef struct {
+    char magia[4];  // "RSVD"
+    uint32_t version;
+    ConfiguracionDiario config;
+} CabeceraDiario;
+
+/* Cabecera de la instantánea, seguida de las reservas y del área de cadenas */
+typedef struct {
+    char magia[4];  // "RSVI"
+    uint32_t version;
+    ConfiguracionDiario config;
+    uint32_t numReservas;
+    uint32_t tamCadenas;
+    uint64_t secuencia;  // Las anotaciones del diario hasta aquí ya están incluidas
+} CabeceraInstantanea;
+
+/* ============================================================================
+ * ESTADO DEL DIARIO
+ * ============================================================================ */
+static char rutaDiario[PATH_MAX];
+static char rutaInstantanea[PATH_MAX];
+static char rutaTemporal[PATH_MAX];
+static int fdDiario = -1;
+static ConfiguracionDiario configuracion;
+static CapturarEstado capturarEstado = NULL;
+static pthread_t tidEscritor;
+
+// Anotaciones aún no escritas y secuencias asignadas y durables (protegidas por mutexDiario)
+static uint8_t *pendiente = NULL;
+static size_t tamPendiente = 0;
+static size_t capacidadPendiente = 0;
+static uint64_t ultimaSecuencia = 0;
+static uint64_t secuenciaDurable = 0;
+static uint64_t anotacionesDesdeInstantanea = 0;
+static int cerrando = 0;
+static pthread_mutex_t mutexDiario = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hayPendientes = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t hayConfirmadas = PTHREAD_COND_INITIALIZER;
+
+// Última anotación del hilo actual que aún debe esperar (0 = ninguna)
+static _Thread_local uint64_t anotacionHilo = 0;
+
+static void *hiloEscritor(void *arg);
+static void tomarInstantanea();
+static void abortarDiario(const char *mensaje);
+
+/* ============================================================================
+ * CODIFICACIÓN DE ANOTACIONES
+ * ============================================================================ */
+static uint8_t *escribirU16(uint8_t *p, uint16_t valor) {
+    p[0] = (uint8_t)(valor & 0xFF);
+    p[1] = (uint8_t)(valor >> 8);
+    return p + 2;
+}
+
+static uint8_t *escribirU32(uint8_t *p, uint32_t valor) {
+    p[0] = (uint8_t)(valor & 0xFF);
+    p[1] = (uint8_t)((valor >> 8) & 0xFF);
+    p[2] = (uint8_t)((valor >> 16) & 0xFF);
+    p[3] = (uint8_t)(valor >> 24);
+    return p + 4;
+}
+
+static uint8_t *escribirCadena(uint8_t *p, const char *cadena) {
+    size_t longitud = strnlen(cadena, MAX_NOMBRE - 1);
+    *p++ = (uint8_t)longitud;
+    memcpy(p, cadena, longitud);
+    return p + longitud;
+}
+
+static uint16_t leerU16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t leerU32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int leerCadena(const uint8_t **p, const uint8_t *fin, char *destino) {
+    if (*p >= fin) {
+        return 0;
+    }
+    size_t longitud = **p;
+    (*p)++;
+    if (longitud > MAX_NOMBRE - 1 || (size_t)(fin - *p) < longitud) {
+        return 0;
+    }
+    memcpy(destino, *p, longitud);
+    destino[longitud] = '\0';
+    *p += longitud;
+    return 1;
+}
+
+/* Suma FNV-1a del cuerpo de una anotación */
+static uint32_t sumaComprobacion(const uint8_t *datos, size_t longitud) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < longitud; i++) {
+        hash = (hash ^ datos[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/*
+ * Codifica una anotación: longitud del cuerpo, suma y cuerpo (secuencia,
+ * día, parque, franja, personas, tipo, índice y los dos nombres). Devuelve su
+ * tamaño.
+ */
+static size_t codificarAnotacion(uint8_t *destino, uint64_t secuencia, const AnotacionReserva *anotacion) {
+    uint8_t *cuerpo = destino + 8;
+    uint8_t *p = cuerpo;
+
+    p = escribirU32(p, (uint32_t)(secuencia & 0xFFFFFFFFu));
+    p = escribirU32(p, (uint32_t)(secuencia >> 32));
+    *p++ = (uint8_t)anotacion->dia;
+    *p++ = (uint8_t)anotacion->parque;
+    p = escribirU16(p, (uint16_t)anotacion->franjaInicio);
+    p = escribirU16(p, (uint16_t)anotacion->numPersonas);
+    *p++ = (uint8_t)anotacion->tipo;
+    p = escribirU32(p, (uint32_t)anotacion->indice);
+    p = escribirCadena(p, anotacion->familia);
+    p = escribirCadena(p, anotacion->agente);
+
+    size_t longitud = (size_t)(p - cuerpo);
+    escribirU32(destino, (uint32_t)longitud);
+    escribirU32(destino + 4, sumaComprobacion(cuerpo, longitud));
+    return 8 + longitud;
+}
+
+/* ============================================================================
+ * ARCHIVOS
+ * ============================================================================ */
+static int escribirTodo(int fd, const void *datos, size_t longitud) {
+    const uint8_t *p = datos;
+    while (longitud > 0) {
+        ssize_t escritos = write(fd, p, longitud);
+        if (escritos == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        p += escritos;
+        longitud -= (size_t)escritos;
+    }
+    return 1;
+}
+
+/*
+ * Falla al hacer durable una anotación: sus reservas no pueden confirmarse.
+ * Tras un fdatasync fallido el kernel puede haber descartado las páginas
+ * sucias, así que reintentar no garantiza nada; el controlador termina sin
+ * avanzar secuenciaDurable, de modo que ningún trabajador llega a responder
+ * lo que no quedó escrito, y el próximo arranque recupera lo que sí.
+ */
+static void abortarDiario(const char *mensaje) {
+    perror(mensaje);
+    exit(EXIT_FAILURE);
+}
+
+/* Hace durable un rename: sincroniza el directorio que contiene la ruta */
+static void sincronizarDirectorio(const char *ruta) {
+    char directorio[PATH_MAX];
+
+    strncpy(directorio, ruta, sizeof(directorio) - 1);
+    directorio[sizeof(directorio) - 1] = '\0';
+    char *barra = strrchr(directorio, '/');
+    if (barra == NULL) {
+        strcpy(directorio, ".");
+    } else if (barra == directorio) {
+        barra[1] = '\0';
+    } else {
+        *barra = '\0';
+    }
+
+    int fd = open(directorio, O_RDONLY);
+    if (fd != -1) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+static void llenarCabeceraDiario(CabeceraDiario *cabecera) {
+    memset(cabecera, 0, sizeof(*cabecera));
+    memcpy(cabecera->magia, "RSVD", 4);
+    cabecera->version = DIARIO_VERSION;
+    cabecera->config = configuracion;
+}
+
+/* ============================================================================
+ * RECUPERACIÓN
+ * ============================================================================ */
+/*
+ * Reaplica las reservas de la instantánea (si existe) leyéndolas de su
+ * proyección. Devuelve cuántas aplicó o -1 si no corresponde a esta
+ * configuración.
+ */
+static long recuperarInstantanea(AplicarAnotacion aplicar, uint64_t *secuencia) {
+    struct stat info;
+
+    *secuencia = 0;
+    int fd = open(rutaInstantanea, O_RDONLY);
+    if (fd == -1) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        perror("Error al abrir la instantánea");
+        return -1;
+    }
+    if (fstat(fd, &info) == -1 || (size_t)info.st_size < sizeof(CabeceraInstantanea)) {
+        fprintf(stderr, "Error: la instantánea %s está incompleta\n", rutaInstantanea);
+        close(fd);
+        return -1;
+    }
+
+    const uint8_t *mapa = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapa == MAP_FAILED) {
+        perror("Error al proyectar la instantánea");
+        return -1;
+    }
+
+    const CabeceraInstantanea *cabecera = (const CabeceraInstantanea *)mapa;
+    const ReservaInstantanea *reservas = (const ReservaInstantanea *)(mapa + sizeof(CabeceraInstantanea));
+    const char *cadenas = (const char *)(reservas + cabecera->numReservas);
+    long aplicadas = -1;
+
+    if (memcmp(cabecera->magia, "RSVI", 4) != 0 || cabecera->version != DIARIO_VERSION ||
+        (size_t)info.st_size != sizeof(CabeceraInstantanea) +
+                                (size_t)cabecera->numReservas * sizeof(ReservaInstantanea) +
+                                cabecera->tamCadenas ||
+        (cabecera->tamCadenas > 0 && cadenas[cabecera->tamCadenas - 1] != '\0')) {
+        fprintf(stderr, "Error: %s no es una instantánea válida\n", rutaInstantanea);
+    } else if (memcmp(&cabecera->config, &configuracion, sizeof(configuracion)) != 0) {
+        fprintf(stderr, "Error: la instantánea %s se tomó con otra configuración (-m, -d, -t, -D, -P)\n",
+                rutaInstantanea);
+    } else {
+        aplicadas = 0;
+        for (uint32_t i = 0; i < cabecera->numReservas; i++) {
+            const ReservaInstantanea *r = &reservas[i];
+            if (r->familia >= cabecera->tamCadenas || r->agente >= cabecera->tamCadenas) {
+                continue;
+            }
+            AnotacionReserva anotacion = {
+                .tipo = r->cancelada ? ANOTACION_RESERVA_CANCELADA : ANOTACION_RESERVA,
+                .dia = r->dia, .parque = r->parque,
+                .franjaInicio = r->franjaInicio, .numPersonas = r->numPersonas,
+                .familia = cadenas + r->familia, .agente = cadenas + r->agente
+            };
+            aplicar(&anotacion);
+            aplicadas++;
+        }
+        *secuencia = cabecera->secuencia;
+    }
+
+    munmap((void *)mapa, (size_t)info.st_size);
+    return aplicadas;
+}
+
+/*
+ * Reaplica las anotaciones del diario posteriores a la instantánea y lo deja
+ * abierto para agregar. Una cola a medio escribir (o dañada) se recorta.
+ * Devuelve cuántas aplicó o -1 si el diario no corresponde.
+ */
+static long recuperarDiario(AplicarAnotacion aplicar, uint64_t secuenciaInstantanea, uint64_t *ultima) {
+    struct stat info;
+    CabeceraDiario cabecera;
+    long aplicadas = 0;
+
+    *ultima = secuenciaInstantanea;
+    int fd = open(rutaDiario, O_RDWR | O_CREAT, 0644);
+    if (fd == -1 || fstat(fd, &info) == -1) {
+        perror("Error al abrir el diario de reservas");
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    // Diario nuevo: solo la cabecera
+    llenarCabeceraDiario(&cabecera);
+    if (info.st_size == 0) {
+        if (!escribirTodo(fd, &cabecera, sizeof(cabecera)) || fsync(fd) == -1) {
+            perror("Error al crear el diario de reservas");
+            close(fd);
+            return -1;
+        }
+        sincronizarDirectorio(rutaDiario);
+    } else {
+        if ((size_t)info.st_size < sizeof(cabecera)) {
+            fprintf(stderr, "Error: %s no es un diario de reservas\n", rutaDiario);
+            close(fd);
+            return -1;
+        }
+        const uint8_t *mapa = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapa == MAP_FAILED) {
+            perror("Error al proyectar el diario de reservas");
+            close(fd);
+            return -1;
+        }
+
+        const CabeceraDiario *leida = (const CabeceraDiario *)mapa;
+        if (memcmp(leida->magia, "RSVD", 4) != 0 || leida->version != DIARIO_VERSION) {
+            fprintf(stderr, "Error: %s no es un diario de reservas\n", rutaDiario);
+            aplicadas = -1;
+        } else if (memcmp(&leida->config, &configuracion, sizeof(configuracion)) != 0) {
+            fprintf(stderr, "Error: el diario %s se escribió con otra configuración (-m, -d, -t, -D, -P)\n",
+                    rutaDiario);
+            aplicadas = -1;
+        }
+
+        // Recorrer las anotaciones hasta la primera incompleta o dañada
+        size_t posicion = sizeof(cabecera);
+        while (aplicadas != -1 && (size_t)info.st_size - posicion >= 8) {
+            const uint8_t *p = mapa + posicion;
+            uint32_t longitud = leerU32(p);
+            if (longitud < 19 || longitud > MAX_ANOTACION - 8 || (size_t)info.st_size - posicion - 8 < longitud ||
+                sumaComprobacion(p + 8, longitud) != leerU32(p + 4)) {
+                break;
+            }
+
+            const uint8_t *cuerpo = p + 8;
+            const uint8_t *fin = cuerpo + longitud;
+            char familia[MAX_NOMBRE];
+            char agente[MAX_NOMBRE];
+            uint64_t secuencia = leerU32(cuerpo) | ((uint64_t)leerU32(cuerpo + 4) << 32);
+            AnotacionReserva anotacion = {
+                .tipo = (TipoAnotacion)cuerpo[14], .indice = (int)leerU32(cuerpo + 15),
+                .dia = cuerpo[8], .parque = cuerpo[9],
+                .franjaInicio = leerU16(cuerpo + 10), .numPersonas = leerU16(cuerpo + 12),
+                .familia = familia, .agente = agente
+            };
+            const uint8_t *cadenas = cuerpo + 19;
+            if (!leerCadena(&cadenas, fin, familia) || !leerCadena(&cadenas, fin, agente)) {
+                break;
+            }
+
+            // Las anteriores a la instantánea ya están en ella (caída antes de vaciar el diario)
+            if (secuencia > secuenciaInstantanea) {
+                aplicar(&anotacion);
+                aplicadas++;
+            }
+            if (secuencia > *ultima) {
+                *ultima = secuencia;
+            }
+            posicion += 8 + longitud;
+        }
+
+        munmap((void *)mapa, (size_t)info.st_size);
+        if (aplicadas != -1 && posicion < (size_t)info.st_size) {
+            fprintf(stderr, "Diario: se descartan %zu bytes de una anotación incompleta\n",
+                    (size_t)info.st_size - posicion);
+            if (ftruncate(fd, (off_t)posicion) == -1) {
+                perror("Error al recortar el diario de reservas");
+                aplicadas = -1;
+            }
+        }
+        if (aplicadas == -1) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    // A partir de aquí solo se agrega al final
+    close(fd);
+    fdDiario = open(rutaDiario, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fdDiario == -1) {
+        perror("Error al abrir el diario de reservas");
+        return -1;
+    }
+    return aplicadas;
+}
+
+/* ============================================================================
+ * APERTURA Y CIERRE
+ * ============================================================================ */
+/*
+ * Recupera el estado guardado en ruta (instantánea en ruta.instantanea y
+ * diario en ruta) llamando a aplicar por cada reserva, y arranca el hilo
+ * escritor. Devuelve cuántas reservas se recuperaron o -1 si falla.
+ */
+long abrirDiario(const char *ruta, const ConfiguracionDiario *config,
+                 AplicarAnotacion aplicar, CapturarEstado capturar) {
+    uint64_t secuenciaInstantanea;
+    uint64_t ultima;
+
+    if (snprintf(rutaDiario, sizeof(rutaDiario), "%s", ruta) >= (int)sizeof(rutaDiario) ||
+        snprintf(rutaInstantanea, sizeof(rutaInstantanea), "%s.instantanea", ruta) >= (int)sizeof(rutaInstantanea) ||
+        snprintf(rutaTemporal, sizeof(rutaTemporal), "%s.instantanea.tmp", ruta) >= (int)sizeof(rutaTemporal)) {
+        fprintf(stderr, "Error: la ruta del diario es demasiado larga\n");
+        return -1;
+    }
+    configuracion = *config;
+    capturarEstado = capturar;
+
+    long deInstantanea = recuperarInstantanea(aplicar, &secuenciaInstantanea);
+    if (deInstantanea == -1) {
+        return -1;
+    }
+    long deDiario = recuperarDiario(aplicar, secuenciaInstantanea, &ultima);
+    if (deDiario == -1) {
+        return -1;
+    }
+
+    ultimaSecuencia = secuenciaDurable = ultima;
+    anotacionesDesdeInstantanea = (uint64_t)deDiario;
+    cerrando = 0;
+    if (pthread_create(&tidEscritor, NULL, hiloEscritor, NULL) != 0) {
+        perror("Error al crear hilo escritor del diario");
+        close(fdDiario);
+        fdDiario = -1;
+        return -1;
+    }
+    return deInstantanea + deDiario;
+}
+
+/*
+ * Vuelca lo pendiente, termina el hilo escritor y, si el diario tiene
+ * anotaciones, toma una última instantánea para que el próximo arranque solo
+ * proyecte un archivo. Requiere que ya no se admitan reservas.
+ */
+void cerrarDiario() {
+    if (fdDiario == -1) {
+        return;
+    }
+
+    pthread_mutex_lock(&mutexDiario);
+    cerrando = 1;
+    pthread_cond_signal(&hayPendientes);
+    pthread_mutex_unlock(&mutexDiario);
+    pthread_join(tidEscritor, NULL);
+
+    if (anotacionesDesdeInstantanea > 0) {
+        tomarInstantanea();
+    }
+
+    close(fdDiario);
+    fdDiario = -1;
+    free(pendiente);
+    pendiente = NULL;
+    tamPendiente = capacidadPendiente = 0;
+}
+
+int diarioActivo() {
+    return fdDiario != -1;
+}
+
+/* ============================================================================
+ * ANOTACIÓN Y CONFIRMACIÓN EN GRUPO
+ * ============================================================================ */
+/*
+ * Anota una reserva recién admitida. Se llama con el mutex de su calendario
+ * tomado, de modo que el orden del diario respeta el de las admisiones; solo
+ * copia en memoria: la escritura la hace el hilo escritor.
+ */
+void anotarReserva(const AnotacionReserva *anotacion) {
+    if (fdDiario == -1) {
+        return;
+    }
+
+    pthread_mutex_lock(&mutexDiario);
+    if (tamPendiente + MAX_ANOTACION > capacidadPendiente) {
+        size_t capacidad = capacidadPendiente ? capacidadPendiente * 2 : 16 * MAX_ANOTACION;
+        uint8_t *nuevo = realloc(pendiente, capacidad);
+        if (nuevo == NULL) {
+            perror("Error al reservar memoria para el diario");
+            exit(EXIT_FAILURE);
+        }
+        pendiente = nuevo;
+        capacidadPendiente = capacidad;
+    }
+    anotacionHilo = ++ultimaSecuencia;
+    tamPendiente += codificarAnotacion(pendiente + tamPendiente, ultimaSecuencia, anotacion);
+    anotacionesDesdeInstantanea++;
+    pthread_cond_signal(&hayPendientes);
+    pthread_mutex_unlock(&mutexDiario);
+}
+
+/* Espera a que las anotaciones del hilo actual sean durables (antes de responder) */
+void esperarDiario() {
+    if (fdDiario == -1 || anotacionHilo == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&mutexDiario);
+    while (secuenciaDurable < anotacionHilo) {
+        pthread_cond_wait(&hayConfirmadas, &mutexDiario);
+    }
+    pthread_mutex_unlock(&mutexDiario);
+    anotacionHilo = 0;
+}
+
+/*
+ * Hilo escritor: toma todas las anotaciones acumuladas y las hace durables
+ * con una escritura y un fdatasync. Mientras sincroniza se acumulan las
+ * siguientes, que salen juntas en la próxima vuelta.
+ */
+static void *hiloEscritor(void *arg) {
+    (void)arg;
+    uint8_t *lote = NULL;
+    size_t capacidadLote = 0;
+
+    pthread_mutex_lock(&mutexDiario);
+    for (;;) {
+        while (tamPendiente == 0 && !cerrando) {
+            pthread_cond_wait(&hayPendientes, &mutexDiario);
+        }
+
+        // El diario creció lo suficiente: pasarlo a una instantánea
+        if (!cerrando && anotacionesDesdeInstantanea >= UMBRAL_INSTANTANEA && capturarEstado != NULL) {
+            pthread_mutex_unlock(&mutexDiario);
+            tomarInstantanea();
+            pthread_mutex_lock(&mutexDiario);
+            continue;
+        }
+        if (tamPendiente == 0) {
+            break;  // Cerrando y sin nada pendiente
+        }
+
+        // Intercambiar buffers: las nuevas anotaciones van al que quedó libre
+        uint8_t *datos = pendiente;
+        size_t tam = tamPendiente;
+        size_t capacidad = capacidadPendiente;
+        pendiente = lote;
+        capacidadPendiente = capacidadLote;
+        tamPendiente = 0;
+        lote = datos;
+        capacidadLote = capacidad;
+        uint64_t hasta = ultimaSecuencia;
+        pthread_mutex_unlock(&mutexDiario);
+
+        if (!escribirTodo(fdDiario, lote, tam) || fdatasync(fdDiario) == -1) {
+            abortarDiario("Error al escribir el diario de reservas");
+        }
+
+        pthread_mutex_lock(&mutexDiario);
+        secuenciaDurable = hasta;
+        pthread_cond_broadcast(&hayConfirmadas);
+    }
+    pthread_mutex_unlock(&mutexDiario);
+
+    free(lote);
+    return NULL;
+}
+
+/* ============================================================================
+ * INSTANTÁNEAS
+ * ============================================================================ */
+/*
+ * Llamada desde capturarEstado con las admisiones detenidas: las anotaciones
+ * pendientes quedan cubiertas por la instantánea y no se escriben en el
+ * diario (salvo que la instantánea falle).
+ */
+void cortarDiario(Instantanea *instantanea) {
+    pthread_mutex_lock(&mutexDiario);
+    instantanea->secuencia = ultimaSecuencia;
+    instantanea->diarioPendiente = pendiente;
+    instantanea->tamPendiente = tamPendiente;
+    pendiente = NULL;
+    tamPendiente = capacidadPendiente = 0;
+    pthread_mutex_unlock(&mutexDiario);
+}
+
+/* Agrega una cadena (con su '\0') al área de cadenas; devuelve su desplazamiento */
+uint32_t agregarCadenaInstantanea(Instantanea *instantanea, const char *cadena) {
+    size_t longitud = strlen(cadena) + 1;
+
+    if (instantanea->tamCadenas + longitud > instantanea->capacidadCadenas) {
+        uint32_t capacidad = instantanea->capacidadCadenas ? instantanea->capacidadCadenas : 4096;
+        while (capacidad < instantanea->tamCadenas + longitud) {
+            capacidad *= 2;
+        }
+        char *nuevas = realloc(instantanea->cadenas, capacidad);
+        if (nuevas == NULL) {
+            perror("Error al reservar memoria para la instantánea");
+            exit(EXIT_FAILURE);
+        }
+        instantanea->cadenas = nuevas;
+        instantanea->capacidadCadenas = capacidad;
+    }
+
+    uint32_t desplazamiento = instantanea->tamCadenas;
+    memcpy(instantanea->cadenas + desplazamiento, cadena, longitud);
+    instantanea->tamCadenas += (uint32_t)longitud;
+    return desplazamiento;
+}
+
+void agregarReservaInstantanea(Instantanea *instantanea, int dia, int parque, int franjaInicio,
+                               int numPersonas, int cancelada, uint32_t familia, uint32_t agente) {
+    if (instantanea->numReservas == instantanea->capacidadReservas) {
+        uint32_t capacidad = instantanea->capacidadReservas ? instantanea->capacidadReservas * 2 : 1024;
+        ReservaInstantanea *nuevas = realloc(instantanea->reservas, sizeof(ReservaInstantanea) * capacidad);
+        if (nuevas == NULL) {
+            perror("Error al reservar memoria para la instantánea");
+            exit(EXIT_FAILURE);
+        }
+        instantanea->reservas = nuevas;
+        instantanea->capacidadReservas = capacidad;
+    }
+
+    ReservaInstantanea *r = &instantanea->reservas[instantanea->numReservas++];
+    memset(r, 0, sizeof(*r));
+    r->dia = (uint8_t)dia;
+    r->parque = (uint8_t)parque;
+    r->franjaInicio = (uint16_t)franjaInicio;
+    r->numPersonas = (uint16_t)numPersonas;
+    r->cancelada = (uint16_t)cancelada;
+    r->familia = familia;
+    r->agente = agente;
+}
+
+/* Escribe la instantánea en un archivo temporal y lo renombra (reemplazo atómico) */
+static int escribirInstantanea(const Instantanea *instantanea) {
+    CabeceraInstantanea cabecera;
+
+    memset(&cabecera, 0, sizeof(cabecera));
+    memcpy(cabecera.magia, "RSVI", 4);
+    cabecera.version = DIARIO_VERSION;
+    cabecera.config = configuracion;
+    cabecera.numReservas = instantanea->numReservas;
+    cabecera.tamCadenas = instantanea->tamCadenas;
+    cabecera.secuencia = instantanea->secuencia;
+
+    int fd = open(rutaTemporal, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return 0;
+    }
+    int escrita = escribirTodo(fd, &cabecera, sizeof(cabecera)) &&
+                  escribirTodo(fd, instantanea->reservas, sizeof(ReservaInstantanea) * instantanea->numReservas) &&
+                  escribirTodo(fd, instantanea->cadenas, instantanea->tamCadenas) &&
+                  fsync(fd) == 0;
+    close(fd);
+
+    if (!escrita || rename(rutaTemporal, rutaInstantanea) == -1) {
+        unlink(rutaTemporal);
+        return 0;
+    }
+    sincronizarDirectorio(rutaInstantanea);
+    return 1;
+}
+
+/*
+ * Captura el estado, lo guarda como instantánea y vacía el diario (todas sus
+ * anotaciones quedan cubiertas). Si la instantánea no se puede escribir, las
+ * anotaciones que cubría se escriben en el diario como de costumbre. Solo la
+ * llama el hilo escritor (o cerrarDiario, ya sin él).
+ */
+static void tomarInstantanea() {
+    Instantanea instantanea;
+    CabeceraDiario cabecera;
+
+    memset(&instantanea, 0, sizeof(instantanea));
+    capturarEstado(&instantanea);
+
+    if (escribirInstantanea(&instantanea)) {
+        // Rehacer el diario solo con la cabecera (O_APPEND escribe tras ella)
+        llenarCabeceraDiario(&cabecera);
+        if (ftruncate(fdDiario, 0) == -1 || !escribirTodo(fdDiario, &cabecera, sizeof(cabecera)) ||
+            fdatasync(fdDiario) == -1) {
+            abortarDiario("Error al vaciar el diario de reservas");
+        }
+    } else {
+        perror("Error al escribir la instantánea; se conserva el diario");
+        if (!escribirTodo(fdDiario, instantanea.diarioPendiente, instantanea.tamPendiente) ||
+            fdatasync(fdDiario) == -1) {
+            abortarDiario("Error al escribir el diario de reservas");
+        }
+    }
+
+    pthread_mutex_lock(&mutexDiario);
+    if (instantanea.secuencia > secuenciaDurable) {
+        secuenciaDurable = instantanea.secuencia;
+    }
+    anotacionesDesdeInstantanea = ultimaSecuencia - instantanea.secuencia;
+    pthread_cond_broadcast(&hayConfirmadas);
+    pthread_mutex_unlock(&mutexDiario);
+
+    free(instantanea.reservas);
+    free(instantanea.cadenas);
+    free(instantanea.diarioPendiente);
+}
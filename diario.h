@@ -0,0 +1,125 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: diario.h
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Diario de reservas e instantáneas del controlador
+ * -----------------------------------------------
+ * Descripción:
+ * Persistencia opcional del estado del controlador
+ * (-j). Cada reserva confirmada (y cada cancelación)
+ * se anota en un diario binario de solo agregado; un hilo escritor vuelca
+ * las anotaciones acumuladas con una sola escritura y
+ * un solo fdatasync (confirmación en grupo), y cada
+ * trabajador espera a que sus anotaciones sean
+ * durables antes de responder. Cada cierto número de
+ * anotaciones el estado completo se guarda en una
+ * instantánea compacta y el diario vuelve a empezar.
+ * Al arrancar se proyecta la instantánea con mmap y se
+ * reaplica la cola del diario, de modo que un
+ * controlador que se cayó recupera sus reservas sin
+ * que los agentes las vuelvan a enviar.
+ *****************************************************/
+
+#ifndef DIARIO_H
+#define DIARIO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define DIARIO_VERSION 2  // v2: cancelaciones
+#define UMBRAL_INSTANTANEA 4096  // Anotaciones entre instantáneas
+
+/*
+ * Parámetros del controlador de los que depende el significado de una
+ * reserva guardada; la recuperación exige que coincidan.
+ */
+typedef struct {
+    uint32_t numDias;
+    uint32_t numParques;
+    uint32_t minutosPorFranja;
+    uint32_t franjasPorReserva;
+    uint32_t aforoMaximo;
+} ConfiguracionDiario;
+
+/* Qué describe una anotación */
+typedef enum {
+    ANOTACION_RESERVA,            // Reserva confirmada
+    ANOTACION_CANCELACION,        // Cancelación de la reserva indice de su calendario
+    ANOTACION_RESERVA_CANCELADA   // Solo en instantáneas: reserva que ya estaba cancelada
+} TipoAnotacion;
+
+/*
+ * Una reserva confirmada o cancelada, tal como se anota y se recupera. Las
+ * reservas de un calendario se numeran en el orden en que se anotan, y las
+ * canceladas siguen en la instantánea para que esa numeración se conserve.
+ */
+typedef struct {
+    TipoAnotacion tipo;
+    int indice;  // Solo en ANOTACION_CANCELACION
+    int dia;
+    int parque;
+    int franjaInicio;
+    int numPersonas;
+    const char *familia;
+    const char *agente;
+} AnotacionReserva;
+
+/* Reserva dentro de una instantánea; los nombres son desplazamientos en su área de cadenas */
+typedef struct {
+    uint8_t dia;
+    uint8_t parque;
+    uint16_t franjaInicio;
+    uint16_t numPersonas;
+    uint16_t cancelada;
+    uint32_t familia;
+    uint32_t agente;
+} ReservaInstantanea;
+
+/* Instantánea en construcción (ver capturarEstado en el controlador) */
+typedef struct {
+    ReservaInstantanea *reservas;
+    uint32_t numReservas;
+    uint32_t capacidadReservas;
+    char *cadenas;
+    uint32_t tamCadenas;
+    uint32_t capacidadCadenas;
+    uint64_t secuencia;       // Última anotación incluida
+    uint8_t *diarioPendiente; // Anotaciones aún no escritas que la instantánea ya cubre
+    size_t tamPendiente;
+} Instantanea;
+
+/*
+ * Vuelve a crear en el controlador una reserva recuperada. Copia las cadenas:
+ * pueden estar en la instantánea proyectada, que se libera al terminar.
+ */
+typedef void (*AplicarAnotacion)(const AnotacionReserva *anotacion);
+
+/*
+ * Llena la instantánea con el estado actual: debe impedir nuevas admisiones
+ * mientras llama a cortarDiario, agregarCadenaInstantanea y
+ * agregarReservaInstantanea.
+ */
+typedef void (*CapturarEstado)(Instantanea *instantanea);
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+long abrirDiario(const char *ruta, const ConfiguracionDiario *config,
+                 AplicarAnotacion aplicar, CapturarEstado capturar);
+void cerrarDiario();
+int diarioActivo();
+void anotarReserva(const AnotacionReserva *anotacion);
+void esperarDiario();
+void cortarDiario(Instantanea *instantanea);
+uint32_t agregarCadenaInstantanea(Instantanea *instantanea, const char *cadena);
+void agregarReservaInstantanea(Instantanea *instantanea, int dia, int parque, int franjaInicio,
+                               int numPersonas, int cancelada, uint32_t familia, uint32_t agente);
+
+#endif
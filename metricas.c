@@ -0,0 +1,292 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: metricas.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Métricas en vivo y reporte legible por máquina
+ * -----------------------------------------------
+ * Descripción:
+ * Implementa el histograma de latencias, el texto que
+ * crece y la publicación atómica declarados en
+ * metricas.h. Una latencia v cae en la cubeta de su
+ * potencia de dos (el bit más alto) y, dentro de ella,
+ * en una de 16 según los 4 bits siguientes; por debajo
+ * de 32 ns cada nanosegundo tiene su cubeta.
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "metricas.h"
+
+#define CAPACIDAD_INICIAL_TEXTO 4096
+#define MAX_RUTA_METRICAS 512  // Ruta del archivo temporal (destino + ".tmp")
+
+/* ============================================================================
+ * HISTOGRAMA DE LATENCIAS
+ * ============================================================================ */
+static int cubetaDeLatencia(long nanos) {
+    if (nanos < SUBCUBETAS) {
+        return nanos < 0 ? 0 : (int)nanos;
+    }
+
+    int exponente = 63 - __builtin_clzl((unsigned long)nanos);
+    if (exponente > MAX_EXPONENTE_LATENCIA) {
+        return CUBETAS_HISTOGRAMA - 1;
+    }
+    int mantisa = (int)(nanos >> (exponente - BITS_SUBCUBETA));  // Entre 16 y 31
+    return (exponente - BITS_SUBCUBETA + 1) * SUBCUBETAS + (mantisa - SUBCUBETAS);
+}
+
+/* Valor representativo de una cubeta: el centro del rango que cubre */
+static long latenciaDeCubeta(int cubeta) {
+    if (cubeta < SUBCUBETAS) {
+        return cubeta;
+    }
+
+    int exponente = cubeta / SUBCUBETAS + BITS_SUBCUBETA - 1;
+    long ancho = 1L << (exponente - BITS_SUBCUBETA);
+    long inferior = (long)(cubeta % SUBCUBETAS + SUBCUBETAS) * ancho;
+    return inferior + ancho / 2;
+}
+
+void inicializarHistograma(HistogramaLatencia *histograma) {
+    for (int i = 0; i < CUBETAS_HISTOGRAMA; i++) {
+        atomic_init(&histograma->cuentas[i], 0);
+    }
+    atomic_init(&histograma->muestras, 0);
+    atomic_init(&histograma->sumaNanos, 0);
+    atomic_init(&histograma->maximoNanos, 0);
+}
+
+/*
+ * Anota veces muestras de la misma latencia. Solo la llama el hilo dueño del
+ * histograma: las sumas relajadas bastan para que otros hilos lo lean.
+ */
+void registrarLatencia(HistogramaLatencia *histograma, long nanos, long veces) {
+    if (nanos < 0) {
+        nanos = 0;
+    }
+
+    atomic_fetch_add_explicit(&histograma->cuentas[cubetaDeLatencia(nanos)], veces, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histograma->muestras, veces, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histograma->sumaNanos, nanos * veces, memory_order_relaxed);
+    if (nanos > atomic_load_explicit(&histograma->maximoNanos, memory_order_relaxed)) {
+        atomic_store_explicit(&histograma->maximoNanos, nanos, memory_order_relaxed);
+    }
+}
+
+/* Suma origen en destino (destino no debe estar siendo escrito por otro hilo) */
+void acumularHistograma(HistogramaLatencia *destino, const HistogramaLatencia *origen) {
+    long muestras = 0;
+
+    for (int i = 0; i < CUBETAS_HISTOGRAMA; i++) {
+        long cuenta = atomic_load_explicit(&origen->cuentas[i], memory_order_relaxed);
+        if (cuenta != 0) {
+            atomic_fetch_add_explicit(&destino->cuentas[i], cuenta, memory_order_relaxed);
+            muestras += cuenta;
+        }
+    }
+
+    // Las muestras se cuentan de las cubetas: con el dueño escribiendo a la
+    // vez, así los percentiles nunca buscan más muestras de las que hay
+    atomic_fetch_add_explicit(&destino->muestras, muestras, memory_order_relaxed);
+    atomic_fetch_add_explicit(&destino->sumaNanos,
+                              atomic_load_explicit(&origen->sumaNanos, memory_order_relaxed),
+                              memory_order_relaxed);
+    long maximo = atomic_load_explicit(&origen->maximoNanos, memory_order_relaxed);
+    if (maximo > atomic_load_explicit(&destino->maximoNanos, memory_order_relaxed)) {
+        atomic_store_explicit(&destino->maximoNanos, maximo, memory_order_relaxed);
+    }
+}
+
+/* Latencia por debajo de la cual queda el percentil pedido (0 sin muestras) */
+long percentilLatencia(const HistogramaLatencia *histograma, double percentil) {
+    long muestras = atomic_load_explicit(&histograma->muestras, memory_order_relaxed);
+    if (muestras == 0) {
+        return 0;
+    }
+
+    long posicion = (long)(percentil / 100.0 * (double)muestras + 0.999999);
+    if (posicion < 1) {
+        posicion = 1;
+    }
+
+    long acumuladas = 0;
+    long maximo = atomic_load_explicit(&histograma->maximoNanos, memory_order_relaxed);
+    for (int i = 0; i < CUBETAS_HISTOGRAMA; i++) {
+        acumuladas += atomic_load_explicit(&histograma->cuentas[i], memory_order_relaxed);
+        if (acumuladas >= posicion) {
+            long valor = latenciaDeCubeta(i);
+            return valor < maximo ? valor : maximo;
+        }
+    }
+    return maximo;
+}
+
+long nanosEntre(const struct timespec *inicio, const struct timespec *fin) {
+    return (long)(fin->tv_sec - inicio->tv_sec) * 1000000000L + (fin->tv_nsec - inicio->tv_nsec);
+}
+
+/* ============================================================================
+ * TEXTO DE LAS MÉTRICAS
+ * ============================================================================ */
+void agregarTexto(TextoMetricas *texto, const char *formato, ...) {
+    if (texto->error) {
+        return;
+    }
+
+    for (;;) {
+        size_t libres = texto->capacidad - texto->longitud;
+        va_list args;
+
+        if (texto->datos != NULL) {
+            va_start(args, formato);
+            int necesarios = vsnprintf(texto->datos + texto->longitud, libres, formato, args);
+            va_end(args);
+            if (necesarios < 0) {
+                texto->error = 1;
+                return;
+            }
+            if ((size_t)necesarios < libres) {
+                texto->longitud += (size_t)necesarios;
+                return;
+            }
+        }
+
+        // No cupo: duplicar la capacidad y volver a componer
+        size_t capacidad = texto->capacidad == 0 ? CAPACIDAD_INICIAL_TEXTO : texto->capacidad * 2;
+        char *datos = realloc(texto->datos, capacidad);
+        if (datos == NULL) {
+            texto->error = 1;
+            return;
+        }
+        texto->datos = datos;
+        texto->capacidad = capacidad;
+    }
+}
+
+void liberarTexto(TextoMetricas *texto) {
+    free(texto->datos);
+    texto->datos = NULL;
+    texto->longitud = 0;
+    texto->capacidad = 0;
+    texto->error = 0;
+}
+
+/*
+ * Escribe el archivo completo con otro nombre y lo renombra sobre el
+ * destino: quien lo lea ve la versión anterior o la nueva, nunca una a medias.
+ * Devuelve 0 si falló (errno indica por qué).
+ */
+int publicarArchivo(const char *ruta, const char *datos, size_t longitud) {
+    char temporal[MAX_RUTA_METRICAS];
+    if (snprintf(temporal, sizeof(temporal), "%s.tmp", ruta) >= (int)sizeof(temporal)) {
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+
+    int fd = open(temporal, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return 0;
+    }
+    while (longitud > 0) {
+        ssize_t escritos = write(fd, datos, longitud);
+        if (escritos == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            unlink(temporal);
+            return 0;
+        }
+        datos += escritos;
+        longitud -= (size_t)escritos;
+    }
+    close(fd);
+
+    if (rename(temporal, ruta) == -1) {
+        unlink(temporal);
+        return 0;
+    }
+    return 1;
+}
+
+/* ============================================================================
+ * INSTRUMENTACIÓN POR ETAPAS
+ * ============================================================================ */
+#define MAX_HILOS_MEDIDOS 256  // Los hilos de más comparten el último juego de histogramas
+
+static HistogramaLatencia *_Atomic etapasHilos[MAX_HILOS_MEDIDOS];
+static atomic_int numHilosMedidos = 0;
+static _Thread_local HistogramaLatencia *etapasHilo = NULL;
+
+static const char *nombresEtapas[NUM_ETAPAS] = {
+    "recepcion", "cola", "cerrojo", "admision", "confirmacion", "diario", "respuesta"
+};
+
+/*
+ * Anota en el histograma de la etapa, del hilo actual, el tiempo desde el
+ * instante indicado. Cada hilo crea su juego de histogramas la primera vez.
+ */
+void medirEtapa(EtapaSolicitud etapa, const struct timespec *desde) {
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+
+    if (etapasHilo == NULL) {
+        int indice = atomic_fetch_add(&numHilosMedidos, 1);
+        if (indice >= MAX_HILOS_MEDIDOS) {
+            etapasHilo = atomic_load(&etapasHilos[MAX_HILOS_MEDIDOS - 1]);
+            if (etapasHilo == NULL) {
+                return;  // Su dueño aún no lo crea: esta muestra se pierde
+            }
+        } else {
+            HistogramaLatencia *propios = malloc(sizeof(HistogramaLatencia) * NUM_ETAPAS);
+            if (propios == NULL) {
+                return;  // Su posición queda vacía; sumarEtapas la salta
+            }
+            for (int e = 0; e < NUM_ETAPAS; e++) {
+                inicializarHistograma(&propios[e]);
+            }
+            atomic_store(&etapasHilos[indice], propios);
+            etapasHilo = propios;
+        }
+    }
+
+    registrarLatencia(&etapasHilo[etapa], nanosEntre(desde, &ahora), 1);
+}
+
+/* Suma en etapas (ya inicializados) los histogramas de todos los hilos */
+void sumarEtapas(HistogramaLatencia etapas[NUM_ETAPAS]) {
+    int hilos = atomic_load(&numHilosMedidos);
+    for (int h = 0; h < hilos && h < MAX_HILOS_MEDIDOS; h++) {
+        HistogramaLatencia *propios = atomic_load(&etapasHilos[h]);
+        if (propios == NULL) {
+            continue;  // Reservado pero aún sin crear
+        }
+        for (int e = 0; e < NUM_ETAPAS; e++) {
+            acumularHistograma(&etapas[e], &propios[e]);
+        }
+    }
+}
+
+const char *nombreEtapa(EtapaSolicitud etapa) {
+    return nombresEtapas[etapa];
+}
+
+/* Libera los histogramas; solo al terminar, cuando ya ningún hilo mide */
+void liberarEtapas() {
+    int hilos = atomic_load(&numHilosMedidos);
+    for (int h = 0; h < hilos && h < MAX_HILOS_MEDIDOS; h++) {
+        free(atomic_load(&etapasHilos[h]));
+        atomic_store(&etapasHilos[h], NULL);
+    }
+    atomic_store(&numHilosMedidos, 0);
+}
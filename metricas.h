@@ -0,0 +1,97 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: metricas.h
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Métricas en vivo y reporte legible por máquina
+ * -----------------------------------------------
+ * Descripción:
+ * Piezas para que el controlador publique sus métricas
+ * mientras atiende: un histograma de latencias con
+ * cubetas logarítmicas (16 por cada potencia de dos,
+ * error relativo menor a 1/16) que un solo hilo llena
+ * sin cerrojos y cualquiera puede sumar y consultar en
+ * cualquier momento; un texto que crece a medida que
+ * se compone el JSON o el CSV, y la publicación de un
+ * archivo de forma atómica (nunca se lee a medias).
+ * Compilado con INSTRUMENTAR_ETAPAS (make INSTRUMENTAR=1)
+ * mide además cada etapa del camino de una solicitud
+ * en histogramas por hilo que se suman al reportar; sin
+ * él, las macros de medición no generan código.
+ *****************************************************/
+
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define BITS_SUBCUBETA 4                        // 16 cubetas por potencia de dos
+#define SUBCUBETAS (1 << BITS_SUBCUBETA)
+#define MAX_EXPONENTE_LATENCIA 42               // Hasta 2^43 ns (más de dos horas)
+#define CUBETAS_HISTOGRAMA ((MAX_EXPONENTE_LATENCIA - BITS_SUBCUBETA + 2) * SUBCUBETAS)
+
+/* Latencias en nanosegundos; lo escribe un solo hilo, lo leen los demás */
+typedef struct {
+    atomic_long cuentas[CUBETAS_HISTOGRAMA];
+    atomic_long muestras;
+    atomic_long sumaNanos;
+    atomic_long maximoNanos;
+} HistogramaLatencia;
+
+/* Texto que crece al componer; error queda en 1 si faltó memoria */
+typedef struct {
+    char *datos;
+    size_t longitud;
+    size_t capacidad;
+    int error;
+} TextoMetricas;
+
+/* Etapas del camino de una solicitud, de la lectura a la respuesta */
+typedef enum {
+    ETAPA_RECEPCION,     // De la lectura de la trama a su entrada en la cola
+    ETAPA_COLA,          // Esperando en la cola a un trabajador
+    ETAPA_CERROJO,       // Esperando el mutex del calendario
+    ETAPA_ADMISION,      // verificarDisponibilidad o buscarHoraAlternativa
+    ETAPA_CONFIRMACION,  // Ocupar la ventana, guardar la reserva y anotarla en el diario
+    ETAPA_DIARIO,        // Esperando que el diario haga durable la reserva (-j)
+    ETAPA_RESPUESTA,     // Localizar el canal del agente y escribir la respuesta
+    NUM_ETAPAS
+} EtapaSolicitud;
+
+#ifdef INSTRUMENTAR_ETAPAS
+#define DECLARAR_INSTANTE(instante) struct timespec instante
+#define MARCAR_INSTANTE(instante) clock_gettime(CLOCK_MONOTONIC, &(instante))
+#define MEDIR_ETAPA(etapa, desde) medirEtapa((etapa), &(desde))
+#else
+#define DECLARAR_INSTANTE(instante)
+#define MARCAR_INSTANTE(instante) ((void)0)
+#define MEDIR_ETAPA(etapa, desde) ((void)0)
+#endif
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+void inicializarHistograma(HistogramaLatencia *histograma);
+void registrarLatencia(HistogramaLatencia *histograma, long nanos, long veces);
+void acumularHistograma(HistogramaLatencia *destino, const HistogramaLatencia *origen);
+long percentilLatencia(const HistogramaLatencia *histograma, double percentil);
+long nanosEntre(const struct timespec *inicio, const struct timespec *fin);
+
+void agregarTexto(TextoMetricas *texto, const char *formato, ...);
+void liberarTexto(TextoMetricas *texto);
+int publicarArchivo(const char *ruta, const char *datos, size_t longitud);
+
+void medirEtapa(EtapaSolicitud etapa, const struct timespec *desde);
+void sumarEtapas(HistogramaLatencia etapas[NUM_ETAPAS]);
+const char *nombreEtapa(EtapaSolicitud etapa);
+void liberarEtapas();
+
+#endif
@@ -0,0 +1,424 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: microbanco.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Microbancos del núcleo de admisión
+ * -----------------------------------------------
+ * Descripción:
+ * Mide en nanosegundos por operación, dentro de un
+ * solo proceso y sin pipes, las funciones de reservas.h
+ * que recorre cada solicitud: admitir y registrar una
+ * reserva (lo que hace admitirReserva sin el diario),
+ * verificar la franja pedida, buscar una alternativa y
+ * avanzar el reloj. Recorre combinaciones de largo del
+ * día, ancho de franja y número de reservas (de 10² a
+ * 10⁷ con -N), con el núcleo vectorizado que elija
+ * -k, y compara el índice de capacidad con el
+ * recorrido lineal de la ocupación, que además sirve
+ * de referencia (también para la alternativa más
+ * cercana de la colocación de lotes): si alguna
+ * respuesta difiere, termina con error.
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "reservas.h"
+#include "ventanas.h"
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define MAX_VALORES 16          // Valores por lista de -h, -m y -N
+#define MAX_PERSONAS_BANCO 8    // Personas por reserva: de 1 a 8
+#define TAM_MUESTRAS 65536      // Solicitudes pregeneradas, recorridas en ciclo (potencia de 2)
+#define NOMBRES_FAMILIAS 4096   // Nombres distintos que se internan
+#define MIN_NANOS_AVANCE 20000000L  // El avance se repite hasta medir al menos 20 ms
+
+/* Solicitud pregenerada: el azar no entra en la medición */
+typedef struct {
+    int franja;
+    int personas;
+} Muestra;
+
+/* Nanosegundos por operación de una combinación */
+typedef struct {
+    double reservar;
+    double verificarIndice, verificarLineal;
+    double alternativaIndice, alternativaLineal;
+    double avance;
+    long enHora, alternativas, sinCupo;
+} Medicion;
+
+/* ============================================================================
+ * VARIABLES GLOBALES
+ * ============================================================================ */
+// Combinaciones a recorrer
+int horasDia[MAX_VALORES] = { 13 };  // 7:00 a 20:00, el horario del controlador
+int numHorasDia = 1;
+int minutosFranja[MAX_VALORES] = { 60, 15, 5 };
+int numMinutosFranja = 3;
+long numReservas[MAX_VALORES] = { 100, 1000, 10000, 100000 };
+int numNumReservas = 4;
+int minutosDuracion = 120;
+long numConsultas = 100000;
+unsigned int semilla = 1;
+char rutaCSV[512] = "";
+
+// Geometría de la combinación en curso (la misma que recibe reservas.c)
+int numFranjas;
+int franjasPorReserva;
+int aforoMaximo;
+
+Muestra muestras[TAM_MUESTRAS];
+char nombresFamilias[NOMBRES_FAMILIAS][24];
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+void procesarArgumentos(int argc, char *argv[]);
+int leerLista(const char *texto, long *valores);
+void medir(int horas, int minutos, long reservas, Medicion *medicion);
+void generarMuestras(unsigned int *estado);
+int verificarLineal(Calendario *cal, int franja, int numPersonas);
+int alternativaLineal(Calendario *cal, int numPersonas, int *franjaEncontrada);
+int cercanaLineal(Calendario *cal, int franjaSolicitada, int numPersonas, int *franjaEncontrada);
+long nanosAhora();
+
+/* ============================================================================
+ * FUNCIÓN PRINCIPAL
+ * ============================================================================ */
+int main(int argc, char *argv[]) {
+    FILE *csv = NULL;
+
+    procesarArgumentos(argc, argv);
+
+    for (int i = 0; i < NOMBRES_FAMILIAS; i++) {
+        snprintf(nombresFamilias[i], sizeof(nombresFamilias[i]), "Familia_%d", i);
+    }
+
+    if (rutaCSV[0] != '\0') {
+        csv = fopen(rutaCSV, "w");
+        if (csv == NULL) {
+            perror("Error al crear el archivo de resultados");
+            exit(EXIT_FAILURE);
+        }
+        fprintf(csv, "horas,minutos_franja,franjas,franjas_reserva,reservas,aforo,reservar_ns,"
+                "verificar_indice_ns,verificar_lineal_ns,alternativa_indice_ns,alternativa_lineal_ns,"
+                "avance_ns,en_hora,alternativas,sin_cupo\n");
+    }
+
+    if (nucleoVentanas() == NULL) {
+        elegirNucleoVentanas(NULL);
+    }
+    printf("⏱  MICROBANCOS DEL NÚCLEO DE ADMISIÓN (ns por operación, %ld consultas, duración %d min, núcleo %s)\n\n",
+           numConsultas, minutosDuracion, nucleoVentanas());
+    printf("%5s %4s %7s %5s %9s %9s | %9s | %9s %9s | %11s %11s | %12s\n",
+           "horas", "min", "franjas", "dur", "reservas", "aforo", "reservar",
+           "verif.ind", "verif.lin", "altern.ind", "altern.lin", "avance");
+
+    for (int h = 0; h < numHorasDia; h++) {
+        for (int m = 0; m < numMinutosFranja; m++) {
+            for (int n = 0; n < numNumReservas; n++) {
+                Medicion medicion;
+                medir(horasDia[h], minutosFranja[m], numReservas[n], &medicion);
+
+                printf("%5d %4d %7d %5d %9ld %9d | %9.1f | %9.1f %9.1f | %11.1f %11.1f | %12.1f\n",
+                       horasDia[h], minutosFranja[m], numFranjas, franjasPorReserva, numReservas[n],
+                       aforoMaximo, medicion.reservar, medicion.verificarIndice, medicion.verificarLineal,
+                       medicion.alternativaIndice, medicion.alternativaLineal, medicion.avance);
+                fflush(stdout);
+                if (csv != NULL) {
+                    fprintf(csv, "%d,%d,%d,%d,%ld,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%ld,%ld,%ld\n",
+                            horasDia[h], minutosFranja[m], numFranjas, franjasPorReserva, numReservas[n],
+                            aforoMaximo, medicion.reservar, medicion.verificarIndice, medicion.verificarLineal,
+                            medicion.alternativaIndice, medicion.alternativaLineal, medicion.avance,
+                            medicion.enHora, medicion.alternativas, medicion.sinCupo);
+                }
+            }
+        }
+    }
+
+    if (csv != NULL && fclose(csv) != 0) {
+        perror("Error al escribir el archivo de resultados");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("\n   reservar: elegirFranja + ocuparVentana + insertarReserva bajo el mutex; "
+           "avance: avanzarCalendario por franja\n");
+    return EXIT_SUCCESS;
+}
+
+/* ============================================================================
+ * PROCESAMIENTO DE ARGUMENTOS
+ * ============================================================================ */
+void procesarArgumentos(int argc, char *argv[]) {
+    long valores[MAX_VALORES];
+    int opt, cantidad;
+
+    while ((opt = getopt(argc, argv, "h:m:N:d:q:x:o:k:")) != -1) {
+        switch (opt) {
+            case 'h':
+            case 'm':
+                cantidad = leerLista(optarg, valores);
+                for (int i = 0; i < cantidad; i++) {
+                    if (valores[i] < 1 || valores[i] > 24 * 60) {
+                        fprintf(stderr, "Error: Las horas y los minutos por franja deben ser positivos\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    if (opt == 'h') {
+                        horasDia[i] = (int)valores[i];
+                    } else {
+                        minutosFranja[i] = (int)valores[i];
+                    }
+                }
+                if (opt == 'h') {
+                    numHorasDia = cantidad;
+                } else {
+                    numMinutosFranja = cantidad;
+                }
+                break;
+            case 'N':
+                numNumReservas = leerLista(optarg, numReservas);
+                for (int i = 0; i < numNumReservas; i++) {
+                    if (numReservas[i] < 1 || numReservas[i] > 100000000L) {
+                        fprintf(stderr, "Error: Las reservas deben estar entre 1 y 10^8\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                break;
+            case 'd':
+                minutosDuracion = atoi(optarg);
+                break;
+            case 'q':
+                numConsultas = atol(optarg);
+                break;
+            case 'x':
+                semilla = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'o':
+                strncpy(rutaCSV, optarg, sizeof(rutaCSV) - 1);
+                rutaCSV[sizeof(rutaCSV) - 1] = '\0';
+                break;
+            case 'k':
+                if (!elegirNucleoVentanas(optarg)) {
+                    fprintf(stderr, "Error: El núcleo '%s' no existe o este procesador no lo soporta\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            default:
+                fprintf(stderr, "Uso: %s [-h <horas,...>] [-m <minutosPorFranja,...>] [-N <reservas,...>] "
+                        "[-d <minutosDuracion>] [-q <consultas>] [-x <semilla>] [-o <resultados.csv>] [-k avx2|sse4|escalar]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (minutosDuracion < 1 || numConsultas < 1) {
+        fprintf(stderr, "Error: La duración y las consultas deben ser mayores a 0\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Lee una lista de enteros separados por comas; devuelve cuántos leyó */
+int leerLista(const char *texto, long *valores) {
+    int cantidad = 0;
+    char *fin;
+
+    while (*texto != '\0') {
+        if (cantidad == MAX_VALORES) {
+            fprintf(stderr, "Error: A lo sumo %d valores por lista\n", MAX_VALORES);
+            exit(EXIT_FAILURE);
+        }
+        valores[cantidad++] = strtol(texto, &fin, 10);
+        if (fin == texto || (*fin != ',' && *fin != '\0')) {
+            fprintf(stderr, "Error: Lista inválida '%s'\n", texto);
+            exit(EXIT_FAILURE);
+        }
+        texto = *fin == ',' ? fin + 1 : fin;
+    }
+
+    if (cantidad == 0) {
+        fprintf(stderr, "Error: Lista vacía\n");
+        exit(EXIT_FAILURE);
+    }
+    return cantidad;
+}
+
+/* ============================================================================
+ * MEDICIÓN
+ * ============================================================================ */
+/*
+ * Mide una combinación sobre un calendario nuevo. El aforo se elige para que
+ * las reservas alcancen a llenar el día: al principio casi todas entran en su
+ * hora, al final se reprograman o no caben, como en una jornada real.
+ */
+void medir(int horas, int minutos, long reservas, Medicion *medicion) {
+    unsigned int estado = semilla;
+    Calendario cal;
+    long inicio, nanos = 0;
+    int franja, franjaLineal;
+
+    numFranjas = horas * 60 / minutos;
+    franjasPorReserva = minutosDuracion / minutos > 0 ? minutosDuracion / minutos : 1;
+    if (numFranjas < franjasPorReserva) {
+        numFranjas = franjasPorReserva;
+    }
+    double carga = (double)reservas * (MAX_PERSONAS_BANCO + 1) / 2.0 * franjasPorReserva / numFranjas;
+    aforoMaximo = carga > MAX_PERSONAS_BANCO ? (int)carga : MAX_PERSONAS_BANCO;
+
+    ConfiguracionCalendarios configuracion = {
+        .numFranjas = numFranjas, .franjasPorReserva = franjasPorReserva,
+        .aforoMaximo = aforoMaximo, .franjaFinPeriodo = numFranjas
+    };
+    configurarCalendarios(&configuracion);
+    inicializarCalendario(&cal, 0, 0, 0);
+    generarMuestras(&estado);
+    memset(medicion, 0, sizeof(*medicion));
+
+    // Admitir y registrar, tal como admitirReserva (sin el diario)
+    inicio = nanosAhora();
+    for (long i = 0; i < reservas; i++) {
+        const Muestra *muestra = &muestras[i & (TAM_MUESTRAS - 1)];
+        pthread_mutex_lock(&cal.mutexReservas);
+        ResultadoAdmision resultado = elegirFranja(&cal, muestra->franja, 1, 0, muestra->personas, &franja);
+        if (resultado != ADMISION_SIN_CUPO && ocuparVentana(&cal, franja, muestra->personas)) {
+            insertarReserva(&cal, nombresFamilias[i % NOMBRES_FAMILIAS], "Banco", franja, muestra->personas);
+        } else {
+            resultado = ADMISION_SIN_CUPO;
+        }
+        pthread_mutex_unlock(&cal.mutexReservas);
+        medicion->enHora += resultado == ADMISION_EN_HORA;
+        medicion->alternativas += resultado == ADMISION_ALTERNATIVA;
+        medicion->sinCupo += resultado == ADMISION_SIN_CUPO;
+    }
+    medicion->reservar = (double)(nanosAhora() - inicio) / (double)reservas;
+
+    // Consultas sobre el calendario lleno, con otras solicitudes
+    generarMuestras(&estado);
+    int disponibles = 0;
+    inicio = nanosAhora();
+    for (long i = 0; i < numConsultas; i++) {
+        const Muestra *muestra = &muestras[i & (TAM_MUESTRAS - 1)];
+        disponibles += verificarDisponibilidad(&cal, muestra->franja, muestra->personas);
+    }
+    medicion->verificarIndice = (double)(nanosAhora() - inicio) / (double)numConsultas;
+
+    int disponiblesLineal = 0;
+    inicio = nanosAhora();
+    for (long i = 0; i < numConsultas; i++) {
+        const Muestra *muestra = &muestras[i & (TAM_MUESTRAS - 1)];
+        disponiblesLineal += verificarLineal(&cal, muestra->franja, muestra->personas);
+    }
+    medicion->verificarLineal = (double)(nanosAhora() - inicio) / (double)numConsultas;
+
+    // La búsqueda parte de la primera franja reservable: se toma la de la muestra
+    long sumaIndice = 0, sumaLineal = 0;
+    inicio = nanosAhora();
+    for (long i = 0; i < numConsultas; i++) {
+        const Muestra *muestra = &muestras[i & (TAM_MUESTRAS - 1)];
+        cal.franjaMinima = muestra->franja;
+        sumaIndice += buscarHoraAlternativa(&cal, muestra->personas, &franja) ? franja + 1 : 0;
+    }
+    medicion->alternativaIndice = (double)(nanosAhora() - inicio) / (double)numConsultas;
+
+    inicio = nanosAhora();
+    for (long i = 0; i < numConsultas; i++) {
+        const Muestra *muestra = &muestras[i & (TAM_MUESTRAS - 1)];
+        cal.franjaMinima = muestra->franja;
+        sumaLineal += alternativaLineal(&cal, muestra->personas, &franjaLineal) ? franjaLineal + 1 : 0;
+    }
+    medicion->alternativaLineal = (double)(nanosAhora() - inicio) / (double)numConsultas;
+
+    // La alternativa más cercana solo se verifica: pedida en la franja de otra muestra
+    for (long i = 0; i < numConsultas; i++) {
+        const Muestra *muestra = &muestras[i & (TAM_MUESTRAS - 1)];
+        int solicitada = muestras[(i + 1) & (TAM_MUESTRAS - 1)].franja;
+        cal.franjaMinima = muestra->franja;
+        sumaIndice += buscarHoraCercana(&cal, solicitada, muestra->personas, &franja) ? franja + 1 : 0;
+        sumaLineal += cercanaLineal(&cal, solicitada, muestra->personas, &franjaLineal) ? franjaLineal + 1 : 0;
+    }
+
+    if (disponibles != disponiblesLineal || sumaIndice != sumaLineal) {
+        fprintf(stderr, "Error: el índice y el recorrido lineal no coinciden (%d franjas, %ld reservas)\n",
+                numFranjas, reservas);
+        exit(EXIT_FAILURE);
+    }
+
+    // Avance del reloj de la apertura al cierre, repetido hasta juntar tiempo suficiente
+    long avances = 0;
+    do {
+        inicio = nanosAhora();
+        for (int f = 0; f < numFranjas; f++) {
+            avanzarCalendario(&cal, f);
+        }
+        nanos += nanosAhora() - inicio;
+        avances += numFranjas;
+    } while (nanos < MIN_NANOS_AVANCE);
+    medicion->avance = (double)nanos / (double)avances;
+
+    liberarCalendario(&cal);
+}
+
+/* Franjas y personas al azar, repartidas por todo el día */
+void generarMuestras(unsigned int *estado) {
+    for (int i = 0; i < TAM_MUESTRAS; i++) {
+        muestras[i].franja = rand_r(estado) % numFranjas;
+        muestras[i].personas = 1 + rand_r(estado) % MAX_PERSONAS_BANCO;
+    }
+}
+
+long nanosAhora() {
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    return (long)ahora.tv_sec * 1000000000L + ahora.tv_nsec;
+}
+
+/* ============================================================================
+ * RECORRIDO LINEAL (REFERENCIA)
+ * ============================================================================ */
+/* Franja por franja sobre la ocupación, sin el índice: O(franjasPorReserva) */
+int verificarLineal(Calendario *cal, int franja, int numPersonas) {
+    for (int f = franja; f < franja + franjasPorReserva && f < numFranjas; f++) {
+        if (leerOcupacion(cal, f) + numPersonas > aforoMaximo) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Ventana con cupo más cercana a la solicitada (a igual distancia, la posterior) */
+int cercanaLineal(Calendario *cal, int franjaSolicitada, int numPersonas, int *franjaEncontrada) {
+    int centro = franjaSolicitada < cal->franjaMinima ? cal->franjaMinima : franjaSolicitada;
+    int mejor = -1;
+
+    for (int f = cal->franjaMinima; f <= numFranjas - franjasPorReserva; f++) {
+        int distancia = f > centro ? f - centro : centro - f;
+        int distanciaMejor = mejor > centro ? mejor - centro : centro - mejor;
+        if (verificarLineal(cal, f, numPersonas) && (mejor == -1 || distancia <= distanciaMejor)) {
+            mejor = f;
+        }
+    }
+
+    if (mejor == -1) {
+        return 0;
+    }
+    *franjaEncontrada = mejor;
+    return 1;
+}
+
+/* Primera ventana con cupo desde franjaMinima: O(numFranjas · franjasPorReserva) */
+int alternativaLineal(Calendario *cal, int numPersonas, int *franjaEncontrada) {
+    for (int f = cal->franjaMinima; f <= numFranjas - franjasPorReserva; f++) {
+        if (verificarLineal(cal, f, numPersonas)) {
+            *franjaEncontrada = f;
+            return 1;
+        }
+    }
+    return 0;
+}
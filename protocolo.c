@@ -0,0 +1,591 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: protocolo.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Protocolo binario entre agentes y controlador
+ * -----------------------------------------------
+ * Descripción:
+ * Implementa la codificación y decodificación de las
+ * tramas del protocolo (ver protocolo.h), el armado de
+ * tramas a partir de lecturas parciales de un pipe y
+ * la reconstrucción del texto legible de una respuesta.
+ * Los enteros se codifican en little-endian con tamaño
+ * fijo para no depender del relleno de las estructuras.
+ *****************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include "protocolo.h"
+
+/* ============================================================================
+ * ESCRITURA Y LECTURA DE CAMPOS
+ * ============================================================================ */
+static uint8_t *escribirU16(uint8_t *p, uint16_t valor) {
+    p[0] = (uint8_t)(valor & 0xFF);
+    p[1] = (uint8_t)(valor >> 8);
+    return p + 2;
+}
+
+static uint8_t *escribirU32(uint8_t *p, uint32_t valor) {
+    p[0] = (uint8_t)(valor & 0xFF);
+    p[1] = (uint8_t)((valor >> 8) & 0xFF);
+    p[2] = (uint8_t)((valor >> 16) & 0xFF);
+    p[3] = (uint8_t)(valor >> 24);
+    return p + 4;
+}
+
+/* Cadena con prefijo de longitud de un byte (sin '\0') */
+static uint8_t *escribirCadena(uint8_t *p, const char *cadena) {
+    size_t longitud = strnlen(cadena, MAX_NOMBRE - 1);
+    *p++ = (uint8_t)longitud;
+    memcpy(p, cadena, longitud);
+    return p + longitud;
+}
+
+static uint16_t leerU16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t leerU32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Lee una cadena validando que no se salga del cuerpo; devuelve 0 si es inválida */
+static int leerCadena(const uint8_t **p, const uint8_t *fin, char *destino) {
+    if (*p >= fin) {
+        return 0;
+    }
+    size_t longitud = **p;
+    (*p)++;
+    if (longitud > MAX_NOMBRE - 1 || (size_t)(fin - *p) < longitud) {
+        return 0;
+    }
+    memcpy(destino, *p, longitud);
+    destino[longitud] = '\0';
+    *p += longitud;
+    return 1;
+}
+
+/* Completa la cabecera una vez conocido el tamaño del cuerpo */
+static size_t cerrarTrama(uint8_t *trama, uint8_t tipo, const uint8_t *finCuerpo) {
+    size_t longitudCuerpo = (size_t)(finCuerpo - (trama + TAM_CABECERA));
+    trama[0] = PROTOCOLO_VERSION;
+    trama[1] = tipo;
+    escribirU16(trama + 2, (uint16_t)longitudCuerpo);
+    return TAM_CABECERA + longitudCuerpo;
+}
+
+/* ============================================================================
+ * MENSAJES DEL AGENTE
+ * ============================================================================ */
+/* Codifica un mensaje en trama (al menos MAX_TRAMA bytes); devuelve su longitud */
+size_t codificarMensaje(const MensajeAgente *msg, uint8_t *trama) {
+    uint8_t *p = trama + TAM_CABECERA;
+
+    switch (msg->tipo) {
+        case MSG_REGISTRO:
+            p = escribirCadena(p, msg->nombreAgente);
+            p = escribirCadena(p, msg->pipeRespuesta);
+            p = escribirCadena(p, msg->segmentoMemoria);
+            break;
+        case MSG_SOLICITUD_RESERVA:
+            p = escribirU32(p, msg->idAgente);
+            p = escribirU32(p, msg->secuencia);
+            p = escribirU32(p, (uint32_t)msg->horaSolicitada);
+            p = escribirU32(p, (uint32_t)msg->numPersonas);
+            *p++ = (uint8_t)msg->dia;
+            *p++ = (uint8_t)msg->parque;
+            p = escribirCadena(p, msg->nombreFamilia);
+            break;
+        case MSG_FIN_AGENTE:
+            p = escribirU32(p, msg->idAgente);
+            break;
+        case MSG_CANCELAR:
+        case MSG_MODIFICAR:
+            p = escribirU32(p, msg->idAgente);
+            p = escribirU32(p, msg->secuencia);
+            p = escribirU32(p, msg->idReserva);
+            if (msg->tipo == MSG_MODIFICAR) {
+                p = escribirU32(p, (uint32_t)msg->horaSolicitada);
+                p = escribirU32(p, (uint32_t)msg->numPersonas);
+            }
+            break;
+        case MSG_CONSULTA_DISPONIBILIDAD:
+            p = escribirU32(p, msg->idAgente);
+            p = escribirU32(p, msg->secuencia);
+            *p++ = (uint8_t)msg->dia;
+            *p++ = (uint8_t)msg->parque;
+            break;
+        default:
+            break;  // Los lotes se codifican con codificarLote
+    }
+
+    return cerrarTrama(trama, (uint8_t)msg->tipo, p);
+}
+
+/* Decodifica una trama completa; devuelve 0 si está mal formada */
+int decodificarMensaje(const uint8_t *trama, size_t longitud, MensajeAgente *msg) {
+    const uint8_t *p = trama + TAM_CABECERA;
+    const uint8_t *fin = trama + longitud;
+
+    memset(msg, 0, sizeof(*msg));
+    msg->tipo = (TipoMensaje)trama[1];
+
+    switch (msg->tipo) {
+        case MSG_REGISTRO:
+            return leerCadena(&p, fin, msg->nombreAgente) &&
+                   leerCadena(&p, fin, msg->pipeRespuesta) &&
+                   leerCadena(&p, fin, msg->segmentoMemoria);
+        case MSG_SOLICITUD_RESERVA:
+            if (fin - p < 18) {
+                return 0;
+            }
+            msg->idAgente = leerU32(p);
+            msg->secuencia = leerU32(p + 4);
+            msg->horaSolicitada = (int32_t)leerU32(p + 8);
+            msg->numPersonas = (int32_t)leerU32(p + 12);
+            msg->dia = p[16];
+            msg->parque = p[17];
+            p += 18;
+            return leerCadena(&p, fin, msg->nombreFamilia);
+        case MSG_FIN_AGENTE:
+            if (fin - p < 4) {
+                return 0;
+            }
+            msg->idAgente = leerU32(p);
+            return 1;
+        case MSG_CANCELAR:
+        case MSG_MODIFICAR:
+            if (fin - p < (msg->tipo == MSG_MODIFICAR ? 20 : 12)) {
+                return 0;
+            }
+            msg->idAgente = leerU32(p);
+            msg->secuencia = leerU32(p + 4);
+            msg->idReserva = leerU32(p + 8);
+            if (msg->tipo == MSG_MODIFICAR) {
+                msg->horaSolicitada = (int32_t)leerU32(p + 12);
+                msg->numPersonas = (int32_t)leerU32(p + 16);
+            }
+            return 1;
+        case MSG_CONSULTA_DISPONIBILIDAD:
+            if (fin - p < 10) {
+                return 0;
+            }
+            msg->idAgente = leerU32(p);
+            msg->secuencia = leerU32(p + 4);
+            msg->dia = p[8];
+            msg->parque = p[9];
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* ============================================================================
+ * RESPUESTAS DEL CONTROLADOR
+ * ============================================================================ */
+size_t codificarRespuesta(const RespuestaControlador *resp, uint8_t *trama) {
+    uint8_t *p = trama + TAM_CABECERA;
+
+    *p++ = (uint8_t)resp->motivo;
+    p = escribirU16(p, (uint16_t)(int16_t)resp->horaAsignada);
+    p = escribirU16(p, (uint16_t)(int16_t)resp->horaActual);
+    p = escribirU32(p, (uint32_t)resp->dato);
+    p = escribirU32(p, resp->secuencia);
+    p = escribirU16(p, (uint16_t)resp->duracion);
+    *p++ = (uint8_t)resp->transporte;
+    p = escribirU32(p, resp->idReserva);
+
+    return cerrarTrama(trama, (uint8_t)resp->tipo, p);
+}
+
+int decodificarRespuesta(const uint8_t *trama, size_t longitud, RespuestaControlador *resp) {
+    const uint8_t *p = trama + TAM_CABECERA;
+
+    if (longitud < TAM_CABECERA + 20) {
+        return 0;
+    }
+
+    resp->tipo = (TipoRespuesta)trama[1];
+    resp->motivo = (MotivoRespuesta)p[0];
+    resp->horaAsignada = (int16_t)leerU16(p + 1);
+    resp->horaActual = (int16_t)leerU16(p + 3);
+    resp->dato = (int32_t)leerU32(p + 5);
+    resp->secuencia = leerU32(p + 9);
+    resp->duracion = leerU16(p + 13);
+    resp->transporte = (TipoTransporte)p[15];
+    resp->idReserva = leerU32(p + 16);
+    return 1;
+}
+
+/*
+ * Reconstruye el texto legible de una respuesta a partir de su tipo y motivo.
+ * numPersonas es el tamaño del grupo de la solicitud original.
+ */
+void describirRespuesta(const RespuestaControlador *resp, int numPersonas, char *texto, size_t tam) {
+    char inicio[MAX_TEXTO_HORA];
+    char fin[MAX_TEXTO_HORA];
+
+    formatearHora(resp->horaAsignada, inicio, sizeof(inicio));
+    formatearHora(resp->horaAsignada + resp->duracion, fin, sizeof(fin));
+
+    switch (resp->tipo) {
+        case RESP_HORA_ACTUAL:
+            formatearHora(resp->horaActual, inicio, sizeof(inicio));
+            snprintf(texto, tam, "Bienvenido. Hora actual: %s", inicio);
+            break;
+        case RESP_RESERVA_OK:
+            snprintf(texto, tam, "Reserva APROBADA - Hora: %s - %s para %d personas",
+                     inicio, fin, numPersonas);
+            break;
+        case RESP_RESERVA_REPROG:
+            if (resp->motivo == MOTIVO_EXTEMPORANEA) {
+                snprintf(texto, tam, "Reserva REPROGRAMADA - Hora solicitada ya pasó. Nueva hora: %s - %s",
+                         inicio, fin);
+            } else {
+                snprintf(texto, tam, "Reserva REPROGRAMADA - Sin disponibilidad en hora solicitada. Nueva hora: %s - %s",
+                         inicio, fin);
+            }
+            break;
+        case RESP_RESERVA_NEGADA:
+            switch (resp->motivo) {
+                case MOTIVO_FUERA_DE_RANGO:
+                    snprintf(texto, tam, "Reserva NEGADA - Hora fuera del rango de operación (%d-%d)",
+                             HORAS_MIN, HORAS_MAX);
+                    break;
+                case MOTIVO_EXCEDE_AFORO:
+                    snprintf(texto, tam, "Reserva NEGADA - Número de personas (%d) excede el aforo máximo (%d). Debe volver otro día.",
+                             numPersonas, resp->dato);
+                    break;
+                case MOTIVO_EXTEMPORANEA:
+                    snprintf(texto, tam, "Reserva NEGADA - Hora extemporánea y sin disponibilidad posterior. Debe volver otro día.");
+                    break;
+                case MOTIVO_FUERA_DE_PERIODO:
+                    snprintf(texto, tam, "Reserva NEGADA - Hora solicitada fuera del periodo de simulación. Debe volver otro día.");
+                    break;
+                case MOTIVO_CALENDARIO_INEXISTENTE:
+                    snprintf(texto, tam, "Reserva NEGADA - El controlador no atiende ese día o parque.");
+                    break;
+                case MOTIVO_RESERVA_INEXISTENTE:
+                    snprintf(texto, tam, "Cambio NEGADO - La reserva no existe, es de otro agente o ya se canceló.");
+                    break;
+                case MOTIVO_RESERVA_INICIADA:
+                    snprintf(texto, tam, "Cambio NEGADO - La reserva ya comenzó.");
+                    break;
+                case MOTIVO_PERSONAS_INVALIDAS:
+                    snprintf(texto, tam, "Reserva NEGADA - El número de personas (%d) debe ser al menos 1.",
+                             numPersonas);
+                    break;
+                case MOTIVO_CAMBIO_SIN_CUPO:
+                    snprintf(texto, tam, "Cambio NEGADO - Sin disponibilidad para el cambio; se conserva la reserva original.");
+                    break;
+                default:
+                    snprintf(texto, tam, "Reserva NEGADA - Sin disponibilidad en todo el periodo. Debe volver otro día.");
+                    break;
+            }
+            break;
+        case RESP_RESERVA_CANCELADA:
+            snprintf(texto, tam, "Reserva CANCELADA - Se liberó la hora %s - %s (%d personas)",
+                     inicio, fin, resp->dato);
+            break;
+        case RESP_FIN_DIA:
+            snprintf(texto, tam, "Fin del día de operaciones");
+            break;
+        case RESP_OCUPADO:
+            snprintf(texto, tam, "Controlador OCUPADO - La cola de solicitudes está llena. Reintentar en %d ms.",
+                     resp->dato);
+            break;
+        default:
+            snprintf(texto, tam, "Respuesta desconocida");
+            break;
+    }
+}
+
+/* Formatea minutos desde la medianoche como "H:MM" (por ejemplo 8:00 u 8:15) */
+void formatearHora(int minutos, char *texto, size_t tam) {
+    snprintf(texto, tam, "%d:%02d", minutos / MINUTOS_POR_HORA, minutos % MINUTOS_POR_HORA);
+}
+
+/* ============================================================================
+ * LOTES DE SOLICITUDES
+ * ============================================================================ */
+#define TAM_CABECERA_LOTE 5  // idAgente + cantidad
+
+void inicializarLote(LoteSolicitudes *lote, uint32_t idAgente) {
+    lote->idAgente = idAgente;
+    lote->cantidad = 0;
+    lote->bytes = TAM_CABECERA_LOTE;
+}
+
+/* Agrega una solicitud; devuelve 0 si el lote está lleno o no cabe en la trama */
+int agregarALote(LoteSolicitudes *lote, int hora, int personas, int dia, int parque, const char *familia) {
+    size_t bytesElemento = 11 + strnlen(familia, MAX_NOMBRE - 1);
+
+    if (lote->cantidad == MAX_LOTE || TAM_CABECERA + lote->bytes + bytesElemento > MAX_TRAMA) {
+        return 0;
+    }
+
+    ElementoLote *elemento = &lote->elementos[lote->cantidad++];
+    elemento->horaSolicitada = hora;
+    elemento->numPersonas = personas;
+    elemento->dia = dia;
+    elemento->parque = parque;
+    strncpy(elemento->nombreFamilia, familia, MAX_NOMBRE - 1);
+    elemento->nombreFamilia[MAX_NOMBRE - 1] = '\0';
+    lote->bytes += bytesElemento;
+    return 1;
+}
+
+size_t codificarLote(const LoteSolicitudes *lote, uint8_t *trama) {
+    uint8_t *p = trama + TAM_CABECERA;
+
+    p = escribirU32(p, lote->idAgente);
+    *p++ = (uint8_t)lote->cantidad;
+    for (int i = 0; i < lote->cantidad; i++) {
+        p = escribirU32(p, (uint32_t)lote->elementos[i].horaSolicitada);
+        p = escribirU32(p, (uint32_t)lote->elementos[i].numPersonas);
+        *p++ = (uint8_t)lote->elementos[i].dia;
+        *p++ = (uint8_t)lote->elementos[i].parque;
+        p = escribirCadena(p, lote->elementos[i].nombreFamilia);
+    }
+
+    return cerrarTrama(trama, MSG_SOLICITUD_LOTE, p);
+}
+
+int decodificarLote(const uint8_t *trama, size_t longitud, LoteSolicitudes *lote) {
+    const uint8_t *p = trama + TAM_CABECERA;
+    const uint8_t *fin = trama + longitud;
+
+    if (trama[1] != MSG_SOLICITUD_LOTE || fin - p < TAM_CABECERA_LOTE) {
+        return 0;
+    }
+
+    lote->idAgente = leerU32(p);
+    lote->cantidad = p[4];
+    lote->bytes = (size_t)(fin - p);
+    p += TAM_CABECERA_LOTE;
+
+    if (lote->cantidad > MAX_LOTE) {
+        return 0;
+    }
+
+    for (int i = 0; i < lote->cantidad; i++) {
+        if (fin - p < 10) {
+            return 0;
+        }
+        lote->elementos[i].horaSolicitada = (int32_t)leerU32(p);
+        lote->elementos[i].numPersonas = (int32_t)leerU32(p + 4);
+        lote->elementos[i].dia = p[8];
+        lote->elementos[i].parque = p[9];
+        p += 10;
+        if (!leerCadena(&p, fin, lote->elementos[i].nombreFamilia)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+size_t codificarRespuestaLote(const RespuestaLote *resp, uint8_t *trama) {
+    uint8_t *p = trama + TAM_CABECERA;
+
+    p = escribirU16(p, (uint16_t)(int16_t)resp->horaActual);
+    p = escribirU16(p, (uint16_t)resp->duracion);
+    p = escribirU32(p, (uint32_t)resp->aforoMaximo);
+    *p++ = (uint8_t)resp->cantidad;
+    for (int i = 0; i < resp->cantidad; i++) {
+        *p++ = (uint8_t)resp->resultados[i].tipo;
+        *p++ = (uint8_t)resp->resultados[i].motivo;
+        p = escribirU16(p, (uint16_t)(int16_t)resp->resultados[i].horaAsignada);
+        p = escribirU32(p, resp->resultados[i].idReserva);
+    }
+
+    return cerrarTrama(trama, RESP_LOTE, p);
+}
+
+int decodificarRespuestaLote(const uint8_t *trama, size_t longitud, RespuestaLote *resp) {
+    const uint8_t *p = trama + TAM_CABECERA;
+    const uint8_t *fin = trama + longitud;
+
+    if (trama[1] != RESP_LOTE || fin - p < 9) {
+        return 0;
+    }
+
+    resp->horaActual = (int16_t)leerU16(p);
+    resp->duracion = leerU16(p + 2);
+    resp->aforoMaximo = (int32_t)leerU32(p + 4);
+    resp->cantidad = p[8];
+    p += 9;
+
+    if (resp->cantidad > MAX_LOTE || fin - p < 8 * resp->cantidad) {
+        return 0;
+    }
+
+    for (int i = 0; i < resp->cantidad; i++) {
+        resp->resultados[i].tipo = (TipoRespuesta)p[0];
+        resp->resultados[i].motivo = (MotivoRespuesta)p[1];
+        resp->resultados[i].horaAsignada = (int16_t)leerU16(p + 2);
+        resp->resultados[i].idReserva = leerU32(p + 4);
+        p += 8;
+    }
+    return 1;
+}
+
+/* Extrae el resultado i de un lote como una respuesta individual */
+void respuestaDeLote(const RespuestaLote *lote, int indice, RespuestaControlador *resp) {
+    resp->tipo = lote->resultados[indice].tipo;
+    resp->motivo = lote->resultados[indice].motivo;
+    resp->horaAsignada = lote->resultados[indice].horaAsignada;
+    resp->horaActual = lote->horaActual;
+    resp->duracion = lote->duracion;
+    resp->dato = (resp->motivo == MOTIVO_EXCEDE_AFORO) ? lote->aforoMaximo : 0;
+    resp->secuencia = 0;  // Los resultados de un lote van en orden
+    resp->transporte = TRANSPORTE_PIPE;  // Solo tiene sentido en el registro
+    resp->idReserva = lote->resultados[indice].idReserva;
+}
+
+/* ============================================================================
+ * DISPONIBILIDAD
+ * ============================================================================ */
+#define TAM_CABECERA_DISPONIBILIDAD 17
+
+_Static_assert(TAM_CABECERA + TAM_CABECERA_DISPONIBILIDAD + 4 * MAX_FRANJAS_CONSULTA <= MAX_TRAMA,
+               "La respuesta de disponibilidad no cabe en una trama");
+
+size_t codificarDisponibilidad(const RespuestaDisponibilidad *resp, uint8_t *trama) {
+    uint8_t *p = trama + TAM_CABECERA;
+
+    *p++ = (uint8_t)resp->motivo;
+    p = escribirU16(p, (uint16_t)(int16_t)resp->horaActual);
+    p = escribirU16(p, (uint16_t)resp->duracion);
+    p = escribirU16(p, (uint16_t)resp->minutosFranja);
+    p = escribirU32(p, resp->secuencia);
+    *p++ = (uint8_t)resp->dia;
+    *p++ = (uint8_t)resp->parque;
+    p = escribirU16(p, (uint16_t)(int16_t)resp->horaDesde);
+    p = escribirU16(p, (uint16_t)resp->cantidad);
+    for (int i = 0; i < resp->cantidad; i++) {
+        p = escribirU32(p, (uint32_t)resp->plazas[i]);
+    }
+
+    return cerrarTrama(trama, RESP_DISPONIBILIDAD, p);
+}
+
+int decodificarDisponibilidad(const uint8_t *trama, size_t longitud, RespuestaDisponibilidad *resp) {
+    const uint8_t *p = trama + TAM_CABECERA;
+    const uint8_t *fin = trama + longitud;
+
+    if (trama[1] != RESP_DISPONIBILIDAD || fin - p < TAM_CABECERA_DISPONIBILIDAD) {
+        return 0;
+    }
+
+    resp->motivo = (MotivoRespuesta)p[0];
+    resp->horaActual = (int16_t)leerU16(p + 1);
+    resp->duracion = leerU16(p + 3);
+    resp->minutosFranja = leerU16(p + 5);
+    resp->secuencia = leerU32(p + 7);
+    resp->dia = p[11];
+    resp->parque = p[12];
+    resp->horaDesde = (int16_t)leerU16(p + 13);
+    resp->cantidad = leerU16(p + 15);
+    p += TAM_CABECERA_DISPONIBILIDAD;
+
+    if (resp->cantidad > MAX_FRANJAS_CONSULTA || fin - p < 4 * resp->cantidad) {
+        return 0;
+    }
+
+    for (int i = 0; i < resp->cantidad; i++) {
+        resp->plazas[i] = (int32_t)leerU32(p);
+        p += 4;
+    }
+    return 1;
+}
+
+/* Tipo de mensaje o respuesta de una trama completa */
+int tipoTrama(const uint8_t *trama) {
+    return trama[1];
+}
+
+/*
+ * Id del agente y secuencia de una trama sin decodificarla entera, para
+ * responderla sin atenderla (RESP_OCUPADO). Todo cuerpo salvo el del
+ * registro empieza por el id; la secuencia (0 si no la lleva) le sigue.
+ * Devuelve 0 si es un registro o la trama es demasiado corta.
+ */
+int remitenteTrama(const uint8_t *trama, size_t longitud, uint32_t *idAgente, uint32_t *secuencia) {
+    const uint8_t *p = trama + TAM_CABECERA;
+    int conSecuencia = trama[1] == MSG_SOLICITUD_RESERVA || trama[1] == MSG_CANCELAR ||
+                       trama[1] == MSG_MODIFICAR || trama[1] == MSG_CONSULTA_DISPONIBILIDAD;
+
+    if (trama[1] == MSG_REGISTRO || longitud < TAM_CABECERA + (conSecuencia ? 8u : 4u)) {
+        return 0;
+    }
+
+    *idAgente = leerU32(p);
+    *secuencia = conSecuencia ? leerU32(p + 4) : 0;
+    return 1;
+}
+
+/* ============================================================================
+ * ARMADO DE TRAMAS DESDE UN PIPE
+ * ============================================================================ */
+void inicializarBufferTramas(BufferTramas *buf) {
+    buf->inicio = 0;
+    buf->fin = 0;
+}
+
+/* Lee del descriptor lo que haya disponible; devuelve lo mismo que read() */
+ssize_t llenarBufferTramas(BufferTramas *buf, int fd) {
+    // Compactar para dejar espacio al final
+    if (buf->inicio > 0) {
+        memmove(buf->datos, buf->datos + buf->inicio, buf->fin - buf->inicio);
+        buf->fin -= buf->inicio;
+        buf->inicio = 0;
+    }
+
+    ssize_t leidos;
+    do {
+        leidos = read(fd, buf->datos + buf->fin, sizeof(buf->datos) - buf->fin);
+    } while (leidos == -1 && errno == EINTR);
+
+    if (leidos > 0) {
+        buf->fin += (size_t)leidos;
+    }
+    return leidos;
+}
+
+/*
+ * Extrae la siguiente trama completa del buffer. Devuelve 1 si hay trama,
+ * 0 si faltan bytes y -1 si la cabecera es inválida (versión distinta o
+ * longitud imposible); en ese caso se descarta el contenido del buffer.
+ */
+int siguienteTrama(BufferTramas *buf, const uint8_t **trama, size_t *longitud) {
+    size_t disponibles = buf->fin - buf->inicio;
+
+    if (disponibles < TAM_CABECERA) {
+        return 0;
+    }
+
+    const uint8_t *cabecera = buf->datos + buf->inicio;
+    size_t total = TAM_CABECERA + leerU16(cabecera + 2);
+
+    if (cabecera[0] != PROTOCOLO_VERSION || total > MAX_TRAMA) {
+        buf->inicio = buf->fin = 0;
+        return -1;
+    }
+
+    if (disponibles < total) {
+        return 0;
+    }
+
+    *trama = cabecera;
+    *longitud = total;
+    buf->inicio += total;
+    return 1;
+}
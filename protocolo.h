@@ -0,0 +1,235 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: protocolo.h
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Protocolo binario entre agentes y controlador
+ * -----------------------------------------------
+ * Descripción:
+ * Define el protocolo compartido por el controlador y
+ * los agentes. Cada trama tiene una cabecera fija de
+ * 4 bytes (versión, tipo y longitud del cuerpo) seguida
+ * de un cuerpo compacto con enteros de tamaño fijo y
+ * cadenas con prefijo de longitud. Los nombres de los
+ * agentes se envían solo en el registro; a partir de
+ * ahí se usa el identificador asignado por el
+ * controlador. Las respuestas viajan como códigos y el
+ * texto legible se reconstruye en quien lo imprime.
+ * Un lote (MSG_SOLICITUD_LOTE) agrupa varias solicitudes
+ * en una sola trama y se responde con una sola trama
+ * RESP_LOTE con un resultado por solicitud.
+ * Cada solicitud individual lleva un número de
+ * secuencia que el controlador devuelve en la
+ * respuesta, de modo que un agente con varias
+ * solicitudes en vuelo pueda emparejarlas aunque
+ * lleguen en otro orden.
+ * Las horas viajan en minutos desde la medianoche, de
+ * modo que el controlador pueda trabajar con franjas
+ * de cualquier ancho; cada respuesta indica además la
+ * duración de la reserva asignada.
+ * Cada solicitud indica además el día (0 = hoy) y el
+ * parque cuyo calendario quiere reservar; el
+ * controlador mantiene un calendario independiente por
+ * cada combinación.
+ * En el registro el agente puede ofrecer un segmento de
+ * memoria compartida (ver anillo.h); la respuesta indica
+ * si el controlador lo aceptó o si la sesión sigue por
+ * los pipes.
+ * Cada reserva aprobada o reprogramada lleva un id que
+ * el agente puede usar después para cancelarla
+ * (MSG_CANCELAR) o cambiarla de hora o de tamaño
+ * (MSG_MODIFICAR) mientras no haya comenzado.
+ * Una consulta (MSG_CONSULTA_DISPONIBILIDAD) no cambia
+ * nada: se responde con una trama RESP_DISPONIBILIDAD
+ * con las personas que aún caben en una reserva que
+ * empiece en cada franja de un día y un parque.
+ * Si la cola de entrada del controlador está llena, la
+ * solicitud no se atiende: se responde enseguida con
+ * RESP_OCUPADO y una espera sugerida antes de
+ * reintentarla.
+ *****************************************************/
+
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define PROTOCOLO_VERSION 9  // v9: hora y personas de las solicitudes en 32 bits
+#define MAX_NOMBRE 128  // Para nombres de familias y agentes (incluye '\0')
+#define HORAS_MIN 7
+#define HORAS_MAX 19
+#define MINUTOS_POR_HORA 60
+#define MINUTO_APERTURA (HORAS_MIN * MINUTOS_POR_HORA)      // 7:00
+#define MINUTO_CIERRE ((HORAS_MAX + 1) * MINUTOS_POR_HORA)  // 20:00, fin de la última hora
+#define MAX_TEXTO_HORA 16  // "HH:MM" con margen
+#define TAM_CABECERA 4
+#define MAX_TRAMA 2048  // Por debajo de PIPE_BUF: cada write es atómico
+#define MAX_LOTE 64  // Máximo de solicitudes por lote
+#define MAX_DIAS 255     // Días (incluido hoy) que caben en el campo de un byte
+#define MAX_PARQUES 255  // Parques que caben en el campo de un byte
+#define TAM_BUFFER_TRAMAS 8192  // Buffer de lectura de tramas desde un pipe
+#define MAX_TEXTO_RESPUESTA 256
+#define MAX_FRANJAS_CONSULTA 480  // Franjas por respuesta de disponibilidad (4 bytes cada una)
+
+/* Tipos de mensaje entre agente y controlador */
+typedef enum {
+    MSG_REGISTRO,           // Registro inicial del agente
+    MSG_SOLICITUD_RESERVA,  // Solicitud de reserva
+    MSG_FIN_AGENTE,         // Agente termina
+    MSG_SOLICITUD_LOTE,     // Varias solicitudes en una trama
+    MSG_CANCELAR,           // Cancelar una reserva por su id
+    MSG_MODIFICAR,          // Cambiar la hora o el grupo de una reserva por su id
+    MSG_CONSULTA_DISPONIBILIDAD  // Plazas libres por franja de un día y un parque
+} TipoMensaje;
+
+/* Tipos de respuesta del controlador */
+typedef enum {
+    RESP_HORA_ACTUAL,       // Respuesta con hora actual
+    RESP_RESERVA_OK,        // Reserva aprobada
+    RESP_RESERVA_REPROG,    // Reserva reprogramada
+    RESP_RESERVA_NEGADA,    // Reserva negada
+    RESP_FIN_DIA,           // Fin del día
+    RESP_LOTE,              // Resultados de un lote, en el mismo orden
+    RESP_RESERVA_CANCELADA, // Reserva cancelada; su cupo vuelve a estar a la venta
+    RESP_DISPONIBILIDAD,    // Plazas libres por franja, en su propio formato
+    RESP_OCUPADO            // Cola llena: no se atendió; reintentar después de dato ms
+} TipoRespuesta;
+
+/* Motivo de una reprogramación o negación (sustituye al texto libre) */
+typedef enum {
+    MOTIVO_NINGUNO,
+    MOTIVO_FUERA_DE_RANGO,      // Hora fuera del rango de operación
+    MOTIVO_EXCEDE_AFORO,        // El grupo supera el aforo máximo
+    MOTIVO_EXTEMPORANEA,        // La hora solicitada ya pasó
+    MOTIVO_FUERA_DE_PERIODO,    // Hora posterior al fin de la simulación
+    MOTIVO_SIN_DISPONIBILIDAD,  // Sin cupo en la hora solicitada
+    MOTIVO_CALENDARIO_INEXISTENTE, // El controlador no atiende ese día o parque
+    MOTIVO_RESERVA_INEXISTENTE, // Id desconocido, de otro agente o ya cancelado
+    MOTIVO_RESERVA_INICIADA,    // La reserva ya comenzó y no se puede cambiar
+    MOTIVO_CAMBIO_SIN_CUPO,     // Sin cupo para la modificación; sigue la reserva original
+    MOTIVO_PERSONAS_INVALIDAS   // El grupo tiene menos de una persona
+} MotivoRespuesta;
+
+/* Canal por el que viajan las tramas de una sesión después del registro */
+typedef enum {
+    TRANSPORTE_PIPE,     // Pipes nominales (siempre disponible)
+    TRANSPORTE_MEMORIA   // Anillos en memoria compartida (ver anillo.h)
+} TipoTransporte;
+
+/* Mensaje del agente al controlador, ya decodificado */
+typedef struct {
+    TipoMensaje tipo;
+    uint32_t idAgente;              // Asignado por el controlador (0 = sin registrar)
+    uint32_t secuencia;             // Todo salvo registro, fin y lote; se devuelve en la respuesta
+    uint32_t idReserva;             // Solo en MSG_CANCELAR y MSG_MODIFICAR
+    int horaSolicitada;             // Minutos desde la medianoche
+    int numPersonas;
+    int dia;                        // Días a partir de hoy (0 = hoy); también en la consulta
+    int parque;                     // Parque o atracción (0 = el primero); también en la consulta
+    char nombreAgente[MAX_NOMBRE];  // Solo en MSG_REGISTRO
+    char pipeRespuesta[MAX_NOMBRE]; // Solo en MSG_REGISTRO
+    char segmentoMemoria[MAX_NOMBRE]; // Solo en MSG_REGISTRO ("" = solo pipes)
+    char nombreFamilia[MAX_NOMBRE]; // Solo en MSG_SOLICITUD_RESERVA
+} MensajeAgente;
+
+/* Respuesta del controlador al agente, ya decodificada */
+typedef struct {
+    TipoRespuesta tipo;
+    MotivoRespuesta motivo;
+    int horaAsignada;  // Minutos desde la medianoche
+    int horaActual;    // Minutos desde la medianoche
+    int duracion;      // Minutos que dura la reserva asignada
+    int32_t dato;  // RESP_HORA_ACTUAL: id del agente; MOTIVO_EXCEDE_AFORO: aforo máximo; RESP_OCUPADO: ms de espera
+    uint32_t secuencia;  // Copia de la secuencia de la solicitud (0 si no aplica)
+    TipoTransporte transporte;  // RESP_HORA_ACTUAL del registro: canal aceptado
+    uint32_t idReserva;  // Reserva aprobada o reprogramada (0 = ninguna)
+} RespuestaControlador;
+
+/* Una solicitud dentro de un lote */
+typedef struct {
+    int horaSolicitada;  // Minutos desde la medianoche
+    int numPersonas;
+    int dia;
+    int parque;
+    char nombreFamilia[MAX_NOMBRE];
+} ElementoLote;
+
+/* Lote de solicitudes de un agente, ya decodificado */
+typedef struct {
+    uint32_t idAgente;
+    int cantidad;
+    size_t bytes;  // Tamaño codificado del cuerpo, para no exceder MAX_TRAMA
+    ElementoLote elementos[MAX_LOTE];
+} LoteSolicitudes;
+
+/* Resultado de una solicitud (individual o dentro de un lote) */
+typedef struct {
+    TipoRespuesta tipo;
+    MotivoRespuesta motivo;
+    int horaAsignada;
+    uint32_t idReserva;  // 0 si se negó
+} ResultadoSolicitud;
+
+/* Respuesta a un lote, ya decodificada */
+typedef struct {
+    int horaActual;
+    int duracion;
+    int32_t aforoMaximo;
+    int cantidad;
+    ResultadoSolicitud resultados[MAX_LOTE];
+} RespuestaLote;
+
+/* Respuesta a una consulta de disponibilidad, ya decodificada */
+typedef struct {
+    MotivoRespuesta motivo;  // MOTIVO_CALENDARIO_INEXISTENTE si no hay tal calendario (sin franjas)
+    int horaActual;
+    int duracion;        // Minutos que dura una reserva
+    int minutosFranja;   // Ancho de cada franja
+    uint32_t secuencia;  // Copia de la secuencia de la consulta
+    int dia;
+    int parque;
+    int horaDesde;  // Minutos desde la medianoche de la primera franja
+    int cantidad;   // Franjas consecutivas desde horaDesde
+    int32_t plazas[MAX_FRANJAS_CONSULTA];  // Personas que caben en una reserva que empiece en cada una
+} RespuestaDisponibilidad;
+
+/* Acumula bytes leídos de un pipe hasta completar tramas */
+typedef struct {
+    uint8_t datos[TAM_BUFFER_TRAMAS];
+    size_t inicio;  // Primer byte sin consumir
+    size_t fin;     // Fin de los bytes válidos
+} BufferTramas;
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+size_t codificarMensaje(const MensajeAgente *msg, uint8_t *trama);
+int decodificarMensaje(const uint8_t *trama, size_t longitud, MensajeAgente *msg);
+size_t codificarRespuesta(const RespuestaControlador *resp, uint8_t *trama);
+int decodificarRespuesta(const uint8_t *trama, size_t longitud, RespuestaControlador *resp);
+void describirRespuesta(const RespuestaControlador *resp, int numPersonas, char *texto, size_t tam);
+void formatearHora(int minutos, char *texto, size_t tam);
+void inicializarLote(LoteSolicitudes *lote, uint32_t idAgente);
+int agregarALote(LoteSolicitudes *lote, int hora, int personas, int dia, int parque, const char *familia);
+size_t codificarLote(const LoteSolicitudes *lote, uint8_t *trama);
+int decodificarLote(const uint8_t *trama, size_t longitud, LoteSolicitudes *lote);
+size_t codificarRespuestaLote(const RespuestaLote *resp, uint8_t *trama);
+int decodificarRespuestaLote(const uint8_t *trama, size_t longitud, RespuestaLote *resp);
+void respuestaDeLote(const RespuestaLote *lote, int indice, RespuestaControlador *resp);
+size_t codificarDisponibilidad(const RespuestaDisponibilidad *resp, uint8_t *trama);
+int decodificarDisponibilidad(const uint8_t *trama, size_t longitud, RespuestaDisponibilidad *resp);
+int tipoTrama(const uint8_t *trama);
+int remitenteTrama(const uint8_t *trama, size_t longitud, uint32_t *idAgente, uint32_t *secuencia);
+void inicializarBufferTramas(BufferTramas *buf);
+ssize_t llenarBufferTramas(BufferTramas *buf, int fd);
+int siguienteTrama(BufferTramas *buf, const uint8_t **trama, size_t *longitud);
+
+#endif
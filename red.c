@@ -0,0 +1,238 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: red.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Transporte por sockets (Unix y TCP)
+ * -----------------------------------------------
+ * Descripción:
+ * Implementa la interpretación de direcciones y la
+ * apertura de sockets declaradas en red.h, tanto del
+ * lado que escucha (controlador) como del que se
+ * conecta (agente).
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "red.h"
+
+#define MAX_DIRECCION 256
+#define COLA_CONEXIONES 128  // Conexiones pendientes de aceptar
+
+/* ============================================================================
+ * INTERPRETACIÓN DE DIRECCIONES
+ * ============================================================================ */
+int esDireccionSocket(const char *direccion) {
+    return strncmp(direccion, PREFIJO_UNIX, strlen(PREFIJO_UNIX)) == 0 ||
+           strncmp(direccion, PREFIJO_TCP, strlen(PREFIJO_TCP)) == 0;
+}
+
+/* Ruta de una dirección Unix (NULL si no lo es) */
+static const char *rutaUnix(const char *direccion) {
+    if (strncmp(direccion, PREFIJO_UNIX, strlen(PREFIJO_UNIX)) != 0) {
+        return NULL;
+    }
+    return direccion + strlen(PREFIJO_UNIX);
+}
+
+/* Arma la dirección de un socket Unix; devuelve 0 si la ruta no cabe */
+static int direccionUnix(const char *ruta, struct sockaddr_un *dir) {
+    memset(dir, 0, sizeof(*dir));
+    dir->sun_family = AF_UNIX;
+    if (ruta[0] == '\0' || strlen(ruta) >= sizeof(dir->sun_path)) {
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+    strcpy(dir->sun_path, ruta);
+    return 1;
+}
+
+/*
+ * Resuelve "tcp:[host:]puerto" con getaddrinfo. Sin host se escucha en todas
+ * las interfaces (pasivo) o se conecta a la máquina local.
+ */
+static struct addrinfo *resolverTcp(const char *direccion, int pasivo) {
+    char copia[MAX_DIRECCION];
+    const char *host = NULL;
+    const char *puerto;
+    struct addrinfo pistas;
+    struct addrinfo *resultado;
+
+    strncpy(copia, direccion + strlen(PREFIJO_TCP), sizeof(copia) - 1);
+    copia[sizeof(copia) - 1] = '\0';
+
+    char *separador = strrchr(copia, ':');
+    if (separador != NULL) {
+        *separador = '\0';
+        host = copia[0] != '\0' ? copia : NULL;
+        puerto = separador + 1;
+    } else {
+        puerto = copia;
+    }
+
+    memset(&pistas, 0, sizeof(pistas));
+    pistas.ai_family = AF_UNSPEC;
+    pistas.ai_socktype = SOCK_STREAM;
+    pistas.ai_flags = pasivo ? AI_PASSIVE : 0;
+    if (getaddrinfo(host, puerto, &pistas, &resultado) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return resultado;
+}
+
+/* Sin Nagle: cada trama sale de inmediato aunque sea pequeña */
+static void desactivarNagle(int fd) {
+    int uno = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+}
+
+/* ============================================================================
+ * LADO QUE ESCUCHA (CONTROLADOR)
+ * ============================================================================ */
+/* Abre un socket de escucha no bloqueante en la dirección; devuelve -1 si falla */
+int escucharEn(const char *direccion) {
+    const char *ruta = rutaUnix(direccion);
+    int fd = -1;
+
+    if (ruta != NULL) {
+        struct sockaddr_un dir;
+        if (!direccionUnix(ruta, &dir)) {
+            return -1;
+        }
+        unlink(ruta);  // Eliminar si quedó de una ejecución anterior
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd != -1 && bind(fd, (struct sockaddr *)&dir, sizeof(dir)) == -1) {
+            close(fd);
+            fd = -1;
+        }
+    } else if (esDireccionSocket(direccion)) {
+        struct addrinfo *lista = resolverTcp(direccion, 1);
+        for (struct addrinfo *ai = lista; ai != NULL && fd == -1; ai = ai->ai_next) {
+            int uno = 1;
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd == -1) {
+                continue;
+            }
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == -1) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        if (lista != NULL) {
+            freeaddrinfo(lista);
+        }
+    } else {
+        errno = EINVAL;
+    }
+
+    if (fd == -1) {
+        return -1;
+    }
+    if (listen(fd, COLA_CONEXIONES) == -1) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+/*
+ * Acepta una conexión pendiente. La conexión queda no bloqueante (la lee el
+ * bucle de eventos) y, si es TCP, sin Nagle. Devuelve -1 si no hay más.
+ */
+int aceptarConexion(int fdEscucha) {
+    struct sockaddr_storage origen;
+    socklen_t tam = sizeof(origen);
+
+    int fd = accept(fdEscucha, (struct sockaddr *)&origen, &tam);
+    if (fd == -1) {
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (origen.ss_family == AF_INET || origen.ss_family == AF_INET6) {
+        desactivarNagle(fd);
+    }
+    return fd;
+}
+
+/* Borra el archivo de un socket Unix (las direcciones TCP no dejan rastro) */
+void eliminarDireccion(const char *direccion) {
+    const char *ruta = rutaUnix(direccion);
+    if (ruta != NULL) {
+        unlink(ruta);
+    }
+}
+
+/* ============================================================================
+ * LADO QUE SE CONECTA (AGENTE)
+ * ============================================================================ */
+/*
+ * Conecta con el controlador; devuelve un socket bloqueante o -1 con errno
+ * (ENOENT o ECONNREFUSED si el controlador aún no escucha).
+ */
+int conectarA(const char *direccion) {
+    const char *ruta = rutaUnix(direccion);
+    int fd = -1;
+
+    if (ruta != NULL) {
+        struct sockaddr_un dir;
+        if (!direccionUnix(ruta, &dir)) {
+            return -1;
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd != -1 && connect(fd, (struct sockaddr *)&dir, sizeof(dir)) == -1) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            fd = -1;
+        }
+        return fd;
+    }
+
+    if (!esDireccionSocket(direccion)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct addrinfo *lista = resolverTcp(direccion, 0);
+    int error = errno;
+    for (struct addrinfo *ai = lista; ai != NULL && fd == -1; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd == -1) {
+            error = errno;
+            continue;
+        }
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == -1) {
+            error = errno;
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (lista != NULL) {
+        freeaddrinfo(lista);
+    }
+
+    if (fd == -1) {
+        errno = error;
+        return -1;
+    }
+    desactivarNagle(fd);
+    return fd;
+}
@@ -0,0 +1,40 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: red.h
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Transporte por sockets (Unix y TCP)
+ * -----------------------------------------------
+ * Descripción:
+ * Permite que los agentes se conecten al controlador
+ * por un socket en lugar del pipe nominal, incluso
+ * desde otra máquina. Una dirección tiene la forma
+ * "unix:/ruta/al/socket" o "tcp:[host:]puerto"; por la
+ * conexión viajan las mismas tramas que por los pipes
+ * y se mantiene abierta durante toda la sesión del
+ * agente. En TCP se desactiva el algoritmo de Nagle
+ * para que las respuestas (tramas pequeñas) no esperen.
+ *****************************************************/
+
+#ifndef RED_H
+#define RED_H
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define PREFIJO_UNIX "unix:"
+#define PREFIJO_TCP "tcp:"
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+int esDireccionSocket(const char *direccion);
+int escucharEn(const char *direccion);
+int aceptarConexion(int fdEscucha);
+int conectarA(const char *direccion);
+void eliminarDireccion(const char *direccion);
+
+#endif
@@ -0,0 +1,287 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: registro.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Registro asíncrono de eventos del controlador
+ * -----------------------------------------------
+ * Descripción:
+ * Implementa la cola y el hilo escritor declarados en
+ * registro.h. Cada ranura lleva un número de secuencia
+ * que indica si está libre para el productor que toma
+ * esa posición o lista para el consumidor; los
+ * productores se reparten las posiciones con un
+ * compare-and-swap sobre la cabeza de la cola.
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "registro.h"
+
+#define MASCARA_REGISTRO (CAPACIDAD_REGISTRO - 1)
+
+typedef struct {
+    _Atomic size_t secuencia;  // == posición: libre; == posición + 1: lista para escribir
+    EventoRegistro evento;
+} RanuraRegistro;
+
+/* ============================================================================
+ * ESTADO DEL REGISTRO
+ * ============================================================================ */
+static RanuraRegistro *ranuras = NULL;
+static _Alignas(64) _Atomic size_t cabeza = 0;  // Próxima posición para un productor
+static _Alignas(64) size_t cola = 0;            // Próxima posición que leerá el hilo escritor
+
+static int fdRegistro = -1;
+static FormatearEvento formatearEvento = NULL;
+static struct timespec instanteInicio;
+static pthread_t hiloRegistro;
+static atomic_int registroActivo = 0;
+
+// Esperas: el escritor cuando no hay eventos, los productores cuando no hay ranuras
+static pthread_mutex_t mutexRegistro = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hayEventos = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t hayRanuras = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t eventosEscritos = PTHREAD_COND_INITIALIZER;
+static atomic_int escritorDurmiendo = 0;
+static atomic_int productoresEsperando = 0;
+static size_t posicionEscrita = 0;  // Eventos ya escritos (protegido por mutexRegistro)
+static int terminar = 0;
+
+/* ============================================================================
+ * ESCRITURA
+ * ============================================================================ */
+static double segundosDesdeInicio() {
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    return (double)(ahora.tv_sec - instanteInicio.tv_sec) +
+           (double)(ahora.tv_nsec - instanteInicio.tv_nsec) / 1e9;
+}
+
+/* Escribe el bloque completo aunque la salida lo acepte en partes */
+static void escribirSalida(const char *datos, size_t longitud) {
+    while (longitud > 0) {
+        ssize_t escritos = write(fdRegistro, datos, longitud);
+        if (escritos == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;  // Sin consola no hay a quién avisar
+        }
+        datos += escritos;
+        longitud -= (size_t)escritos;
+    }
+}
+
+/* Ranura de la posición si ya la publicó su productor (NULL si no) */
+static RanuraRegistro *ranuraLista(size_t posicion) {
+    RanuraRegistro *ranura = &ranuras[posicion & MASCARA_REGISTRO];
+    size_t secuencia = atomic_load_explicit(&ranura->secuencia, memory_order_acquire);
+    return secuencia == posicion + 1 ? ranura : NULL;
+}
+
+/*
+ * Hilo escritor: da formato a los eventos en un bloque de salida y lo escribe
+ * cuando se llena o cuando la cola queda vacía, antes de dormir.
+ */
+static void *hiloEscritorRegistro(void *arg) {
+    (void)arg;
+    char *salida = malloc(TAM_SALIDA_REGISTRO);
+    size_t usados = 0;
+
+    if (salida == NULL) {
+        perror("Error al reservar el búfer del registro");
+        return NULL;
+    }
+
+    for (;;) {
+        RanuraRegistro *ranura;
+        int liberadas = 0;
+
+        while ((ranura = ranuraLista(cola)) != NULL) {
+            if (TAM_SALIDA_REGISTRO - usados < MAX_TEXTO_EVENTO) {
+                escribirSalida(salida, usados);
+                usados = 0;
+            }
+            usados += formatearEvento(&ranura->evento, salida + usados, TAM_SALIDA_REGISTRO - usados);
+
+            // Devolver la ranura a los productores de la siguiente vuelta
+            atomic_store_explicit(&ranura->secuencia, cola + CAPACIDAD_REGISTRO, memory_order_release);
+            cola++;
+            liberadas = 1;
+
+            // Con la cola llena no hacer esperar a los productores hasta vaciarla
+            if ((cola & 255) == 0 && atomic_load(&productoresEsperando) > 0) {
+                pthread_mutex_lock(&mutexRegistro);
+                pthread_cond_broadcast(&hayRanuras);
+                pthread_mutex_unlock(&mutexRegistro);
+            }
+        }
+        if (usados > 0) {
+            escribirSalida(salida, usados);
+            usados = 0;
+        }
+
+        pthread_mutex_lock(&mutexRegistro);
+        posicionEscrita = cola;
+        pthread_cond_broadcast(&eventosEscritos);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (liberadas && atomic_load(&productoresEsperando) > 0) {
+            pthread_cond_broadcast(&hayRanuras);
+        }
+
+        // Anunciar que se va a dormir y volver a mirar: un productor que
+        // publique después verá escritorDurmiendo y despertará al escritor
+        atomic_store(&escritorDurmiendo, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (ranuraLista(cola) == NULL) {
+            if (terminar) {
+                pthread_mutex_unlock(&mutexRegistro);
+                break;
+            }
+            pthread_cond_wait(&hayEventos, &mutexRegistro);
+        }
+        atomic_store(&escritorDurmiendo, 0);
+        pthread_mutex_unlock(&mutexRegistro);
+    }
+
+    free(salida);
+    return NULL;
+}
+
+/* ============================================================================
+ * INTERFAZ
+ * ============================================================================ */
+/* Arranca el hilo escritor; devuelve 0 si no se pudo (se escribe en línea) */
+int iniciarRegistro(int fdSalida, FormatearEvento formatear) {
+    fdRegistro = fdSalida;
+    formatearEvento = formatear;
+    clock_gettime(CLOCK_MONOTONIC, &instanteInicio);
+
+    ranuras = calloc(CAPACIDAD_REGISTRO, sizeof(RanuraRegistro));
+    if (ranuras == NULL) {
+        return 0;
+    }
+    for (size_t i = 0; i < CAPACIDAD_REGISTRO; i++) {
+        atomic_init(&ranuras[i].secuencia, i);
+    }
+
+    if (pthread_create(&hiloRegistro, NULL, hiloEscritorRegistro, NULL) != 0) {
+        free(ranuras);
+        ranuras = NULL;
+        return 0;
+    }
+    atomic_store(&registroActivo, 1);
+    return 1;
+}
+
+/*
+ * Encola un evento (los datos se copian). Sin hilo escritor (antes de
+ * iniciarRegistro o después de terminarRegistro) se escribe en línea.
+ */
+void registrarEvento(int tipo, const void *datos, size_t tam) {
+    if (tam > TAM_DATOS_EVENTO) {
+        tam = TAM_DATOS_EVENTO;
+    }
+
+    if (!atomic_load_explicit(&registroActivo, memory_order_acquire)) {
+        static pthread_mutex_t mutexEnLinea = PTHREAD_MUTEX_INITIALIZER;
+        static char texto[MAX_TEXTO_EVENTO];
+        static EventoRegistro evento;
+        if (formatearEvento == NULL) {
+            return;
+        }
+        pthread_mutex_lock(&mutexEnLinea);
+        evento.tipo = tipo;
+        evento.instante = segundosDesdeInicio();
+        memcpy(evento.datos, datos, tam);
+        escribirSalida(texto, formatearEvento(&evento, texto, sizeof(texto)));
+        pthread_mutex_unlock(&mutexEnLinea);
+        return;
+    }
+
+    // Tomar una posición: su ranura está libre cuando su secuencia coincide
+    size_t posicion = atomic_load_explicit(&cabeza, memory_order_relaxed);
+    RanuraRegistro *ranura;
+    for (;;) {
+        ranura = &ranuras[posicion & MASCARA_REGISTRO];
+        size_t secuencia = atomic_load_explicit(&ranura->secuencia, memory_order_acquire);
+        intptr_t diferencia = (intptr_t)secuencia - (intptr_t)posicion;
+
+        if (diferencia == 0) {
+            if (atomic_compare_exchange_weak_explicit(&cabeza, &posicion, posicion + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diferencia < 0) {
+            // Cola llena: esperar a que el escritor libere ranuras
+            pthread_mutex_lock(&mutexRegistro);
+            atomic_fetch_add(&productoresEsperando, 1);
+            atomic_thread_fence(memory_order_seq_cst);
+            if ((intptr_t)atomic_load(&ranura->secuencia) - (intptr_t)posicion < 0) {
+                pthread_cond_wait(&hayRanuras, &mutexRegistro);
+            }
+            atomic_fetch_sub(&productoresEsperando, 1);
+            pthread_mutex_unlock(&mutexRegistro);
+            posicion = atomic_load_explicit(&cabeza, memory_order_relaxed);
+        } else {
+            posicion = atomic_load_explicit(&cabeza, memory_order_relaxed);
+        }
+    }
+
+    ranura->evento.tipo = tipo;
+    ranura->evento.instante = segundosDesdeInicio();
+    memcpy(ranura->evento.datos, datos, tam);
+    atomic_store_explicit(&ranura->secuencia, posicion + 1, memory_order_release);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&escritorDurmiendo)) {
+        pthread_mutex_lock(&mutexRegistro);
+        pthread_cond_signal(&hayEventos);
+        pthread_mutex_unlock(&mutexRegistro);
+    }
+}
+
+/* Espera a que todo lo encolado hasta ahora esté escrito */
+void vaciarRegistro() {
+    if (!atomic_load(&registroActivo)) {
+        return;
+    }
+
+    size_t objetivo = atomic_load(&cabeza);
+    pthread_mutex_lock(&mutexRegistro);
+    pthread_cond_signal(&hayEventos);
+    while (posicionEscrita < objetivo) {
+        pthread_cond_wait(&eventosEscritos, &mutexRegistro);
+    }
+    pthread_mutex_unlock(&mutexRegistro);
+}
+
+/* Escribe lo pendiente y detiene el hilo; lo que se registre después va en línea */
+void terminarRegistro() {
+    if (!atomic_load(&registroActivo)) {
+        return;
+    }
+
+    vaciarRegistro();
+    atomic_store(&registroActivo, 0);
+
+    pthread_mutex_lock(&mutexRegistro);
+    terminar = 1;
+    pthread_cond_signal(&hayEventos);
+    pthread_mutex_unlock(&mutexRegistro);
+    pthread_join(hiloRegistro, NULL);
+
+    free(ranuras);
+    ranuras = NULL;
+}
@@ -0,0 +1,56 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: registro.h
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Registro asíncrono de eventos del controlador
+ * -----------------------------------------------
+ * Descripción:
+ * Saca la escritura en consola del camino de las
+ * solicitudes. Quien produce un evento solo copia sus
+ * datos a una ranura de una cola circular sin cerrojos
+ * (varios productores, un consumidor); un hilo propio
+ * los da formato con la función que se le indique y
+ * los escribe en bloques grandes con write(). Un
+ * productor solo espera si la cola está llena, nunca
+ * por la consola directamente.
+ *****************************************************/
+
+#ifndef REGISTRO_H
+#define REGISTRO_H
+
+#include <stddef.h>
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define CAPACIDAD_REGISTRO 4096       // Eventos encolados (potencia de 2)
+#define TAM_DATOS_EVENTO 320          // Datos de un evento, copiados tal cual
+#define TAM_SALIDA_REGISTRO 65536     // Bloque de salida del hilo que escribe
+#define MAX_TEXTO_EVENTO 8192         // Lo más que puede ocupar un evento con formato
+
+/* Evento tal como lo recibe la función de formato */
+typedef struct {
+    int tipo;
+    double instante;  // Segundos desde iniciarRegistro
+    _Alignas(16) unsigned char datos[TAM_DATOS_EVENTO];
+} EventoRegistro;
+
+/*
+ * Da formato a un evento en destino (hay al menos MAX_TEXTO_EVENTO bytes) y
+ * devuelve los bytes escritos; 0 si el evento no produce salida.
+ */
+typedef size_t (*FormatearEvento)(const EventoRegistro *evento, char *destino, size_t tam);
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+int iniciarRegistro(int fdSalida, FormatearEvento formatear);
+void registrarEvento(int tipo, const void *datos, size_t tam);
+void vaciarRegistro();
+void terminarRegistro();
+
+#endif
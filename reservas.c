@@ -0,0 +1,693 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: reservas.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Calendarios, admisión y avance de hora
+ * -----------------------------------------------
+ * Descripción:
+ * Implementa los calendarios declarados en reservas.h:
+ * su creación, el almacén de reservas por bloques, la
+ * tabla de cadenas, el índice de capacidad libre (un
+ * árbol de segmentos alimentado por el núcleo
+ * vectorizado de ventanas.h), la ocupación atómica por
+ * franja con su contador de secuencia, la elección de
+ * la franja de una reserva y el avance del reloj. Quien
+ * llame se encarga de tomar cal->mutexReservas donde se
+ * indica; solo avanzarCalendario lo toma por sí misma,
+ * y las consultas de disponibilidad no lo toman nunca.
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "reservas.h"
+#include "ventanas.h"
+
+#define UMBRAL_BARRIDO_VENTANAS 512  // Hasta cuántas franjas la búsqueda barre las hojas en vez de bajar por el árbol
+
+// Geometría de los calendarios (ver configurarCalendarios)
+static int numFranjas;
+static int franjasPorReserva;
+static int aforoMaximo;
+static int franjaFinPeriodo;
+static int hojasIndice;  // Hojas del índice de capacidad: potencia de 2 >= numFranjas
+
+static void inicializarIndiceCapacidad(Calendario *cal);
+static void actualizarIndiceFranjas(Calendario *cal, int desde, int hasta);
+static Reserva *nuevaReserva(Calendario *cal);
+static void agregarAListaFranja(Calendario *cal, ListaFranja *lista, int indice, int esInicio);
+static void liberarAlmacen(Calendario *cal);
+
+static int franjaValida(int franja) {
+    return (franja >= 0 && franja < numFranjas);
+}
+
+/* ============================================================================
+ * CALENDARIOS
+ * ============================================================================ */
+void configurarCalendarios(const ConfiguracionCalendarios *config) {
+    numFranjas = config->numFranjas;
+    franjasPorReserva = config->franjasPorReserva;
+    aforoMaximo = config->aforoMaximo;
+    franjaFinPeriodo = config->franjaFinPeriodo;
+
+    // La primera potencia de dos que cubre todas las franjas
+    for (hojasIndice = 1; hojasIndice < numFranjas; hojasIndice *= 2) {
+    }
+
+    // El mejor núcleo que soporte el procesador, salvo que ya se haya fijado uno
+    if (nucleoVentanas() == NULL) {
+        elegirNucleoVentanas(NULL);
+    }
+}
+
+/* Prepara un calendario vacío con sus estructuras por franja. */
+void inicializarCalendario(Calendario *cal, int dia, int parque, int franjaMinima) {
+    memset(cal, 0, sizeof(*cal));
+    cal->dia = dia;
+    cal->parque = parque;
+    cal->franjaMinima = franjaMinima;
+
+    // Estructuras por franja, dimensionadas desde el inicio para numFranjas
+    cal->ocupacionPorFranja = aligned_alloc(TAM_LINEA_CACHE, sizeof(OcupacionFranja) * numFranjas);
+    cal->reservasQueInician = malloc(sizeof(ListaFranja) * numFranjas);
+    cal->reservasQueTerminan = malloc(sizeof(ListaFranja) * numFranjas);
+    if (cal->ocupacionPorFranja == NULL || cal->reservasQueInician == NULL || cal->reservasQueTerminan == NULL) {
+        perror("Error al reservar memoria para las franjas");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < numFranjas; i++) {
+        atomic_init(&cal->ocupacionPorFranja[i].personas, 0);
+    }
+    atomic_init(&cal->versionOcupacion, 0);
+    inicializarIndiceCapacidad(cal);
+    for (int i = 0; i < numFranjas; i++) {
+        cal->reservasQueInician[i].primera = cal->reservasQueInician[i].ultima = -1;
+        cal->reservasQueTerminan[i].primera = cal->reservasQueTerminan[i].ultima = -1;
+    }
+
+    pthread_mutex_init(&cal->mutexReservas, NULL);
+}
+
+void liberarCalendario(Calendario *cal) {
+    liberarAlmacen(cal);
+    free(cal->ocupacionPorFranja);
+    free(cal->ocupacionContigua);
+    free(cal->arbolVentanas);
+    free(cal->reservasQueInician);
+    free(cal->reservasQueTerminan);
+    pthread_mutex_destroy(&cal->mutexReservas);
+}
+
+/* ============================================================================
+ * REGISTRO DE RESERVAS
+ * ============================================================================ */
+/* Guarda en el almacén una reserva cuyo cupo ya se ocupó. Requiere cal->mutexReservas tomado. */
+void insertarReserva(Calendario *cal, const char *familia, const char *agente, int franjaInicio, int numPersonas) {
+    int indice = cal->almacen.cantidad;
+    Reserva *reserva = nuevaReserva(cal);
+
+    reserva->idFamilia = internarCadena(cal, familia);
+    reserva->idAgente = internarCadena(cal, agente);
+    reserva->franjaInicio = franjaInicio;
+    reserva->franjaFin = franjaInicio + franjasPorReserva - 1;
+    reserva->numPersonas = numPersonas;
+    reserva->activa = 0;  // Se activará cuando llegue su hora
+    reserva->cancelada = 0;
+    reserva->siguienteQueInicia = -1;
+    reserva->siguienteQueTermina = -1;
+
+    // Indexar por franja de inicio y de fin para que el reloj no recorra todo el almacén
+    if (franjaValida(reserva->franjaInicio)) {
+        agregarAListaFranja(cal, &cal->reservasQueInician[reserva->franjaInicio], indice, 1);
+    }
+    if (franjaValida(reserva->franjaFin)) {
+        agregarAListaFranja(cal, &cal->reservasQueTerminan[reserva->franjaFin], indice, 0);
+    }
+}
+
+/* ============================================================================
+ * ALMACÉN DE RESERVAS Y TABLA DE CADENAS
+ * ============================================================================ */
+/* Devuelve una reserva nueva al final del almacén. Requiere cal->mutexReservas tomado. */
+static Reserva *nuevaReserva(Calendario *cal) {
+    int bloque = cal->almacen.cantidad / TAM_BLOQUE_RESERVAS;
+
+    if (bloque == cal->almacen.numBloques) {
+        // Crecer el arreglo de bloques; las reservas existentes no se mueven
+        if (cal->almacen.numBloques == cal->almacen.capacidadBloques) {
+            int nuevaCapacidad = cal->almacen.capacidadBloques ? cal->almacen.capacidadBloques * 2 : 4;
+            Reserva **bloques = realloc(cal->almacen.bloques, sizeof(Reserva *) * nuevaCapacidad);
+            if (bloques == NULL) {
+                perror("Error al reservar memoria para el almacén de reservas");
+                exit(EXIT_FAILURE);
+            }
+            cal->almacen.bloques = bloques;
+            cal->almacen.capacidadBloques = nuevaCapacidad;
+        }
+
+        cal->almacen.bloques[bloque] = malloc(sizeof(Reserva) * TAM_BLOQUE_RESERVAS);
+        if (cal->almacen.bloques[bloque] == NULL) {
+            perror("Error al reservar memoria para el almacén de reservas");
+            exit(EXIT_FAILURE);
+        }
+        cal->almacen.numBloques++;
+    }
+
+    return &cal->almacen.bloques[bloque][cal->almacen.cantidad++ % TAM_BLOQUE_RESERVAS];
+}
+
+Reserva *obtenerReserva(Calendario *cal, int indice) {
+    return &cal->almacen.bloques[indice / TAM_BLOQUE_RESERVAS][indice % TAM_BLOQUE_RESERVAS];
+}
+
+/* Como obtenerReserva, pero con el índice sin validar: NULL si no existe o ya se canceló */
+Reserva *buscarReserva(Calendario *cal, int indice) {
+    if (indice < 0 || indice >= cal->almacen.cantidad) {
+        return NULL;
+    }
+
+    Reserva *reserva = obtenerReserva(cal, indice);
+    return reserva->cancelada ? NULL : reserva;
+}
+
+/*
+ * Cancela una reserva vigente que todavía no ha comenzado: resta sus personas
+ * de las franjas que ocupaba y actualiza el índice solo en ellas, de modo que
+ * el cupo queda a la venta de inmediato. La reserva sigue en el almacén (los
+ * índices de las demás no cambian) y el reloj la salta al activar.
+ */
+void cancelarReserva(Calendario *cal, int indice) {
+    Reserva *reserva = obtenerReserva(cal, indice);
+
+    ocuparVentana(cal, reserva->franjaInicio, -reserva->numPersonas);
+    reserva->cancelada = 1;
+}
+
+/* Deshace cancelarReserva si la ventana sigue teniendo cupo; devuelve 0 si no */
+int restituirReserva(Calendario *cal, int indice) {
+    Reserva *reserva = obtenerReserva(cal, indice);
+
+    if (!ocuparVentana(cal, reserva->franjaInicio, reserva->numPersonas)) {
+        return 0;
+    }
+    reserva->cancelada = 0;
+    return 1;
+}
+
+/* Agrega la reserva al final de una lista por franja. Requiere cal->mutexReservas tomado. */
+static void agregarAListaFranja(Calendario *cal, ListaFranja *lista, int indice, int esInicio) {
+    if (lista->ultima == -1) {
+        lista->primera = indice;
+    } else if (esInicio) {
+        obtenerReserva(cal, lista->ultima)->siguienteQueInicia = indice;
+    } else {
+        obtenerReserva(cal, lista->ultima)->siguienteQueTermina = indice;
+    }
+    lista->ultima = indice;
+}
+
+/* Hash FNV-1a de una cadena */
+static uint32_t hashCadena(const char *cadena) {
+    uint32_t hash = 2166136261u;
+    while (*cadena) {
+        hash ^= (uint8_t)*cadena++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Inserta un id en la primera ranura libre de su secuencia de sondeo */
+static void insertarRanura(uint32_t *ranuras, uint32_t numRanuras, const char *cadena, uint32_t id) {
+    uint32_t i = hashCadena(cadena) & (numRanuras - 1);
+    while (ranuras[i] != 0) {
+        i = (i + 1) & (numRanuras - 1);
+    }
+    ranuras[i] = id + 1;
+}
+
+/*
+ * Devuelve el id de la cadena, guardándola si es la primera vez que aparece.
+ * Requiere cal->mutexReservas tomado.
+ */
+uint32_t internarCadena(Calendario *cal, const char *cadena) {
+    uint32_t i;
+
+    if (cal->cadenas.numRanuras > 0) {
+        i = hashCadena(cadena) & (cal->cadenas.numRanuras - 1);
+        while (cal->cadenas.ranuras[i] != 0) {
+            uint32_t id = cal->cadenas.ranuras[i] - 1;
+            if (strcmp(cal->cadenas.cadenas[id], cadena) == 0) {
+                return id;
+            }
+            i = (i + 1) & (cal->cadenas.numRanuras - 1);
+        }
+    }
+
+    // Mantener la tabla hash a lo sumo medio llena
+    if ((cal->cadenas.numCadenas + 1) * 2 > cal->cadenas.numRanuras) {
+        uint32_t numRanuras = cal->cadenas.numRanuras ? cal->cadenas.numRanuras * 2 : RANURAS_INICIALES_CADENAS;
+        uint32_t *ranuras = calloc(numRanuras, sizeof(uint32_t));
+        if (ranuras == NULL) {
+            perror("Error al reservar memoria para la tabla de cadenas");
+            exit(EXIT_FAILURE);
+        }
+        for (uint32_t id = 0; id < cal->cadenas.numCadenas; id++) {
+            insertarRanura(ranuras, numRanuras, cal->cadenas.cadenas[id], id);
+        }
+        free(cal->cadenas.ranuras);
+        cal->cadenas.ranuras = ranuras;
+        cal->cadenas.numRanuras = numRanuras;
+    }
+
+    if (cal->cadenas.numCadenas == cal->cadenas.capacidadCadenas) {
+        uint32_t nuevaCapacidad = cal->cadenas.capacidadCadenas ? cal->cadenas.capacidadCadenas * 2 : RANURAS_INICIALES_CADENAS / 2;
+        char **cadenas = realloc(cal->cadenas.cadenas, sizeof(char *) * nuevaCapacidad);
+        if (cadenas == NULL) {
+            perror("Error al reservar memoria para la tabla de cadenas");
+            exit(EXIT_FAILURE);
+        }
+        cal->cadenas.cadenas = cadenas;
+        cal->cadenas.capacidadCadenas = nuevaCapacidad;
+    }
+
+    uint32_t id = cal->cadenas.numCadenas;
+    cal->cadenas.cadenas[id] = strdup(cadena);
+    if (cal->cadenas.cadenas[id] == NULL) {
+        perror("Error al reservar memoria para la tabla de cadenas");
+        exit(EXIT_FAILURE);
+    }
+    cal->cadenas.numCadenas++;
+    insertarRanura(cal->cadenas.ranuras, cal->cadenas.numRanuras, cadena, id);
+
+    return id;
+}
+
+const char *cadenaInternada(Calendario *cal, uint32_t id) {
+    return cal->cadenas.cadenas[id];
+}
+
+static void liberarAlmacen(Calendario *cal) {
+    for (int b = 0; b < cal->almacen.numBloques; b++) {
+        free(cal->almacen.bloques[b]);
+    }
+    free(cal->almacen.bloques);
+    cal->almacen.bloques = NULL;
+    cal->almacen.numBloques = cal->almacen.capacidadBloques = cal->almacen.cantidad = 0;
+
+    for (uint32_t id = 0; id < cal->cadenas.numCadenas; id++) {
+        free(cal->cadenas.cadenas[id]);
+    }
+    free(cal->cadenas.cadenas);
+    free(cal->cadenas.ranuras);
+    cal->cadenas.cadenas = NULL;
+    cal->cadenas.ranuras = NULL;
+    cal->cadenas.numCadenas = cal->cadenas.capacidadCadenas = cal->cadenas.numRanuras = 0;
+}
+
+/* ============================================================================
+ * ÍNDICE DE CAPACIDAD LIBRE
+ * ============================================================================ */
+/*
+ * Dos arreglos sobre las franjas de operación:
+ *  - ocupacionContigua: copia de la ocupación con franjasPorReserva ceros de
+ *    relleno al final, para que toda ventana se lea completa (una ventana
+ *    recortada al horario solo suma ceros).
+ *  - arbolVentanas: árbol de segmentos cuyas hojas guardan, para cada franja
+ *    de inicio f, la ocupación máxima de su ventana [f, f + franjasPorReserva),
+ *    y sus nodos el mínimo de esos valores por rango. Una ventana admite n
+ *    personas si su valor más n no supera el aforo.
+ * Los máximos por ventana los calcula el núcleo vectorizado (ventanas.h)
+ * sobre la copia contigua, varias franjas de inicio por instrucción: una
+ * reserva recalcula las ventanas que se solapan con ella y sube el mínimo
+ * una sola vez por todo el rango, en O(franjasPorReserva² / ancho del vector
+ * + log F) en lugar de una consulta y una subida por ventana. La
+ * verificación lee una hoja (O(1)); la búsqueda de la primera ventana libre
+ * barre las hojas de 64 en 64 con máscaras si el rango es corto y baja por
+ * el árbol (O(log F)) si es largo.
+ */
+
+/* Recalcula las ventanas que empiezan en [desde, hasta] y el mínimo de sus ancestros. */
+static void actualizarVentanas(Calendario *cal, int desde, int hasta) {
+    maximosVentana(cal->ocupacionContigua + desde, hasta - desde + 1, franjasPorReserva,
+                   cal->arbolVentanas + hojasIndice + desde);
+
+    for (desde = (hojasIndice + desde) / 2, hasta = (hojasIndice + hasta) / 2; desde >= 1; desde /= 2, hasta /= 2) {
+        for (int nodo = desde; nodo <= hasta; nodo++) {
+            int izq = cal->arbolVentanas[2 * nodo];
+            int der = cal->arbolVentanas[2 * nodo + 1];
+            cal->arbolVentanas[nodo] = izq < der ? izq : der;
+        }
+    }
+}
+
+/* Primera hoja en [desde, hasta] con valor <= limite dentro del nodo dado; -1 si no hay. */
+static int primeraVentanaLibre(Calendario *cal, int nodo, int ini, int fin, int desde, int hasta, int limite) {
+    if (fin < desde || ini > hasta || cal->arbolVentanas[nodo] > limite) {
+        return -1;
+    }
+    if (ini == fin) {
+        return ini;
+    }
+
+    int medio = (ini + fin) / 2;
+    int indice = primeraVentanaLibre(cal, 2 * nodo, ini, medio, desde, hasta, limite);
+    if (indice == -1) {
+        indice = primeraVentanaLibre(cal, 2 * nodo + 1, medio + 1, fin, desde, hasta, limite);
+    }
+    return indice;
+}
+
+/* Última hoja en [desde, hasta] con valor <= limite dentro del nodo dado; -1 si no hay. */
+static int ultimaVentanaLibre(Calendario *cal, int nodo, int ini, int fin, int desde, int hasta, int limite) {
+    if (fin < desde || ini > hasta || cal->arbolVentanas[nodo] > limite) {
+        return -1;
+    }
+    if (ini == fin) {
+        return ini;
+    }
+
+    int medio = (ini + fin) / 2;
+    int indice = ultimaVentanaLibre(cal, 2 * nodo + 1, medio + 1, fin, desde, hasta, limite);
+    if (indice == -1) {
+        indice = ultimaVentanaLibre(cal, 2 * nodo, ini, medio, desde, hasta, limite);
+    }
+    return indice;
+}
+
+/* Lo mismo recorriendo las hojas en orden, FRANJAS_MASCARA por máscara */
+static int barrerVentanasLibres(Calendario *cal, int desde, int hasta, int limite) {
+    const int *ventanas = cal->arbolVentanas + hojasIndice;
+
+    for (int base = desde; base <= hasta; base += FRANJAS_MASCARA) {
+        int cantidad = hasta - base + 1 < FRANJAS_MASCARA ? hasta - base + 1 : FRANJAS_MASCARA;
+        uint64_t libres = mascaraVentanasLibres(ventanas + base, cantidad, limite);
+        if (libres != 0) {
+            return base + __builtin_ctzll(libres);
+        }
+    }
+    return -1;
+}
+
+/* Y en orden inverso, desde hasta hacia desde */
+static int barrerVentanasLibresAtras(Calendario *cal, int desde, int hasta, int limite) {
+    const int *ventanas = cal->arbolVentanas + hojasIndice;
+
+    for (int tope = hasta; tope >= desde; tope -= FRANJAS_MASCARA) {
+        int base = tope - FRANJAS_MASCARA + 1 > desde ? tope - FRANJAS_MASCARA + 1 : desde;
+        uint64_t libres = mascaraVentanasLibres(ventanas + base, tope - base + 1, limite);
+        if (libres != 0) {
+            return base + 63 - __builtin_clzll(libres);
+        }
+    }
+    return -1;
+}
+
+/* Primera (o última, si atras) ventana libre en [desde, hasta], por máscaras o por el árbol */
+static int buscarVentanaLibre(Calendario *cal, int desde, int hasta, int limite, int atras) {
+    if (desde > hasta) {
+        return -1;
+    }
+    if (hasta - desde < UMBRAL_BARRIDO_VENTANAS) {
+        return atras ? barrerVentanasLibresAtras(cal, desde, hasta, limite)
+                     : barrerVentanasLibres(cal, desde, hasta, limite);
+    }
+    return atras ? ultimaVentanaLibre(cal, 1, 0, hojasIndice - 1, desde, hasta, limite)
+                 : primeraVentanaLibre(cal, 1, 0, hojasIndice - 1, desde, hasta, limite);
+}
+
+static void inicializarIndiceCapacidad(Calendario *cal) {
+    cal->ocupacionContigua = calloc(numFranjas + franjasPorReserva, sizeof(int));
+    cal->arbolVentanas = malloc(2 * hojasIndice * sizeof(int));
+    if (cal->ocupacionContigua == NULL || cal->arbolVentanas == NULL) {
+        perror("Error al reservar el índice de capacidad");
+        exit(EXIT_FAILURE);
+    }
+
+    // Ocupación en cero; las hojas sin franja asociada nunca son una ventana libre
+    for (int i = 0; i < 2 * hojasIndice; i++) {
+        cal->arbolVentanas[i] = INT_MAX;
+    }
+    actualizarVentanas(cal, 0, numFranjas - 1);
+}
+
+/* Copia al índice la ocupación de las franjas [desde, hasta]. Requiere cal->mutexReservas tomado. */
+static void actualizarIndiceFranjas(Calendario *cal, int desde, int hasta) {
+    for (int f = desde; f <= hasta; f++) {
+        cal->ocupacionContigua[f] = leerOcupacion(cal, f);
+    }
+
+    // Solo cambian las ventanas que contienen alguna de estas franjas
+    desde = desde - franjasPorReserva + 1 > 0 ? desde - franjasPorReserva + 1 : 0;
+    actualizarVentanas(cal, desde, hasta);
+}
+
+/* ============================================================================
+ * OCUPACIÓN POR FRANJA
+ * ============================================================================ */
+/*
+ * La ocupación de cada franja es un contador atómico acotado a [0, aforo]:
+ * ajustarCupo suma (o resta, con personas negativas) con compare-and-swap y
+ * falla sin modificar nada si el resultado saldría del rango. Los lectores
+ * (reloj y reporte) la consultan sin tomar el mutex del calendario. Las
+ * escrituras siguen ocurriendo dentro de la admisión, porque el índice de
+ * capacidad y el registro de reservas deben cambiar junto con ella; el tope
+ * del contador garantiza además que ninguna franja supere el aforo.
+ */
+int ajustarCupo(OcupacionFranja *franja, int personas) {
+    int actual = atomic_load_explicit(&franja->personas, memory_order_relaxed);
+
+    do {
+        int nueva = actual + personas;
+        if (nueva < 0 || nueva > aforoMaximo) {
+            return 0;
+        }
+        // Si otro hilo cambió el contador, actual se recarga y se vuelve a comprobar
+    } while (!atomic_compare_exchange_weak_explicit(&franja->personas, &actual, actual + personas,
+                                                    memory_order_acq_rel, memory_order_relaxed));
+
+    return 1;
+}
+
+int leerOcupacion(Calendario *cal, int franja) {
+    return atomic_load_explicit(&cal->ocupacionPorFranja[franja].personas, memory_order_acquire);
+}
+
+/*
+ * Suma personas a todas las franjas de una reserva que empieza en franjaInicio.
+ * Si alguna no tiene cupo deshace las anteriores y devuelve 0. Requiere
+ * cal->mutexReservas tomado (por el índice de capacidad), que además hace de
+ * este el único escritor del contador de secuencia: los cambios, y los que
+ * se deshacen, quedan entre las dos escrituras del contador.
+ */
+int ocuparVentana(Calendario *cal, int franjaInicio, int personas) {
+    unsigned version = atomic_load_explicit(&cal->versionOcupacion, memory_order_relaxed);
+    int fin = franjaInicio;
+    int cabe = 1;
+
+    atomic_store_explicit(&cal->versionOcupacion, version + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (; fin < franjaInicio + franjasPorReserva && franjaValida(fin); fin++) {
+        if (!ajustarCupo(&cal->ocupacionPorFranja[fin], personas)) {
+            for (int f = franjaInicio; f < fin; f++) {
+                ajustarCupo(&cal->ocupacionPorFranja[f], -personas);
+            }
+            cabe = 0;
+            break;
+        }
+    }
+
+    atomic_store_explicit(&cal->versionOcupacion, version + 2, memory_order_release);
+
+    if (cabe && fin > franjaInicio) {
+        actualizarIndiceFranjas(cal, franjaInicio, fin - 1);
+    }
+    return cabe;
+}
+
+/* ============================================================================
+ * INSTANTÁNEA DE LA OCUPACIÓN
+ * ============================================================================ */
+/*
+ * Copia la ocupación de las franjas [desde, desde + cantidad) sin tomar el
+ * mutex: lee el contador de secuencia, copia y lo vuelve a leer, y repite
+ * si una admisión estaba a medias (contador impar) o terminó entre las dos
+ * lecturas. Así la copia nunca muestra media reserva, y los lectores no
+ * frenan a las admisiones ni se frenan entre sí. Las franjas fuera del
+ * horario se copian en cero. Devuelve los reintentos que hicieron falta.
+ */
+int copiarOcupacion(Calendario *cal, int desde, int cantidad, int *ocupacion) {
+    int reintentos = 0;
+
+    for (;;) {
+        unsigned version = atomic_load_explicit(&cal->versionOcupacion, memory_order_acquire);
+        if (version & 1) {
+            reintentos++;
+            continue;
+        }
+        for (int i = 0; i < cantidad; i++) {
+            int f = desde + i;
+            ocupacion[i] = franjaValida(f) ?
+                atomic_load_explicit(&cal->ocupacionPorFranja[f].personas, memory_order_relaxed) : 0;
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&cal->versionOcupacion, memory_order_relaxed) == version) {
+            return reintentos;
+        }
+        reintentos++;
+    }
+}
+
+/*
+ * Personas que caben todavía en una reserva que empiece en cada franja de
+ * [desde, desde + cantidad): el aforo menos la ocupación máxima de su
+ * ventana, sobre una instantánea de copiarOcupacion y con el mismo núcleo
+ * vectorizado que el índice. ocupacion es espacio de trabajo de
+ * cantidad + franjasPorReserva - 1 enteros. No toma cal->mutexReservas.
+ */
+void consultarPlazasLibres(Calendario *cal, int desde, int cantidad, int *ocupacion, int *plazas) {
+    if (cantidad <= 0) {
+        return;
+    }
+
+    copiarOcupacion(cal, desde, cantidad + franjasPorReserva - 1, ocupacion);
+    maximosVentana(ocupacion, cantidad, franjasPorReserva, plazas);
+    for (int i = 0; i < cantidad; i++) {
+        plazas[i] = aforoMaximo - plazas[i];
+    }
+}
+
+/* ============================================================================
+ * VERIFICACIÓN DE DISPONIBILIDAD
+ * ============================================================================ */
+/* Requiere cal->mutexReservas tomado (ver elegirFranja). */
+int verificarDisponibilidad(Calendario *cal, int franja, int numPersonas) {
+    if (!franjaValida(franja)) {
+        return 1;  // Sin franjas que verificar (igual que el recorrido original)
+    }
+
+    // La franja y las siguientes de la reserva deben tener cupo
+    return cal->arbolVentanas[hojasIndice + franja] + numPersonas <= aforoMaximo;
+}
+
+/* ============================================================================
+ * BÚSQUEDA DE HORA ALTERNATIVA
+ * ============================================================================ */
+/* Última franja de inicio cuya ventana cabe en el periodo */
+static int ultimaFranjaReservable() {
+    int fin = franjaFinPeriodo < numFranjas ? franjaFinPeriodo : numFranjas;
+    return fin - franjasPorReserva;
+}
+
+/* Requiere cal->mutexReservas tomado (ver elegirFranja). */
+int buscarHoraAlternativa(Calendario *cal, int numPersonas, int *franjaEncontrada) {
+    // Buscar desde la primera franja reservable hasta la última ventana que cabe en el periodo
+    int limite = aforoMaximo - numPersonas;
+    if (limite < 0) {
+        return 0;
+    }
+
+    int franja = buscarVentanaLibre(cal, cal->franjaMinima, ultimaFranjaReservable(), limite, 0);
+    if (franja == -1) {
+        return 0;  // No se encontró hora alternativa
+    }
+
+    *franjaEncontrada = franja;
+    return 1;
+}
+
+/*
+ * Alternativa más cercana a la franja solicitada en lugar de la primera del
+ * periodo: la primera ventana libre desde la solicitada y la última antes de
+ * ella, y de las dos la de menor desplazamiento (a igual distancia, la
+ * posterior, que el grupo nunca llega antes de lo pedido). Dos búsquedas en
+ * el índice, O(log F). Requiere cal->mutexReservas tomado.
+ */
+int buscarHoraCercana(Calendario *cal, int franjaSolicitada, int numPersonas, int *franjaEncontrada) {
+    int desde = cal->franjaMinima;
+    int hasta = ultimaFranjaReservable();
+    int limite = aforoMaximo - numPersonas;
+
+    if (limite < 0) {
+        return 0;
+    }
+
+    int centro = franjaSolicitada < desde ? desde : franjaSolicitada;
+    int posterior = buscarVentanaLibre(cal, centro, hasta, limite, 0);
+    int anterior = buscarVentanaLibre(cal, desde, centro <= hasta ? centro - 1 : hasta, limite, 1);
+
+    if (posterior == -1 && anterior == -1) {
+        return 0;
+    }
+    if (posterior == -1 || (anterior != -1 && centro - anterior < posterior - centro)) {
+        *franjaEncontrada = anterior;
+    } else {
+        *franjaEncontrada = posterior;
+    }
+    return 1;
+}
+
+/* ============================================================================
+ * ELECCIÓN DE LA FRANJA
+ * ============================================================================ */
+/*
+ * Franja en la que cabe una reserva: la solicitada si intentarHoraSolicitada,
+ * ya no pasó y tiene cupo; si no, la primera alternativa con cupo (o la más
+ * cercana a la solicitada, si alternativaCercana). Solo
+ * consulta: quien llame ocupa la ventana (ocuparVentana) e inserta la
+ * reserva dentro de la misma sección crítica. Requiere cal->mutexReservas tomado.
+ */
+ResultadoAdmision elegirFranja(Calendario *cal, int franjaSolicitada, int intentarHoraSolicitada,
+                               int alternativaCercana, int numPersonas, int *franjaAsignada) {
+    if (intentarHoraSolicitada && franjaSolicitada >= cal->franjaMinima &&
+        verificarDisponibilidad(cal, franjaSolicitada, numPersonas)) {
+        *franjaAsignada = franjaSolicitada;
+        return ADMISION_EN_HORA;
+    }
+    if (alternativaCercana ? buscarHoraCercana(cal, franjaSolicitada, numPersonas, franjaAsignada)
+                           : buscarHoraAlternativa(cal, numPersonas, franjaAsignada)) {
+        return ADMISION_ALTERNATIVA;
+    }
+    return ADMISION_SIN_CUPO;
+}
+
+/* ============================================================================
+ * AVANCE DE HORA
+ * ============================================================================ */
+/*
+ * Lleva el calendario a la franja dada: ya no se reserva antes de ella, se
+ * activan las reservas que empiezan en ella y se desactivan las que
+ * terminaron en la anterior. Toma cal->mutexReservas.
+ */
+void avanzarCalendario(Calendario *cal, int franja) {
+    pthread_mutex_lock(&cal->mutexReservas);
+
+    cal->franjaMinima = franja;
+
+    // Activar reservas que comienzan en esta franja
+    if (franjaValida(franja)) {
+        for (int i = cal->reservasQueInician[franja].primera; i != -1; ) {
+            Reserva *r = obtenerReserva(cal, i);
+            r->activa = !r->cancelada;
+            i = r->siguienteQueInicia;
+        }
+    }
+
+    // Desactivar reservas que terminaron en la franja anterior (las únicas que
+    // pueden seguir activas con franjaFin < franja)
+    if (franjaValida(franja - 1)) {
+        for (int i = cal->reservasQueTerminan[franja - 1].primera; i != -1; ) {
+            Reserva *r = obtenerReserva(cal, i);
+            r->activa = 0;
+            i = r->siguienteQueTermina;
+        }
+    }
+
+    pthread_mutex_unlock(&cal->mutexReservas);
+}
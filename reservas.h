@@ -0,0 +1,156 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: reservas.h
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Calendarios, admisión y avance de hora
+ * -----------------------------------------------
+ * Descripción:
+ * El núcleo de la admisión de reservas, separado del
+ * controlador para poder usarlo (y medirlo) sin pipes
+ * ni hilos: el calendario de un día y un parque con su
+ * ocupación por franja, el almacén de reservas, la
+ * tabla de cadenas internadas, el índice de capacidad
+ * libre que responde si una ventana tiene cupo y cuál
+ * es la primera con cupo, y el avance del reloj que
+ * activa y desactiva las reservas de cada franja. La
+ * ocupación se puede copiar además sin el mutex, como
+ * una instantánea consistente protegida por un contador
+ * de secuencia, para las consultas de disponibilidad.
+ * No sabe de minutos ni de horas: todo va en franjas
+ * desde la apertura.
+ *****************************************************/
+
+#ifndef RESERVAS_H
+#define RESERVAS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define TAM_BLOQUE_RESERVAS 256  // Reservas por bloque del almacén (potencia de 2)
+#define RANURAS_INICIALES_CADENAS 64  // Tamaño inicial de la tabla de cadenas (potencia de 2)
+#define TAM_LINEA_CACHE 64  // Contadores compartidos en líneas de caché separadas
+
+/* Geometría común a todos los calendarios; se fija una vez, antes de crearlos */
+typedef struct {
+    int numFranjas;         // Franjas entre la apertura y el cierre
+    int franjasPorReserva;  // Duración de una reserva en franjas
+    int aforoMaximo;        // Personas por franja
+    int franjaFinPeriodo;   // Primera franja después del periodo reservable (exclusiva)
+} ConfiguracionCalendarios;
+
+/* Estructura para registrar una reserva (los nombres están en la tabla de cadenas) */
+typedef struct {
+    uint32_t idFamilia;  // Cadena internada con el nombre de la familia
+    uint32_t idAgente;   // Cadena internada con el nombre del agente
+    int franjaInicio;
+    int franjaFin;       // Última franja ocupada (inclusive)
+    int numPersonas;
+    int activa;  // 1 si está activa, 0 si ya salió
+    int cancelada;  // 1 si se canceló: su cupo ya se devolvió y el reloj la ignora
+    int siguienteQueInicia;  // Siguiente reserva con la misma hora de inicio (-1 = fin)
+    int siguienteQueTermina; // Siguiente reserva con la misma hora de fin (-1 = fin)
+} Reserva;
+
+/*
+ * Almacén de reservas por bloques de tamaño fijo: crece sin límite y sin
+ * mover las reservas ya registradas (solo crece el arreglo de bloques).
+ */
+typedef struct {
+    Reserva **bloques;
+    int numBloques;
+    int capacidadBloques;
+    int cantidad;
+} AlmacenReservas;
+
+/* Lista de reservas por franja, en orden de registro (índices en el almacén) */
+typedef struct {
+    int primera;
+    int ultima;
+} ListaFranja;
+
+/*
+ * Tabla de cadenas internadas: cada nombre distinto se guarda una sola vez y
+ * se identifica por su posición. Las ranuras forman una tabla hash de
+ * direccionamiento abierto que guarda id + 1 (0 = ranura vacía).
+ */
+typedef struct {
+    char **cadenas;
+    uint32_t numCadenas;
+    uint32_t capacidadCadenas;
+    uint32_t *ranuras;
+    uint32_t numRanuras;
+} TablaCadenas;
+
+/*
+ * Ocupación de una franja: un contador atómico en su propia línea de caché,
+ * para que las admisiones en franjas distintas no se invaliden entre sí.
+ */
+typedef struct {
+    _Alignas(TAM_LINEA_CACHE) atomic_int personas;
+} OcupacionFranja;
+
+/*
+ * Calendario de un día y un parque. Cada calendario es un fragmento
+ * independiente con su propio mutex, de modo que las solicitudes de días o
+ * parques distintos nunca compiten por el mismo cerrojo. versionOcupacion es
+ * el contador de secuencia de la ocupación: impar mientras ocuparVentana la
+ * cambia, par en reposo (ver copiarOcupacion).
+ */
+typedef struct {
+    int dia;           // Días a partir de hoy (0 = hoy)
+    int parque;
+    int franjaMinima;  // Primera franja reservable; solo avanza con el reloj en los de hoy
+    OcupacionFranja *ocupacionPorFranja;  // Personas por franja (numFranjas); se lee sin mutex
+    atomic_uint versionOcupacion;         // Contador de secuencia de ocupacionPorFranja
+    int *ocupacionContigua;   // Copia de la ocupación en un solo arreglo, para el núcleo vectorizado
+    int *arbolVentanas;       // Mínimo, por franja de inicio, de la ocupación máxima de su ventana
+    AlmacenReservas almacen;
+    TablaCadenas cadenas;
+    ListaFranja *reservasQueInician;   // Por franja de inicio
+    ListaFranja *reservasQueTerminan;  // Por franja de fin
+    pthread_mutex_t mutexReservas;     // Protege los campos anteriores salvo la ocupación
+} Calendario;
+
+/* Resultado de la admisión atómica de una reserva */
+typedef enum {
+    ADMISION_EN_HORA,       // Reservada en la hora solicitada
+    ADMISION_ALTERNATIVA,   // Reservada en una hora alternativa
+    ADMISION_SIN_CUPO       // Sin cupo en todo el periodo
+} ResultadoAdmision;
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+void configurarCalendarios(const ConfiguracionCalendarios *config);
+void inicializarCalendario(Calendario *cal, int dia, int parque, int franjaMinima);
+void liberarCalendario(Calendario *cal);
+
+ResultadoAdmision elegirFranja(Calendario *cal, int franjaSolicitada, int intentarHoraSolicitada,
+                               int alternativaCercana, int numPersonas, int *franjaAsignada);
+int verificarDisponibilidad(Calendario *cal, int franja, int numPersonas);
+int buscarHoraAlternativa(Calendario *cal, int numPersonas, int *franjaEncontrada);
+int buscarHoraCercana(Calendario *cal, int franjaSolicitada, int numPersonas, int *franjaEncontrada);
+int ocuparVentana(Calendario *cal, int franjaInicio, int personas);
+void insertarReserva(Calendario *cal, const char *familia, const char *agente, int franjaInicio, int numPersonas);
+Reserva *buscarReserva(Calendario *cal, int indice);
+void cancelarReserva(Calendario *cal, int indice);
+int restituirReserva(Calendario *cal, int indice);
+void avanzarCalendario(Calendario *cal, int franja);
+
+int ajustarCupo(OcupacionFranja *franja, int personas);
+int leerOcupacion(Calendario *cal, int franja);
+int copiarOcupacion(Calendario *cal, int desde, int cantidad, int *ocupacion);
+void consultarPlazasLibres(Calendario *cal, int desde, int cantidad, int *ocupacion, int *plazas);
+Reserva *obtenerReserva(Calendario *cal, int indice);
+uint32_t internarCadena(Calendario *cal, const char *cadena);
+const char *cadenaInternada(Calendario *cal, uint32_t id);
+
+#endif
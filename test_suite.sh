@@ -367,6 +367,55 @@ EOF
     cleanup
 }
 
+# TEST 34: Grupos que no caben en 16 bits
+test_oversized_group() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 34: GRUPOS DE MÁS DE 65535 PERSONAS${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    # 65537 y 65536 no deben llegar al controlador como 1 y 0 personas
+    cat > "$TEST_DIR/test34_solicitudes_1.csv" << EOF
+Familia_H,8,65537
+Familia_I,9,65536
+Familia_J,10,3
+Familia_J,modificar,10,65537
+EOF
+    cat > "$TEST_DIR/test34_solicitudes_2.csv" << EOF
+Familia_K,8,65537
+Familia_L,9,1
+EOF
+    
+    ./controlador -i 7 -f 12 -s 10 -t 20 -p pipe_test34 > "$TEST_DIR/test34_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+    
+    ./agente -s AgenteGrande -a "$TEST_DIR/test34_solicitudes_1.csv" -p pipe_test34 -r 0 > "$TEST_DIR/test34_agente_1.log" 2>&1 &
+    local agent_pid=$!
+    wait_for_process $agent_pid 10
+    
+    # También dentro de un lote
+    ./agente -s AgenteGrandeLote -a "$TEST_DIR/test34_solicitudes_2.csv" -p pipe_test34 -r 0 -l 4 > "$TEST_DIR/test34_agente_2.log" 2>&1 &
+    agent_pid=$!
+    wait_for_process $agent_pid 10
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    if [ "$(grep -c "excede el aforo" "$TEST_DIR/test34_agente_1.log")" -eq 3 ] && \
+       [ "$(grep -c "excede el aforo" "$TEST_DIR/test34_agente_2.log")" -eq 1 ] && \
+       ! grep -q "debe ser al menos 1" "$TEST_DIR"/test34_agente_*.log && \
+       grep -q "Personas: 65537" "$TEST_DIR/test34_controlador.log" && \
+       grep -q "Solicitudes negadas: *3" "$TEST_DIR/test34_controlador.log" && \
+       grep -q "Cambios negados: *1" "$TEST_DIR/test34_controlador.log"; then
+        print_test_result "Grupos de más de 65535 personas" "PASS" "Llegan completos y se niegan por exceder el aforo, también en lote y al modificar"
+    else
+        print_test_result "Grupos de más de 65535 personas" "FAIL" "Un grupo grande llegó truncado al controlador"
+    fi
+    
+    cleanup
+}
+
 # TEST 8: Reporte final completo
 test_final_report() {
     log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
@@ -493,6 +542,962 @@ test_stress() {
     cleanup
 }
 
+# TEST 11: Solicitudes en lote
+test_batch_requests() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 11: SOLICITUDES EN LOTE${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+
+    # Crear archivo con 6 solicitudes (un lote de 4 y otro de 2)
+    cat > "$TEST_DIR/test11_solicitudes.csv" << EOF
+Familia_L1,8,4
+Familia_L2,9,3
+Familia_L3,10,5
+Familia_L4,11,2
+Familia_L5,12,6
+Familia_L6,13,1
+EOF
+
+    # Iniciar controlador
+    ./controlador -i 7 -f 15 -s 2 -t 30 -p pipe_test11 > "$TEST_DIR/test11_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 2
+
+    # Iniciar agente enviando lotes de 4 solicitudes
+    ./agente -s AgenteLote -a "$TEST_DIR/test11_solicitudes.csv" -p pipe_test11 -l 4 > "$TEST_DIR/test11_agente.log" 2>&1 &
+    local agent_pid=$!
+
+    wait_for_process $agent_pid 30
+    sleep 2
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+
+    # Dos lotes en el controlador y una respuesta por solicitud en el agente
+    local lotes=$(grep -c "LOTE DE SOLICITUDES" "$TEST_DIR/test11_controlador.log")
+    local respuestas=$(grep -c "Reserva APROBADA\|Reserva REPROGRAMADA\|Reserva NEGADA" "$TEST_DIR/test11_agente.log")
+
+    if [ "$lotes" -eq 2 ] && [ "$respuestas" -eq 6 ]; then
+        print_test_result "Solicitudes en lote" "PASS" "$lotes lotes, $respuestas/6 respuestas recibidas"
+    else
+        print_test_result "Solicitudes en lote" "FAIL" "$lotes lotes, $respuestas/6 respuestas recibidas"
+    fi
+
+    cleanup
+}
+
+# TEST 12: Solicitudes en vuelo (ventana)
+test_pipelined_requests() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 12: SOLICITUDES EN VUELO (VENTANA)${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    # Crear archivo con 8 solicitudes
+    > "$TEST_DIR/test12_solicitudes.csv"
+    for i in {1..8}; do
+        echo "Familia_V$i,$((8 + (i % 5))),$((1 + (i % 4)))" >> "$TEST_DIR/test12_solicitudes.csv"
+    done
+    
+    # Iniciar controlador con varios hilos trabajadores (respuestas en cualquier orden)
+    ./controlador -i 7 -f 15 -s 2 -t 30 -p pipe_test12 -w 4 > "$TEST_DIR/test12_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 2
+    
+    # Iniciar agente con hasta 4 solicitudes en vuelo
+    ./agente -s AgenteVentana -a "$TEST_DIR/test12_solicitudes.csv" -p pipe_test12 -W 4 > "$TEST_DIR/test12_agente.log" 2>&1 &
+    local agent_pid=$!
+    
+    wait_for_process $agent_pid 30
+    sleep 2
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    # Cada solicitud debe recibir exactamente una respuesta emparejada
+    local respuestas=$(grep -c "RESPUESTA DEL CONTROLADOR" "$TEST_DIR/test12_agente.log")
+    local desconocidas=$(grep -c "secuencia desconocida" "$TEST_DIR/test12_agente.log")
+    
+    if [ "$respuestas" -eq 8 ] && [ "$desconocidas" -eq 0 ] && grep -q "termina" "$TEST_DIR/test12_agente.log"; then
+        print_test_result "Solicitudes en vuelo" "PASS" "$respuestas/8 respuestas emparejadas por secuencia"
+    else
+        print_test_result "Solicitudes en vuelo" "FAIL" "$respuestas/8 respuestas, $desconocidas sin emparejar"
+    fi
+    
+    cleanup
+}
+
+# TEST 13: Envío sin pausa y estadísticas de carga
+test_load_pacing() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 13: ENVÍO SIN PAUSA Y ESTADÍSTICAS DE CARGA${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    # Crear archivo con 10 solicitudes
+    > "$TEST_DIR/test13_solicitudes.csv"
+    for i in {1..10}; do
+        echo "Familia_R$i,$((8 + (i % 6))),$((1 + (i % 3)))" >> "$TEST_DIR/test13_solicitudes.csv"
+    done
+    
+    # Iniciar controlador
+    ./controlador -i 7 -f 15 -s 2 -t 30 -p pipe_test13 > "$TEST_DIR/test13_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 2
+    
+    # Con -r 0 el agente no espera entre solicitudes: debe terminar enseguida
+    ./agente -s AgenteCarga -a "$TEST_DIR/test13_solicitudes.csv" -p pipe_test13 -r 0 > "$TEST_DIR/test13_agente.log" 2>&1 &
+    local agent_pid=$!
+    
+    local agent_ok=0
+    wait_for_process $agent_pid 5 && agent_ok=1
+    sleep 1
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    if [ $agent_ok -eq 1 ] && grep -q "Solicitudes respondidas:  10" "$TEST_DIR/test13_agente.log" && \
+       grep -q "Tasa lograda" "$TEST_DIR/test13_agente.log" && grep -q "p99" "$TEST_DIR/test13_agente.log"; then
+        print_test_result "Envío sin pausa" "PASS" "10 solicitudes respondidas y estadísticas de carga reportadas"
+    else
+        print_test_result "Envío sin pausa" "FAIL" "El agente no terminó a tiempo o no reportó estadísticas"
+    fi
+    
+    cleanup
+}
+
+# TEST 14: Franjas de 15 minutos
+test_short_slots() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 14: FRANJAS DE 15 MINUTOS${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    # Una hora al inicio de franja y otra que no coincide con ninguna
+    cat > "$TEST_DIR/test14_solicitudes.csv" << EOF
+Familia_M1,8:15,4
+Familia_M2,8:10,2
+EOF
+    
+    # Iniciar controlador con franjas de 15 minutos y reservas de 90
+    ./controlador -i 7 -f 15 -s 2 -t 30 -p pipe_test14 -m 15 -d 90 > "$TEST_DIR/test14_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 2
+    
+    ./agente -s AgenteFranjas -a "$TEST_DIR/test14_solicitudes.csv" -p pipe_test14 -r 0 > "$TEST_DIR/test14_agente.log" 2>&1 &
+    local agent_pid=$!
+    
+    wait_for_process $agent_pid 10
+    sleep 1
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    # 8:15 se aprueba con 90 minutos de duración; 8:10 no empieza una franja
+    if grep -q "Hora asignada: *8:15 - 9:45" "$TEST_DIR/test14_agente.log" && \
+       grep -q "Reserva NEGADA - Hora fuera del rango" "$TEST_DIR/test14_agente.log"; then
+        print_test_result "Franjas de 15 minutos" "PASS" "8:15 asignada hasta 9:45 y 8:10 rechazada"
+    else
+        print_test_result "Franjas de 15 minutos" "FAIL" "Las horas en minutos no se respetaron"
+    fi
+    
+    cleanup
+}
+
+# TEST 15: Calendarios por día y parque
+test_sharded_calendars() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 15: CALENDARIOS POR DÍA Y PARQUE${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    # Dos grupos que juntos superan el aforo, pero en días distintos, y un día no atendido
+    cat > "$TEST_DIR/test15_solicitudes.csv" << EOF
+Familia_D0,9,8
+Familia_D1,9,8,1
+Familia_D5,9,3,5
+EOF
+    
+    # Iniciar controlador con dos días y dos parques
+    ./controlador -i 7 -f 15 -s 2 -t 10 -p pipe_test15 -D 2 -P 2 > "$TEST_DIR/test15_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 2
+    
+    ./agente -s AgenteDias -a "$TEST_DIR/test15_solicitudes.csv" -p pipe_test15 -r 0 > "$TEST_DIR/test15_agente.log" 2>&1 &
+    local agent_pid=$!
+    
+    wait_for_process $agent_pid 10
+    sleep 1
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    # Cada día tiene su propio aforo; el día 5 no existe con -D 2
+    local aprobadas=$(grep -c "Reserva APROBADA" "$TEST_DIR/test15_agente.log")
+    if [ "$aprobadas" -eq 2 ] && grep -q "no atiende ese día o parque" "$TEST_DIR/test15_agente.log"; then
+        print_test_result "Calendarios por día y parque" "PASS" "Aforo independiente por día y día inexistente rechazado"
+    else
+        print_test_result "Calendarios por día y parque" "FAIL" "$aprobadas/2 aprobadas o día inexistente no rechazado"
+    fi
+    
+    cleanup
+}
+
+# TEST 16: Finalización inmediata con SIGINT
+test_prompt_shutdown() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 16: FINALIZACIÓN INMEDIATA CON SIGINT${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    # Horas largas: sin el evento de fin el reloj tardaría 30 s en despertar
+    ./controlador -i 7 -f 19 -s 30 -t 20 -p pipe_test16 > "$TEST_DIR/test16_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 2
+    
+    kill -INT $ctrl_pid 2>/dev/null
+    
+    # El controlador debe terminar en menos de un segundo
+    local ctrl_ok=0
+    for i in {1..10}; do
+        if ! kill -0 $ctrl_pid 2>/dev/null; then
+            ctrl_ok=1
+            break
+        fi
+        sleep 0.1
+    done
+    wait_for_process $ctrl_pid 5
+    
+    if [ $ctrl_ok -eq 1 ] && grep -q "REPORTE FINAL" "$TEST_DIR/test16_controlador.log"; then
+        print_test_result "Finalización con SIGINT" "PASS" "Terminó en menos de 1 s con reporte final"
+    else
+        print_test_result "Finalización con SIGINT" "FAIL" "No terminó a tiempo o no generó el reporte"
+    fi
+    
+    cleanup
+}
+
+# TEST 17: Reloj a máxima velocidad
+test_max_speed_clock() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 17: RELOJ A MÁXIMA VELOCIDAD${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    # Crear archivo con 20 solicitudes repartidas en el día
+    > "$TEST_DIR/test17_solicitudes.csv"
+    for i in {1..20}; do
+        echo "Familia_V$i,$((8 + (i % 10))),$((1 + (i % 4)))" >> "$TEST_DIR/test17_solicitudes.csv"
+    done
+    
+    # Con -s 0 el día entero (13 horas) debe pasar en cuanto se atiendan las solicitudes
+    ./controlador -i 7 -f 19 -s 0 -t 10 -p pipe_test17 > "$TEST_DIR/test17_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+    
+    ./agente -s AgenteVeloz -a "$TEST_DIR/test17_solicitudes.csv" -p pipe_test17 -r 0 > "$TEST_DIR/test17_agente.log" 2>&1 &
+    local agent_pid=$!
+    
+    local ctrl_ok=0
+    wait_for_process $agent_pid 5
+    wait_for_process $ctrl_pid 3 && ctrl_ok=1
+    
+    local horas=$(grep -c "⏰ HORA:" "$TEST_DIR/test17_controlador.log")
+    local aprobadas=$(grep -c "Reserva APROBADA" "$TEST_DIR/test17_agente.log")
+    if [ $ctrl_ok -eq 1 ] && [ "$horas" -eq 13 ] && [ "$aprobadas" -gt 0 ]; then
+        print_test_result "Reloj a máxima velocidad" "PASS" "$horas horas simuladas en segundos, $aprobadas aprobadas"
+    else
+        print_test_result "Reloj a máxima velocidad" "FAIL" "$horas/13 horas, $aprobadas aprobadas, terminó: $ctrl_ok"
+    fi
+    
+    cleanup
+}
+
+# TEST 18: Admisión concurrente sin sobrecupo
+test_concurrent_admission() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 18: ADMISIÓN CONCURRENTE SIN SOBRECUPO${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    # 6 agentes con 10 solicitudes cada uno, todas compitiendo por las mismas horas
+    for a in {1..6}; do
+        > "$TEST_DIR/test18_agente$a.csv"
+        for i in {1..10}; do
+            echo "Familia_C${a}_$i,$((8 + (i % 3))),$((1 + (i % 4)))" >> "$TEST_DIR/test18_agente$a.csv"
+        done
+    done
+    
+    # 8 trabajadores y aforo pequeño para que las admisiones choquen
+    ./controlador -i 7 -f 19 -s 2 -t 10 -w 8 -p pipe_test18 > "$TEST_DIR/test18_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+    
+    local pids=()
+    for a in {1..6}; do
+        ./agente -s AgenteC$a -a "$TEST_DIR/test18_agente$a.csv" -p pipe_test18 -r 0 > "$TEST_DIR/test18_agente$a.log" 2>&1 &
+        pids+=($!)
+    done
+    for pid in "${pids[@]}"; do
+        wait_for_process $pid 10
+    done
+    sleep 1
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    # El total de las estadísticas debe cubrir las 60 solicitudes y ninguna hora superar el aforo
+    local total=$(grep "Total de solicitudes:" "$TEST_DIR/test18_controlador.log" | grep -o "[0-9]*$")
+    local maximo=$(grep "│ [0-9][0-9]:[0-9][0-9]│" "$TEST_DIR/test18_controlador.log" | awk -F'│' '{ if ($3 + 0 > m) m = $3 + 0 } END { print m + 0 }')
+    if [ "${total:-0}" -eq 60 ] && [ "$maximo" -le 10 ] && [ "$maximo" -gt 0 ]; then
+        print_test_result "Admisión concurrente sin sobrecupo" "PASS" "$total/60 solicitudes contabilizadas, ocupación máxima $maximo/10"
+    else
+        print_test_result "Admisión concurrente sin sobrecupo" "FAIL" "${total:-0}/60 solicitudes contabilizadas, ocupación máxima $maximo/10"
+    fi
+    
+    cleanup
+}
+
+# TEST 19: Transporte en memoria compartida
+test_shared_memory_transport() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 19: TRANSPORTE EN MEMORIA COMPARTIDA${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    # Crear archivo con 10 solicitudes
+    > "$TEST_DIR/test19_solicitudes.csv"
+    for i in {1..10}; do
+        echo "Familia_M$i,$((8 + (i % 6))),$((1 + (i % 3)))" >> "$TEST_DIR/test19_solicitudes.csv"
+    done
+    
+    ./controlador -i 7 -f 19 -s 2 -t 20 -w 2 -p pipe_test19 > "$TEST_DIR/test19_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+    
+    # Un agente por memoria compartida (en ventana) y otro por pipes, a la vez
+    ./agente -s AgenteMem -a "$TEST_DIR/test19_solicitudes.csv" -p pipe_test19 -r 0 -W 4 -M > "$TEST_DIR/test19_agente_mem.log" 2>&1 &
+    local mem_pid=$!
+    ./agente -s AgentePipe -a "$TEST_DIR/test19_solicitudes.csv" -p pipe_test19 -r 0 > "$TEST_DIR/test19_agente_pipe.log" 2>&1 &
+    local pipe_pid=$!
+    
+    local mem_ok=0
+    wait_for_process $mem_pid 10 && mem_ok=1
+    wait_for_process $pipe_pid 10
+    sleep 1
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    local negociado=$(grep -c "Agente 'AgenteMem' registrado (memoria compartida)" "$TEST_DIR/test19_controlador.log")
+    local resp_mem=$(grep -c "RESPUESTA DEL CONTROLADOR" "$TEST_DIR/test19_agente_mem.log")
+    local resp_pipe=$(grep -c "RESPUESTA DEL CONTROLADOR" "$TEST_DIR/test19_agente_pipe.log")
+    local restos=$(ls /dev/shm 2>/dev/null | grep -c "^reservas_AgenteMem_")
+    if [ "$negociado" -eq 1 ] && [ $mem_ok -eq 1 ] && [ "$resp_mem" -eq 10 ] && [ "$resp_pipe" -eq 10 ] && [ "$restos" -eq 0 ]; then
+        print_test_result "Transporte en memoria compartida" "PASS" "$resp_mem/10 respuestas por memoria, $resp_pipe/10 por pipes"
+    else
+        print_test_result "Transporte en memoria compartida" "FAIL" "negociado: $negociado, $resp_mem/10 por memoria, $resp_pipe/10 por pipes, segmentos sin borrar: $restos"
+    fi
+    
+    cleanup
+}
+
+# TEST 20: Conexión por sockets Unix y TCP
+test_socket_transport() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 20: CONEXIÓN POR SOCKETS UNIX Y TCP${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    # Crear archivo con 10 solicitudes
+    > "$TEST_DIR/test20_solicitudes.csv"
+    for i in {1..10}; do
+        echo "Familia_S$i,$((8 + (i % 6))),$((1 + (i % 3)))" >> "$TEST_DIR/test20_solicitudes.csv"
+    done
+    
+    local socket_unix="$TEST_DIR/test20.sock"
+    local puerto=$((20000 + RANDOM % 20000))
+    ./controlador -i 7 -f 19 -s 2 -t 20 -w 2 -p pipe_test20 -L "unix:$socket_unix" -L "tcp:127.0.0.1:$puerto" > "$TEST_DIR/test20_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+    
+    # Un agente por cada transporte, a la vez (el de TCP en ventana)
+    ./agente -s AgenteUnix -a "$TEST_DIR/test20_solicitudes.csv" -p "unix:$socket_unix" -r 0 > "$TEST_DIR/test20_agente_unix.log" 2>&1 &
+    local unix_pid=$!
+    ./agente -s AgenteTcp -a "$TEST_DIR/test20_solicitudes.csv" -p "tcp:127.0.0.1:$puerto" -r 0 -W 4 > "$TEST_DIR/test20_agente_tcp.log" 2>&1 &
+    local tcp_pid=$!
+    ./agente -s AgentePipe -a "$TEST_DIR/test20_solicitudes.csv" -p pipe_test20 -r 0 > "$TEST_DIR/test20_agente_pipe.log" 2>&1 &
+    local pipe_pid=$!
+    
+    wait_for_process $unix_pid 10
+    wait_for_process $tcp_pid 10
+    wait_for_process $pipe_pid 10
+    sleep 1
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    local por_socket=$(grep -c "registrado (socket)" "$TEST_DIR/test20_controlador.log")
+    local resp_unix=$(grep -c "RESPUESTA DEL CONTROLADOR" "$TEST_DIR/test20_agente_unix.log")
+    local resp_tcp=$(grep -c "RESPUESTA DEL CONTROLADOR" "$TEST_DIR/test20_agente_tcp.log")
+    local resp_pipe=$(grep -c "RESPUESTA DEL CONTROLADOR" "$TEST_DIR/test20_agente_pipe.log")
+    local restos=0
+    [ -e "$socket_unix" ] && restos=1
+    if [ "$por_socket" -eq 2 ] && [ "$resp_unix" -eq 10 ] && [ "$resp_tcp" -eq 10 ] && [ "$resp_pipe" -eq 10 ] && [ $restos -eq 0 ]; then
+        print_test_result "Conexión por sockets" "PASS" "Unix: $resp_unix/10, TCP: $resp_tcp/10, pipe: $resp_pipe/10"
+    else
+        print_test_result "Conexión por sockets" "FAIL" "registrados por socket: $por_socket, Unix: $resp_unix/10, TCP: $resp_tcp/10, pipe: $resp_pipe/10, socket sin borrar: $restos"
+    fi
+    
+    cleanup
+}
+
+# TEST 21: Registro de agentes sin límite fijo
+test_agent_registry() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 21: REGISTRO DE AGENTES SIN LÍMITE FIJO${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    echo "Familia_R,8,1" > "$TEST_DIR/test21_solicitudes.csv"
+    
+    ./controlador -i 7 -f 19 -s 2 -t 100 -w 4 -p pipe_test21 > "$TEST_DIR/test21_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+    
+    # 60 agentes a la vez: más que la antigua tabla fija de 50
+    local pids=()
+    for i in {1..60}; do
+        ./agente -s AgenteR$i -a "$TEST_DIR/test21_solicitudes.csv" -p pipe_test21 -r 0 > "$TEST_DIR/test21_agente_$i.log" 2>&1 &
+        pids+=($!)
+    done
+    for pid in "${pids[@]}"; do
+        wait_for_process $pid 15
+    done
+    sleep 1
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    local registrados=$(grep -c "→ Agente 'AgenteR[0-9]*' registrado" "$TEST_DIR/test21_controlador.log")
+    local rechazados=$(grep -c "No se pudo registrar" "$TEST_DIR/test21_controlador.log")
+    local respuestas=$(cat "$TEST_DIR"/test21_agente_*.log | grep -c "RESPUESTA DEL CONTROLADOR")
+    if [ "$registrados" -eq 60 ] && [ "$rechazados" -eq 0 ] && [ "$respuestas" -eq 60 ]; then
+        print_test_result "Registro de agentes sin límite fijo" "PASS" "$registrados/60 agentes registrados, $respuestas/60 respuestas"
+    else
+        print_test_result "Registro de agentes sin límite fijo" "FAIL" "$registrados/60 registrados, $rechazados rechazados, $respuestas/60 respuestas"
+    fi
+    
+    cleanup
+}
+
+test_journal_recovery() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 22: DIARIO DE RESERVAS Y RECUPERACIÓN TRAS CAÍDA${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    rm -f "$TEST_DIR"/test22.diario*
+    
+    echo "Familia_J1,8,10" > "$TEST_DIR/test22_solicitudes_1.csv"
+    echo "Familia_J2,8,5" > "$TEST_DIR/test22_solicitudes_2.csv"
+    
+    ./controlador -i 7 -f 19 -s 3 -t 10 -p pipe_test22 -j "$TEST_DIR/test22.diario" > "$TEST_DIR/test22_controlador_1.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+    
+    ./agente -s AgenteJ1 -a "$TEST_DIR/test22_solicitudes_1.csv" -p pipe_test22 -r 0 > "$TEST_DIR/test22_agente_1.log" 2>&1 &
+    local agent_pid=$!
+    wait_for_process $agent_pid 10
+    
+    # Caída abrupta: sin reporte ni cierre ordenado
+    kill -9 $ctrl_pid 2>/dev/null
+    wait $ctrl_pid 2>/dev/null
+    rm -f pipe_test22
+    
+    ./controlador -i 7 -f 19 -s 3 -t 10 -p pipe_test22 -j "$TEST_DIR/test22.diario" > "$TEST_DIR/test22_controlador_2.log" 2>&1 &
+    ctrl_pid=$!
+    sleep 1
+    
+    # Las 8:00 ya están llenas por la reserva recuperada
+    ./agente -s AgenteJ2 -a "$TEST_DIR/test22_solicitudes_2.csv" -p pipe_test22 -r 0 > "$TEST_DIR/test22_agente_2.log" 2>&1 &
+    agent_pid=$!
+    wait_for_process $agent_pid 10
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    if grep -q "RESERVA APROBADA" "$TEST_DIR/test22_agente_1.log" && \
+       grep -q "1 reservas recuperadas" "$TEST_DIR/test22_controlador_2.log" && \
+       grep -q "RESPUESTA DEL CONTROLADOR" "$TEST_DIR/test22_agente_2.log" && \
+       ! grep -q "RESERVA APROBADA" "$TEST_DIR/test22_agente_2.log"; then
+        print_test_result "Diario de reservas y recuperación" "PASS" "La reserva sobrevivió a kill -9 y ocupa su franja"
+    else
+        print_test_result "Diario de reservas y recuperación" "FAIL" "La reserva no se recuperó tras la caída"
+    fi
+    
+    rm -f "$TEST_DIR"/test22.diario*
+    cleanup
+}
+
+test_csv_format() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 23: ARCHIVO CSV CON COMILLAS Y ESPACIOS${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    
+    cleanup
+    
+    local largo=$(printf 'L%.0s' {1..300})
+    printf '  Garcia , 8 , 2\r\n\r\n"Perez, Ana",9,3\n"Dice ""Hola""",10,1\n%s,11,1\n"Final",12,2' "$largo" > "$TEST_DIR/test23_solicitudes.csv"
+    
+    ./controlador -i 7 -f 19 -s 2 -t 50 -p pipe_test23 > "$TEST_DIR/test23_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+    
+    ./agente -s AgenteCSV -a "$TEST_DIR/test23_solicitudes.csv" -p pipe_test23 -r 0 > "$TEST_DIR/test23_agente.log" 2>&1 &
+    local agent_pid=$!
+    wait_for_process $agent_pid 10
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+    
+    local log_agente="$TEST_DIR/test23_agente.log"
+    local respuestas=$(grep -c "RESPUESTA DEL CONTROLADOR" "$log_agente")
+    if [ "$respuestas" -eq 5 ] && \
+       grep -q "Familia: Garcia " "$log_agente" && \
+       grep -q "Familia: Perez, Ana " "$log_agente" && \
+       grep -q 'Familia: Dice "Hola" ' "$log_agente" && \
+       grep -q "Línea 5: nombre de familia truncado" "$log_agente" && \
+       grep -q "Solicitud #6" "$log_agente"; then
+        print_test_result "Archivo CSV con comillas y espacios" "PASS" "5/5 solicitudes interpretadas correctamente"
+    else
+        print_test_result "Archivo CSV con comillas y espacios" "FAIL" "$respuestas/5 respuestas o campos mal interpretados"
+    fi
+    
+    cleanup
+}
+
+test_quiet_output() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 24: SALIDA ESTRUCTURADA EN MODO SILENCIOSO${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+
+    cat > "$TEST_DIR/test24_solicitudes.csv" << EOF
+Familia_Q1,8,5
+Familia_Q2,9,50
+EOF
+
+    ./controlador -i 7 -f 9 -s 1 -t 20 -p pipe_test24 -v 0 > "$TEST_DIR/test24_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 0.5
+
+    ./agente -s AgenteQ -a "$TEST_DIR/test24_solicitudes.csv" -p pipe_test24 -r 0 > "$TEST_DIR/test24_agente.log" 2>&1 &
+    local agent_pid=$!
+    wait_for_process $agent_pid 10
+    wait_for_process $ctrl_pid 10
+
+    local log_ctrl="$TEST_DIR/test24_controlador.log"
+    local lineas=$(wc -l < "$log_ctrl")
+    local estructuradas=$(grep -c "^t=[0-9.]* evento=" "$log_ctrl")
+    if grep -q 'evento=solicitud agente="AgenteQ" familia="Familia_Q1" hora=8:00 personas=5 .*resultado=aprobada' "$log_ctrl" && \
+       grep -q 'familia="Familia_Q2".*resultado=negada motivo=excede_aforo' "$log_ctrl" && \
+       grep -q "evento=reporte aceptadas=1 reprogramadas=0 negadas=1" "$log_ctrl" && \
+       [ "$lineas" -eq "$estructuradas" ]; then
+        print_test_result "Salida estructurada en modo silencioso" "PASS" "$estructuradas líneas clave=valor, sin recuadros"
+    else
+        print_test_result "Salida estructurada en modo silencioso" "FAIL" "$estructuradas de $lineas líneas estructuradas o faltan eventos"
+    fi
+
+    cleanup
+}
+
+test_live_metrics() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 25: MÉTRICAS EN VIVO Y REPORTE ESTRUCTURADO${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+
+    cat > "$TEST_DIR/test25_solicitudes.csv" << EOF
+Familia_M1,8,5
+Familia_M2,9,50
+EOF
+
+    local metricas="$TEST_DIR/test25_metricas.json"
+    local reporte="$TEST_DIR/test25_reporte.csv"
+    ./controlador -i 7 -f 9 -s 1 -t 20 -p pipe_test25 -M "$metricas" -R "$reporte" > "$TEST_DIR/test25_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 0.5
+
+    ./agente -s AgenteM -a "$TEST_DIR/test25_solicitudes.csv" -p pipe_test25 -r 0 > "$TEST_DIR/test25_agente.log" 2>&1 &
+    local agent_pid=$!
+    wait_for_process $agent_pid 10
+
+    # Con el día en curso: la instantánea de la última franja
+    sleep 1.2
+    local en_vivo=0
+    if grep -q '"final":false' "$metricas" && \
+       grep -q '"aceptadas":1,"reprogramadas":0,"negadas":1' "$metricas" && \
+       grep -q '"latenciaAdmisionUs":{"muestras":2' "$metricas"; then
+        en_vivo=1
+    fi
+
+    wait_for_process $ctrl_pid 10
+
+    if [ $en_vivo -eq 1 ] && grep -q '"final":true' "$metricas" && \
+       grep -q "^aceptadas,,,,1$" "$reporte" && \
+       grep -q "^negadas,,,,1$" "$reporte" && \
+       grep -q "^latencia_muestras,,,,2$" "$reporte" && \
+       grep -q "^ocupacion,0,0,08:00,5$" "$reporte"; then
+        print_test_result "Métricas en vivo y reporte estructurado" "PASS" "JSON publicado en cada franja y reporte CSV al final"
+    else
+        print_test_result "Métricas en vivo y reporte estructurado" "FAIL" "Faltan campos en $metricas o en $reporte"
+    fi
+
+    cleanup
+}
+
+test_load_benchmark() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 26: BANCO DE CARGA${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+
+    local resultados="$TEST_DIR/test26_resultados.json"
+    local base="$TEST_DIR/test26_base.json"
+
+    # Primera corrida: sin base previa, queda como base
+    ./carga -n 2 -s 200 -o "$resultados" -b "$base" > "$TEST_DIR/test26_carga1.log" 2>&1
+    local estado1=$?
+
+    # Segunda corrida: se compara con la base (umbral amplio, no se mide la máquina)
+    ./carga -n 2 -s 200 -o "$resultados" -b "$base" -u 1000 > "$TEST_DIR/test26_carga2.log" 2>&1
+    local estado2=$?
+
+    if [ $estado1 -eq 0 ] && [ $estado2 -eq 0 ] && [ -f "$base" ] && \
+       grep -q '"respondidas":400,"agentesFallidos":0' "$resultados" && \
+       grep -q '"latenciaAdmisionUs":{"p50":' "$resultados" && \
+       grep -q '"contencion":{"maximoCola":' "$resultados" && \
+       grep -q "COMPARACIÓN CON LA BASE" "$TEST_DIR/test26_carga2.log"; then
+        print_test_result "Banco de carga" "PASS" "400 solicitudes respondidas, resultados en JSON y comparación con la base"
+    else
+        print_test_result "Banco de carga" "FAIL" "Estados $estado1/$estado2; ver $TEST_DIR/test26_carga*.log"
+    fi
+
+    cleanup
+}
+
+test_admission_microbenchmarks() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 27: MICROBANCOS DEL NÚCLEO DE ADMISIÓN${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+
+    # Dos anchos de franja y dos tamaños; termina con error si el índice y el recorrido lineal difieren
+    local resultados="$TEST_DIR/test27_microbanco.csv"
+    ./microbanco -m 60,15 -N 100,1000 -q 2000 -o "$resultados" > "$TEST_DIR/test27_microbanco.log" 2>&1
+    local estado=$?
+
+    if [ $estado -eq 0 ] && [ "$(wc -l < "$resultados")" -eq 5 ] && \
+       grep -q "^13,60,13,2,100,69," "$resultados" && \
+       grep -q "^13,15,52,8,1000,692," "$resultados"; then
+        print_test_result "Microbancos del núcleo de admisión" "PASS" "ns/op de 4 combinaciones; el índice coincide con el recorrido lineal"
+    else
+        print_test_result "Microbancos del núcleo de admisión" "FAIL" "Estado $estado; ver $TEST_DIR/test27_microbanco.log"
+    fi
+
+    cleanup
+}
+
+test_vector_window_kernel() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 28: NÚCLEOS VECTORIZADOS DE VENTANAS${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+
+    # Cada núcleo que soporte el procesador debe dar los mismos resultados que el recorrido lineal
+    local probados=""
+    local fallidos=""
+    local nucleo
+    for nucleo in avx2 sse4 escalar; do
+        ./microbanco -k $nucleo -m 15,5 -N 100,1000 -q 2000 > "$TEST_DIR/test28_$nucleo.log" 2>&1
+        local estado=$?
+        if grep -q "no lo soporta" "$TEST_DIR/test28_$nucleo.log"; then
+            continue
+        fi
+        probados="$probados $nucleo"
+        if [ $estado -ne 0 ] || ! grep -q "núcleo $nucleo" "$TEST_DIR/test28_$nucleo.log"; then
+            fallidos="$fallidos $nucleo"
+        fi
+    done
+
+    if [ -z "$fallidos" ] && echo "$probados" | grep -q "escalar"; then
+        print_test_result "Núcleos vectorizados de ventanas" "PASS" "Coinciden con el recorrido lineal:$probados"
+    else
+        print_test_result "Núcleos vectorizados de ventanas" "FAIL" "Fallaron:$fallidos; ver $TEST_DIR/test28_*.log"
+    fi
+
+    cleanup
+}
+
+test_batch_placement() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 29: COLOCACIÓN DE LOTES COMPLETOS${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+
+    # Aforo 10 y reservas de 2 horas entre 7:00 y 13:00. En orden de llegada la
+    # familia pequeña de las 8:00 fragmenta el cupo: de las tres grandes solo
+    # una entra (reprogramada). Colocando de mayor a menor entran las tres.
+    cat > "$TEST_DIR/test29_solicitudes.csv" << EOF
+Familia_Pequena,8,2
+Familia_G1,7,10
+Familia_G2,9,10
+Familia_G3,11,10
+EOF
+
+    local modo
+    local resumen=""
+    for modo in llegada ordenado; do
+        local opcion=""
+        [ "$modo" = "ordenado" ] && opcion="-O"
+        ./controlador -i 7 -f 12 -s 10 -t 10 -p pipe_test29 $opcion > "$TEST_DIR/test29_controlador_$modo.log" 2>&1 &
+        local ctrl_pid=$!
+        sleep 2
+
+        ./agente -s AgenteLote -a "$TEST_DIR/test29_solicitudes.csv" -p pipe_test29 -l 4 > "$TEST_DIR/test29_agente_$modo.log" 2>&1 &
+        local agent_pid=$!
+        wait_for_process $agent_pid 30
+        kill -INT $ctrl_pid 2>/dev/null
+        wait_for_process $ctrl_pid 5
+
+        local aprobadas=$(grep -c "Reserva APROBADA" "$TEST_DIR/test29_agente_$modo.log")
+        local reprogramadas=$(grep -c "RESERVA REPROGRAMADA" "$TEST_DIR/test29_agente_$modo.log")
+        local negadas=$(grep -c "Reserva NEGADA" "$TEST_DIR/test29_agente_$modo.log")
+        resumen="$resumen $modo=$aprobadas/$reprogramadas/$negadas"
+    done
+
+    if echo "$resumen" | grep -q "llegada=1/1/2 ordenado=3/0/1"; then
+        print_test_result "Colocación de lotes completos" "PASS" "Aprobadas/reprogramadas/negadas:$resumen"
+    else
+        print_test_result "Colocación de lotes completos" "FAIL" "Aprobadas/reprogramadas/negadas:$resumen"
+    fi
+
+    cleanup
+}
+
+test_cancel_modify() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 30: CANCELACIÓN Y MODIFICACIÓN DE RESERVAS${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+    rm -f "$TEST_DIR"/test30.diario*
+
+    # Aforo 4 y reservas de 2 horas. Cada reserva de las 9:00 llena el parque:
+    # la de B solo entra porque A canceló, y la de C porque B se mudó a las 11:00.
+    cat > "$TEST_DIR/test30_solicitudes_1.csv" << EOF
+Familia_A,9,4
+Familia_A,cancelar
+Familia_B,9,4
+Familia_B,modificar,11,2
+Familia_C,9,4
+Familia_X,cancelar
+EOF
+    echo "Familia_D,9,4" > "$TEST_DIR/test30_solicitudes_2.csv"
+
+    ./controlador -i 7 -f 12 -s 10 -t 4 -p pipe_test30 -j "$TEST_DIR/test30.diario" > "$TEST_DIR/test30_controlador_1.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+
+    ./agente -s AgenteCambios -a "$TEST_DIR/test30_solicitudes_1.csv" -p pipe_test30 -r 0 > "$TEST_DIR/test30_agente_1.log" 2>&1 &
+    local agent_pid=$!
+    wait_for_process $agent_pid 10
+
+    # Caída abrupta: al reaplicar el diario las cancelaciones deben liberar su cupo
+    kill -9 $ctrl_pid 2>/dev/null
+    wait $ctrl_pid 2>/dev/null
+    rm -f pipe_test30
+
+    ./controlador -i 7 -f 12 -s 10 -t 4 -p pipe_test30 -j "$TEST_DIR/test30.diario" > "$TEST_DIR/test30_controlador_2.log" 2>&1 &
+    ctrl_pid=$!
+    sleep 1
+
+    # Las 9:00 siguen ocupadas por C, no por A ni por la B original
+    ./agente -s AgenteCambios2 -a "$TEST_DIR/test30_solicitudes_2.csv" -p pipe_test30 -r 0 > "$TEST_DIR/test30_agente_2.log" 2>&1 &
+    agent_pid=$!
+    wait_for_process $agent_pid 10
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+
+    local aprobadas=$(grep -c "RESERVA APROBADA" "$TEST_DIR/test30_agente_1.log")
+    local canceladas=$(grep -c "RESERVA CANCELADA" "$TEST_DIR/test30_agente_1.log")
+    local negadas=$(grep -c "RESERVA NEGADA" "$TEST_DIR/test30_agente_1.log")
+    local resumen="aprobadas=$aprobadas canceladas=$canceladas negadas=$negadas"
+
+    if [ "$resumen" = "aprobadas=4 canceladas=1 negadas=0" ] && \
+       grep -q "Familia_X no tiene una reserva aprobada" "$TEST_DIR/test30_agente_1.log" && \
+       grep -q "Hora asignada: 11:00" "$TEST_DIR/test30_agente_1.log" && \
+       grep -q "6 reservas recuperadas" "$TEST_DIR/test30_controlador_2.log" && \
+       ! grep -q "descartada" "$TEST_DIR/test30_controlador_2.log" && \
+       grep -q "RESERVA REPROGRAMADA" "$TEST_DIR/test30_agente_2.log"; then
+        print_test_result "Cancelación y modificación de reservas" "PASS" "$resumen; el cupo liberado se revendió y sobrevivió a kill -9"
+    else
+        print_test_result "Cancelación y modificación de reservas" "FAIL" "$resumen"
+    fi
+
+    rm -f "$TEST_DIR"/test30.diario*
+    cleanup
+}
+
+test_availability_query() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 31: CONSULTA DE DISPONIBILIDAD${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+
+    # Aforo 10 y reservas de 2 horas: la de A deja 6 plazas en las ventanas
+    # que pisan las 9:00 o las 10:00 y ninguna consulta cambia nada
+    cat > "$TEST_DIR/test31_solicitudes_1.csv" << EOF
+Familia_A,9,4
+Familia_B,consultar
+Familia_C,consultar,5
+EOF
+    echo "Familia_D,consultar" > "$TEST_DIR/test31_solicitudes_2.csv"
+
+    ./controlador -i 7 -f 12 -s 10 -t 10 -p pipe_test31 > "$TEST_DIR/test31_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+
+    ./agente -s AgenteConsulta -a "$TEST_DIR/test31_solicitudes_1.csv" -p pipe_test31 -r 0 > "$TEST_DIR/test31_agente_1.log" 2>&1 &
+    local agent_pid=$!
+    wait_for_process $agent_pid 10
+
+    # Con -W la respuesta la recibe el hilo lector de la ventana
+    ./agente -s AgenteConsulta2 -a "$TEST_DIR/test31_solicitudes_2.csv" -p pipe_test31 -r 0 -W 4 > "$TEST_DIR/test31_agente_2.log" 2>&1 &
+    agent_pid=$!
+    wait_for_process $agent_pid 10
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+
+    if grep -qE "│ +7:00 - +9:00 +10 plazas" "$TEST_DIR/test31_agente_1.log" && \
+       grep -qE "│ +9:00 - 11:00 +6 plazas" "$TEST_DIR/test31_agente_1.log" && \
+       grep -qE "│ 11:00 - 13:00 +10 plazas" "$TEST_DIR/test31_agente_1.log" && \
+       grep -q "CONSULTA NEGADA" "$TEST_DIR/test31_agente_1.log" && \
+       grep -qE "│ +9:00 - 11:00 +6 plazas" "$TEST_DIR/test31_agente_2.log" && \
+       grep -q "Consultas de disponibilidad: *3" "$TEST_DIR/test31_controlador.log" && \
+       grep -q "Total de solicitudes: *1" "$TEST_DIR/test31_controlador.log"; then
+        print_test_result "Consulta de disponibilidad" "PASS" "Plazas por hora sin reservar, también con -W"
+    else
+        print_test_result "Consulta de disponibilidad" "FAIL" "Plazas o totales inesperados"
+    fi
+
+    cleanup
+}
+
+test_busy_backoff() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 32: COLA LLENA Y REINTENTOS (RESP_OCUPADO)${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+
+    # Con una cola de 1 y 16 solicitudes en vuelo por agente, casi todas las
+    # ráfagas encuentran la cola llena: se rechazan y el agente las reenvía
+    for i in $(seq 1 40); do
+        echo "Familia_$i,$((8 + i % 10)),1"
+    done > "$TEST_DIR/test32_solicitudes.csv"
+
+    ./controlador -i 7 -f 19 -s 30 -t 100 -p pipe_test32 -q 1 > "$TEST_DIR/test32_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+
+    ./agente -s AgenteRafaga1 -a "$TEST_DIR/test32_solicitudes.csv" -p pipe_test32 -r 0 -W 16 > "$TEST_DIR/test32_agente_1.log" 2>&1 &
+    local agent1_pid=$!
+    ./agente -s AgenteRafaga2 -a "$TEST_DIR/test32_solicitudes.csv" -p pipe_test32 -r 0 -W 16 > "$TEST_DIR/test32_agente_2.log" 2>&1 &
+    local agent2_pid=$!
+    wait_for_process $agent1_pid 20
+    wait_for_process $agent2_pid 20
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+
+    # Cada rechazo se reenvió (ninguno agotó los reintentos) y todas se atendieron
+    local rechazadas=$(grep -oE "Rechazadas por cola llena: *[0-9]+" "$TEST_DIR/test32_controlador.log" | grep -oE "[0-9]+$")
+    local reintentos=$(cat "$TEST_DIR"/test32_agente_*.log | grep -oE "Reintentos por ocupación: *[0-9]+" | \
+                       grep -oE "[0-9]+$" | awk '{ s += $1 } END { print s + 0 }')
+
+    if [ -n "$rechazadas" ] && [ "$rechazadas" -gt 0 ] && [ "$rechazadas" -eq "$reintentos" ] && \
+       grep -q "Total de solicitudes: *80" "$TEST_DIR/test32_controlador.log" && \
+       grep -q "Solicitudes respondidas: *40" "$TEST_DIR/test32_agente_1.log" && \
+       grep -q "Solicitudes respondidas: *40" "$TEST_DIR/test32_agente_2.log" && \
+       ! grep -q "CONTROLADOR OCUPADO" "$TEST_DIR"/test32_agente_*.log; then
+        print_test_result "Cola llena y reintentos" "PASS" "$rechazadas rechazos con RESP_OCUPADO, todos reenviados y atendidos"
+    else
+        print_test_result "Cola llena y reintentos" "FAIL" "Rechazos ($rechazadas), reintentos ($reintentos) o totales inesperados"
+    fi
+
+    cleanup
+}
+
+test_invalid_group_size() {
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+    log "${BOLD}${BLUE}  TEST 33: GRUPOS DE CERO O MENOS PERSONAS${NC}"
+    log "${BOLD}${BLUE}══════════════════════════════════════════════════════════════${NC}"
+
+    cleanup
+
+    # Un grupo negativo no debe liberar cupo: después de llenar las 9:00 con
+    # Familia_E, Familia_F ya no cabe ahí aunque Familia_B pidiera -1
+    cat > "$TEST_DIR/test33_solicitudes_1.csv" << EOF
+Familia_A,9,0
+Familia_B,9,-1
+Familia_E,9,10
+Familia_F,9,1
+Familia_C,11,3
+Familia_C,modificar,11,0
+EOF
+    cat > "$TEST_DIR/test33_solicitudes_2.csv" << EOF
+Familia_D,9,-1
+Familia_G,9,1
+EOF
+
+    ./controlador -i 7 -f 12 -s 10 -t 10 -p pipe_test33 > "$TEST_DIR/test33_controlador.log" 2>&1 &
+    local ctrl_pid=$!
+    sleep 1
+
+    ./agente -s AgenteGrupos -a "$TEST_DIR/test33_solicitudes_1.csv" -p pipe_test33 -r 0 > "$TEST_DIR/test33_agente_1.log" 2>&1 &
+    local agent_pid=$!
+    wait_for_process $agent_pid 10
+
+    # En un lote la validación es la misma
+    ./agente -s AgenteGruposLote -a "$TEST_DIR/test33_solicitudes_2.csv" -p pipe_test33 -r 0 -l 4 > "$TEST_DIR/test33_agente_2.log" 2>&1 &
+    agent_pid=$!
+    wait_for_process $agent_pid 10
+    kill -INT $ctrl_pid 2>/dev/null
+    wait_for_process $ctrl_pid 5
+
+    if [ "$(grep -c "debe ser al menos 1" "$TEST_DIR/test33_agente_1.log")" -eq 3 ] && \
+       [ "$(grep -c "debe ser al menos 1" "$TEST_DIR/test33_agente_2.log")" -eq 1 ] && \
+       [ "$(grep -c "RESERVA REPROGRAMADA" "$TEST_DIR/test33_agente_1.log")" -eq 1 ] && \
+       grep -q "RESERVA REPROGRAMADA" "$TEST_DIR/test33_agente_2.log" && \
+       grep -q "Solicitudes negadas: *3" "$TEST_DIR/test33_controlador.log" && \
+       grep -q "Cambios negados: *1" "$TEST_DIR/test33_controlador.log"; then
+        print_test_result "Grupos de cero o menos personas" "PASS" "Negados sin tocar el cupo, también en lote y al modificar"
+    else
+        print_test_result "Grupos de cero o menos personas" "FAIL" "Un grupo vacío o negativo se admitió o cambió el cupo"
+    fi
+
+    cleanup
+}
+
 # Función para imprimir resumen final
 print_summary() {
     log ""
@@ -545,6 +1550,30 @@ main() {
         test_final_report
         test_out_of_range
         test_stress
+        test_batch_requests
+        test_pipelined_requests
+        test_load_pacing
+        test_short_slots
+        test_sharded_calendars
+        test_prompt_shutdown
+        test_max_speed_clock
+        test_concurrent_admission
+        test_shared_memory_transport
+        test_socket_transport
+        test_agent_registry
+        test_journal_recovery
+        test_csv_format
+        test_quiet_output
+        test_live_metrics
+        test_load_benchmark
+        test_admission_microbenchmarks
+        test_vector_window_kernel
+        test_batch_placement
+        test_cancel_modify
+        test_availability_query
+        test_busy_backoff
+        test_invalid_group_size
+        test_oversized_group
     else
         log "${RED}La compilación falló. Abortando pruebas.${NC}"
     fi
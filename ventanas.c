@@ -0,0 +1,176 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: ventanas.c
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Núcleo vectorizado de ventanas de capacidad
+ * -----------------------------------------------
+ * Descripción:
+ * Implementa los núcleos declarados en ventanas.h. Las
+ * versiones vectoriales calculan a la vez las ventanas
+ * de varias franjas de inicio consecutivas: el vector
+ * i..i+7 se compara con i+1..i+8, i+2..i+9 y así hasta
+ * cubrir el ancho, con cargas sin alinear. Se compilan
+ * con el atributo target de GCC, de modo que el resto
+ * del programa no exige AVX2 para ejecutarse; fuera de
+ * x86 solo existe la versión escalar.
+ *****************************************************/
+
+#include <string.h>
+#include "ventanas.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NUCLEOS_X86
+#include <immintrin.h>
+#endif
+
+/* Un juego de núcleos y su nombre */
+typedef struct {
+    const char *nombre;
+    void (*maximos)(const int *valores, int cantidad, int ancho, int *maximos);
+    uint64_t (*mascara)(const int *ventanas, int cantidad, int limite);
+    int (*soportado)();
+} NucleoVentanas;
+
+/* ============================================================================
+ * VERSIÓN ESCALAR
+ * ============================================================================ */
+static void maximosEscalar(const int *valores, int cantidad, int ancho, int *maximos) {
+    for (int i = 0; i < cantidad; i++) {
+        int maximo = valores[i];
+        for (int k = 1; k < ancho; k++) {
+            maximo = valores[i + k] > maximo ? valores[i + k] : maximo;
+        }
+        maximos[i] = maximo;
+    }
+}
+
+static uint64_t mascaraEscalar(const int *ventanas, int cantidad, int limite) {
+    uint64_t mascara = 0;
+
+    for (int i = 0; i < cantidad; i++) {
+        mascara |= (uint64_t)(ventanas[i] <= limite) << i;
+    }
+    return mascara;
+}
+
+static int siempre() {
+    return 1;
+}
+
+#ifdef NUCLEOS_X86
+/* ============================================================================
+ * VERSIÓN SSE4.1 (4 FRANJAS POR INSTRUCCIÓN)
+ * ============================================================================ */
+__attribute__((target("sse4.1")))
+static void maximosSSE4(const int *valores, int cantidad, int ancho, int *maximos) {
+    int i = 0;
+
+    for (; i + 4 <= cantidad; i += 4) {
+        __m128i maximo = _mm_loadu_si128((const __m128i *)(valores + i));
+        for (int k = 1; k < ancho; k++) {
+            maximo = _mm_max_epi32(maximo, _mm_loadu_si128((const __m128i *)(valores + i + k)));
+        }
+        _mm_storeu_si128((__m128i *)(maximos + i), maximo);
+    }
+    maximosEscalar(valores + i, cantidad - i, ancho, maximos + i);
+}
+
+__attribute__((target("sse4.1")))
+static uint64_t mascaraSSE4(const int *ventanas, int cantidad, int limite) {
+    __m128i tope = _mm_set1_epi32(limite);
+    uint64_t mascara = 0;
+    int i = 0;
+
+    for (; i + 4 <= cantidad; i += 4) {
+        __m128i excede = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(ventanas + i)), tope);
+        mascara |= (uint64_t)(~_mm_movemask_ps(_mm_castsi128_ps(excede)) & 0xF) << i;
+    }
+    if (i < cantidad) {
+        mascara |= mascaraEscalar(ventanas + i, cantidad - i, limite) << i;
+    }
+    return mascara;
+}
+
+static int soportaSSE4() {
+    return __builtin_cpu_supports("sse4.1");
+}
+
+/* ============================================================================
+ * VERSIÓN AVX2 (8 FRANJAS POR INSTRUCCIÓN)
+ * ============================================================================ */
+__attribute__((target("avx2")))
+static void maximosAVX2(const int *valores, int cantidad, int ancho, int *maximos) {
+    int i = 0;
+
+    for (; i + 8 <= cantidad; i += 8) {
+        __m256i maximo = _mm256_loadu_si256((const __m256i *)(valores + i));
+        for (int k = 1; k < ancho; k++) {
+            maximo = _mm256_max_epi32(maximo, _mm256_loadu_si256((const __m256i *)(valores + i + k)));
+        }
+        _mm256_storeu_si256((__m256i *)(maximos + i), maximo);
+    }
+    maximosEscalar(valores + i, cantidad - i, ancho, maximos + i);
+}
+
+__attribute__((target("avx2")))
+static uint64_t mascaraAVX2(const int *ventanas, int cantidad, int limite) {
+    __m256i tope = _mm256_set1_epi32(limite);
+    uint64_t mascara = 0;
+    int i = 0;
+
+    for (; i + 8 <= cantidad; i += 8) {
+        __m256i excede = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(ventanas + i)), tope);
+        mascara |= (uint64_t)(~_mm256_movemask_ps(_mm256_castsi256_ps(excede)) & 0xFF) << i;
+    }
+    if (i < cantidad) {
+        mascara |= mascaraEscalar(ventanas + i, cantidad - i, limite) << i;
+    }
+    return mascara;
+}
+
+static int soportaAVX2() {
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+/* ============================================================================
+ * ELECCIÓN DEL NÚCLEO
+ * ============================================================================ */
+/* En orden de preferencia */
+static const NucleoVentanas nucleos[] = {
+#ifdef NUCLEOS_X86
+    { "avx2", maximosAVX2, mascaraAVX2, soportaAVX2 },
+    { "sse4", maximosSSE4, mascaraSSE4, soportaSSE4 },
+#endif
+    { "escalar", maximosEscalar, mascaraEscalar, siempre }
+};
+
+static const NucleoVentanas *nucleo = &nucleos[sizeof(nucleos) / sizeof(nucleos[0]) - 1];
+static int nucleoElegido = 0;
+
+int elegirNucleoVentanas(const char *nombre) {
+    for (size_t i = 0; i < sizeof(nucleos) / sizeof(nucleos[0]); i++) {
+        if ((nombre == NULL || strcmp(nombre, nucleos[i].nombre) == 0) && nucleos[i].soportado()) {
+            nucleo = &nucleos[i];
+            nucleoElegido = 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *nucleoVentanas() {
+    return nucleoElegido ? nucleo->nombre : NULL;
+}
+
+void maximosVentana(const int *valores, int cantidad, int ancho, int *maximos) {
+    nucleo->maximos(valores, cantidad, ancho, maximos);
+}
+
+uint64_t mascaraVentanasLibres(const int *ventanas, int cantidad, int limite) {
+    return nucleo->mascara(ventanas, cantidad, limite);
+}
@@ -0,0 +1,53 @@
+/*****************************************************
+ * PONTIFICIA UNIVERSIDAD JAVERIANA
+ *
+ * Materia: Sistemas Operativos
+ * Docente: J. Corredor, PhD
+ * Autor: Juan David Garzon Ballen, Juan Sanchez Panqueva
+ * Programa: ventanas.h
+ * Fecha: 17 de noviembre de 2025
+ * Tema: Núcleo vectorizado de ventanas de capacidad
+ * -----------------------------------------------
+ * Descripción:
+ * Las dos operaciones que el índice de capacidad
+ * (reservas.h) repite sobre arreglos contiguos de
+ * enteros: la ocupación máxima de cada ventana de un
+ * ancho dado y la máscara de las ventanas cuyo valor
+ * no supera un límite (las franjas de inicio con cupo).
+ * Hay una versión con AVX2 (8 franjas por instrucción),
+ * otra con SSE4.1 (4) y una escalar; la mejor que
+ * soporte el procesador se elige al arrancar.
+ *****************************************************/
+
+#ifndef VENTANAS_H
+#define VENTANAS_H
+
+#include <stdint.h>
+
+/* ============================================================================
+ * CONSTANTES Y DEFINICIONES
+ * ============================================================================ */
+#define FRANJAS_MASCARA 64  // Franjas de inicio por máscara (bits de un uint64_t)
+
+/* ============================================================================
+ * PROTOTIPOS DE FUNCIONES
+ * ============================================================================ */
+/*
+ * maximos[i] = máximo de valores[i .. i + ancho - 1], para i en [0, cantidad).
+ * Se leen cantidad + ancho - 1 valores.
+ */
+void maximosVentana(const int *valores, int cantidad, int ancho, int *maximos);
+
+/* Bit i encendido si ventanas[i] <= limite, para i en [0, cantidad) (cantidad <= 64) */
+uint64_t mascaraVentanasLibres(const int *ventanas, int cantidad, int limite);
+
+/*
+ * Fija el núcleo por nombre ("avx2", "sse4" o "escalar") o, con NULL, el
+ * mejor que soporte el procesador. Devuelve 0 si no existe o no se soporta.
+ */
+int elegirNucleoVentanas(const char *nombre);
+
+/* Nombre del núcleo en uso; NULL si todavía no se eligió ninguno */
+const char *nucleoVentanas();
+
+#endif